@@ -0,0 +1,213 @@
+// Compares FramePool with allocating every frame (make_shared plus a payload vector, as the delegate used to) on
+// a live-pipeline workload: a main and an LRV video stream with per-frame size jitter around their GOP pattern,
+// plus AAC audio. Frames are held by a replay-style window on the ingest thread and released by a second thread
+// as a host recorder would, so frees happen on both. Reports the ingest cost per frame (acquire, copy, hand-off)
+// once the window is full, and the pool's high-water mark per size class. bin/framePoolBenchTcmalloc (make
+// bench-tcmalloc) runs the same workload with tcmalloc_minimal linked in.
+//
+// usage: framePoolBench [seconds] [holdSeconds]
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/Stream/framePool.h"
+
+#ifndef BENCH_ALLOCATOR
+#define BENCH_ALLOCATOR "default allocator"
+#endif
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int FPS = 30;
+	constexpr int GOP = 30;
+	constexpr double IDR_WEIGHT = 8.0;
+	constexpr double LRV_SHARE = 0.125;	 // LRV bitrate relative to the main stream
+	constexpr double AUDIO_FPS = 48000.0 / 1024.0;
+	constexpr size_t AUDIO_FRAME_BYTES = 380;  // 128 kbit/s AAC plus the ADTS header
+	constexpr double SIZE_JITTER = 0.5;
+	constexpr auto BATCH_INTERVAL = std::chrono::milliseconds(5);
+
+	struct Ingest
+	{
+		size_t size;
+		FrameKind kind;
+	};
+
+	// One second of ingest in callback order: both video streams and audio interleaved by time.
+	std::vector<Ingest> secondOfIngest(double bitsPerSecond, std::mt19937& random)
+	{
+		std::uniform_real_distribution<double> jitter(1.0 - SIZE_JITTER, 1.0 + SIZE_JITTER);
+		std::vector<Ingest> ingest;
+		double audioTime = 0.0;
+		for (int i = 0; i < FPS; i++)
+		{
+			const double frameTime = static_cast<double>(i) / FPS;
+			for (; audioTime < frameTime; audioTime += 1.0 / AUDIO_FPS)
+				ingest.push_back({AUDIO_FRAME_BYTES, FrameKind::Audio});
+			for (double share : {1.0, LRV_SHARE})
+			{
+				const double unit = bitsPerSecond * share / 8.0 / FPS * GOP / (IDR_WEIGHT + (GOP - 1));
+				const double weight = i % GOP == 0 ? IDR_WEIGHT : jitter(random);
+				ingest.push_back({static_cast<size_t>(unit * weight), FrameKind::Video});
+			}
+		}
+		return ingest;
+	}
+
+	// Releases the frames handed to it on its own thread, in batches like the host recorder's writer.
+	class Releaser
+	{
+	public:
+		Releaser(): mThread([this] { loop(); }) {}
+
+		~Releaser()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopping = true;
+			}
+			mCondition.notify_one();
+			mThread.join();
+		}
+
+		void push(FramePtr frame)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mFrames.push_back(std::move(frame));
+		}
+
+	private:
+		void loop()
+		{
+			std::vector<FramePtr> batch;
+			std::unique_lock<std::mutex> lock(mMutex);
+			while (true)
+			{
+				mCondition.wait_for(lock, BATCH_INTERVAL, [this] { return mStopping; });
+				if (mStopping && mFrames.empty())
+					break;
+				batch.assign(mFrames.begin(), mFrames.end());
+				mFrames.clear();
+				lock.unlock();
+				batch.clear();
+				lock.lock();
+			}
+		}
+
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		std::deque<FramePtr> mFrames;
+		bool mStopping = false;
+		std::thread mThread;
+	};
+
+	double percentile(std::vector<double>& values, double p)
+	{
+		if (values.empty())
+			return 0.0;
+		const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1)));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+
+	void run(const char* name, double bitsPerSecond, double seconds, double holdSeconds, FramePool* pool)
+	{
+		std::mt19937 random(1);
+		std::vector<Ingest> ingest;
+		for (int second = 0; second < static_cast<int>(seconds); second++)
+		{
+			auto part = secondOfIngest(bitsPerSecond, random);
+			ingest.insert(ingest.end(), part.begin(), part.end());
+		}
+		size_t largest = 0;
+		for (const auto& entry : ingest)
+			largest = std::max(largest, entry.size);
+		std::vector<uint8_t> source(largest, 0x5a);
+
+		const size_t holdFrames = static_cast<size_t>(holdSeconds * ingest.size() / seconds);
+		// Only the steady state counts, once the window is full and the pool has grown to its high-water mark.
+		const size_t warmup = std::min(2 * holdFrames, ingest.size() / 2);
+		std::deque<FramePtr> window;
+		std::vector<double> frameNs;
+		frameNs.reserve(ingest.size());
+		double bytes = 0.0;
+		{
+			Releaser releaser;
+			const auto start = Clock::now();
+			for (size_t i = 0; i < ingest.size(); i++)
+			{
+				const auto before = Clock::now();
+				auto frame = pool != nullptr ? pool->acquire(ingest[i].size) : std::make_shared<EncodedFrame>();
+				frame->kind = ingest[i].kind;
+				frame->timestamp = static_cast<int64_t>(i);
+				frame->payload.assign(source.data(), source.data() + ingest[i].size);
+				FramePtr shared = std::move(frame);
+				releaser.push(shared);
+				window.push_back(std::move(shared));
+				if (window.size() > holdFrames)
+					window.pop_front();
+				if (i >= warmup)
+					frameNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+				bytes += static_cast<double>(ingest[i].size);
+			}
+			const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			std::printf(
+				"%-30s frames=%zu steady-state ns/frame p50=%.0f p99=%.0f max=%.0f  overall throughput=%.0f MB/s\n",
+				name,
+				ingest.size(),
+				percentile(frameNs, 0.50),
+				percentile(frameNs, 0.99),
+				*std::max_element(frameNs.begin(), frameNs.end()),
+				bytes / (1024.0 * 1024.0) / elapsed
+			);
+		}
+		if (pool == nullptr)
+			return;
+
+		const auto stats = pool->getStats();
+		std::printf(
+			"%-30s reserved=%.1fMB exhausted=%llu oversize=%llu high-water frames per class:",
+			"",
+			stats.reservedBytes / (1024.0 * 1024.0),
+			static_cast<unsigned long long>(stats.exhausted),
+			static_cast<unsigned long long>(stats.oversize)
+		);
+		for (const auto& sizeClass : stats.classes)
+		{
+			if (sizeClass.frames != 0)
+				std::printf(" %zuK:%zu", sizeClass.frameBytes >> 10, sizeClass.frames);
+		}
+		std::printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double seconds = argc > 1 ? std::atof(argv[1]) : 120.0;
+	const double holdSeconds = argc > 2 ? std::atof(argv[2]) : 30.0;
+
+	std::printf("allocator: %s, %.0f s of ingest, %.0f s held\n", BENCH_ALLOCATOR, seconds, holdSeconds);
+	for (double bitsPerSecond : {10e6, 50e6})
+	{
+		char name[64];
+		std::snprintf(name, sizeof(name), "%.0f Mbit/s allocate per frame", bitsPerSecond / 1e6);
+		run(name, bitsPerSecond, seconds, holdSeconds, nullptr);
+		FramePool pool(FramePool::Config{});
+		std::snprintf(name, sizeof(name), "%.0f Mbit/s frame pool", bitsPerSecond / 1e6);
+		run(name, bitsPerSecond, seconds, holdSeconds, &pool);
+	}
+	return 0;
+}
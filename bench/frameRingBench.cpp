@@ -0,0 +1,126 @@
+// Pushes synthetic H.264-like frame sequences through LeticoStreamDelegate and reports how long the SDK callback
+// thread is held per frame, plus ring overflow and drop counters.
+//
+// usage: frameRingBench [seconds] [consumerDelayUs]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/Stream/leticoStreamDelegate.h"
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int FPS = 30;
+	constexpr int GOP = 30;
+	constexpr double IDR_WEIGHT = 8.0;
+
+	class CountingSink : public StreamSink
+	{
+	public:
+		explicit CountingSink(int delayUs): mDelayUs(delayUs) {}
+
+		void onVideoFrame(const FramePtr& frame) override
+		{
+			mFrames.fetch_add(1, std::memory_order_relaxed);
+			mBytes.fetch_add(frame->size(), std::memory_order_relaxed);
+			if (mDelayUs > 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(mDelayUs));
+		}
+
+		std::atomic<uint64_t> mFrames{0};
+		std::atomic<uint64_t> mBytes{0};
+
+	private:
+		int mDelayUs;
+	};
+
+	// Frame sizes for one GOP so the average matches the requested bitrate.
+	std::vector<size_t> gopFrameSizes(double bitsPerSecond)
+	{
+		const double bytesPerGop = bitsPerSecond / 8.0 * GOP / FPS;
+		const double unit = bytesPerGop / (IDR_WEIGHT + (GOP - 1));
+		std::vector<size_t> sizes(GOP, static_cast<size_t>(unit));
+		sizes[0] = static_cast<size_t>(unit * IDR_WEIGHT);
+		return sizes;
+	}
+
+	double percentile(std::vector<double>& values, double p)
+	{
+		if (values.empty())
+			return 0.0;
+		const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1)));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+
+	void run(const char* name, double bitsPerSecond, double seconds, bool paced, int consumerDelayUs)
+	{
+		auto delegate = std::make_shared<LeticoStreamDelegate>();
+		auto sink = std::make_shared<CountingSink>(consumerDelayUs);
+		delegate->addSink(sink);
+
+		const auto sizes = gopFrameSizes(bitsPerSecond);
+		std::vector<uint8_t> source(*std::max_element(sizes.begin(), sizes.end()), 0x5a);
+		const int frameCount = static_cast<int>(seconds * FPS);
+		std::vector<double> callbackUs;
+		callbackUs.reserve(frameCount);
+
+		const auto start = Clock::now();
+		for (int i = 0; i < frameCount; i++)
+		{
+			if (paced)
+				std::this_thread::sleep_until(start + std::chrono::microseconds(1000000LL * i / FPS));
+			const auto before = Clock::now();
+			delegate->OnVideoData(source.data(), sizes[i % GOP], i * 1000LL / FPS, 0, 0);
+			const auto after = Clock::now();
+			callbackUs.push_back(std::chrono::duration<double, std::micro>(after - before).count());
+		}
+		const double producerSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		const auto stats = delegate->getStats().video;
+		delegate.reset();  // joins the consumer after it drained the ring
+
+		const double pushedMB = stats.pushedBytes / (1024.0 * 1024.0);
+		std::printf(
+			"%-22s frames=%d delivered=%llu dropped=%llu overflows=%llu oversized=%llu highWater=%.1fMB/%.0fMB\n",
+			name,
+			frameCount,
+			static_cast<unsigned long long>(sink->mFrames.load()),
+			static_cast<unsigned long long>(stats.droppedRecords),
+			static_cast<unsigned long long>(stats.overflows),
+			static_cast<unsigned long long>(stats.oversized),
+			stats.highWaterBytes / (1024.0 * 1024.0),
+			stats.capacityBytes / (1024.0 * 1024.0)
+		);
+		std::printf(
+			"%-22s callback us p50=%.2f p99=%.2f max=%.2f  producer throughput=%.1f MB/s\n",
+			"",
+			percentile(callbackUs, 0.50),
+			percentile(callbackUs, 0.99),
+			*std::max_element(callbackUs.begin(), callbackUs.end()),
+			pushedMB / producerSeconds
+		);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double seconds = argc > 1 ? std::atof(argv[1]) : 5.0;
+	const int consumerDelayUs = argc > 2 ? std::atoi(argv[2]) : 0;
+
+	run("10 Mbit/s real-time", 10e6, seconds, true, consumerDelayUs);
+	run("50 Mbit/s real-time", 50e6, seconds, true, consumerDelayUs);
+	run("10 Mbit/s max-speed", 10e6, seconds * 20, false, consumerDelayUs);
+	run("50 Mbit/s max-speed", 50e6, seconds * 20, false, consumerDelayUs);
+	return 0;
+}
@@ -0,0 +1,150 @@
+// Writes synthetic 1 kHz IMU data (slow motion plus sensor noise) through a GyroArchiveWriter, then reads it back
+// and reports the compression ratio against raw GyroData, the worst quantization error, full-decode throughput
+// and the latency of a random one-second range read.
+//
+// usage: gyroArchiveBench [directory] [seconds] [chunkSamples]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/Stream/gyroArchive.h"
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int RATE_HZ = 1000;
+	constexpr size_t BATCH = 20;  // samples per OnGyroData callback
+	constexpr int RANGE_READS = 200;
+
+	std::vector<ins_camera::GyroData> synthesize(double seconds)
+	{
+		std::mt19937 random(42);
+		std::normal_distribution<double> accelNoise(0.0, 0.002);
+		std::normal_distribution<double> gyroNoise(0.0, 0.0005);
+		std::vector<ins_camera::GyroData> samples(static_cast<size_t>(seconds * RATE_HZ));
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			const double t = static_cast<double>(i) / RATE_HZ;
+			auto& s = samples[i];
+			s.timestamp = 1000 + static_cast<int64_t>(i);
+			s.ax = 0.05 * std::sin(0.7 * t) + accelNoise(random);
+			s.ay = 0.03 * std::cos(1.3 * t) + accelNoise(random);
+			s.az = 1.0 + 0.02 * std::sin(0.4 * t) + accelNoise(random);
+			s.gx = 0.2 * std::sin(0.9 * t) + gyroNoise(random);
+			s.gy = 0.1 * std::sin(2.1 * t) + gyroNoise(random);
+			s.gz = 0.3 * std::cos(0.5 * t) + gyroNoise(random);
+		}
+		return samples;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const std::string directory = argc > 1 ? argv[1] : "/tmp";
+	const double seconds = argc > 2 ? std::atof(argv[2]) : 600.0;
+	const uint32_t chunkSamples = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 1000;
+
+	const auto samples = synthesize(seconds);
+	GyroArchiveWriter::Config config;
+	config.directory = directory;
+	config.filePrefix = "gyroArchiveBench";
+	config.chunkSamples = chunkSamples;
+	config.rollSeconds = seconds + 1.0;
+	GyroArchiveWriter writer(config);
+	writer.start();
+	const auto encodeStart = Clock::now();
+	for (size_t i = 0; i < samples.size(); i += BATCH)
+		writer.onGyroData(samples.data() + i, std::min(BATCH, samples.size() - i));
+	const auto files = writer.stop();
+	const double encodeSeconds = std::chrono::duration<double>(Clock::now() - encodeStart).count();
+	const auto stats = writer.getStats();
+	if (files.size() != 1 || stats.writeErrors)
+	{
+		std::printf("unexpected: %zu files, %lu write errors\n", files.size(), stats.writeErrors);
+		return 1;
+	}
+
+	const double raw = static_cast<double>(samples.size() * sizeof(ins_camera::GyroData));
+	std::printf(
+		"%zu samples, %lu chunks: %.1f KB vs %.1f KB raw, %.2f bytes/sample, ratio %.1fx\n",
+		samples.size(),
+		stats.chunks,
+		stats.bytes / 1e3,
+		raw / 1e3,
+		static_cast<double>(stats.bytes) / samples.size(),
+		raw / stats.bytes
+	);
+	std::printf("encode: %.1f M samples/s\n", samples.size() / encodeSeconds / 1e6);
+
+	GyroArchiveReader reader;
+	if (!reader.open(files[0]))
+	{
+		std::printf("cannot open %s\n", files[0].c_str());
+		return 1;
+	}
+	std::vector<ins_camera::GyroData> decoded;
+	decoded.reserve(samples.size());
+	const auto decodeStart = Clock::now();
+	const bool ok = reader.read(samples.front().timestamp, samples.back().timestamp, decoded);
+	const double decodeSeconds = std::chrono::duration<double>(Clock::now() - decodeStart).count();
+	if (!ok || decoded.size() != samples.size())
+	{
+		std::printf("decode failed: %zu of %zu samples\n", decoded.size(), samples.size());
+		return 1;
+	}
+	double accelError = 0.0;
+	double gyroError = 0.0;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const auto& a = samples[i];
+		const auto& b = decoded[i];
+		if (a.timestamp != b.timestamp)
+		{
+			std::printf("timestamp mismatch at %zu\n", i);
+			return 1;
+		}
+		accelError = std::max({accelError, std::abs(a.ax - b.ax), std::abs(a.ay - b.ay), std::abs(a.az - b.az)});
+		gyroError = std::max({gyroError, std::abs(a.gx - b.gx), std::abs(a.gy - b.gy), std::abs(a.gz - b.gz)});
+	}
+	std::printf(
+		"decode: %.1f M samples/s, max error accel %.2g (step %.0g) gyro %.2g (step %.0g)\n",
+		samples.size() / decodeSeconds / 1e6,
+		accelError,
+		config.accelStep,
+		gyroError,
+		config.gyroStep
+	);
+
+	std::mt19937 random(7);
+	std::uniform_int_distribution<int64_t> pick(samples.front().timestamp, samples.back().timestamp - RATE_HZ);
+	std::vector<ins_camera::GyroData> range;
+	double worstMs = 0.0;
+	const auto rangeStart = Clock::now();
+	for (int i = 0; i < RANGE_READS; i++)
+	{
+		const int64_t from = pick(random);
+		range.clear();
+		const auto start = Clock::now();
+		reader.read(from, from + RATE_HZ - 1, range);
+		worstMs = std::max(worstMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		if (range.size() != RATE_HZ)
+		{
+			std::printf("range read returned %zu samples\n", range.size());
+			return 1;
+		}
+	}
+	const double averageMs = std::chrono::duration<double, std::milli>(Clock::now() - rangeStart).count() / RANGE_READS;
+	std::printf("1 s range read: average %.3f ms, worst %.3f ms\n", averageMs, worstMs);
+
+	std::filesystem::remove(files[0]);
+	return 0;
+}
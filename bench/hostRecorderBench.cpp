@@ -0,0 +1,140 @@
+// Feeds several HostRecorders at once with synthetic frames at a fixed bitrate (as the delegate thread would) and
+// reports sustained disk throughput, queue drops and the slowest block write per recorder.
+//
+// usage: hostRecorderBench [directory] [cameras] [mbitPerSecond] [seconds] [ts|mp4]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/Stream/hostRecorder.h"
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int FPS = 30;
+	constexpr int GOP = 30;
+	constexpr double IDR_WEIGHT = 8.0;
+
+	// 1920x1080 High profile SPS and a PPS, put in front of every IDR so MP4 output has an init segment.
+	const uint8_t PARAMETER_SETS[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x28, 0xac, 0xd9, 0x40, 0x78, 0x02, 0x27,
+									  0xe5, 0xc0, 0x44, 0x00, 0x00, 0x03, 0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xf0, 0x3c,
+									  0x60, 0xc6, 0x58, 0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+	FramePtr makeFrame(int64_t timestamp, size_t size, bool keyframe)
+	{
+		auto frame = std::make_shared<EncodedFrame>();
+		frame->timestamp = timestamp;
+		const uint8_t header[] = {0x00, 0x00, 0x00, 0x01, static_cast<uint8_t>(keyframe ? 0x65 : 0x41)};
+		const size_t prefix = keyframe ? sizeof(PARAMETER_SETS) : 0;
+		frame->payload.assign(std::max(size, prefix + sizeof(header)), 0x5a);
+		if (keyframe)
+		{
+			std::copy(std::begin(PARAMETER_SETS), std::end(PARAMETER_SETS), frame->payload.begin());
+		}
+		std::copy(std::begin(header), std::end(header), frame->payload.begin() + prefix);
+		return frame;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const std::string directory = argc > 1 ? argv[1] : "/tmp";
+	const int cameras = argc > 2 ? std::atoi(argv[2]) : 4;
+	const double mbit = argc > 3 ? std::atof(argv[3]) : 120.0;
+	const double seconds = argc > 4 ? std::atof(argv[4]) : 10.0;
+	const bool mp4 = argc > 5 && std::string(argv[5]) == "mp4";
+
+	// An IDR is IDR_WEIGHT times the size of a P frame; together one GOP carries one second of the target bitrate.
+	const double bytesPerGop = mbit * 1e6 / 8.0 * GOP / FPS;
+	const double unit = bytesPerGop / (IDR_WEIGHT + (GOP - 1));
+
+	std::vector<std::shared_ptr<GopCache>> sources;
+	std::vector<std::shared_ptr<CmafFragmenter>> fragmenters;
+	std::vector<std::unique_ptr<HostRecorder>> recorders;
+	for (int i = 0; i < cameras; i++)
+	{
+		auto source = std::make_shared<GopCache>(GopCache::Config{});
+		source->start(ins_camera::VideoEncodeType::H264);
+		std::shared_ptr<CmafFragmenter> fragmenter;
+		if (mp4)
+		{
+			fragmenter = std::make_shared<CmafFragmenter>(CmafFragmenter::Config{});
+			fragmenter->start(ins_camera::VideoEncodeType::H264);
+			source->subscribe(fragmenter);
+		}
+		HostRecorder::Config config;
+		config.directory = directory;
+		config.filePrefix = "bench" + std::to_string(i);
+		config.format = mp4 ? HostRecorder::Format::Mp4 : HostRecorder::Format::Ts;
+		config.rollSeconds = 5.0;
+		config.preallocateBytes = static_cast<size_t>(mbit * 1e6 / 8.0 * config.rollSeconds * 1.1);
+		recorders.push_back(std::make_unique<HostRecorder>(config, source, fragmenter));
+		recorders.back()->start(ins_camera::VideoEncodeType::H264);
+		sources.push_back(std::move(source));
+		fragmenters.push_back(std::move(fragmenter));
+	}
+
+	std::printf(
+		"%d cameras x %.0f Mbit/s for %.0f s into %s (%s)\n", cameras, mbit, seconds, directory.c_str(), mp4 ? "mp4" : "ts"
+	);
+	const int frameCount = static_cast<int>(seconds * FPS);
+	const auto start = Clock::now();
+	std::vector<std::thread> producers;
+	for (int c = 0; c < cameras; c++)
+	{
+		producers.emplace_back(
+			[&, c]
+			{
+				for (int i = 0; i < frameCount; i++)
+				{
+					const bool keyframe = i % GOP == 0;
+					const size_t size = static_cast<size_t>(keyframe ? unit * IDR_WEIGHT : unit);
+					sources[c]->onVideoFrame(makeFrame(1000 + i * 1000 / FPS, size, keyframe));
+					std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>((i + 1) * 1e6 / FPS)));
+				}
+			}
+		);
+	}
+	for (auto& producer : producers)
+		producer.join();
+
+	bool ok = true;
+	uint64_t totalBytes = 0;
+	for (int c = 0; c < cameras; c++)
+	{
+		if (fragmenters[c])
+		{
+			fragmenters[c]->stop();
+		}
+		auto files = recorders[c]->stop();
+		const auto stats = recorders[c]->getStats();
+		const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		totalBytes += stats.bytesWritten;
+		std::printf(
+			"camera %d: %4zu files %8.1f MB %7.1f Mbit/s frames %6lu dropped %5lu drop-events %3lu max-write %6.2f ms errors %lu\n",
+			c,
+			files.size(),
+			stats.bytesWritten / 1e6,
+			stats.bytesWritten * 8 / 1e6 / elapsed,
+			stats.framesWritten,
+			stats.queue.droppedFrames,
+			stats.queue.dropEvents,
+			stats.maxWriteMs,
+			stats.writeErrors
+		);
+		ok &= stats.queue.droppedFrames == 0 && stats.writeErrors == 0;
+		for (const auto& file : files)
+			std::filesystem::remove(file);
+	}
+	std::printf("total %.1f MB, %s\n", totalBytes / 1e6, ok ? "no drops" : "DROPS OR ERRORS");
+	return ok ? 0 : 1;
+}
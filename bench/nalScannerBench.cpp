@@ -0,0 +1,307 @@
+// Measures Annex-B start code search throughput of every NalParser kernel (scalar, SSE2, AVX2) against a naive
+// byte-by-byte loop, plus the per-frame cost of split(), containsKeyframe() and parseSlice(), on a recorded stream:
+// a raw Annex-B file (e.g. saved from /api/v1/stream/raw) or a callback capture (.ltcap). Without a file it
+// synthesizes 4K (3840x1920) 30 fps H.264 at 40 Mbit/s with four slices per picture and emulation prevention
+// applied, which is what the camera sends in its highest live mode.
+//
+// usage: nalScannerBench [stream.h264|stream.h265|capture.ltcap] [passes] [h264|h265]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/Stream/callbackReplayer.h"
+#include "../src/Stream/nalParser.h"
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int FPS = 30;
+	constexpr int GOP = 30;
+	constexpr double IDR_WEIGHT = 8.0;
+	constexpr int SLICES = 4;
+	constexpr double SYNTHETIC_MBIT = 40.0;
+	constexpr double SYNTHETIC_SECONDS = 10.0;
+	constexpr double TARGET_BYTES = 4e9;  // scanned per kernel when no pass count is given
+
+	using Frames = std::vector<std::vector<uint8_t>>;
+
+	// Appends `payload` as RBSP: inserts emulation prevention bytes so no start code appears inside a NAL unit.
+	void appendEscaped(std::vector<uint8_t>& out, const std::vector<uint8_t>& payload)
+	{
+		int zeros = 0;
+		for (uint8_t byte : payload)
+		{
+			if (zeros >= 2 && byte <= 3)
+			{
+				out.push_back(0x03);
+				zeros = 0;
+			}
+			out.push_back(byte);
+			zeros = byte == 0 ? zeros + 1 : 0;
+		}
+	}
+
+	Frames synthesize()
+	{
+		// 3840x1920 High profile SPS and a PPS, put in front of every IDR.
+		const uint8_t parameterSets[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x33, 0xac, 0xb4, 0x03, 0xc0,
+										 0x07, 0x89, 0xf9, 0x70, 0x11, 0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xe3, 0xcb};
+		const double bytesPerGop = SYNTHETIC_MBIT * 1e6 / 8.0 * GOP / FPS;
+		const double unit = bytesPerGop / (IDR_WEIGHT + (GOP - 1));
+		std::mt19937 random(7);
+		// Coded slice data is close to uniformly random, zero runs included.
+		std::uniform_int_distribution<int> byteValue(0, 255);
+		std::vector<uint8_t> payload;
+
+		Frames frames(static_cast<size_t>(SYNTHETIC_SECONDS * FPS));
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			const bool keyframe = i % GOP == 0;
+			auto& frame = frames[i];
+			const uint8_t aud[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xf0};
+			frame.assign(std::begin(aud), std::end(aud));
+			if (keyframe)
+				frame.insert(frame.end(), std::begin(parameterSets), std::end(parameterSets));
+			const size_t sliceBytes = static_cast<size_t>((keyframe ? unit * IDR_WEIGHT : unit) / SLICES);
+			for (int slice = 0; slice < SLICES; slice++)
+			{
+				const uint8_t startCode[] = {0x00, 0x00, 0x01};
+				frame.insert(frame.end(), std::begin(startCode), std::end(startCode));
+				frame.push_back(keyframe ? 0x65 : 0x41);
+				payload.resize(sliceBytes);
+				for (auto& byte : payload)
+					byte = static_cast<uint8_t>(byteValue(random));
+				// first_mb_in_slice 0 (first slice) or 1 (the others), then slice_type 7 (I) or 5 (P).
+				if (slice == 0)
+					payload[0] = keyframe ? 0x88 : 0x9a;
+				else
+					payload[0] = keyframe ? 0x42 : 0x46;
+				if (slice != 0 && keyframe)
+					payload[1] = static_cast<uint8_t>(0x20 | (payload[1] & 0x1f));  // last two bits of slice_type 7
+				appendEscaped(frame, payload);
+			}
+		}
+		return frames;
+	}
+
+	// Cuts a raw Annex-B stream into access units at the first slice of every picture.
+	Frames splitAccessUnits(const std::vector<uint8_t>& stream, ins_camera::VideoEncodeType codec)
+	{
+		Frames frames;
+		NalScanner scanner(stream.data(), stream.size(), codec);
+		NalUnit nal;
+		const uint8_t* frameStart = stream.data();
+		const uint8_t* nonVcl = nullptr;  // first non-slice unit since the last slice
+		bool haveSlice = false;
+		while (scanner.next(nal))
+		{
+			SliceInfo slice;
+			if (!NalParser::parseSlice(codec, nal, slice))
+			{
+				if (haveSlice && nonVcl == nullptr)
+					nonVcl = nal.data - 3;
+				continue;
+			}
+			if (slice.firstInPicture && haveSlice)
+			{
+				// The new access unit starts with the AUD/parameter sets in front of its first slice, if any.
+				const uint8_t* start = nonVcl != nullptr ? nonVcl : nal.data - 3;
+				frames.emplace_back(frameStart, start);
+				frameStart = start;
+			}
+			nonVcl = nullptr;
+			haveSlice = true;
+		}
+		frames.emplace_back(frameStart, stream.data() + stream.size());
+		return frames;
+	}
+
+	class CollectingDelegate : public ins_camera::StreamDelegate
+	{
+	public:
+		void OnAudioData(const uint8_t*, size_t, int64_t) override {}
+		void OnVideoData(const uint8_t* data, size_t size, int64_t, uint8_t, int streamIndex) override
+		{
+			if (streamIndex == 0)
+				frames.emplace_back(data, data + size);
+		}
+		void OnGyroData(const std::vector<ins_camera::GyroData>&) override {}
+		void OnExposureData(const ins_camera::ExposureData&) override {}
+
+		Frames frames;
+	};
+
+	bool load(const std::string& path, ins_camera::VideoEncodeType codec, Frames& frames)
+	{
+		if (path.size() > 6 && path.compare(path.size() - 6, 6, ".ltcap") == 0)
+		{
+			CollectingDelegate delegate;
+			CallbackReplayer::Options options;
+			options.speed = 0.0;
+			CallbackReplayer::Result result;
+			if (!CallbackReplayer::replay(path, delegate, options, result))
+				return false;
+			frames = std::move(delegate.frames);
+			return !frames.empty();
+		}
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::vector<uint8_t> stream((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		frames = splitAccessUnits(stream, codec);
+		return !stream.empty();
+	}
+
+	// The loop every consumer used to carry: compare three bytes at every offset.
+	const uint8_t* findNaive(const uint8_t* begin, const uint8_t* end)
+	{
+		for (const uint8_t* p = begin; end - p >= 3; p++)
+		{
+			if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+				return p;
+		}
+		return end;
+	}
+
+	template <typename Find>
+	void runScan(const char* name, const Frames& frames, size_t totalBytes, int passes, Find find)
+	{
+		uint64_t startCodes = 0;
+		const auto begin = Clock::now();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (const auto& frame : frames)
+			{
+				const uint8_t* end = frame.data() + frame.size();
+				for (const uint8_t* p = find(frame.data(), end); p != end; p = find(p + 3, end))
+					startCodes++;
+			}
+		}
+		const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+		std::printf(
+			"%-8s %7.2f GB/s  %10lu start codes  (%.3f s)\n",
+			name,
+			static_cast<double>(totalBytes) * passes / 1e9 / seconds,
+			startCodes,
+			seconds
+		);
+	}
+
+	template <typename Body>
+	double nsPerFrame(const Frames& frames, int passes, Body body)
+	{
+		const auto begin = Clock::now();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (const auto& frame : frames)
+				body(frame);
+		}
+		const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+		return seconds * 1e9 / static_cast<double>(frames.size() * passes);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const std::string path = argc > 1 ? argv[1] : "";
+	const std::string codecName = argc > 3 ? argv[3] : "";
+	const bool h265 = codecName == "h265" ||
+		(path.size() > 5 && (path.compare(path.size() - 5, 5, ".h265") == 0 || path.compare(path.size() - 5, 5, ".hevc") == 0));
+	const auto codec = h265 ? ins_camera::VideoEncodeType::H265 : ins_camera::VideoEncodeType::H264;
+
+	Frames frames;
+	if (path.empty())
+	{
+		frames = synthesize();
+		std::printf("synthetic 3840x1920 H.264, %.0f Mbit/s, %d slices per picture\n", SYNTHETIC_MBIT, SLICES);
+	}
+	else if (!load(path, codec, frames))
+	{
+		std::fprintf(stderr, "cannot read %s\n", path.c_str());
+		return 1;
+	}
+
+	size_t totalBytes = 0;
+	for (const auto& frame : frames)
+		totalBytes += frame.size();
+	const int defaultPasses = std::max(static_cast<int>(TARGET_BYTES / static_cast<double>(totalBytes)), 1);
+	const int passes = argc > 2 ? std::max(std::atoi(argv[2]), 1) : defaultPasses;
+	std::printf(
+		"%zu frames, %.1f MB, %.1f KB/frame, %d passes, dispatch picks %s\n\n",
+		frames.size(),
+		totalBytes / 1e6,
+		totalBytes / 1e3 / static_cast<double>(frames.size()),
+		passes,
+		NalParser::kernelName(NalParser::bestKernel())
+	);
+
+	runScan("naive", frames, totalBytes, passes, findNaive);
+	for (auto kernel : {NalParser::ScanKernel::Scalar, NalParser::ScanKernel::Sse2, NalParser::ScanKernel::Avx2})
+	{
+		if (!NalParser::isSupported(kernel))
+		{
+			std::printf("%-8s not supported on this CPU\n", NalParser::kernelName(kernel));
+			continue;
+		}
+		runScan(
+			NalParser::kernelName(kernel),
+			frames,
+			totalBytes,
+			passes,
+			[kernel](const uint8_t* begin, const uint8_t* end) { return NalParser::findStartCode(begin, end, kernel); }
+		);
+	}
+
+	std::vector<NalUnit> nals;
+	uint64_t keyframes = 0;
+	uint64_t slices[4] = {};
+	const double splitNs = nsPerFrame(
+		frames,
+		passes,
+		[&](const std::vector<uint8_t>& frame)
+		{
+			nals.clear();
+			NalParser::split(frame.data(), frame.size(), codec, nals);
+		}
+	);
+	const double keyframeNs = nsPerFrame(
+		frames,
+		passes,
+		[&](const std::vector<uint8_t>& frame) { keyframes += NalParser::containsKeyframe(frame.data(), frame.size(), codec); }
+	);
+	const double sliceNs = nsPerFrame(
+		frames,
+		1,
+		[&](const std::vector<uint8_t>& frame)
+		{
+			NalScanner scanner(frame.data(), frame.size(), codec);
+			NalUnit nal;
+			SliceInfo slice;
+			while (scanner.next(nal))
+			{
+				if (NalParser::parseSlice(codec, nal, slice))
+					slices[static_cast<int>(slice.type)]++;
+			}
+		}
+	);
+	std::printf("\nsplit            %9.0f ns/frame\n", splitNs);
+	std::printf("containsKeyframe %9.0f ns/frame  (%lu keyframes per pass)\n", keyframeNs, keyframes / passes);
+	std::printf(
+		"scan + parseSlice %8.0f ns/frame  (slices: %lu I, %lu P, %lu B, %lu unknown)\n",
+		sliceNs,
+		slices[static_cast<int>(SliceType::I)],
+		slices[static_cast<int>(SliceType::P)],
+		slices[static_cast<int>(SliceType::B)],
+		slices[static_cast<int>(SliceType::Unknown)]
+	);
+	return 0;
+}
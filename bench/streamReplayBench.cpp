@@ -0,0 +1,257 @@
+// Replays a capture of SDK stream callbacks (see POST /api/v1/stream/startCapture) into the production pipeline
+// -- LeticoStreamDelegate, GopCache, HlsSegmenter and ReplayBuffer -- and reports how long each callback held the
+// SDK thread, ring drops and whether every frame made it to the sinks. Without a camera, --synthesize writes a
+// capture of 30 fps H.264 with 1 kHz gyro batches, per-frame exposure and audio to replay instead; with two lenses
+// the rear stream (index 1) jitters by a few ms and skips a frame now and then, and the replay reports how the
+// FramePairer matched the lenses.
+//
+// usage: streamReplayBench <capture> [speed] [loops]
+//        streamReplayBench --synthesize <capture> [seconds] [mbitPerSecond] [lenses]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/Stream/callbackCapture.h"
+#include "../src/Stream/callbackReplayer.h"
+#include "../src/Stream/framePairer.h"
+#include "../src/Stream/gopCache.h"
+#include "../src/Stream/hlsSegmentStore.h"
+#include "../src/Stream/hlsSegmenter.h"
+#include "../src/Stream/leticoStreamDelegate.h"
+#include "../src/Stream/replayBuffer.h"
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int FPS = 30;
+	constexpr int GOP = 30;
+	constexpr double IDR_WEIGHT = 8.0;
+	constexpr int GYRO_HZ = 1000;
+	constexpr int GYRO_BATCH = 10;
+	constexpr int AUDIO_FRAME_MS = 21;	// 1024 samples at 48 kHz
+	constexpr size_t AUDIO_FRAME_BYTES = 384;
+	constexpr int REAR_JITTER_MS = 4;
+	constexpr int REAR_SKIP_EVERY = 97;	// frames
+
+	// 1920x1080 High profile SPS and a PPS, put in front of every IDR.
+	const uint8_t PARAMETER_SETS[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x28, 0xac, 0xd9, 0x40, 0x78, 0x02, 0x27,
+									  0xe5, 0xc0, 0x44, 0x00, 0x00, 0x03, 0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xf0, 0x3c,
+									  0x60, 0xc6, 0x58, 0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+	class CountingSink : public StreamSink
+	{
+	public:
+		void onVideoFrame(const FramePtr&) override { video++; }
+		void onAudioFrame(const FramePtr&) override { audio++; }
+		void onGyroData(const ins_camera::GyroData*, size_t count) override { gyroSamples += count; }
+		void onExposureData(const ins_camera::ExposureData&) override { exposure++; }
+
+		std::atomic<uint64_t> video{0};
+		std::atomic<uint64_t> audio{0};
+		std::atomic<uint64_t> gyroSamples{0};
+		std::atomic<uint64_t> exposure{0};
+	};
+
+	// Writes the callbacks a camera would issue over `seconds`, interleaved by arrival time.
+	bool synthesize(const std::string& path, double seconds, double mbit, int lenses)
+	{
+		CallbackCaptureWriter writer;
+		if (!writer.open(path))
+			return false;
+
+		const double bytesPerGop = mbit * 1e6 / 8.0 * GOP / FPS;
+		const double unit = bytesPerGop / (IDR_WEIGHT + (GOP - 1));
+		const int64_t baseTimestamp = 1000;
+		const int64_t durationMs = static_cast<int64_t>(seconds * 1000);
+
+		std::vector<uint8_t> frame;
+		std::mt19937 random(1);
+		std::uniform_int_distribution<int> jitter(-REAR_JITTER_MS, REAR_JITTER_MS);
+		std::vector<uint8_t> audio(AUDIO_FRAME_BYTES, 0x21);
+		std::vector<ins_camera::GyroData> gyro(GYRO_BATCH);
+		int64_t nextVideo = 0;
+		int64_t nextAudio = 0;
+		int64_t nextGyro = 0;
+		int frameIndex = 0;
+		int64_t gyroIndex = 0;
+		for (int64_t ms = 0; ms < durationMs; ms++)
+		{
+			const int64_t offsetNs = ms * 1000000;
+			if (ms >= nextGyro)
+			{
+				for (auto& sample : gyro)
+				{
+					const double t = static_cast<double>(gyroIndex) / GYRO_HZ;
+					sample = {baseTimestamp + gyroIndex * 1000 / GYRO_HZ, 0.0, 0.0, 9.81, 0.1 * t, 0.0, 0.05};
+					gyroIndex++;
+				}
+				writer.writeGyro(offsetNs, gyro);
+				nextGyro += GYRO_BATCH * 1000 / GYRO_HZ;
+			}
+			if (ms >= nextAudio)
+			{
+				writer.write(CaptureKind::Audio, offsetNs, baseTimestamp + ms, audio.data(), audio.size());
+				nextAudio += AUDIO_FRAME_MS;
+			}
+			if (ms >= nextVideo)
+			{
+				const bool keyframe = frameIndex % GOP == 0;
+				const uint8_t header[] = {0x00, 0x00, 0x00, 0x01, static_cast<uint8_t>(keyframe ? 0x65 : 0x41)};
+				const size_t prefix = keyframe ? sizeof(PARAMETER_SETS) : 0;
+				frame.assign(std::max(static_cast<size_t>(keyframe ? unit * IDR_WEIGHT : unit), prefix + sizeof(header)), 0x5a);
+				if (keyframe)
+				{
+					std::copy(std::begin(PARAMETER_SETS), std::end(PARAMETER_SETS), frame.begin());
+				}
+				std::copy(std::begin(header), std::end(header), frame.begin() + prefix);
+				writer.write(CaptureKind::Video, offsetNs, baseTimestamp + ms, frame.data(), frame.size());
+				if (lenses > 1 && frameIndex % REAR_SKIP_EVERY != REAR_SKIP_EVERY - 1)
+				{
+					const int64_t rearTimestamp = baseTimestamp + ms + jitter(random);
+					writer.write(CaptureKind::Video, offsetNs, rearTimestamp, frame.data(), frame.size(), 0, 1);
+				}
+				writer.writeExposure(offsetNs, ins_camera::ExposureData{static_cast<double>(baseTimestamp + ms) / 1000.0, 1.0 / 240});
+				frameIndex++;
+				nextVideo = static_cast<int64_t>(frameIndex) * 1000 / FPS;
+			}
+		}
+		std::printf("wrote %s: %lu records, %.1f MB, %.0f s\n", path.c_str(), writer.records(), writer.bytes() / 1e6, seconds);
+		return writer.close();
+	}
+
+	void printKind(const char* name, const CallbackReplayer::KindResult& kind, double seconds)
+	{
+		std::printf(
+			"%-9s %8lu calls %8.1f MB/s  p50 %7.2f us  p99 %7.2f us  p99.9 %7.2f us  max %8.2f us\n",
+			name,
+			kind.calls,
+			kind.bytes / 1e6 / seconds,
+			kind.p50Us,
+			kind.p99Us,
+			kind.p999Us,
+			kind.maxUs
+		);
+	}
+
+	void printRing(const char* name, const FrameRing::Stats& ring)
+	{
+		std::printf(
+			"%-9s ring %8lu records %6lu dropped %4lu overflows  high-water %6.1f of %6.1f MB\n",
+			name,
+			ring.pushedRecords,
+			ring.droppedRecords,
+			ring.overflows,
+			ring.highWaterBytes / 1e6,
+			ring.capacityBytes / 1e6
+		);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 2 && std::string(argv[1]) == "--synthesize")
+	{
+		const double seconds = argc > 3 ? std::atof(argv[3]) : 10.0;
+		const double mbit = argc > 4 ? std::atof(argv[4]) : 60.0;
+		const int lenses = argc > 5 ? std::atoi(argv[5]) : 1;
+		return synthesize(argv[2], seconds, mbit, lenses) ? 0 : 1;
+	}
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <capture> [speed] [loops]\n       %s --synthesize <capture> [seconds] [mbit] [lenses]\n", argv[0], argv[0]);
+		return 2;
+	}
+
+	CallbackReplayer::Options options;
+	options.speed = argc > 2 ? std::atof(argv[2]) : 1.0;
+	options.loops = argc > 3 ? std::atoi(argv[3]) : 1;
+
+	auto delegate = std::make_shared<LeticoStreamDelegate>();
+	auto gopCache = std::make_shared<GopCache>(GopCache::Config{});
+	auto store = std::make_shared<HlsSegmentStore>(HlsSegmentStore::Config{});
+	auto segmenter = std::make_shared<HlsSegmenter>(HlsSegmenter::Config{}, store);
+	auto replayBuffer = std::make_shared<ReplayBuffer>(ReplayBuffer::Config{});
+	auto counter = std::make_shared<CountingSink>();
+	auto pairer = std::make_shared<FramePairer>(FramePairer::Config{});
+	gopCache->start(ins_camera::VideoEncodeType::H264);
+	segmenter->start(ins_camera::VideoEncodeType::H264);
+	replayBuffer->start(ins_camera::VideoEncodeType::H264);
+	pairer->start(ins_camera::VideoEncodeType::H264);
+	gopCache->subscribe(segmenter);
+	gopCache->subscribe(replayBuffer);
+	gopCache->subscribe(pairer);
+	delegate->addSink(gopCache);
+	delegate->addSink(counter);
+
+	CallbackReplayer::Result result;
+	if (!CallbackReplayer::replay(argv[1], *delegate, options, result))
+	{
+		std::fprintf(stderr, "cannot open capture %s\n", argv[1]);
+		return 1;
+	}
+
+	// Let the consumer thread drain what is still queued before counting deliveries.
+	const auto drainDeadline = Clock::now() + std::chrono::seconds(5);
+	while (counter->video < result.video.calls - delegate->getStats().video.droppedRecords && Clock::now() < drainDeadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	segmenter->stop();
+	gopCache->stop();
+
+	const auto stats = delegate->getStats();
+	std::printf(
+		"replayed %.1f s of capture x %d in %.2f s (%s), %lu late calls\n",
+		result.captureSeconds,
+		options.loops,
+		result.wallSeconds,
+		options.speed > 0.0 ? ("speed " + std::to_string(options.speed)).c_str() : "as fast as possible",
+		result.lateCalls
+	);
+	printKind("video", result.video, result.wallSeconds);
+	printKind("audio", result.audio, result.wallSeconds);
+	printKind("gyro", result.gyro, result.wallSeconds);
+	printKind("exposure", result.exposure, result.wallSeconds);
+	printRing("video", stats.video);
+	printRing("audio", stats.audio);
+	printRing("gyro", stats.gyro);
+	printRing("exposure", stats.exposure);
+	std::printf(
+		"delivered video %lu/%lu audio %lu/%lu exposure %lu/%lu gyro samples %lu, replay window %.1f s\n",
+		counter->video.load(),
+		result.video.calls,
+		counter->audio.load(),
+		result.audio.calls,
+		counter->exposure.load(),
+		result.exposure.calls,
+		counter->gyroSamples.load(),
+		replayBuffer->bufferedSeconds()
+	);
+
+	const auto pairs = pairer->getStats();
+	if (pairs.pairs > 0)
+	{
+		std::printf(
+			"lens pairs %lu (%lu keyframe) unmatched %lu/%lu overflowed %lu/%lu skew average %.2f ms max %ld ms\n",
+			pairs.pairs,
+			pairs.keyframePairs,
+			pairs.unmatched[0],
+			pairs.unmatched[1],
+			pairs.overflowed[0],
+			pairs.overflowed[1],
+			pairs.averageSkewMs,
+			pairs.maxSkewMs
+		);
+	}
+
+	const bool ok = counter->video == result.video.calls && stats.video.droppedRecords == 0;
+	std::printf("%s\n", ok ? "no drops" : "DROPS");
+	return ok ? 0 : 1;
+}
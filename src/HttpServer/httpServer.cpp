@@ -1,8 +1,13 @@
 #pragma once
 #include "httpServer.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <cstdio>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -21,6 +26,13 @@ LeticoHttpServer::LeticoHttpServer(std::vector<std::shared_ptr<LeticoCamera>> ca
             mServerAddress = config["server"]["address"].as<std::string>("localhost");
             mPort = config["server"]["port"].as<int>(9091);
             mNginxMediaUrl = config["nginx"]["mediaUrl"].as<std::string>("localhost");
+            mThreadCount = config["server"]["threads"].as<size_t>(mThreadCount);
+            mMaxStreamingClients = config["server"]["maxStreamingClients"].as<size_t>(mThreadCount / 2);
+            if (config["stream"])
+            {
+                mRawQueueConfig.maxFrames = config["stream"]["rawQueueFrames"].as<size_t>(mRawQueueConfig.maxFrames);
+                mRawQueueConfig.maxBytes = config["stream"]["rawQueueMB"].as<size_t>(mRawQueueConfig.maxBytes >> 20) << 20;
+            }
 
         } else {
             std::cerr << "Server configuration not found in config.yaml. Using default values." << std::endl;
@@ -35,7 +47,11 @@ LeticoHttpServer::LeticoHttpServer(std::vector<std::shared_ptr<LeticoCamera>> ca
 		mNginxMediaUrl = "localhost/media/";
     }
 
+    // At least one worker stays free of streaming clients for everything else.
+    mMaxStreamingClients = std::min(mMaxStreamingClients, mThreadCount > 0 ? mThreadCount - 1 : 0);
     mServer = std::make_shared<httplib::Server>();
+    // Blocking LL-HLS playlist requests hold a worker each, so the pool is sized from config.
+    mServer->new_task_queue = [threads = mThreadCount] { return new httplib::ThreadPool(threads); };
     createServer();
 	
 }
@@ -75,6 +91,99 @@ void LeticoHttpServer::createServer()
 	}
 }
 
+void LeticoHttpServer::servePlaylist(
+	const httplib::Request& req, httplib::Response& res, const std::shared_ptr<HlsSegmenter>& segmenter
+)
+{
+	auto store = segmenter->store();
+
+	// LL-HLS blocking playlist reload: hold the request until the requested part exists.
+	if (segmenter->config().lowLatency && req.has_param("_HLS_msn"))
+	{
+		try
+		{
+			uint64_t msn = std::stoull(req.get_param_value("_HLS_msn"));
+			int part = req.has_param("_HLS_part") ? std::stoi(req.get_param_value("_HLS_part")) : -1;
+			auto timeout = std::chrono::milliseconds(static_cast<int64_t>(segmenter->config().targetDuration * 3000));
+			if (store->waitForPart(msn, part, timeout) == HlsSegmentStore::BlockResult::Unreachable)
+			{
+				res.status = BAD_REQUEST;
+				return;
+			}
+		}
+		catch (const std::exception&)
+		{
+			res.status = BAD_REQUEST;
+			return;
+		}
+	}
+
+	auto playlist = store->getPlaylist();
+	if (!playlist)
+	{
+		res.status = NOT_FOUND;
+		return;
+	}
+	res.set_header("Cache-Control", "no-cache");
+	serveSharedBuffer(res, playlist, "application/x-mpegURL");
+}
+
+void LeticoHttpServer::serveSharedBuffer(httplib::Response& res, const SharedBuffer& buffer, const char* contentType)
+{
+	// The provider keeps the buffer alive until the response is written; no per-request copy is made.
+	res.set_content_provider(
+		buffer->size(),
+		contentType,
+		[buffer](size_t offset, size_t length, httplib::DataSink& sink)
+		{
+			sink.write(buffer->data() + offset, length);
+			return true;
+		}
+	);
+}
+
+nlohmann::json LeticoHttpServer::healthToJson(const StreamHealthMonitor::Stats& stats)
+{
+	nlohmann::json streams = nlohmann::json::array();
+	for (const auto& stream : stats.streams)
+	{
+		streams.push_back(
+			{{"streamIndex", stream.streamIndex},
+			 {"frames", stream.frames},
+			 {"bytes", stream.bytes},
+			 {"bitrateKbps", stream.bitrateKbps},
+			 {"intervalMs",
+			  {{"last", stream.lastIntervalMs}, {"average", stream.averageIntervalMs}, {"max", stream.maxIntervalMs}}},
+			 {"discontinuities", stream.discontinuities},
+			 {"secondsSinceFrame", stream.secondsSinceFrame}}
+		);
+	}
+	return {
+		{"state", StreamHealthMonitor::stateName(stats.state)},
+		{"autoRestart", stats.autoRestart},
+		{"stalls", stats.stalls},
+		{"restarts", stats.restarts},
+		{"failedRestarts", stats.failedRestarts},
+		{"backoffSeconds", stats.backoffSeconds},
+		{"lastStallSeconds", stats.lastStallSeconds},
+		{"secondsSinceFrame", stats.secondsSinceFrame},
+		{"audioFrames", stats.audioFrames},
+		{"streams", streams}};
+}
+
+bool LeticoHttpServer::acquireStreamingClient()
+{
+	if (mStreamingClients.fetch_add(1, std::memory_order_acq_rel) < mMaxStreamingClients)
+		return true;
+	mStreamingClients.fetch_sub(1, std::memory_order_acq_rel);
+	return false;
+}
+
+void LeticoHttpServer::releaseStreamingClient()
+{
+	mStreamingClients.fetch_sub(1, std::memory_order_acq_rel);
+}
+
 void LeticoHttpServer::createEndpoints()
 {
 	//======== HEALTHY ===========
@@ -85,35 +194,501 @@ void LeticoHttpServer::createEndpoints()
 
 	mServer->Get(
 		"/stream.m3u8",
-		[](const httplib::Request&, httplib::Response& res)
+		[&](const httplib::Request& req, httplib::Response& res)
 		{
-			std::ifstream t("stream.m3u8");
-			std::stringstream buffer;
-			buffer << t.rdbuf();
+			if (mCameras.empty())
+			{
+				res.status = NOT_FOUND;
+				return;
+			}
+			servePlaylist(req, res, mCameras[0]->getHlsSegmenter());
+		}
+	);
 
-			res.set_content(buffer.str(), "application/x-mpegURL");
+	// Adaptive bitrate (liveStream.adaptive): the main and LRV streams as two variants.
+	mServer->Get(
+		"/master.m3u8",
+		[&](const httplib::Request&, httplib::Response& res)
+		{
+			std::string playlist = mCameras.empty() ? "" : mCameras[0]->getMasterPlaylist();
+			if (playlist.empty())
+			{
+				res.status = NOT_FOUND;
+				return;
+			}
+			res.set_header("Cache-Control", "no-cache");
+			res.set_content(playlist, "application/x-mpegURL");
 		}
 	);
 
 	mServer->Get(
-		R"(/(.+\.ts))",
-		[](const httplib::Request& req, httplib::Response& res)
+		"/stream_lrv.m3u8",
+		[&](const httplib::Request& req, httplib::Response& res)
 		{
-			std::ifstream file(req.matches[1], std::ios::binary | std::ios::ate);
-			if (file.is_open())
+			auto segmenter = mCameras.empty() ? nullptr : mCameras[0]->getLrvHlsSegmenter();
+			if (!segmenter)
 			{
-				auto size = file.tellg();
-				std::string buffer(size,
-								   '\0');  // Create string buffer to the size of the file
-				file.seekg(0);
-				file.read(buffer.data(), size);
+				res.status = NOT_FOUND;
+				return;
+			}
+			servePlaylist(req, res, segmenter);
+		}
+	);
 
-				res.set_content(buffer, "video/MP2T");
+	// MPEG-DASH over the same CMAF segments (hls.container: fmp4).
+	mServer->Get(
+		R"(/stream(_lrv)?\.mpd)",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			std::shared_ptr<HlsSegmenter> segmenter;
+			if (!mCameras.empty())
+			{
+				segmenter = req.matches[1].matched ? mCameras[0]->getLrvHlsSegmenter() : mCameras[0]->getHlsSegmenter();
 			}
-			else
+			auto manifest = segmenter ? segmenter->store()->getManifest() : nullptr;
+			if (!manifest)
 			{
 				res.status = NOT_FOUND;
+				return;
 			}
+			res.set_header("Cache-Control", "no-cache");
+			serveSharedBuffer(res, manifest, "application/dash+xml");
+		}
+	);
+
+	mServer->Get(
+		R"(/(.+\.(ts|m4s|mp4)))",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			if (mCameras.empty())
+			{
+				res.status = NOT_FOUND;
+				return;
+			}
+			const std::string name = req.matches[1];
+			auto segmenter = mCameras[0]->getHlsSegmenter();
+			if (name.rfind(LeticoCamera::LRV_SEGMENT_PREFIX, 0) == 0 && mCameras[0]->getLrvHlsSegmenter())
+			{
+				segmenter = mCameras[0]->getLrvHlsSegmenter();
+			}
+			auto segment = segmenter->store()->getSegment(name);
+			if (!segment && segmenter->isUpcoming(name))
+			{
+				// Parts announced through EXT-X-PRELOAD-HINT are requested before they exist; any other missing name
+				// is answered at once instead of holding a worker thread.
+				auto timeout = std::chrono::milliseconds(static_cast<int64_t>(segmenter->config().targetDuration * 2000));
+				segment = segmenter->store()->waitForSegment(name, timeout);
+			}
+			if (!segment)
+			{
+				res.status = NOT_FOUND;
+				return;
+			}
+			const std::string extension = req.matches[2];
+			const char* contentType = extension == "ts" ? "video/MP2T" : extension == "m4s" ? "video/iso.segment" : "video/mp4";
+			serveSharedBuffer(res, segment, contentType);
+		}
+	);
+	//======== Raw elementary stream ===========
+	mServer->Get(
+		"/api/v1/stream/raw",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			int streamIndex = 0;
+			try
+			{
+				cameraIndex = req.has_param("cameraIndex") ? std::stoi(req.get_param_value("cameraIndex")) : 0;
+				streamIndex = req.has_param("streamIndex") ? std::stoi(req.get_param_value("streamIndex")) : 0;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			if (!acquireStreamingClient())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Too many streaming clients"}};
+				res.status = SERVICE_UNAVAILABLE;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto gopCache = mCameras[cameraIndex]->getGopCache();
+			const auto codec = gopCache->codec();
+			auto queue = std::make_shared<FrameQueue>(mRawQueueConfig, streamIndex, codec);
+			gopCache->subscribe(queue);
+
+			// Frames stay shared with every other client until written; the provider only holds references.
+			auto pending = std::make_shared<std::vector<FramePtr>>();
+			res.set_header("Cache-Control", "no-cache");
+			res.set_chunked_content_provider(
+				codec == ins_camera::VideoEncodeType::H265 ? "video/H265" : "video/H264",
+				[queue, pending](size_t, httplib::DataSink& sink)
+				{
+					pending->clear();
+					if (!queue->popAll(*pending, std::chrono::seconds(1)))
+					{
+						sink.done();
+						return true;
+					}
+					for (const auto& frame : *pending)
+					{
+						if (!sink.write(reinterpret_cast<const char*>(frame->data()), frame->size()))
+							return false;
+					}
+					return sink.is_writable();
+				},
+				[this, gopCache, queue](bool)
+				{
+					gopCache->unsubscribe(queue);
+					queue->close();
+					releaseStreamingClient();
+				}
+			);
+		}
+	);
+	//======== Gyro range, packed binary ===========
+	mServer->Get(
+		"/api/v1/stream/gyro",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			int64_t from = std::numeric_limits<int64_t>::min();
+			int64_t to = std::numeric_limits<int64_t>::max();
+			size_t limit = SIZE_MAX;
+			std::string format = req.has_param("format") ? req.get_param_value("format") : "f32";
+			try
+			{
+				cameraIndex = req.has_param("cameraIndex") ? std::stoi(req.get_param_value("cameraIndex")) : 0;
+				from = req.has_param("from") ? std::stoll(req.get_param_value("from")) : from;
+				to = req.has_param("to") ? std::stoll(req.get_param_value("to")) : to;
+				limit = req.has_param("limit") ? std::stoull(req.get_param_value("limit")) : limit;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size() || (format != "f32" && format != "f64"))
+			{
+				jsonResponse = {{"status", "error"}, {"message", cameraIndex >= mCameras.size() ? "Invalid camera index" : "Invalid format"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			const auto type = format == "f64" ? Letico::GyroStore::ValueType::Float64 : Letico::GyroStore::ValueType::Float32;
+			res.set_header("Cache-Control", "no-cache");
+			res.set_content(mCameras[cameraIndex]->getGyroStore()->packRange(from, to, type, limit), "application/octet-stream");
+		}
+	);
+	//======== Exposure timeline, per-second aggregates ===========
+	mServer->Get(
+		"/api/v1/stream/exposure",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			int64_t from = std::numeric_limits<int64_t>::min();
+			int64_t to = std::numeric_limits<int64_t>::max();
+			size_t limit = SIZE_MAX;
+			size_t samples = 0;
+			try
+			{
+				cameraIndex = req.has_param("cameraIndex") ? std::stoi(req.get_param_value("cameraIndex")) : 0;
+				from = req.has_param("from") ? std::stoll(req.get_param_value("from")) : from;
+				to = req.has_param("to") ? std::stoll(req.get_param_value("to")) : to;
+				limit = req.has_param("limit") ? std::stoull(req.get_param_value("limit")) : limit;
+				samples = req.has_param("samples") ? std::stoull(req.get_param_value("samples")) : samples;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto store = mCameras[cameraIndex]->getExposureStore();
+			auto seconds = nlohmann::json::array();
+			for (const auto& bucket : store->timeline(from, to, limit))
+			{
+				seconds.push_back({bucket.timestamp, bucket.count, bucket.min, bucket.mean, bucket.max});
+			}
+			auto recent = nlohmann::json::array();
+			for (const auto& sample : store->recent(samples))
+			{
+				recent.push_back({sample.timestamp, sample.exposure});
+			}
+			jsonResponse = {{"status", "success"}, {"seconds", seconds}, {"samples", recent}};
+			res.set_header("Cache-Control", "no-cache");
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== Orientation, server-sent events ===========
+	mServer->Get(
+		"/api/v1/stream/orientation",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			double rate = 50.0;
+			try
+			{
+				cameraIndex = req.has_param("cameraIndex") ? std::stoi(req.get_param_value("cameraIndex")) : 0;
+				rate = req.has_param("rate") ? std::stod(req.get_param_value("rate")) : rate;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			// std::stod accepts "nan" and "inf"; no tick interval can be derived from those.
+			if (!std::isfinite(rate))
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid rate"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			if (!acquireStreamingClient())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Too many streaming clients"}};
+				res.status = SERVICE_UNAVAILABLE;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			using Attitude = Letico::OrientationEstimator::Attitude;
+			auto estimator = mCameras[cameraIndex]->getOrientationEstimator();
+			auto interval = std::chrono::microseconds(static_cast<int64_t>(1e6 / std::clamp(rate, 1.0, 1000.0)));
+			auto formatAttitude = [](const Attitude& attitude, char* buffer, size_t size)
+			{
+				return std::snprintf(
+					buffer,
+					size,
+					"[%lld,%.6f,%.6f,%.6f,%.6f]",
+					static_cast<long long>(attitude.timestamp),
+					attitude.w,
+					attitude.x,
+					attitude.y,
+					attitude.z
+				);
+			};
+
+			// The first event is the recent history; after that one attitude event per tick, only when it changed.
+			struct State
+			{
+				bool sentHistory = false;
+				uint64_t update = 0;
+				std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now();
+			};
+			auto state = std::make_shared<State>();
+			res.set_header("Cache-Control", "no-cache");
+			res.set_chunked_content_provider(
+				"text/event-stream",
+				[estimator, interval, formatAttitude, state](size_t, httplib::DataSink& sink)
+				{
+					char buffer[160];
+					if (!state->sentHistory)
+					{
+						state->sentHistory = true;
+						std::string event = "event: history\ndata: [";
+						const auto history = estimator->history();
+						for (size_t i = 0; i < history.size(); i++)
+						{
+							if (i > 0)
+								event += ',';
+							event.append(buffer, formatAttitude(history[i], buffer, sizeof(buffer)));
+						}
+						event += "]\n\n";
+						return sink.write(event.data(), event.size());
+					}
+
+					std::this_thread::sleep_until(state->nextTick);
+					state->nextTick = std::max(state->nextTick + interval, std::chrono::steady_clock::now());
+					Attitude attitude;
+					const uint64_t update = estimator->waitForUpdate(state->update, std::chrono::seconds(1), attitude);
+					if (update == state->update)
+					{
+						// Comment line: keeps proxies from timing out while the stream is stopped.
+						return sink.write(": keepalive\n\n", 13);
+					}
+					state->update = update;
+					std::string event = "event: attitude\ndata: ";
+					event.append(buffer, formatAttitude(attitude, buffer, sizeof(buffer)));
+					event += "\n\n";
+					return sink.write(event.data(), event.size());
+				},
+				[this](bool) { releaseStreamingClient(); }
+			);
+		}
+	);
+	//======== Stream pipeline statistics ===========
+	mServer->Get(
+		"/api/v1/stream/stats",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = req.has_param("cameraIndex") ? std::stoi(req.get_param_value("cameraIndex")) : 0;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto ringJson = [](const FrameRing::Stats& stats)
+			{
+				return nlohmann::json{
+					{"pushedRecords", stats.pushedRecords},
+					{"pushedBytes", stats.pushedBytes},
+					{"droppedRecords", stats.droppedRecords},
+					{"droppedBytes", stats.droppedBytes},
+					{"overflows", stats.overflows},
+					{"highWaterBytes", stats.highWaterBytes},
+					{"capacityBytes", stats.capacityBytes}};
+			};
+			auto rings = mCameras[cameraIndex]->getStreamDelegate()->getStats();
+			auto gop = mCameras[cameraIndex]->getGopCache()->getStats();
+			auto recorder = mCameras[cameraIndex]->getHostRecorder()->getStats();
+			auto gyro = mCameras[cameraIndex]->getGyroStore()->getStats();
+			auto exposure = mCameras[cameraIndex]->getExposureStore()->getStats();
+			auto health = mCameras[cameraIndex]->getHealthMonitor()->getStats();
+			jsonResponse = {
+				{"status", "success"},
+				{"rings", {{"video", ringJson(rings.video)}, {"audio", ringJson(rings.audio)}, {"gyro", ringJson(rings.gyro)}}},
+				{"gopCache",
+				 {{"subscriptions", gop.subscriptions},
+				  {"servedFromCache", gop.servedFromCache},
+				  {"waitedForKeyframe", gop.waitedForKeyframe},
+				  {"gopsCached", gop.gopsCached},
+				  {"gopsOverflowed", gop.gopsOverflowed},
+				  {"subscribers", gop.subscribers},
+				  {"cachedFrames", gop.cachedFrames},
+				  {"cachedBytes", gop.cachedBytes}}},
+				{"timeToFirstFrameMs", {{"last", gop.lastTtffMs}, {"average", gop.averageTtffMs}, {"max", gop.maxTtffMs}}},
+				{"hostRecorder",
+				 {{"recording", recorder.recording},
+				  {"framesWritten", recorder.framesWritten},
+				  {"bytesWritten", recorder.bytesWritten},
+				  {"files", recorder.files},
+				  {"writeErrors", recorder.writeErrors},
+				  {"maxWriteMs", recorder.maxWriteMs},
+				  {"droppedFrames", recorder.queue.droppedFrames},
+				  {"queuedBytes", recorder.queue.queuedBytes}}},
+				{"gyroStore",
+				 {{"samples", gyro.samples},
+				  {"batches", gyro.batches},
+				  {"discontinuities", gyro.discontinuities},
+				  {"stored", gyro.stored},
+				  {"capacity", gyro.capacity},
+				  {"oldestTimestamp", gyro.oldestTimestamp},
+				  {"newestTimestamp", gyro.newestTimestamp}}},
+				{"exposureStore",
+				 {{"samples", exposure.samples},
+				  {"discontinuities", exposure.discontinuities},
+				  {"stored", exposure.stored},
+				  {"capacity", exposure.capacity},
+				  {"seconds", exposure.buckets},
+				  {"oldestTimestamp", exposure.oldestTimestamp},
+				  {"newestTimestamp", exposure.newestTimestamp}}},
+				{"health", healthToJson(health)},
+				{"audio",
+				 {{"sampleRate", rings.audioFormat.sampleRate},
+				  {"channels", rings.audioFormat.channels},
+				  {"codec", AdtsFramer::codecString(rings.audioFormat)},
+				  {"frames", rings.audioClock.frames},
+				  {"droppedBeforeVideo", rings.audioClock.dropped},
+				  {"sameClock", rings.audioClock.sameClock},
+				  {"offsetMs", rings.audioClock.offsetMs},
+				  {"skewMs", rings.audioClock.skewMs},
+				  {"resyncs", rings.audioClock.resyncs}}},
+				{"framePool",
+				 {{"reservedBytes", rings.framePool.reservedBytes},
+				  {"maxBytes", rings.framePool.maxBytes},
+				  {"inUse", rings.framePool.inUse},
+				  {"inUseBytes", rings.framePool.inUseBytes},
+				  {"acquired", rings.framePool.acquired},
+				  {"exhausted", rings.framePool.exhausted},
+				  {"oversize", rings.framePool.oversize},
+				  {"classes", nlohmann::json::array()}}}};
+			for (const auto& sizeClass : rings.framePool.classes)
+			{
+				jsonResponse["framePool"]["classes"].push_back({{"frameBytes", sizeClass.frameBytes},
+																{"frames", sizeClass.frames},
+																{"inUse", sizeClass.inUse},
+																{"acquired", sizeClass.acquired}});
+			}
+			if (auto archive = mCameras[cameraIndex]->getGyroArchive())
+			{
+				auto stats = archive->getStats();
+				jsonResponse["gyroArchive"] = {
+					{"active", stats.active},
+					{"samples", stats.samples},
+					{"chunks", stats.chunks},
+					{"bytes", stats.bytes},
+					{"files", stats.files},
+					{"writeErrors", stats.writeErrors}};
+			}
+			if (auto pairer = mCameras[cameraIndex]->getFramePairer())
+			{
+				auto stats = pairer->getStats();
+				jsonResponse["framePairer"] = {
+					{"pairs", stats.pairs},
+					{"keyframePairs", stats.keyframePairs},
+					{"unmatched", {stats.unmatched[0], stats.unmatched[1]}},
+					{"overflowed", {stats.overflowed[0], stats.overflowed[1]}},
+					{"queued", {stats.queued[0], stats.queued[1]}},
+					{"discontinuities", stats.discontinuities},
+					{"otherStreams", stats.otherStreams},
+					{"skewMs", {{"last", stats.lastSkewMs}, {"average", stats.averageSkewMs}, {"max", stats.maxSkewMs}}}};
+			}
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== Stream health of every camera, for alerting ===========
+	mServer->Get(
+		"/api/v1/stream/health",
+		[&](const httplib::Request&, httplib::Response& res)
+		{
+			nlohmann::json cameras = nlohmann::json::array();
+			for (size_t cameraIndex = 0; cameraIndex < mCameras.size(); cameraIndex++)
+			{
+				auto health = healthToJson(mCameras[cameraIndex]->getHealthMonitor()->getStats());
+				health["cameraIndex"] = cameraIndex;
+				cameras.push_back(std::move(health));
+			}
+			nlohmann::json jsonResponse = {{"status", "success"}, {"cameras", cameras}};
+			res.set_content(jsonResponse.dump(), "application/json");
 		}
 	);
 	//======== Get all cameras series ========
@@ -370,7 +945,8 @@ void LeticoHttpServer::createEndpoints()
 				{"message", "Recording stopped and files downloaded successfully"},
 				{"deviceUrls", deviceUrls},
 				{"homeUrls", folderUrls},
-				{"wwwUrls", wwwUrls}};
+				{"wwwUrls", wwwUrls},
+				{"indexFile", mCameras[cameraIndex]->getRecordingIndexPath()}};
 
 			res.set_content(jsonResponse.dump(), "application/json");
 		}
@@ -439,7 +1015,50 @@ void LeticoHttpServer::createEndpoints()
 				return;
 			}
 
-			auto errorMessage = mCameras[cameraIndex]->startPreviewLiveStream();
+			// A named profile (or the default one), then any individual parameters on top of it.
+			Letico::LiveStreamProfile profile;
+			const std::string profileName = req.has_param("profile") ? req.get_param_value("profile") : "";
+			if (!mCameras[cameraIndex]->getStreamProfile(profileName, profile))
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Unknown stream profile"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			try
+			{
+				auto boolParam = [&req](const char* name, bool value)
+				{
+					if (!req.has_param(name))
+						return value;
+					const std::string text = req.get_param_value(name);
+					if (text != "true" && text != "false" && text != "1" && text != "0")
+						throw std::invalid_argument(name);
+					return text == "true" || text == "1";
+				};
+				if (req.has_param("resolution"))
+					profile.resolution = static_cast<ins_camera::VideoResolution>(std::stoi(req.get_param_value("resolution")));
+				if (req.has_param("bitrateKbps"))
+					profile.bitrateKbps = std::stoul(req.get_param_value("bitrateKbps"));
+				if (req.has_param("lrvResolution"))
+					profile.lrvResolution = static_cast<ins_camera::VideoResolution>(std::stoi(req.get_param_value("lrvResolution")));
+				if (req.has_param("lrvBitrateKbps"))
+					profile.lrvBitrateKbps = std::stoul(req.get_param_value("lrvBitrateKbps"));
+				if (req.has_param("segmentDuration"))
+					profile.segmentDuration = std::stod(req.get_param_value("segmentDuration"));
+				profile.audio = boolParam("audio", profile.audio);
+				profile.gyro = boolParam("gyro", profile.gyro);
+				profile.lrv = boolParam("lrv", profile.lrv);
+			}
+			catch (const std::exception&)
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid stream parameter"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			// startPreviewLiveStream checks the profile against the camera's capabilities.
+			auto errorMessage = mCameras[cameraIndex]->startPreviewLiveStream(profile);
 			if (!errorMessage.empty())
 			{
 				jsonResponse = {{"status", "error"}, {"message", errorMessage}};
@@ -453,6 +1072,69 @@ void LeticoHttpServer::createEndpoints()
 			res.set_content(jsonResponse.dump(), "application/json");
 		}
 	);
+	//======== Live stream profiles ========
+	mServer->Get(
+		"/api/v1/stream/profiles",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = req.has_param("cameraIndex") ? std::stoi(req.get_param_value("cameraIndex")) : 0;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto camera = mCameras[cameraIndex];
+			auto capabilities = camera->getStreamCapabilities();
+			nlohmann::json profiles = nlohmann::json::object();
+			for (const auto& name : camera->getStreamProfileNames())
+			{
+				Letico::LiveStreamProfile profile;
+				camera->getStreamProfile(name, profile);
+				const std::string invalid = capabilities.check(profile);
+				profiles[name] = {
+					{"resolution", static_cast<int>(profile.resolution)},
+					{"bitrateKbps", profile.bitrateKbps},
+					{"lrvResolution", static_cast<int>(profile.lrvResolution)},
+					{"lrvBitrateKbps", profile.lrvBitrateKbps},
+					{"audio", profile.audio},
+					{"gyro", profile.gyro},
+					{"lrv", profile.lrv},
+					{"segmentDuration", profile.segmentDuration},
+					{"supported", invalid.empty()},
+					{"message", invalid}};
+			}
+			auto resolutions = [](const std::vector<ins_camera::VideoResolution>& list)
+			{
+				std::vector<int> values;
+				for (auto resolution : list)
+					values.push_back(static_cast<int>(resolution));
+				return values;
+			};
+			jsonResponse = {
+				{"status", "success"},
+				{"profiles", profiles},
+				{"capabilities",
+				 {{"resolutions", resolutions(capabilities.resolutions)},
+				  {"lrvResolutions", resolutions(capabilities.lrvResolutions)},
+				  {"minBitrateKbps", capabilities.minBitrateKbps},
+				  {"maxBitrateKbps", capabilities.maxBitrateKbps},
+				  {"minSegmentDuration", capabilities.minSegmentDuration},
+				  {"maxSegmentDuration", capabilities.maxSegmentDuration}}}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
 	//======== Stop live stream ========
 	mServer->Post(
 		"/api/v1/stopLiveStream",
@@ -482,6 +1164,296 @@ void LeticoHttpServer::createEndpoints()
 			res.set_content(jsonResponse.dump(), "application/json");
 		}
 	);
+	//======== save instant replay ========
+	mServer->Post(
+		"/api/v1/saveReplay",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			double seconds = 0.0;
+			try
+			{
+				cameraIndex = std::stoi(req.get_param_value("cameraIndex"));
+				// Without `seconds` everything buffered is saved.
+				seconds = req.has_param("seconds") ? std::stod(req.get_param_value("seconds")) : 1e9;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+
+			if (cameraIndex >= mCameras.size() || seconds <= 0.0)
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index or duration"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			std::string folderUrl = mCameras[cameraIndex]->saveReplay(seconds);
+			if (folderUrl.empty())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Unable to save replay"}};
+				res.status = INTERNAL_SERVER_ERROR;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			std::string wwwUrl = mServerAddress + ":" + std::to_string(mPort) + "/api/v1/getMedia?fileName=" + folderUrl;
+			jsonResponse = {{"status", "success"}, {"message", "Replay saved successfully"}, {"homeUrl", folderUrl}, {"wwwUrl", wwwUrl}};
+
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== start host-side recording ========
+	mServer->Post(
+		"/api/v1/startHostRecording",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = std::stoi(req.get_param_value("cameraIndex"));
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto errorMessage = mCameras[cameraIndex]->startHostRecording();
+			if (!errorMessage.empty())
+			{
+				jsonResponse = {{"status", "error"}, {"message", errorMessage}};
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			jsonResponse = {{"status", "success"}, {"message", "Host recording started successfully"}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== stop host-side recording ========
+	mServer->Post(
+		"/api/v1/stopHostRecording",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = std::stoi(req.get_param_value("cameraIndex"));
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto folderUrls = mCameras[cameraIndex]->stopHostRecording();
+			if (folderUrls.empty())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Unable to stop host recording, no recordings found"}};
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			std::vector<std::string> wwwUrls;
+			wwwUrls.reserve(folderUrls.size());
+			for (const auto& folderUrl : folderUrls)
+			{
+				wwwUrls.push_back(mServerAddress + ":" + std::to_string(mPort) + "/api/v1/getMedia?fileName=" + folderUrl);
+			}
+			jsonResponse = {
+				{"status", "success"},
+				{"message", "Host recording stopped successfully"},
+				{"homeUrls", folderUrls},
+				{"wwwUrls", wwwUrls}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== start capturing raw stream callbacks ========
+	mServer->Post(
+		"/api/v1/stream/startCapture",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = std::stoi(req.get_param_value("cameraIndex"));
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto path = mCameras[cameraIndex]->startCallbackCapture();
+			if (path.empty())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Unable to start capture, a capture may already be running"}};
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			jsonResponse = {{"status", "success"}, {"message", "Capture started successfully"}, {"homeUrl", path}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== stop capturing raw stream callbacks ========
+	mServer->Post(
+		"/api/v1/stream/stopCapture",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = std::stoi(req.get_param_value("cameraIndex"));
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto stats = mCameras[cameraIndex]->stopCallbackCapture();
+			if (stats.path.empty())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "No capture has been started"}};
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+			jsonResponse = {
+				{"status", "success"},
+				{"message", "Capture stopped successfully"},
+				{"homeUrl", stats.path},
+				{"wwwUrl", mServerAddress + ":" + std::to_string(mPort) + "/api/v1/getMedia?fileName=" + stats.path},
+				{"records", stats.records},
+				{"dropped", stats.dropped},
+				{"bytes", stats.bytes},
+				{"seconds", stats.seconds}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== enable motion-triggered recording ========
+	mServer->Post(
+		"/api/v1/motionTrigger/enable",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = std::stoi(req.get_param_value("cameraIndex"));
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			mCameras[cameraIndex]->getMotionTrigger()->setEnabled(true);
+			jsonResponse = {{"status", "success"}, {"message", "Motion trigger enabled"}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== disable motion-triggered recording ========
+	mServer->Post(
+		"/api/v1/motionTrigger/disable",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = std::stoi(req.get_param_value("cameraIndex"));
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			mCameras[cameraIndex]->getMotionTrigger()->setEnabled(false);
+			jsonResponse = {{"status", "success"}, {"message", "Motion trigger disabled"}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
+	//======== motion trigger state ========
+	mServer->Get(
+		"/api/v1/motionTrigger/status",
+		[&](const httplib::Request& req, httplib::Response& res)
+		{
+			nlohmann::json jsonResponse;
+			size_t cameraIndex = 0;
+			try
+			{
+				cameraIndex = req.has_param("cameraIndex") ? std::stoi(req.get_param_value("cameraIndex")) : 0;
+			}
+			catch (...)
+			{
+				cameraIndex = mCameras.size();
+			}
+			if (cameraIndex >= mCameras.size())
+			{
+				jsonResponse = {{"status", "error"}, {"message", "Invalid camera index"}};
+				res.status = BAD_REQUEST;
+				res.set_content(jsonResponse.dump(), "application/json");
+				return;
+			}
+
+			auto stats = mCameras[cameraIndex]->getMotionTrigger()->getStats();
+			jsonResponse = {
+				{"status", "success"},
+				{"enabled", stats.enabled},
+				{"recording", stats.recording},
+				{"motionRms", stats.motionRms},
+				{"exposure", stats.exposure},
+				{"starts", stats.starts},
+				{"stops", stats.stops},
+				{"failedStarts", stats.failedStarts},
+				{"suppressedByExposure", stats.suppressedByExposure},
+				{"latencyMs", {{"last", stats.lastLatencyMs}, {"average", stats.averageLatencyMs}, {"max", stats.maxLatencyMs}}},
+				{"lastStartCallMs", stats.lastStartCallMs}};
+			res.set_content(jsonResponse.dump(), "application/json");
+		}
+	);
 	//======== get battery info ========
 	mServer->Post(
 		"/api/v1/getBatteryInfo",
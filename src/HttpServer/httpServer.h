@@ -1,6 +1,7 @@
 
 #include <httplib.h>
 
+#include <atomic>
 #include <cstddef>
 #include <json.hpp>
 #include <memory>
@@ -9,6 +10,7 @@
 #include <vector>
 
 #include "../LeticoCamera/leticoCamera.h"
+#include "../Stream/frameQueue.h"
 #include "../utils.hpp"
 
 using json = nlohmann::json;
@@ -24,6 +26,7 @@ namespace Letico
 			BAD_REQUEST = 400,
 			NOT_FOUND = 404,
 			INTERNAL_SERVER_ERROR =500,
+			SERVICE_UNAVAILABLE = 503,
 		};
 		enum RequestType
 		{
@@ -37,6 +40,14 @@ namespace Letico
 	private:
 		void createEndpoints();
 		void createServer();
+		static void serveSharedBuffer(httplib::Response& res, const SharedBuffer& buffer, const char* contentType);
+		// Serves a segmenter's media playlist, honouring LL-HLS blocking reload.
+		static void servePlaylist(const httplib::Request& req, httplib::Response& res, const std::shared_ptr<HlsSegmenter>& segmenter);
+		static nlohmann::json healthToJson(const StreamHealthMonitor::Stats& stats);
+		// A streaming response (SSE, raw stream) holds a worker thread until the client leaves. False, with nothing
+		// reserved, when mMaxStreamingClients are already connected; release from the response's releaser.
+		bool acquireStreamingClient();
+		void releaseStreamingClient();
 
 		std::shared_ptr<httplib::Server> mServer;
 		std::vector<std::shared_ptr<LeticoCamera>> mCameras;
@@ -44,6 +55,10 @@ namespace Letico
 
 		std::string mServerAddress;
 		int mPort;
+		size_t mThreadCount = 32;
+		size_t mMaxStreamingClients = 16;
+		std::atomic<size_t> mStreamingClients{0};
+		FrameQueue::Config mRawQueueConfig;
 		std::string mNginxMediaUrl;
 	};
 }
\ No newline at end of file
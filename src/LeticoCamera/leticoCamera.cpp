@@ -1,5 +1,6 @@
 #include "leticoCamera.h"
 
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,17 @@ LeticoCamera::LeticoCamera(): mCurrentDownloadIndex(0)
 
 LeticoCamera::~LeticoCamera()
 {
+	if (mMotionTrigger)
+	{
+		// Its action thread calls back into this camera; it must be gone before the camera is.
+		mStreamDelegate->removeSink(mMotionTrigger);
+		mMotionTrigger.reset();
+	}
+	if (mHealthMonitor)
+	{
+		mStreamDelegate->removeSink(mHealthMonitor);
+		mHealthMonitor.reset();
+	}
 	if (mCamera)
 	{
 		mCamera->Close();
@@ -134,23 +146,129 @@ void LeticoCamera::downloadAllFiles()
 
 std::string LeticoCamera::startPreviewLiveStream()
 {
-	ins_camera::LiveStreamParam param;
-	param.video_resolution = ins_camera::VideoResolution::RES_720_360P30;
-	param.lrv_video_resulution = ins_camera::VideoResolution::RES_720_360P30;
-	param.video_bitrate = 1024 * 1024 / 2;
-	param.enable_audio = false;
-	param.using_lrv = false;
-	if (mCamera->StartLiveStreaming(param))
+	Letico::LiveStreamProfile profile;
+	if (!getStreamProfile("", profile))
+	{
+		return "Unknown stream profile " + mDefaultStreamProfile;
+	}
+	return startPreviewLiveStream(profile);
+}
+
+std::string LeticoCamera::startPreviewLiveStream(const Letico::LiveStreamProfile &requested)
+{
+	Letico::LiveStreamProfile profile = requested;
+	if (mLrvHlsSegmenter)
+	{
+		// The LRV variant of the master playlist needs the LRV stream, so its settings are checked and used
+		// whether or not the profile asks for it.
+		profile.lrv = true;
+	}
+	auto error = getStreamCapabilities().check(profile);
+	if (!error.empty())
+	{
+		return error;
+	}
+	// The LRV variant is what players switch down to; at or above the main bitrate they would rank it first.
+	if (mLrvHlsSegmenter && profile.lrvBitrateKbps >= profile.bitrateKbps)
+	{
+		return "lrvBitrateKbps must be below bitrateKbps with adaptive streaming";
+	}
+	// The LL-HLS segment store is sized for hls.segmentDuration worth of parts.
+	if (mHlsSegmenter->config().lowLatency && profile.segmentDuration > mHlsSegmentDuration)
+	{
+		return "segmentDuration above hls.segmentDuration is not supported in lowLatency mode";
+	}
+	// Waits for a restart in progress and keeps the monitor from starting one while the pipeline is reconfigured;
+	// arm() below watches the new stream.
+	mHealthMonitor->disarm();
+	const double segmentDuration = profile.segmentDuration > 0.0 ? profile.segmentDuration : mHlsSegmentDuration;
+	mHlsSegmenter->setTargetDuration(segmentDuration);
+	if (mLrvHlsSegmenter)
+	{
+		mLrvHlsSegmenter->setTargetDuration(segmentDuration);
+	}
+	mLiveStreamParam = profile.toParam();
+	mLiveStreamParam.audio_samplerate = mAudioFormat.sampleRate;
+	setLiveAudio(profile.audio);
+	mStreamDelegate->resetAudioClock();
+
+	mGopCache->start(mCamera->GetVideoEncodeType());
+	mReplayBuffer->start(mCamera->GetVideoEncodeType());
+	if (mFramePairer)
+	{
+		mFramePairer->start(mCamera->GetVideoEncodeType());
+	}
+	mOrientationEstimator->reset();
+	if (mGyroArchive)
+	{
+		mGyroArchive->start();
+	}
+	mHlsSegmenter->start(mCamera->GetVideoEncodeType());
+	if (mCmafFragmenter)
+	{
+		mCmafFragmenter->start(mCamera->GetVideoEncodeType());
+	}
+	if (mLrvHlsSegmenter)
+	{
+		mLrvHlsSegmenter->start(mCamera->GetVideoEncodeType());
+	}
+	if (mLrvCmafFragmenter)
+	{
+		mLrvCmafFragmenter->start(mCamera->GetVideoEncodeType());
+	}
+	if (mCamera->StartLiveStreaming(mLiveStreamParam))
 	{
 		std::cout << "successfully started live stream" << std::endl;
+		mHealthMonitor->arm();
 		return "";
 	}
 
+	if (mCmafFragmenter)
+	{
+		mCmafFragmenter->stop();
+	}
+	if (mLrvCmafFragmenter)
+	{
+		mLrvCmafFragmenter->stop();
+	}
+	if (mGyroArchive)
+	{
+		mGyroArchive->stop();
+	}
+	mHlsSegmenter->stop();
+	if (mLrvHlsSegmenter)
+	{
+		mLrvHlsSegmenter->stop();
+	}
+	mGopCache->stop();
 	return "Failed to start stream";
 }
 
 std::string LeticoCamera::stopPreviewLiveStream()
 {
+	// Waits for a restart in progress, so it cannot bring the stream back after this stop.
+	mHealthMonitor->disarm();
+	// The fragmenter flushes the open GOP to its consumers first, so recordings and playlists end complete.
+	if (mCmafFragmenter)
+	{
+		mCmafFragmenter->stop();
+	}
+	if (mLrvCmafFragmenter)
+	{
+		mLrvCmafFragmenter->stop();
+	}
+	// Nothing feeds the recorder once the stream is gone; close its file now rather than on the next start.
+	stopHostRecording();
+	if (mGyroArchive)
+	{
+		mGyroArchive->stop();
+	}
+	mHlsSegmenter->stop();
+	if (mLrvHlsSegmenter)
+	{
+		mLrvHlsSegmenter->stop();
+	}
+	mGopCache->stop();
 	if (mCamera->StopLiveStreaming())
 	{
 		std::cout << "success!" << std::endl;
@@ -161,6 +279,171 @@ std::string LeticoCamera::stopPreviewLiveStream()
 	return "Failed to stop live stream";
 }
 
+bool LeticoCamera::restartLiveStream()
+{
+	std::cerr << "Live stream stalled, restarting." << std::endl;
+	if (!mCamera->StopLiveStreaming())
+	{
+		std::cerr << "failed to stop stalled live stream." << std::endl;
+	}
+	// Flush the open GOP before the segmenters close their segments; start() then begins a new init segment.
+	if (mCmafFragmenter)
+	{
+		mCmafFragmenter->stop();
+	}
+	if (mLrvCmafFragmenter)
+	{
+		mLrvCmafFragmenter->stop();
+	}
+	mHlsSegmenter->markDiscontinuity();
+	if (mLrvHlsSegmenter)
+	{
+		mLrvHlsSegmenter->markDiscontinuity();
+	}
+	// Subscribers wait for the first keyframe of the restarted stream.
+	mGopCache->start(mCamera->GetVideoEncodeType());
+	mStreamDelegate->resetAudioClock();
+	if (mCmafFragmenter)
+	{
+		mCmafFragmenter->start(mCamera->GetVideoEncodeType());
+	}
+	if (mLrvCmafFragmenter)
+	{
+		mLrvCmafFragmenter->start(mCamera->GetVideoEncodeType());
+	}
+	if (mCamera->StartLiveStreaming(mLiveStreamParam))
+	{
+		std::cout << "restarted live stream" << std::endl;
+		return true;
+	}
+	std::cerr << "failed to restart live stream." << std::endl;
+	return false;
+}
+
+void LeticoCamera::setLiveAudio(bool enabled)
+{
+	mHlsSegmenter->setAudio(enabled);
+	if (mLrvHlsSegmenter)
+	{
+		mLrvHlsSegmenter->setAudio(enabled);
+	}
+	if (mCmafFragmenter)
+	{
+		mCmafFragmenter->setAudio(enabled, mAudioFormat);
+	}
+	if (mLrvCmafFragmenter)
+	{
+		mLrvCmafFragmenter->setAudio(enabled, mAudioFormat);
+	}
+}
+
+std::string LeticoCamera::saveReplay(double seconds)
+{
+	// Snapshot first so the saved window ends at the moment of the request, not when the write finishes.
+	auto snapshot = mReplayBuffer->snapshot(seconds);
+	if (snapshot.frames.empty())
+	{
+		std::cerr << "Replay buffer is empty." << std::endl;
+		return "";
+	}
+
+	try
+	{
+		YAML::Node config = YAML::LoadFile("config/service.yaml");
+		auto basePath = config["savePath"].as<std::string>();
+
+		const std::string stamp = Utils::fileTimestamp();
+		std::filesystem::path file_to_save = basePath / std::filesystem::path("replay_" + mSerialNumber + "_" + stamp + ".ts");
+		if (!Letico::ReplayBuffer::writeTransportStream(snapshot, file_to_save.string()))
+		{
+			std::cerr << "Failed to write replay to " << file_to_save.string() << std::endl;
+			return "";
+		}
+		std::cout << "Replay of " << snapshot.duration << " s saved to " << file_to_save.string() << std::endl;
+		return file_to_save.string();
+	}
+	catch (...)
+	{
+		return "";
+	}
+}
+
+std::string LeticoCamera::startHostRecording()
+{
+	if (!mHostRecorder->start(mGopCache->codec()))
+	{
+		return "Host recording is already running";
+	}
+	if (mHostRecordingIndex)
+	{
+		startFrameIndex(*mHostRecordingIndex, mHostRecorder->config().directory, "host_index");
+	}
+	std::cout << "Host recording started" << std::endl;
+	return "";
+}
+
+std::vector<std::string> LeticoCamera::stopHostRecording()
+{
+	auto files = mHostRecorder->stop();
+	if (mHostRecordingIndex && mHostRecordingIndex->getStats().active)
+	{
+		files.push_back(mHostRecordingIndex->stop().path);
+	}
+	for (const auto &file : files)
+	{
+		std::cout << "Host recording saved to " << file << std::endl;
+	}
+	return files;
+}
+
+std::string LeticoCamera::getRecordingIndexPath()
+{
+	return mRecordingIndexPath;
+}
+
+std::string LeticoCamera::startFrameIndex(Letico::FrameIndexer &indexer, const std::string &directory, const std::string &prefix)
+{
+	const std::string stamp = Utils::fileTimestamp();
+	std::filesystem::path file_to_save = directory / std::filesystem::path(prefix + "_" + mSerialNumber + "_" + stamp + ".lidx");
+	if (!indexer.start(file_to_save.string(), mGopCache->codec()))
+	{
+		std::cerr << "Failed to start frame index " << file_to_save.string() << std::endl;
+		return "";
+	}
+	return file_to_save.string();
+}
+
+std::string LeticoCamera::startCallbackCapture()
+{
+	try
+	{
+		YAML::Node config = YAML::LoadFile("config/service.yaml");
+		auto basePath = config["savePath"].as<std::string>();
+
+		const std::string stamp = Utils::fileTimestamp();
+		std::filesystem::path file_to_save = basePath / std::filesystem::path("capture_" + mSerialNumber + "_" + stamp + ".ltcap");
+		if (!mCallbackRecorder->start(file_to_save.string()))
+		{
+			std::cerr << "Failed to start callback capture to " << file_to_save.string() << std::endl;
+			return "";
+		}
+		std::cout << "Capturing stream callbacks to " << file_to_save.string() << std::endl;
+		return file_to_save.string();
+	}
+	catch (...)
+	{
+		return "";
+	}
+}
+
+Letico::CallbackRecorder::Stats LeticoCamera::stopCallbackCapture()
+{
+	auto stats = mCallbackRecorder->stop();
+	std::cout << "Captured " << stats.records << " callbacks (" << stats.bytes << " bytes, " << stats.dropped << " dropped) to "
+			  << stats.path << std::endl;
+	return stats;
+}
+
 void LeticoCamera::setExposureSettings(
 	int bias, double shutterSpeed, int iso, ins_camera::PhotographyOptions_ExposureMode exposureMode, ins_camera::CameraFunctionMode functionMode
 )
@@ -493,6 +776,17 @@ std::string LeticoCamera::startRecording(int bitrate, ins_camera::VideoResolutio
 	if (mCamera->StartRecording())
 	{
 		std::cout << "Recording started successfully." << std::endl;
+		if (mRecordingIndex)
+		{
+			try
+			{
+				startFrameIndex(*mRecordingIndex, YAML::LoadFile("config/service.yaml")["savePath"].as<std::string>(), "index");
+			}
+			catch (const YAML::Exception &e)
+			{
+				std::cerr << "No frame index for this recording: " << e.what() << std::endl;
+			}
+		}
 		return errorMessage;
 	}
 	errorMessage = "Failed to start recording.";
@@ -509,6 +803,12 @@ std::vector<std::string> LeticoCamera::stopRecording()
 	}
 
 	auto url = mCamera->StopRecording();
+	if (mRecordingIndex && mRecordingIndex->getStats().active)
+	{
+		auto index = mRecordingIndex->stop();
+		mRecordingIndexPath = index.path;
+		std::cout << "Frame index of " << index.frames << " frames saved to " << index.path << std::endl;
+	}
 	if (url.Empty())
 	{
 		std::cerr << "Stop recording failed." << std::endl;
@@ -549,7 +849,378 @@ void LeticoCamera::discoverAndOpenCamera()
 	{
 		std::cout << "Camera opened successfully." << std::endl;
 	}
+	installStreamDelegate();
 	mSerialNumber = mCamera->GetSerialNumber();
 	std::cout << mCamera->GetHttpBaseUrl();
 	discovery.FreeDeviceDescriptors(list);
 }
+
+void LeticoCamera::installStreamDelegate()
+{
+	size_t videoRingBytes = Letico::LeticoStreamDelegate::DEFAULT_VIDEO_RING_BYTES;
+	Letico::GopCache::Config gopConfig;
+	Letico::HlsSegmenter::Config hlsConfig;
+	Letico::HlsSegmentStore::Config storeConfig;
+	Letico::ReplayBuffer::Config replayConfig;
+	Letico::HostRecorder::Config recorderConfig;
+	Letico::GyroStore::Config gyroConfig;
+	Letico::ExposureStore::Config exposureConfig;
+	Letico::OrientationEstimator::Config orientationConfig;
+	Letico::MotionTrigger::Config triggerConfig;
+	Letico::StreamHealthMonitor::Config healthConfig;
+	Letico::LeticoStreamDelegate::AudioConfig audioConfig;
+	Letico::FramePool::Config poolConfig;
+	Letico::CmafFragmenter::Config fragmenterConfig;
+	Letico::FrameIndexer::Config indexConfig;
+	bool frameIndexEnabled = true;
+	Letico::GyroArchiveWriter::Config archiveConfig;
+	bool gyroArchiveEnabled = false;
+	Letico::FramePairer::Config pairerConfig;
+	bool framePairingEnabled = false;
+	bool adaptiveStreaming = false;
+	int lrvStreamType = 1;
+	mStreamProfiles["default"] = Letico::LiveStreamProfile{};
+	mDefaultStreamProfile = "default";
+	try
+	{
+		YAML::Node config = YAML::LoadFile("config/service.yaml");
+		recorderConfig.directory = config["savePath"].as<std::string>("");
+		archiveConfig.directory = recorderConfig.directory;
+		if (config["stream"] && config["stream"]["videoRingMB"])
+		{
+			videoRingBytes = config["stream"]["videoRingMB"].as<size_t>() * 1024 * 1024;
+		}
+		if (config["stream"] && config["stream"]["gopCacheMB"])
+		{
+			gopConfig.maxBytes = config["stream"]["gopCacheMB"].as<size_t>() * 1024 * 1024;
+		}
+		if (config["stream"] && config["stream"]["gyroSamples"])
+		{
+			gyroConfig.capacity = config["stream"]["gyroSamples"].as<size_t>();
+		}
+		if (config["stream"])
+		{
+			exposureConfig.capacity = config["stream"]["exposureSamples"].as<size_t>(exposureConfig.capacity);
+			exposureConfig.seconds = config["stream"]["exposureSeconds"].as<size_t>(exposureConfig.seconds);
+		}
+		if (config["orientation"])
+		{
+			orientationConfig.beta = config["orientation"]["beta"].as<double>(orientationConfig.beta);
+			orientationConfig.gyroScale = config["orientation"]["gyroScale"].as<double>(orientationConfig.gyroScale);
+			orientationConfig.historySeconds = config["orientation"]["historySeconds"].as<double>(orientationConfig.historySeconds);
+			orientationConfig.historyHz = config["orientation"]["historyHz"].as<double>(orientationConfig.historyHz);
+		}
+		if (config["motionTrigger"])
+		{
+			auto trigger = config["motionTrigger"];
+			triggerConfig.enabled = trigger["enabled"].as<bool>(triggerConfig.enabled);
+			triggerConfig.windowMs = trigger["windowMs"].as<double>(triggerConfig.windowMs);
+			triggerConfig.startRms = trigger["startRms"].as<double>(triggerConfig.startRms);
+			triggerConfig.stopRms = trigger["stopRms"].as<double>(triggerConfig.stopRms);
+			triggerConfig.startHoldMs = trigger["startHoldMs"].as<double>(triggerConfig.startHoldMs);
+			triggerConfig.stopHoldSeconds = trigger["stopHoldSeconds"].as<double>(triggerConfig.stopHoldSeconds);
+			triggerConfig.minRecordSeconds = trigger["minRecordSeconds"].as<double>(triggerConfig.minRecordSeconds);
+			triggerConfig.maxExposure = trigger["maxExposure"].as<double>(triggerConfig.maxExposure);
+		}
+		if (config["streamHealth"])
+		{
+			auto health = config["streamHealth"];
+			healthConfig.autoRestart = health["autoRestart"].as<bool>(healthConfig.autoRestart);
+			healthConfig.stallSeconds = health["stallSeconds"].as<double>(healthConfig.stallSeconds);
+			healthConfig.startupSeconds = health["startupSeconds"].as<double>(healthConfig.startupSeconds);
+			healthConfig.gapMs = health["gapMs"].as<double>(healthConfig.gapMs);
+			healthConfig.initialBackoffSeconds = health["initialBackoffSeconds"].as<double>(healthConfig.initialBackoffSeconds);
+			healthConfig.maxBackoffSeconds = health["maxBackoffSeconds"].as<double>(healthConfig.maxBackoffSeconds);
+			healthConfig.healthySeconds = health["healthySeconds"].as<double>(healthConfig.healthySeconds);
+		}
+		if (config["audio"])
+		{
+			auto audio = config["audio"];
+			audioConfig.format.sampleRate = audio["sampleRate"].as<uint32_t>(audioConfig.format.sampleRate);
+			audioConfig.format.channels = static_cast<uint8_t>(audio["channels"].as<int>(audioConfig.format.channels));
+			audioConfig.clock.sameClockMs = audio["sameClockMs"].as<double>(audioConfig.clock.sameClockMs);
+			audioConfig.clock.maxSkewMs = audio["maxSkewMs"].as<double>(audioConfig.clock.maxSkewMs);
+			audioConfig.clock.jumpMs = audio["jumpMs"].as<double>(audioConfig.clock.jumpMs);
+			hlsConfig.audioQueueMs = audio["queueMs"].as<double>(hlsConfig.audioQueueMs);
+			fragmenterConfig.audioQueueMs = hlsConfig.audioQueueMs;
+		}
+		if (config["framePool"])
+		{
+			auto pool = config["framePool"];
+			for (const auto &kb : pool["classKB"])
+			{
+				poolConfig.classBytes.push_back(kb.as<size_t>() << 10);
+			}
+			poolConfig.maxBytes = pool["maxMB"].as<size_t>(poolConfig.maxBytes >> 20) << 20;
+		}
+		if (config["frameIndex"])
+		{
+			frameIndexEnabled = config["frameIndex"]["enabled"].as<bool>(frameIndexEnabled);
+			indexConfig.samplesPerFrame = config["frameIndex"]["samplesPerFrame"].as<uint32_t>(indexConfig.samplesPerFrame);
+			indexConfig.gyroMarginMs = config["frameIndex"]["gyroMarginMs"].as<double>(indexConfig.gyroMarginMs);
+			indexConfig.matchToleranceMs = config["frameIndex"]["matchToleranceMs"].as<double>(indexConfig.matchToleranceMs);
+		}
+		if (config["gyroArchive"])
+		{
+			auto archive = config["gyroArchive"];
+			gyroArchiveEnabled = archive["enabled"].as<bool>(gyroArchiveEnabled);
+			archiveConfig.directory = archive["directory"].as<std::string>(archiveConfig.directory);
+			archiveConfig.chunkSamples = archive["chunkSamples"].as<uint32_t>(archiveConfig.chunkSamples);
+			archiveConfig.rollSeconds = archive["rollMinutes"].as<double>(archiveConfig.rollSeconds / 60.0) * 60.0;
+			archiveConfig.accelStep = archive["accelStep"].as<double>(archiveConfig.accelStep);
+			archiveConfig.gyroStep = archive["gyroStep"].as<double>(archiveConfig.gyroStep);
+		}
+		if (config["liveStream"])
+		{
+			auto live = config["liveStream"];
+			for (const auto &entry : live["profiles"])
+			{
+				mStreamProfiles[entry.first.as<std::string>()] =
+					Letico::LiveStreamProfile::fromYaml(entry.second, Letico::LiveStreamProfile{});
+			}
+			mDefaultStreamProfile = live["profile"].as<std::string>(mDefaultStreamProfile);
+			adaptiveStreaming = live["adaptive"].as<bool>(adaptiveStreaming);
+			lrvStreamType = live["lrvStreamType"].as<int>(lrvStreamType);
+		}
+		if (config["framePairing"])
+		{
+			framePairingEnabled = config["framePairing"]["enabled"].as<bool>(framePairingEnabled);
+			pairerConfig.toleranceMs = config["framePairing"]["toleranceMs"].as<double>(pairerConfig.toleranceMs);
+			pairerConfig.maxQueuedFrames = config["framePairing"]["maxQueuedFrames"].as<size_t>(pairerConfig.maxQueuedFrames);
+		}
+		if (config["hls"])
+		{
+			hlsConfig.targetDuration = config["hls"]["segmentDuration"].as<double>(hlsConfig.targetDuration);
+			hlsConfig.windowSize = config["hls"]["windowSize"].as<size_t>(hlsConfig.windowSize);
+			hlsConfig.lowLatency = config["hls"]["mode"].as<std::string>("standard") == "lowLatency";
+			hlsConfig.partTarget = config["hls"]["partDuration"].as<double>(hlsConfig.partTarget);
+			// Low-latency mode keeps every partial segment in the store as well.
+			size_t objectsPerSegment = hlsConfig.lowLatency ? static_cast<size_t>(hlsConfig.targetDuration / hlsConfig.partTarget) + 2 : 1;
+			storeConfig.maxSegments =
+				config["hls"]["storeSegments"].as<size_t>((hlsConfig.windowSize + 4) * objectsPerSegment);
+			storeConfig.maxAge = std::chrono::seconds(config["hls"]["segmentMaxAge"].as<int>(30));
+			hlsConfig.fragmentedMp4 = config["hls"]["container"].as<std::string>("ts") == "fmp4";
+			if (hlsConfig.fragmentedMp4 && hlsConfig.lowLatency)
+			{
+				// Fragments are cut per GOP, far longer than a partial segment.
+				std::cerr << "hls.container fmp4 is not supported in lowLatency mode, using ts" << std::endl;
+				hlsConfig.fragmentedMp4 = false;
+			}
+		}
+		if (config["replay"])
+		{
+			replayConfig.maxSeconds = config["replay"]["seconds"].as<double>(replayConfig.maxSeconds);
+			replayConfig.maxBytes = config["replay"]["maxMB"].as<size_t>(replayConfig.maxBytes >> 20) << 20;
+		}
+		if (config["recording"])
+		{
+			recorderConfig.directory = config["recording"]["directory"].as<std::string>(recorderConfig.directory);
+			recorderConfig.rollSeconds = config["recording"]["rollMinutes"].as<double>(recorderConfig.rollSeconds / 60.0) * 60.0;
+			recorderConfig.blockBytes = config["recording"]["blockMB"].as<size_t>(recorderConfig.blockBytes >> 20) << 20;
+			recorderConfig.preallocateBytes =
+				config["recording"]["preallocateMB"].as<size_t>(recorderConfig.preallocateBytes >> 20) << 20;
+			recorderConfig.directIo = config["recording"]["directIo"].as<bool>(recorderConfig.directIo);
+			recorderConfig.format = config["recording"]["format"].as<std::string>("ts") == "mp4" ? Letico::HostRecorder::Format::Mp4
+																								  : Letico::HostRecorder::Format::Ts;
+			recorderConfig.queue.maxBytes = config["recording"]["queueMB"].as<size_t>(recorderConfig.queue.maxBytes >> 20) << 20;
+		}
+	}
+	catch (const YAML::Exception &e)
+	{
+		std::cerr << "Error reading stream config: " << e.what() << std::endl;
+	}
+
+	if (Letico::AdtsFramer::samplingIndex(audioConfig.format.sampleRate) < 0)
+	{
+		std::cerr << "audio.sampleRate " << audioConfig.format.sampleRate << " is not an AAC rate, using 48000" << std::endl;
+		audioConfig.format.sampleRate = 48000;
+	}
+	mAudioFormat = audioConfig.format;
+	mStreamDelegate = std::make_shared<Letico::LeticoStreamDelegate>(videoRingBytes, audioConfig, poolConfig);
+	mGopCache = std::make_shared<Letico::GopCache>(gopConfig);
+	mHlsSegmentDuration = hlsConfig.targetDuration;
+	mLiveStreamParam = mStreamProfiles[mDefaultStreamProfile].toParam();
+	mHlsSegmenter = std::make_shared<Letico::HlsSegmenter>(hlsConfig, std::make_shared<Letico::HlsSegmentStore>(storeConfig));
+	mStreamDelegate->addSink(mGopCache);
+	mGyroStore = std::make_shared<Letico::GyroStore>(gyroConfig);
+	mStreamDelegate->addSink(mGyroStore);
+	mExposureStore = std::make_shared<Letico::ExposureStore>(exposureConfig);
+	mStreamDelegate->addSink(mExposureStore);
+	if (gyroArchiveEnabled)
+	{
+		archiveConfig.filePrefix = "gyro_" + (mCamera ? mCamera->GetSerialNumber() : std::string("camera"));
+		mGyroArchive = std::make_shared<Letico::GyroArchiveWriter>(archiveConfig);
+		mStreamDelegate->addSink(mGyroArchive);
+	}
+	mOrientationEstimator = std::make_shared<Letico::OrientationEstimator>(orientationConfig);
+	mStreamDelegate->addSink(mOrientationEstimator);
+	if (frameIndexEnabled)
+	{
+		mRecordingIndex = std::make_shared<Letico::FrameIndexer>(indexConfig);
+		mHostRecordingIndex = std::make_shared<Letico::FrameIndexer>(indexConfig);
+		mStreamDelegate->addSink(mRecordingIndex);
+		mStreamDelegate->addSink(mHostRecordingIndex);
+	}
+	triggerConfig.gyroScale = orientationConfig.gyroScale;
+	mMotionTrigger = std::make_shared<Letico::MotionTrigger>(
+		triggerConfig, [this] { return startRecording().empty(); }, [this] { stopRecording(); }
+	);
+	mStreamDelegate->addSink(mMotionTrigger);
+	mHealthMonitor = std::make_shared<Letico::StreamHealthMonitor>(healthConfig, [this] { return restartLiveStream(); });
+	mStreamDelegate->addSink(mHealthMonitor);
+	mReplayBuffer = std::make_shared<Letico::ReplayBuffer>(replayConfig);
+	if (hlsConfig.fragmentedMp4 || recorderConfig.format == Letico::HostRecorder::Format::Mp4)
+	{
+		// One fMP4 muxing pass shared by HLS and the host recorder.
+		mCmafFragmenter = std::make_shared<Letico::CmafFragmenter>(fragmenterConfig);
+		mGopCache->subscribe(mCmafFragmenter);
+	}
+	if (hlsConfig.fragmentedMp4)
+	{
+		mCmafFragmenter->subscribe(mHlsSegmenter);
+	}
+	else
+	{
+		mGopCache->subscribe(mHlsSegmenter);
+	}
+	if (adaptiveStreaming)
+	{
+		// The LRV stream is segmented in parallel as the second variant of the master playlist.
+		mStreamDelegate->setLrvStreamType(lrvStreamType);
+		auto lrvConfig = hlsConfig;
+		lrvConfig.streamIndex = Letico::LRV_STREAM_INDEX;
+		lrvConfig.segmentPrefix = LRV_SEGMENT_PREFIX;
+		mLrvHlsSegmenter = std::make_shared<Letico::HlsSegmenter>(lrvConfig, std::make_shared<Letico::HlsSegmentStore>(storeConfig));
+		if (lrvConfig.fragmentedMp4)
+		{
+			auto lrvFragmenterConfig = fragmenterConfig;
+			lrvFragmenterConfig.streamIndex = Letico::LRV_STREAM_INDEX;
+			mLrvCmafFragmenter = std::make_shared<Letico::CmafFragmenter>(lrvFragmenterConfig);
+			mGopCache->subscribe(mLrvCmafFragmenter);
+			mLrvCmafFragmenter->subscribe(mLrvHlsSegmenter);
+		}
+		else
+		{
+			mGopCache->subscribe(mLrvHlsSegmenter);
+		}
+	}
+	mGopCache->subscribe(mReplayBuffer);
+	if (framePairingEnabled)
+	{
+		mFramePairer = std::make_shared<Letico::FramePairer>(pairerConfig);
+		mGopCache->subscribe(mFramePairer);
+	}
+	recorderConfig.filePrefix = "host_" + (mCamera ? mCamera->GetSerialNumber() : std::string("camera"));
+	mHostRecorder = std::make_shared<Letico::HostRecorder>(recorderConfig, mGopCache, mCmafFragmenter);
+	mCallbackRecorder = std::make_shared<Letico::CallbackRecorder>(mStreamDelegate);
+	if (mCamera)
+	{
+		std::shared_ptr<ins_camera::StreamDelegate> delegate = mCallbackRecorder;
+		mCamera->SetStreamDelegate(delegate);
+	}
+}
+
+std::shared_ptr<Letico::LeticoStreamDelegate> LeticoCamera::getStreamDelegate()
+{
+	return mStreamDelegate;
+}
+
+std::shared_ptr<Letico::HlsSegmenter> LeticoCamera::getHlsSegmenter()
+{
+	return mHlsSegmenter;
+}
+
+bool LeticoCamera::getStreamProfile(const std::string &name, Letico::LiveStreamProfile &profile)
+{
+	auto it = mStreamProfiles.find(name.empty() ? mDefaultStreamProfile : name);
+	if (it == mStreamProfiles.end())
+		return false;
+	profile = it->second;
+	return true;
+}
+
+std::vector<std::string> LeticoCamera::getStreamProfileNames()
+{
+	std::vector<std::string> names;
+	for (const auto &entry : mStreamProfiles)
+	{
+		names.push_back(entry.first);
+	}
+	return names;
+}
+
+Letico::LiveStreamCapabilities LeticoCamera::getStreamCapabilities()
+{
+	return Letico::LiveStreamCapabilities::forCamera(mCamera ? mCamera->GetCameraType() : ins_camera::CameraType::Unknown);
+}
+
+std::shared_ptr<Letico::HlsSegmenter> LeticoCamera::getLrvHlsSegmenter()
+{
+	return mLrvHlsSegmenter;
+}
+
+std::string LeticoCamera::getMasterPlaylist()
+{
+	if (!mLrvHlsSegmenter)
+		return "";
+	std::vector<Letico::HlsMasterPlaylist::Variant> variants(2);
+	variants[0].uri = "stream.m3u8";
+	variants[0].bandwidth = mLiveStreamParam.video_bitrate;
+	variants[0].parameterSets = mGopCache->parameterSets(0);
+	variants[1].uri = "stream_lrv.m3u8";
+	variants[1].bandwidth = mLiveStreamParam.lrv_video_bitrate;
+	variants[1].parameterSets = mGopCache->parameterSets(Letico::LRV_STREAM_INDEX);
+	if (mLiveStreamParam.enable_audio)
+	{
+		// The ADTS headers of the camera decide the format, which may differ from the configured one.
+		auto format = mStreamDelegate->getStats().audioFormat;
+		variants[0].audioCodec = Letico::AdtsFramer::codecString(format);
+		variants[1].audioCodec = variants[0].audioCodec;
+	}
+	return Letico::HlsMasterPlaylist::build(mGopCache->codec(), variants);
+}
+
+std::shared_ptr<Letico::GopCache> LeticoCamera::getGopCache()
+{
+	return mGopCache;
+}
+
+std::shared_ptr<Letico::HostRecorder> LeticoCamera::getHostRecorder()
+{
+	return mHostRecorder;
+}
+
+std::shared_ptr<Letico::GyroStore> LeticoCamera::getGyroStore()
+{
+	return mGyroStore;
+}
+
+std::shared_ptr<Letico::ExposureStore> LeticoCamera::getExposureStore()
+{
+	return mExposureStore;
+}
+
+std::shared_ptr<Letico::GyroArchiveWriter> LeticoCamera::getGyroArchive()
+{
+	return mGyroArchive;
+}
+
+std::shared_ptr<Letico::FramePairer> LeticoCamera::getFramePairer()
+{
+	return mFramePairer;
+}
+
+std::shared_ptr<Letico::OrientationEstimator> LeticoCamera::getOrientationEstimator()
+{
+	return mOrientationEstimator;
+}
+
+std::shared_ptr<Letico::MotionTrigger> LeticoCamera::getMotionTrigger()
+{
+	return mMotionTrigger;
+}
+
+std::shared_ptr<Letico::StreamHealthMonitor> LeticoCamera::getHealthMonitor()
+{
+	return mHealthMonitor;
+}
@@ -6,17 +6,38 @@
 
 #include <iostream>
 #include <json.hpp>
+#include <map>
 #include <string>
 #include <thread>
 #include <vector>
 #include <yaml-cpp/yaml.h>
 
+#include "../Stream/callbackRecorder.h"
+#include "../Stream/cmafFragmenter.h"
+#include "../Stream/exposureStore.h"
+#include "../Stream/frameIndex.h"
+#include "../Stream/framePairer.h"
+#include "../Stream/gopCache.h"
+#include "../Stream/gyroArchive.h"
+#include "../Stream/gyroStore.h"
+#include "../Stream/hlsMasterPlaylist.h"
+#include "../Stream/hlsSegmenter.h"
+#include "../Stream/hostRecorder.h"
+#include "../Stream/leticoStreamDelegate.h"
+#include "../Stream/motionTrigger.h"
+#include "../Stream/orientationEstimator.h"
+#include "../Stream/replayBuffer.h"
+#include "../Stream/streamHealthMonitor.h"
 #include "../utils.hpp"
+#include "liveStreamProfile.h"
 
 using json = nlohmann::json;
 class LeticoCamera
 {
 public:
+	// Segment names of the LRV rendition start with this, so the HTTP server knows which store serves them.
+	static constexpr const char* LRV_SEGMENT_PREFIX = "lrv_segment";
+
 	LeticoCamera();
 
 	~LeticoCamera();
@@ -37,8 +58,25 @@ public:
 		ins_camera::CameraFunctionMode functionMode = ins_camera::CameraFunctionMode::FUNCTION_MODE_NORMAL_VIDEO
 	);
 	std::vector<std::string> stopRecording();
+	// Frame/exposure/gyro sidecar index of the last camera recording, or "" if none was written.
+	std::string getRecordingIndexPath();
+	// Starts the live stream with the default profile (liveStream.profile).
 	std::string startPreviewLiveStream();
+	// Returns an error if the camera cannot stream `profile`, without touching the camera.
+	std::string startPreviewLiveStream(const Letico::LiveStreamProfile& profile);
+	// Profile `name` from liveStream.profiles, or the default profile for "". False if there is no such profile.
+	bool getStreamProfile(const std::string& name, Letico::LiveStreamProfile& profile);
+	std::vector<std::string> getStreamProfileNames();
+	Letico::LiveStreamCapabilities getStreamCapabilities();
 	std::string stopPreviewLiveStream();
+	// Writes the last `seconds` of the live stream to savePath; returns the file path or "" on failure.
+	std::string saveReplay(double seconds);
+	// Records the live stream on the host into rolling files under recording.directory; returns an error or "".
+	std::string startHostRecording();
+	std::vector<std::string> stopHostRecording();
+	// Captures the raw SDK stream callbacks to savePath for offline replay; returns the file path or "".
+	std::string startCallbackCapture();
+	Letico::CallbackRecorder::Stats stopCallbackCapture();
 	void setExposureSettings(
 		int bias = 0,
 		double shutterSpeed = 1.0 / 120.0,
@@ -69,13 +107,62 @@ public:
 	void stopTimelapse();
 	json getBatteryStatus();
 	json getStorageInfo();
+	std::shared_ptr<Letico::LeticoStreamDelegate> getStreamDelegate();
+	std::shared_ptr<Letico::HlsSegmenter> getHlsSegmenter();
+	// LRV rendition, nullptr unless liveStream.adaptive.
+	std::shared_ptr<Letico::HlsSegmenter> getLrvHlsSegmenter();
+	// Master playlist listing the main and LRV variants, or "" unless liveStream.adaptive.
+	std::string getMasterPlaylist();
+	std::shared_ptr<Letico::GopCache> getGopCache();
+	std::shared_ptr<Letico::HostRecorder> getHostRecorder();
+	std::shared_ptr<Letico::GyroStore> getGyroStore();
+	std::shared_ptr<Letico::ExposureStore> getExposureStore();
+	// nullptr unless gyroArchive.enabled.
+	std::shared_ptr<Letico::GyroArchiveWriter> getGyroArchive();
+	// nullptr unless framePairing.enabled; stitchers and dual-lens muxers subscribe here.
+	std::shared_ptr<Letico::FramePairer> getFramePairer();
+	std::shared_ptr<Letico::OrientationEstimator> getOrientationEstimator();
+	std::shared_ptr<Letico::MotionTrigger> getMotionTrigger();
+	std::shared_ptr<Letico::StreamHealthMonitor> getHealthMonitor();
 
 	// More camera-related methods...
 
 private:
 	std::shared_ptr<ins_camera::Camera> mCamera;
 	std::vector<std::string> mSerialNumbersVec;
+	std::shared_ptr<Letico::LeticoStreamDelegate> mStreamDelegate;
+	std::shared_ptr<Letico::CallbackRecorder> mCallbackRecorder;  // what the SDK calls; forwards to mStreamDelegate
+	std::shared_ptr<Letico::GopCache> mGopCache;
+	std::shared_ptr<Letico::CmafFragmenter> mCmafFragmenter;  // only when HLS or recording use fMP4
+	std::shared_ptr<Letico::HlsSegmenter> mHlsSegmenter;
+	std::shared_ptr<Letico::HlsSegmenter> mLrvHlsSegmenter;
+	std::shared_ptr<Letico::CmafFragmenter> mLrvCmafFragmenter;
+	ins_camera::LiveStreamParam mLiveStreamParam;  // of the running or last live stream
+	std::map<std::string, Letico::LiveStreamProfile> mStreamProfiles;
+	std::string mDefaultStreamProfile;
+	double mHlsSegmentDuration = 2.0;  // hls.segmentDuration, used by profiles that set none
+	Letico::AdtsFramer::Config mAudioFormat;  // audio.sampleRate / audio.channels, requested from the camera
+	std::shared_ptr<Letico::ReplayBuffer> mReplayBuffer;
+	std::shared_ptr<Letico::FramePairer> mFramePairer;	// dual-lens cameras only
+	std::shared_ptr<Letico::HostRecorder> mHostRecorder;
+	std::shared_ptr<Letico::GyroStore> mGyroStore;
+	std::shared_ptr<Letico::ExposureStore> mExposureStore;
+	std::shared_ptr<Letico::GyroArchiveWriter> mGyroArchive;  // written while the live stream runs
+	std::shared_ptr<Letico::OrientationEstimator> mOrientationEstimator;
+	std::shared_ptr<Letico::MotionTrigger> mMotionTrigger;  // starts/stops camera recording on motion
+	std::shared_ptr<Letico::StreamHealthMonitor> mHealthMonitor;  // restarts a stalled live stream
+	std::shared_ptr<Letico::FrameIndexer> mRecordingIndex;	 // camera recordings
+	std::shared_ptr<Letico::FrameIndexer> mHostRecordingIndex;
+	std::string mRecordingIndexPath;
 	void discoverAndOpenCamera();
+	void installStreamDelegate();
+	// Tells the segmenters and fragmenters whether the next session carries audio.
+	void setLiveAudio(bool enabled);
+	// Stops and starts the camera stream with the running parameters, keeping the HLS session; the segmenters mark
+	// the break with EXT-X-DISCONTINUITY. Called by the health monitor on a stall.
+	bool restartLiveStream();
+	// Starts `indexer` on <directory>/<prefix>_<serial>_<time>.lidx; returns the path or "".
+	std::string startFrameIndex(Letico::FrameIndexer& indexer, const std::string& directory, const std::string& prefix);
 	std::string mSerialNumber;
 	size_t mCurrentDownloadIndex;
 };
@@ -0,0 +1,94 @@
+#include "liveStreamProfile.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace Letico;
+
+namespace
+{
+	bool contains(const std::vector<ins_camera::VideoResolution>& list, ins_camera::VideoResolution resolution)
+	{
+		return std::find(list.begin(), list.end(), resolution) != list.end();
+	}
+}
+
+LiveStreamProfile LiveStreamProfile::fromYaml(const YAML::Node& node, const LiveStreamProfile& base)
+{
+	LiveStreamProfile profile = base;
+	profile.resolution = static_cast<ins_camera::VideoResolution>(node["resolution"].as<int>(static_cast<int>(base.resolution)));
+	profile.bitrateKbps = node["bitrateKbps"].as<uint32_t>(base.bitrateKbps);
+	profile.lrvResolution =
+		static_cast<ins_camera::VideoResolution>(node["lrvResolution"].as<int>(static_cast<int>(base.lrvResolution)));
+	profile.lrvBitrateKbps = node["lrvBitrateKbps"].as<uint32_t>(base.lrvBitrateKbps);
+	profile.audio = node["audio"].as<bool>(base.audio);
+	profile.gyro = node["gyro"].as<bool>(base.gyro);
+	profile.lrv = node["lrv"].as<bool>(base.lrv);
+	profile.segmentDuration = node["segmentDuration"].as<double>(base.segmentDuration);
+	return profile;
+}
+
+ins_camera::LiveStreamParam LiveStreamProfile::toParam() const
+{
+	ins_camera::LiveStreamParam param;
+	param.video_resolution = resolution;
+	param.video_bitrate = bitrateKbps * 1024;
+	param.lrv_video_resulution = lrvResolution;
+	param.lrv_video_bitrate = lrvBitrateKbps * 1024;
+	param.enable_audio = audio;
+	param.enable_gyro = gyro;
+	param.using_lrv = lrv;
+	return param;
+}
+
+LiveStreamCapabilities LiveStreamCapabilities::forCamera(ins_camera::CameraType type)
+{
+	using ins_camera::VideoResolution;
+	LiveStreamCapabilities capabilities;
+	capabilities.resolutions = {
+		VideoResolution::RES_720_360P30,
+		VideoResolution::RES_1440_720P30,
+		VideoResolution::RES_1920_960P30,
+		VideoResolution::RES_2560_1280P30};
+	capabilities.lrvResolutions = {
+		VideoResolution::RES_640_320P30,
+		VideoResolution::RES_720_360P30,
+		VideoResolution::RES_1024_512P30,
+		VideoResolution::RES_1440_720P30};
+	capabilities.maxBitrateKbps = 20 * 1024;
+	switch (type)
+	{
+	case ins_camera::CameraType::Insta360OneX2:
+	case ins_camera::CameraType::Insta360OneRS:
+	case ins_camera::CameraType::Insta360X3:
+		capabilities.resolutions.push_back(VideoResolution::RES_3840_1920P30);
+		capabilities.maxBitrateKbps = 40 * 1024;
+		break;
+	default:
+		break;
+	}
+	return capabilities;
+}
+
+std::string LiveStreamCapabilities::check(const LiveStreamProfile& profile) const
+{
+	if (!contains(resolutions, profile.resolution))
+		return "Resolution " + std::to_string(static_cast<int>(profile.resolution)) + " is not supported by this camera";
+	if (profile.bitrateKbps < minBitrateKbps || profile.bitrateKbps > maxBitrateKbps)
+		return "bitrateKbps must be between " + std::to_string(minBitrateKbps) + " and " + std::to_string(maxBitrateKbps);
+	if (profile.lrv)
+	{
+		if (!contains(lrvResolutions, profile.lrvResolution))
+			return "LRV resolution " + std::to_string(static_cast<int>(profile.lrvResolution)) + " is not supported by this camera";
+		if (profile.lrvBitrateKbps < minBitrateKbps || profile.lrvBitrateKbps > maxBitrateKbps)
+			return "lrvBitrateKbps must be between " + std::to_string(minBitrateKbps) + " and " + std::to_string(maxBitrateKbps);
+	}
+	if (profile.segmentDuration != 0.0 &&
+		(profile.segmentDuration < minSegmentDuration || profile.segmentDuration > maxSegmentDuration))
+	{
+		char message[96];
+		std::snprintf(message, sizeof(message), "segmentDuration must be between %g and %g seconds", minSegmentDuration, maxSegmentDuration);
+		return message;
+	}
+	return "";
+}
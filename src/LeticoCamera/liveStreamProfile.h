@@ -0,0 +1,47 @@
+#pragma once
+
+#include <camera/camera.h>
+#include <camera/photography_settings.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+namespace Letico
+{
+	// Named set of live stream parameters (liveStream.profiles in config/service.yaml). Resolutions are
+	// ins_camera::VideoResolution values. Fields a configured profile leaves out keep the defaults below, not the
+	// values of another profile.
+	struct LiveStreamProfile
+	{
+		// The LRV stream is the switch-down variant of adaptive streaming, so it stays below the main stream.
+		ins_camera::VideoResolution resolution = ins_camera::VideoResolution::RES_1440_720P30;
+		uint32_t bitrateKbps = 2048;
+		ins_camera::VideoResolution lrvResolution = ins_camera::VideoResolution::RES_720_360P30;
+		uint32_t lrvBitrateKbps = 512;
+		bool audio = true;
+		bool gyro = true;
+		bool lrv = false;  // LiveStreamParam::using_lrv
+		double segmentDuration = 0.0;  // HLS target duration in seconds; 0 = hls.segmentDuration
+
+		// Fields missing from `node` keep their value from `base`. Throws YAML::Exception on malformed values.
+		static LiveStreamProfile fromYaml(const YAML::Node& node, const LiveStreamProfile& base);
+		ins_camera::LiveStreamParam toParam() const;
+	};
+
+	// What a camera model can stream live. The SDK has no capability query, so this is a table per CameraType.
+	struct LiveStreamCapabilities
+	{
+		std::vector<ins_camera::VideoResolution> resolutions;
+		std::vector<ins_camera::VideoResolution> lrvResolutions;
+		uint32_t minBitrateKbps = 100;
+		uint32_t maxBitrateKbps = 0;
+		double minSegmentDuration = 0.5;
+		double maxSegmentDuration = 10.0;
+
+		static LiveStreamCapabilities forCamera(ins_camera::CameraType type);
+		// "" if the camera can stream `profile`, otherwise what is wrong with it.
+		std::string check(const LiveStreamProfile& profile) const;
+	};
+}
@@ -0,0 +1,129 @@
+#include "rtspServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+
+#include <cerrno>
+#include <iostream>
+#include <utility>
+
+using namespace Letico;
+
+LeticoRtspServer::LeticoRtspServer(std::vector<std::shared_ptr<GopCache>> sources):
+	LeticoRtspServer(std::move(sources), loadConfig())
+{
+}
+
+LeticoRtspServer::LeticoRtspServer(std::vector<std::shared_ptr<GopCache>> sources, Config config):
+	mSources(std::move(sources)),
+	mConfig(std::move(config))
+{
+	start();
+}
+
+LeticoRtspServer::~LeticoRtspServer()
+{
+	mRunning.store(false, std::memory_order_release);
+	if (mListenSocket >= 0)
+	{
+		// Wakes the blocking accept().
+		::shutdown(mListenSocket, SHUT_RDWR);
+		::close(mListenSocket);
+	}
+	if (mAcceptThread.joinable())
+		mAcceptThread.join();
+
+	std::lock_guard<std::mutex> lock(mSessionsMutex);
+	for (auto& session : mSessions)
+	{
+		session->stop();
+	}
+	mSessions.clear();
+}
+
+LeticoRtspServer::Config LeticoRtspServer::loadConfig()
+{
+	Config config;
+	try
+	{
+		YAML::Node yaml = YAML::LoadFile("config/service.yaml");
+		if (yaml["rtsp"])
+		{
+			config.address = yaml["rtsp"]["address"].as<std::string>(config.address);
+			config.port = yaml["rtsp"]["port"].as<int>(config.port);
+			config.maxClients = yaml["rtsp"]["maxClients"].as<size_t>(config.maxClients);
+			config.session.maxPacketSize = yaml["rtsp"]["packetSize"].as<size_t>(config.session.maxPacketSize);
+		}
+	}
+	catch (const YAML::Exception& e)
+	{
+		std::cerr << "Error reading RTSP config: " << e.what() << std::endl;
+	}
+	return config;
+}
+
+void LeticoRtspServer::start()
+{
+	mListenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (mListenSocket < 0)
+	{
+		std::cerr << "RTSP server: unable to create socket" << std::endl;
+		return;
+	}
+	const int reuse = 1;
+	::setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(static_cast<uint16_t>(mConfig.port));
+	if (::inet_pton(AF_INET, mConfig.address.c_str(), &address.sin_addr) != 1 ||
+		::bind(mListenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(mListenSocket, 16) != 0)
+	{
+		std::cerr << "RTSP server: unable to listen on " << mConfig.address << ":" << mConfig.port << std::endl;
+		::close(mListenSocket);
+		mListenSocket = -1;
+		return;
+	}
+
+	socklen_t length = sizeof(address);
+	::getsockname(mListenSocket, reinterpret_cast<sockaddr*>(&address), &length);
+	mPort = ntohs(address.sin_port);
+	mRunning.store(true, std::memory_order_release);
+	mAcceptThread = std::thread([this] { acceptLoop(); });
+	std::cout << "RTSP server listen on port " << mPort << std::endl;
+}
+
+void LeticoRtspServer::acceptLoop()
+{
+	while (mRunning.load(std::memory_order_acquire))
+	{
+		sockaddr_in peer{};
+		socklen_t length = sizeof(peer);
+		const int socket = ::accept(mListenSocket, reinterpret_cast<sockaddr*>(&peer), &length);
+		if (socket < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		std::lock_guard<std::mutex> lock(mSessionsMutex);
+		reapSessionsLocked();
+		if (mSessions.size() >= mConfig.maxClients)
+		{
+			::close(socket);
+			continue;
+		}
+		auto session = std::make_unique<RtspSession>(socket, peer, mSources, mConfig.session);
+		session->start();
+		mSessions.push_back(std::move(session));
+	}
+}
+
+void LeticoRtspServer::reapSessionsLocked()
+{
+	mSessions.remove_if([](const std::unique_ptr<RtspSession>& session) { return session->finished(); });
+}
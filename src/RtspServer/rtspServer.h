@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Stream/gopCache.h"
+#include "rtspSession.h"
+
+namespace Letico
+{
+	// RTSP/RTP server for the live preview, running next to LeticoHttpServer. Clients open
+	// rtsp://<address>:<port>/camera<N>/stream<K> and receive RTP over UDP or interleaved on the RTSP connection.
+	// Each connection gets its own session and threads; frames are shared with every other consumer through the
+	// camera's GOP cache, so a new client starts on the last keyframe.
+	class LeticoRtspServer
+	{
+	public:
+		struct Config
+		{
+			std::string address = "0.0.0.0";
+			int port = 8554;  // 0 picks a free port, see port()
+			size_t maxClients = 16;
+			RtspSession::Config session;
+		};
+
+		// `sources` holds one GOP cache per camera, in the same order as the HTTP server's camera list.
+		explicit LeticoRtspServer(std::vector<std::shared_ptr<GopCache>> sources);
+		LeticoRtspServer(std::vector<std::shared_ptr<GopCache>> sources, Config config);
+		~LeticoRtspServer();
+
+		bool isRunning() const { return mRunning.load(std::memory_order_acquire); }
+		int port() const { return mPort; }
+
+	private:
+		static Config loadConfig();
+		void start();
+		void acceptLoop();
+		void reapSessionsLocked();
+
+		std::vector<std::shared_ptr<GopCache>> mSources;
+		Config mConfig;
+		int mListenSocket = -1;
+		int mPort = 0;
+		std::atomic<bool> mRunning{false};
+		std::thread mAcceptThread;
+
+		std::mutex mSessionsMutex;
+		std::list<std::unique_ptr<RtspSession>> mSessions;
+	};
+}
@@ -0,0 +1,623 @@
+#include "rtspSession.h"
+
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <utility>
+
+#include "../Stream/nalParser.h"
+
+using namespace Letico;
+
+namespace
+{
+	constexpr size_t MAX_REQUEST_SIZE = 16 * 1024;
+	constexpr int SESSION_TIMEOUT_SECONDS = 60;
+	constexpr int UDP_SEND_BUFFER_BYTES = 1024 * 1024;
+	constexpr uint32_t NTP_UNIX_OFFSET = 2208988800u;  // seconds from 1900 to 1970
+	const char CNAME[] = "letico";
+
+	// Writes all iovecs, continuing after partial writes. Fails on error or when the send timeout expires.
+	bool writeAll(int socket, iovec* iov, int count)
+	{
+		while (count > 0)
+		{
+			msghdr message{};
+			message.msg_iov = iov;
+			message.msg_iovlen = count;
+			ssize_t written = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			while (count > 0 && static_cast<size_t>(written) >= iov->iov_len)
+			{
+				written -= iov->iov_len;
+				iov++;
+				count--;
+			}
+			if (count > 0)
+			{
+				iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+				iov->iov_len -= written;
+			}
+		}
+		return true;
+	}
+
+	std::string base64(const uint8_t* data, size_t size)
+	{
+		static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string out;
+		out.reserve((size + 2) / 3 * 4);
+		for (size_t i = 0; i < size; i += 3)
+		{
+			uint32_t chunk = data[i] << 16;
+			if (i + 1 < size)
+				chunk |= data[i + 1] << 8;
+			if (i + 2 < size)
+				chunk |= data[i + 2];
+			out += ALPHABET[(chunk >> 18) & 0x3f];
+			out += ALPHABET[(chunk >> 12) & 0x3f];
+			out += i + 1 < size ? ALPHABET[(chunk >> 6) & 0x3f] : '=';
+			out += i + 2 < size ? ALPHABET[chunk & 0x3f] : '=';
+		}
+		return out;
+	}
+
+	// Parses "a-b" after `key` in a Transport header; the second value defaults to a + 1.
+	bool parsePortPair(const std::string& transport, const std::string& key, int& first, int& second)
+	{
+		const size_t position = transport.find(key);
+		if (position == std::string::npos)
+			return false;
+		const int matched = std::sscanf(transport.c_str() + position + key.size(), "%d-%d", &first, &second);
+		if (matched < 1)
+			return false;
+		if (matched == 1)
+			second = first + 1;
+		return true;
+	}
+
+	int indexAfter(const std::string& path, const std::string& key)
+	{
+		const size_t position = path.find(key);
+		if (position == std::string::npos)
+			return 0;
+		return std::atoi(path.c_str() + position + key.size());
+	}
+
+	void putUint32(uint8_t* out, uint32_t value)
+	{
+		out[0] = static_cast<uint8_t>(value >> 24);
+		out[1] = static_cast<uint8_t>(value >> 16);
+		out[2] = static_cast<uint8_t>(value >> 8);
+		out[3] = static_cast<uint8_t>(value);
+	}
+}
+
+RtspSession::RtspSession(int socket, const sockaddr_in& peer, const std::vector<std::shared_ptr<GopCache>>& sources, Config config):
+	mSocket(socket),
+	mPeer(peer),
+	mSources(sources),
+	mConfig(config)
+{
+	const int noDelay = 1;
+	::setsockopt(mSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	timeval timeout{static_cast<time_t>(mConfig.sendTimeout.count()), 0};
+	::setsockopt(mSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+RtspSession::~RtspSession()
+{
+	stop();
+	if (mReaderThread.joinable())
+		mReaderThread.join();
+	stopPlaying();
+	::close(mSocket);
+	if (mRtpSocket >= 0)
+		::close(mRtpSocket);
+	if (mRtcpSocket >= 0)
+		::close(mRtcpSocket);
+}
+
+void RtspSession::start()
+{
+	mReaderThread = std::thread([this] { readLoop(); });
+}
+
+void RtspSession::stop()
+{
+	// Unblocks the reader; it tears the RTP side down on its way out.
+	::shutdown(mSocket, SHUT_RDWR);
+}
+
+void RtspSession::readLoop()
+{
+	std::string buffer;
+	char chunk[4096];
+	bool open = true;
+	while (open)
+	{
+		const ssize_t received = ::recv(mSocket, chunk, sizeof(chunk), 0);
+		if (received <= 0)
+			break;
+		buffer.append(chunk, received);
+
+		while (open && !buffer.empty())
+		{
+			if (buffer[0] == '$')
+			{
+				// Interleaved RTCP receiver reports from the client; nothing in them changes what we send.
+				if (buffer.size() < 4)
+					break;
+				const size_t length = (static_cast<uint8_t>(buffer[2]) << 8) | static_cast<uint8_t>(buffer[3]);
+				if (buffer.size() < 4 + length)
+					break;
+				buffer.erase(0, 4 + length);
+				continue;
+			}
+
+			const size_t headerEnd = buffer.find("\r\n\r\n");
+			if (headerEnd == std::string::npos)
+			{
+				open = buffer.size() <= MAX_REQUEST_SIZE;
+				break;
+			}
+
+			Request request;
+			std::istringstream lines(buffer.substr(0, headerEnd));
+			std::string line;
+			std::getline(lines, line);
+			std::istringstream requestLine(line);
+			requestLine >> request.method >> request.url;
+			while (std::getline(lines, line))
+			{
+				const size_t colon = line.find(':');
+				if (colon == std::string::npos)
+					continue;
+				std::string name = line.substr(0, colon);
+				for (auto& c : name)
+					c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+				std::string value = line.substr(colon + 1);
+				value.erase(0, value.find_first_not_of(' '));
+				if (!value.empty() && value.back() == '\r')
+					value.pop_back();
+				request.headers[name] = value;
+			}
+			request.cseq = request.headers["cseq"];
+
+			const size_t contentLength =
+				request.headers.count("content-length") ? std::strtoul(request.headers["content-length"].c_str(), nullptr, 10) : 0;
+			if (buffer.size() < headerEnd + 4 + contentLength)
+				break;
+			buffer.erase(0, headerEnd + 4 + contentLength);
+			open = handleRequest(request);
+		}
+	}
+	stopPlaying();
+	mFinished.store(true, std::memory_order_release);
+}
+
+bool RtspSession::handleRequest(const Request& request)
+{
+	const std::string session = mSessionId.empty() ? "" : "Session: " + mSessionId + "\r\n";
+	if (request.method == "OPTIONS")
+	{
+		sendResponse(request, 200, "OK", "Public: OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN, GET_PARAMETER, SET_PARAMETER\r\n");
+	}
+	else if (request.method == "DESCRIBE")
+	{
+		handleDescribe(request);
+	}
+	else if (request.method == "SETUP")
+	{
+		handleSetup(request);
+	}
+	else if (request.method == "PLAY")
+	{
+		handlePlay(request);
+	}
+	else if (request.method == "TEARDOWN")
+	{
+		stopPlaying();
+		sendResponse(request, 200, "OK", session);
+		return false;
+	}
+	else if (request.method == "GET_PARAMETER" || request.method == "SET_PARAMETER")
+	{
+		// Keep-alive.
+		sendResponse(request, 200, "OK", session);
+	}
+	else
+	{
+		sendResponse(request, 501, "Not Implemented");
+	}
+	return true;
+}
+
+void RtspSession::handleDescribe(const Request& request)
+{
+	if (!resolveStream(request.url))
+	{
+		sendResponse(request, 404, "Not Found");
+		return;
+	}
+	std::string base = request.url;
+	if (base.back() != '/')
+		base += '/';
+	sendResponse(request, 200, "OK", "Content-Base: " + base + "\r\nContent-Type: application/sdp\r\n", buildSdp());
+}
+
+void RtspSession::handleSetup(const Request& request)
+{
+	if (mPlaying.load(std::memory_order_acquire))
+	{
+		sendResponse(request, 455, "Method Not Valid in This State");
+		return;
+	}
+	if (!mSource && !resolveStream(request.url))
+	{
+		sendResponse(request, 404, "Not Found");
+		return;
+	}
+
+	std::random_device random;
+	if (mSessionId.empty())
+	{
+		char id[17];
+		std::snprintf(id, sizeof(id), "%08X%08X", random(), random());
+		mSessionId = id;
+	}
+	mPacketizer = std::make_unique<RtpPacketizer>(mCodec, random(), static_cast<uint16_t>(random()), mConfig.maxPacketSize);
+	char ssrc[9];
+	std::snprintf(ssrc, sizeof(ssrc), "%08X", mPacketizer->ssrc());
+
+	auto transportIt = request.headers.find("transport");
+	const std::string transport = transportIt == request.headers.end() ? "" : transportIt->second;
+	std::string reply;
+	int first = 0;
+	int second = 1;
+	if (transport.find("RTP/AVP/TCP") != std::string::npos)
+	{
+		parsePortPair(transport, "interleaved=", first, second);
+		mTransport = Transport::Interleaved;
+		mRtpChannel = static_cast<uint8_t>(first);
+		mRtcpChannel = static_cast<uint8_t>(second);
+		reply = "RTP/AVP/TCP;unicast;interleaved=" + std::to_string(first) + "-" + std::to_string(second);
+	}
+	else if (parsePortPair(transport, "client_port=", first, second))
+	{
+		if (!openUdpSockets())
+		{
+			sendResponse(request, 500, "Internal Server Error");
+			return;
+		}
+		mTransport = Transport::Udp;
+		mClientRtp = mPeer;
+		mClientRtp.sin_port = htons(static_cast<uint16_t>(first));
+		mClientRtcp = mPeer;
+		mClientRtcp.sin_port = htons(static_cast<uint16_t>(second));
+
+		sockaddr_in local{};
+		socklen_t length = sizeof(local);
+		::getsockname(mRtpSocket, reinterpret_cast<sockaddr*>(&local), &length);
+		const int serverPort = ntohs(local.sin_port);
+		reply = "RTP/AVP;unicast;client_port=" + std::to_string(first) + "-" + std::to_string(second) +
+				";server_port=" + std::to_string(serverPort) + "-" + std::to_string(serverPort + 1);
+	}
+	else
+	{
+		sendResponse(request, 461, "Unsupported Transport");
+		return;
+	}
+
+	sendResponse(
+		request,
+		200,
+		"OK",
+		"Transport: " + reply + ";ssrc=" + ssrc + "\r\nSession: " + mSessionId + ";timeout=" + std::to_string(SESSION_TIMEOUT_SECONDS) + "\r\n"
+	);
+}
+
+void RtspSession::handlePlay(const Request& request)
+{
+	if (mTransport == Transport::None || !mPacketizer)
+	{
+		sendResponse(request, 455, "Method Not Valid in This State");
+		return;
+	}
+	const std::string session = "Session: " + mSessionId + "\r\n";
+	if (mPlaying.load(std::memory_order_acquire))
+	{
+		sendResponse(request, 200, "OK", session);
+		return;
+	}
+
+	std::random_device random;
+	mRtpBase = random();
+	mFirstTimestamp = -1;
+	sendResponse(
+		request,
+		200,
+		"OK",
+		session + "Range: npt=0.000-\r\nRTP-Info: url=" + request.url + ";seq=" + std::to_string(mPacketizer->nextSequence()) +
+			";rtptime=" + std::to_string(mRtpBase) + "\r\n"
+	);
+
+	// Subscribing replays the cached GOP into the queue, so the first packets sent are a decodable keyframe.
+	mQueue = std::make_shared<FrameQueue>(mConfig.queue, mStreamIndex, mCodec);
+	mPlaying.store(true, std::memory_order_release);
+	mSource->subscribe(mQueue);
+	mSenderThread = std::thread([this] { sendLoop(); });
+}
+
+void RtspSession::sendResponse(const Request& request, int status, const std::string& reason, const std::string& headers, const std::string& body)
+{
+	std::string response = "RTSP/1.0 " + std::to_string(status) + " " + reason + "\r\nCSeq: " + request.cseq +
+						   "\r\nServer: Letico\r\n" + headers;
+	if (!body.empty())
+	{
+		response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+	}
+	response += "\r\n" + body;
+
+	std::lock_guard<std::mutex> lock(mWriteMutex);
+	iovec iov{response.data(), response.size()};
+	writeAll(mSocket, &iov, 1);
+}
+
+bool RtspSession::resolveStream(const std::string& url)
+{
+	// rtsp://host:port/camera<N>/stream<K>; either part may be left out and defaults to 0.
+	size_t pathStart = url.find("://");
+	pathStart = url.find('/', pathStart == std::string::npos ? 0 : pathStart + 3);
+	const std::string path = pathStart == std::string::npos ? "" : url.substr(pathStart);
+	const int cameraIndex = indexAfter(path, "camera");
+	if (cameraIndex < 0 || static_cast<size_t>(cameraIndex) >= mSources.size() || !mSources[cameraIndex])
+		return false;
+
+	mSource = mSources[cameraIndex];
+	mStreamIndex = indexAfter(path, "stream");
+	mCodec = mSource->codec();
+	return true;
+}
+
+std::string RtspSession::buildSdp() const
+{
+	sockaddr_in local{};
+	socklen_t length = sizeof(local);
+	::getsockname(mSocket, reinterpret_cast<sockaddr*>(&local), &length);
+	char address[INET_ADDRSTRLEN] = "0.0.0.0";
+	::inet_ntop(AF_INET, &local.sin_addr, address, sizeof(address));
+
+	const bool h265 = mCodec == ins_camera::VideoEncodeType::H265;
+	std::string fmtp = h265 ? "" : "packetization-mode=1";
+	// Out-of-band parameter sets let players configure the decoder before the first keyframe arrives.
+	if (FramePtr parameterSets = mSource->parameterSets(mStreamIndex))
+	{
+		std::vector<NalUnit> nals;
+		NalParser::split(parameterSets->data(), parameterSets->size(), mCodec, nals);
+		std::string vps, sps, pps, profile;
+		for (const auto& nal : nals)
+		{
+			const std::string encoded = base64(nal.data, nal.size);
+			if (h265 && nal.type == NalParser::H265_VPS)
+				vps = encoded;
+			else if (nal.type == (h265 ? NalParser::H265_SPS : NalParser::H264_SPS))
+			{
+				sps = encoded;
+				if (!h265 && nal.size >= 4)
+				{
+					char id[7];
+					std::snprintf(id, sizeof(id), "%02X%02X%02X", nal.data[1], nal.data[2], nal.data[3]);
+					profile = id;
+				}
+			}
+			else if (nal.type == (h265 ? NalParser::H265_PPS : NalParser::H264_PPS))
+				pps = encoded;
+		}
+		if (h265)
+			fmtp = "sprop-vps=" + vps + ";sprop-sps=" + sps + ";sprop-pps=" + pps;
+		else
+			fmtp += (profile.empty() ? "" : ";profile-level-id=" + profile) + ";sprop-parameter-sets=" + sps + "," + pps;
+	}
+
+	std::ostringstream sdp;
+	sdp << "v=0\r\n"
+		<< "o=- " << std::hash<std::string>{}(mSessionId) % 1000000000 << " 1 IN IP4 " << address << "\r\n"
+		<< "s=Letico live\r\n"
+		<< "c=IN IP4 0.0.0.0\r\n"
+		<< "t=0 0\r\n"
+		<< "a=control:*\r\n"
+		<< "a=range:npt=now-\r\n"
+		<< "m=video 0 RTP/AVP " << int(RtpPacketizer::PAYLOAD_TYPE) << "\r\n"
+		<< "a=rtpmap:" << int(RtpPacketizer::PAYLOAD_TYPE) << (h265 ? " H265/" : " H264/") << RtpPacketizer::CLOCK_RATE << "\r\n";
+	if (!fmtp.empty())
+		sdp << "a=fmtp:" << int(RtpPacketizer::PAYLOAD_TYPE) << " " << fmtp << "\r\n";
+	sdp << "a=control:trackID=0\r\n";
+	return sdp.str();
+}
+
+bool RtspSession::openUdpSockets()
+{
+	if (mRtpSocket >= 0)
+		return true;
+
+	// RTP on an even port and RTCP on the next one, as RFC 3550 recommends.
+	for (int attempt = 0; attempt < 16; attempt++)
+	{
+		int rtp = ::socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		socklen_t length = sizeof(address);
+		if (rtp < 0 || ::bind(rtp, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+			::getsockname(rtp, reinterpret_cast<sockaddr*>(&address), &length) != 0 || ntohs(address.sin_port) % 2 != 0)
+		{
+			if (rtp >= 0)
+				::close(rtp);
+			continue;
+		}
+
+		int rtcp = ::socket(AF_INET, SOCK_DGRAM, 0);
+		address.sin_port = htons(ntohs(address.sin_port) + 1);
+		if (rtcp < 0 || ::bind(rtcp, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			::close(rtp);
+			if (rtcp >= 0)
+				::close(rtcp);
+			continue;
+		}
+
+		// Keyframes go out as a burst of packets; a larger buffer avoids dropping them locally.
+		::setsockopt(rtp, SOL_SOCKET, SO_SNDBUF, &UDP_SEND_BUFFER_BYTES, sizeof(UDP_SEND_BUFFER_BYTES));
+		mRtpSocket = rtp;
+		mRtcpSocket = rtcp;
+		return true;
+	}
+	return false;
+}
+
+void RtspSession::sendLoop()
+{
+	std::vector<FramePtr> frames;
+	mLastReport = std::chrono::steady_clock::now() - mConfig.senderReportInterval;
+	while (mPlaying.load(std::memory_order_acquire))
+	{
+		frames.clear();
+		if (!mQueue->popAll(frames, std::chrono::milliseconds(200)))
+			break;
+
+		for (const auto& frame : frames)
+		{
+			if (mFirstTimestamp < 0)
+				mFirstTimestamp = frame->timestamp;
+			const uint32_t rtpTimestamp =
+				mRtpBase + static_cast<uint32_t>((frame->timestamp - mFirstTimestamp) * RtpPacketizer::CLOCK_RATE / TIMESTAMP_HZ);
+
+			bool sent = true;
+			mPacketizer->packetize(
+				frame->data(),
+				frame->size(),
+				rtpTimestamp,
+				[&](const uint8_t* header, size_t headerSize, const uint8_t* payload, size_t payloadSize)
+				{
+					sent = sendRtp(header, headerSize, payload, payloadSize);
+					return sent;
+				}
+			);
+			if (!sent)
+			{
+				// The control connection is gone or stuck; end the session.
+				mPlaying.store(false, std::memory_order_release);
+				::shutdown(mSocket, SHUT_RDWR);
+				return;
+			}
+			mLastRtpTimestamp = rtpTimestamp;
+			mLastSendTime = std::chrono::steady_clock::now();
+		}
+
+		if (mFirstTimestamp >= 0 && std::chrono::steady_clock::now() - mLastReport >= mConfig.senderReportInterval)
+		{
+			sendSenderReport();
+		}
+	}
+}
+
+bool RtspSession::sendRtp(const uint8_t* header, size_t headerSize, const uint8_t* payload, size_t payloadSize)
+{
+	if (mTransport == Transport::Interleaved)
+		return sendInterleaved(mRtpChannel, header, headerSize, payload, payloadSize);
+
+	iovec iov[2] = {{const_cast<uint8_t*>(header), headerSize}, {const_cast<uint8_t*>(payload), payloadSize}};
+	msghdr message{};
+	message.msg_name = &mClientRtp;
+	message.msg_namelen = sizeof(mClientRtp);
+	message.msg_iov = iov;
+	message.msg_iovlen = 2;
+	// UDP is lossy by nature; a packet the kernel refuses is simply lost.
+	::sendmsg(mRtpSocket, &message, MSG_NOSIGNAL);
+	return true;
+}
+
+bool RtspSession::sendRtcp(const uint8_t* data, size_t size)
+{
+	if (mTransport == Transport::Interleaved)
+		return sendInterleaved(mRtcpChannel, data, size, nullptr, 0);
+
+	::sendto(mRtcpSocket, data, size, MSG_NOSIGNAL, reinterpret_cast<const sockaddr*>(&mClientRtcp), sizeof(mClientRtcp));
+	return true;
+}
+
+bool RtspSession::sendInterleaved(uint8_t channel, const uint8_t* header, size_t headerSize, const uint8_t* payload, size_t payloadSize)
+{
+	const size_t length = headerSize + payloadSize;
+	uint8_t prefix[4] = {'$', channel, static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length)};
+	iovec iov[3] = {{prefix, sizeof(prefix)}, {const_cast<uint8_t*>(header), headerSize}, {const_cast<uint8_t*>(payload), payloadSize}};
+
+	std::lock_guard<std::mutex> lock(mWriteMutex);
+	return writeAll(mSocket, iov, payloadSize != 0 ? 3 : 2);
+}
+
+void RtspSession::sendSenderReport()
+{
+	const auto now = std::chrono::steady_clock::now();
+	mLastReport = now;
+
+	// The RTP timestamp of "now", extrapolated from the last frame sent.
+	const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - mLastSendTime).count();
+	const uint32_t rtpNow = mLastRtpTimestamp + static_cast<uint32_t>(elapsed * RtpPacketizer::CLOCK_RATE / 1000000);
+
+	const auto wall = std::chrono::system_clock::now().time_since_epoch();
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(wall);
+	const uint64_t fraction = std::chrono::duration_cast<std::chrono::nanoseconds>(wall - seconds).count();
+	const uint32_t ntpSeconds = static_cast<uint32_t>(seconds.count()) + NTP_UNIX_OFFSET;
+	const uint32_t ntpFraction = static_cast<uint32_t>((fraction << 32) / 1000000000);
+
+	// Compound packet: SR (RFC 3550 section 6.4.1) followed by SDES with a CNAME, padded to 32-bit words.
+	uint8_t packet[64] = {};
+	packet[0] = 0x80;
+	packet[1] = 200;
+	packet[3] = 6;	// length in 32-bit words minus one
+	putUint32(packet + 4, mPacketizer->ssrc());
+	putUint32(packet + 8, ntpSeconds);
+	putUint32(packet + 12, ntpFraction);
+	putUint32(packet + 16, rtpNow);
+	putUint32(packet + 20, mPacketizer->packetCount());
+	putUint32(packet + 24, mPacketizer->octetCount());
+
+	uint8_t* sdes = packet + 28;
+	const size_t cnameLength = sizeof(CNAME) - 1;
+	const size_t sdesLength = (8 + 2 + cnameLength + 1 + 3) / 4 * 4;
+	sdes[0] = 0x81;
+	sdes[1] = 202;
+	sdes[3] = static_cast<uint8_t>(sdesLength / 4 - 1);
+	putUint32(sdes + 4, mPacketizer->ssrc());
+	sdes[8] = 1;  // CNAME
+	sdes[9] = static_cast<uint8_t>(cnameLength);
+	std::copy(CNAME, CNAME + cnameLength, sdes + 10);
+
+	sendRtcp(packet, 28 + sdesLength);
+}
+
+void RtspSession::stopPlaying()
+{
+	mPlaying.store(false, std::memory_order_release);
+	if (mQueue)
+	{
+		mSource->unsubscribe(mQueue);
+		mQueue->close();
+	}
+	if (mSenderThread.joinable() && mSenderThread.get_id() != std::this_thread::get_id())
+		mSenderThread.join();
+}
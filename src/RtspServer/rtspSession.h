@@ -0,0 +1,108 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Stream/frameQueue.h"
+#include "../Stream/gopCache.h"
+#include "../Stream/rtpPacketizer.h"
+
+namespace Letico
+{
+	// One RTSP control connection and the RTP session it sets up. The reader thread answers RTSP requests; after
+	// PLAY a sender thread drains the session's FrameQueue, packetizes each frame and sends it either over UDP
+	// to the client's ports or interleaved on the control connection ($-framing, RFC 2326 section 10.12).
+	class RtspSession
+	{
+	public:
+		struct Config
+		{
+			size_t maxPacketSize = RtpPacketizer::DEFAULT_MAX_PACKET_SIZE;
+			FrameQueue::Config queue;
+			std::chrono::seconds senderReportInterval{1};
+			std::chrono::seconds sendTimeout{5};  // a TCP client that stops reading is disconnected after this
+		};
+
+		RtspSession(int socket, const sockaddr_in& peer, const std::vector<std::shared_ptr<GopCache>>& sources, Config config);
+		~RtspSession();
+
+		void start();
+		void stop();
+		bool finished() const { return mFinished.load(std::memory_order_acquire); }
+
+	private:
+		struct Request
+		{
+			std::string method;
+			std::string url;
+			std::string cseq;
+			std::map<std::string, std::string> headers;	 // lower-case names
+		};
+
+		enum class Transport
+		{
+			None,
+			Udp,
+			Interleaved
+		};
+
+		void readLoop();
+		bool handleRequest(const Request& request);
+		void handleDescribe(const Request& request);
+		void handleSetup(const Request& request);
+		void handlePlay(const Request& request);
+		void sendResponse(const Request& request, int status, const std::string& reason, const std::string& headers = "", const std::string& body = "");
+
+		bool resolveStream(const std::string& url);
+		std::string buildSdp() const;
+		bool openUdpSockets();
+
+		void sendLoop();
+		bool sendRtp(const uint8_t* header, size_t headerSize, const uint8_t* payload, size_t payloadSize);
+		bool sendRtcp(const uint8_t* data, size_t size);
+		bool sendInterleaved(uint8_t channel, const uint8_t* header, size_t headerSize, const uint8_t* payload, size_t payloadSize);
+		void sendSenderReport();
+		void stopPlaying();
+
+		int mSocket;
+		sockaddr_in mPeer;
+		std::vector<std::shared_ptr<GopCache>> mSources;
+		Config mConfig;
+		std::thread mReaderThread;
+		std::thread mSenderThread;
+		std::atomic<bool> mFinished{false};
+		std::atomic<bool> mPlaying{false};
+		std::mutex mWriteMutex;	 // RTSP responses and interleaved packets share the control socket
+
+		std::string mSessionId;
+		std::shared_ptr<GopCache> mSource;
+		int mStreamIndex = 0;
+		ins_camera::VideoEncodeType mCodec = ins_camera::VideoEncodeType::H264;
+
+		Transport mTransport = Transport::None;
+		int mRtpSocket = -1;
+		int mRtcpSocket = -1;
+		sockaddr_in mClientRtp{};
+		sockaddr_in mClientRtcp{};
+		uint8_t mRtpChannel = 0;
+		uint8_t mRtcpChannel = 1;
+
+		std::shared_ptr<FrameQueue> mQueue;
+		std::unique_ptr<RtpPacketizer> mPacketizer;
+		uint32_t mRtpBase = 0;
+		int64_t mFirstTimestamp = -1;
+		uint32_t mLastRtpTimestamp = 0;
+		std::chrono::steady_clock::time_point mLastSendTime;
+		std::chrono::steady_clock::time_point mLastReport;
+	};
+}
@@ -0,0 +1,105 @@
+#include "adtsFramer.h"
+
+#include <algorithm>
+
+#include "streamTypes.h"
+
+using namespace Letico;
+
+namespace
+{
+	const uint32_t SAMPLING_FREQUENCIES[] = {
+		96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350};
+	constexpr size_t MAX_FRAME_SIZE = 0x1fff;  // 13-bit aac_frame_length
+}
+
+AdtsFramer::AdtsFramer(Config config): mConfig(config)
+{
+}
+
+size_t AdtsFramer::split(const uint8_t* data, size_t size, std::vector<AccessUnit>& out)
+{
+	Config parsed;
+	size_t headerSize = 0;
+	size_t frameSize = 0;
+	if (!parseHeader(data, size, parsed, headerSize, frameSize))
+	{
+		if (size == 0)
+			return 0;
+		out.push_back({data, size});
+		return 1;
+	}
+
+	mConfig = parsed;
+	size_t found = 0;
+	size_t offset = 0;
+	while (parseHeader(data + offset, size - offset, parsed, headerSize, frameSize))
+	{
+		out.push_back({data + offset + headerSize, frameSize - headerSize});
+		offset += frameSize;
+		found++;
+	}
+	return found;
+}
+
+void AdtsFramer::writeHeader(uint8_t* out, size_t payloadSize) const
+{
+	const size_t frameSize = std::min(payloadSize + HEADER_SIZE, MAX_FRAME_SIZE);
+	const int index = samplingIndex(mConfig.sampleRate);
+	const uint8_t frequency = static_cast<uint8_t>(index < 0 ? 3 : index);
+	out[0] = 0xff;
+	out[1] = 0xf1;	// MPEG-4, layer 0, no CRC
+	out[2] = static_cast<uint8_t>(((mConfig.objectType - 1) & 0x03) << 6 | frequency << 2 | ((mConfig.channels >> 2) & 0x01));
+	out[3] = static_cast<uint8_t>((mConfig.channels & 0x03) << 6 | ((frameSize >> 11) & 0x03));
+	out[4] = static_cast<uint8_t>(frameSize >> 3);
+	out[5] = static_cast<uint8_t>((frameSize & 0x07) << 5 | 0x1f);	// buffer fullness 0x7ff: variable rate
+	out[6] = 0xfc;	// one raw data block
+}
+
+int64_t AdtsFramer::durationOf(size_t frames) const
+{
+	if (mConfig.sampleRate == 0)
+		return 0;
+	return static_cast<int64_t>(frames) * SAMPLES_PER_FRAME * TIMESTAMP_HZ / mConfig.sampleRate;
+}
+
+bool AdtsFramer::parseHeader(const uint8_t* data, size_t size, Config& config, size_t& headerSize, size_t& frameSize)
+{
+	if (size < HEADER_SIZE || data[0] != 0xff || (data[1] & 0xf6) != 0xf0)
+		return false;
+	const uint8_t frequency = (data[2] >> 2) & 0x0f;
+	if (frequency >= sizeof(SAMPLING_FREQUENCIES) / sizeof(SAMPLING_FREQUENCIES[0]))
+		return false;
+	headerSize = (data[1] & 0x01) ? HEADER_SIZE : HEADER_SIZE + 2;
+	frameSize = static_cast<size_t>(data[3] & 0x03) << 11 | static_cast<size_t>(data[4]) << 3 | data[5] >> 5;
+	if (frameSize <= headerSize || frameSize > size)
+		return false;
+	config.objectType = static_cast<uint8_t>((data[2] >> 6) + 1);
+	config.sampleRate = SAMPLING_FREQUENCIES[frequency];
+	config.channels = static_cast<uint8_t>((data[2] & 0x01) << 2 | data[3] >> 6);
+	return true;
+}
+
+std::vector<uint8_t> AdtsFramer::audioSpecificConfig(const Config& config)
+{
+	const int index = samplingIndex(config.sampleRate);
+	const uint8_t frequency = static_cast<uint8_t>(index < 0 ? 3 : index);
+	return {
+		static_cast<uint8_t>(config.objectType << 3 | frequency >> 1),
+		static_cast<uint8_t>((frequency & 0x01) << 7 | (config.channels & 0x0f) << 3)};
+}
+
+std::string AdtsFramer::codecString(const Config& config)
+{
+	return "mp4a.40." + std::to_string(config.objectType);
+}
+
+int AdtsFramer::samplingIndex(uint32_t sampleRate)
+{
+	for (size_t i = 0; i < sizeof(SAMPLING_FREQUENCIES) / sizeof(SAMPLING_FREQUENCIES[0]); i++)
+	{
+		if (SAMPLING_FREQUENCIES[i] == sampleRate)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Letico
+{
+	// Packs the camera's AAC audio into ADTS frames (7-byte header, no CRC), the form MPEG-TS carries and the
+	// pipeline passes downstream. The SDK may deliver raw access units or ADTS already; ADTS input is split at its
+	// headers and its sample rate, channel layout and object type replace the configured ones.
+	class AdtsFramer
+	{
+	public:
+		struct Config
+		{
+			uint8_t objectType = 2;	 // AAC-LC
+			uint32_t sampleRate = 48000;
+			uint8_t channels = 2;
+
+			bool operator==(const Config& other) const
+			{
+				return objectType == other.objectType && sampleRate == other.sampleRate && channels == other.channels;
+			}
+			bool operator!=(const Config& other) const { return !(*this == other); }
+		};
+
+		// A raw access unit inside the buffer handed to split(); no header.
+		struct AccessUnit
+		{
+			const uint8_t* data;
+			size_t size;
+		};
+
+		static constexpr size_t HEADER_SIZE = 7;
+		static constexpr uint32_t SAMPLES_PER_FRAME = 1024;
+
+		explicit AdtsFramer(Config config);
+
+		// Appends the access units of one callback payload to `out`; returns how many were found.
+		size_t split(const uint8_t* data, size_t size, std::vector<AccessUnit>& out);
+		// ADTS header for a raw access unit of `payloadSize` bytes.
+		void writeHeader(uint8_t* out, size_t payloadSize) const;
+
+		const Config& config() const { return mConfig; }
+		// Duration of `frames` access units in stream timestamp units (ms), rounded down.
+		int64_t durationOf(size_t frames) const;
+
+		// Parses the ADTS header at `data`. `headerSize` is 7, or 9 with CRC; `frameSize` includes the header.
+		static bool parseHeader(const uint8_t* data, size_t size, Config& config, size_t& headerSize, size_t& frameSize);
+		// AudioSpecificConfig (ISO 14496-3) for MP4 sample entries.
+		static std::vector<uint8_t> audioSpecificConfig(const Config& config);
+		// RFC 6381 codec string, e.g. "mp4a.40.2".
+		static std::string codecString(const Config& config);
+		// Index into the ADTS sampling frequency table, or -1 for a rate ADTS cannot signal.
+		static int samplingIndex(uint32_t sampleRate);
+
+	private:
+		Config mConfig;
+	};
+}
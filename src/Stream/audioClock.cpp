@@ -0,0 +1,96 @@
+#include "audioClock.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace Letico;
+
+namespace
+{
+	// Weight of one frame in the smoothed skew; arrival jitter of single callbacks averages out over ~1/3 s.
+	constexpr double SKEW_SMOOTHING = 1.0 / 16.0;
+	constexpr int64_t NO_TIMESTAMP = std::numeric_limits<int64_t>::min();
+}
+
+AudioClock::AudioClock(Config config): mConfig(config)
+{
+}
+
+void AudioClock::reset()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats = Stats();
+	mHaveVideo = false;
+	mAnchored = false;
+}
+
+void AudioClock::onVideo(int64_t timestamp, Clock::time_point arrival)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mVideoTimestamp = timestamp;
+	mVideoArrival = arrival;
+	mHaveVideo = true;
+}
+
+bool AudioClock::rebase(int64_t timestamp, Clock::time_point arrival, int64_t& rebased)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mHaveVideo)
+	{
+		mStats.dropped++;
+		return false;
+	}
+
+	const auto sinceVideo = std::chrono::duration_cast<std::chrono::milliseconds>(arrival - mVideoArrival).count();
+	const int64_t videoNow = mVideoTimestamp + sinceVideo;
+	const int64_t step = timestamp - mLastAudio;
+	if (!mAnchored || step < 0 || static_cast<double>(step) > mConfig.jumpMs)
+	{
+		anchor(timestamp, videoNow);
+	}
+	mLastAudio = timestamp;
+
+	rebased = timestamp + mStats.offsetMs;
+	mStats.skewMs += (static_cast<double>(rebased - videoNow) - mStats.skewMs) * SKEW_SMOOTHING;
+	if (mStats.sameClock && std::abs(mStats.skewMs) > mConfig.sameClockMs)
+	{
+		// Only looked like one clock at the anchor; it runs at a different rate.
+		anchor(timestamp, videoNow);
+		rebased = timestamp + mStats.offsetMs;
+	}
+	else if (!mStats.sameClock && std::abs(mStats.skewMs) > mConfig.maxSkewMs)
+	{
+		// The audio clock drifted from the video clock; pull it back onto it.
+		mStats.offsetMs -= std::llround(mStats.skewMs);
+		rebased = timestamp + mStats.offsetMs;
+		mStats.skewMs = 0.0;
+		mStats.resyncs++;
+	}
+	if (mLastRebased != NO_TIMESTAMP && rebased <= mLastRebased)
+	{
+		rebased = mLastRebased + 1;
+	}
+	mLastRebased = rebased;
+	mStats.frames++;
+	return true;
+}
+
+AudioClock::Stats AudioClock::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+void AudioClock::anchor(int64_t timestamp, int64_t videoNow)
+{
+	if (mAnchored)
+		mStats.resyncs++;
+	mAnchored = true;
+	const int64_t offset = videoNow - timestamp;
+	mStats.sameClock = static_cast<double>(std::abs(offset)) <= mConfig.sameClockMs;
+	mStats.offsetMs = mStats.sameClock ? 0 : offset;
+	mStats.skewMs = static_cast<double>(timestamp + mStats.offsetMs - videoNow);
+	// The rebased timeline restarts with the anchor; it may legitimately step back (the camera clock restarted).
+	mLastRebased = NO_TIMESTAMP;
+}
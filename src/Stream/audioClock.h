@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace Letico
+{
+	// Rebases audio timestamps onto the video clock. Both callbacks are stamped by the camera, but the audio clock
+	// may start from a different origin or drift; the arrival times of the two streams tell them apart. At the
+	// first audio frame after video the audio timestamp is compared with where the video clock is at that moment:
+	// within `sameClockMs` the timestamps are taken as they are, otherwise audio is anchored to the video clock and
+	// re-anchored whenever its smoothed drift exceeds `maxSkewMs`. A jump in the audio timestamps, or a shared clock
+	// drifting by more than `sameClockMs`, starts over.
+	class AudioClock
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Config
+		{
+			double sameClockMs = 1000.0;
+			double maxSkewMs = 40.0;
+			double jumpMs = 500.0;	// audio timestamp steps beyond this (or backwards) re-anchor
+		};
+
+		struct Stats
+		{
+			bool sameClock = false;
+			int64_t offsetMs = 0;  // added to audio timestamps
+			double skewMs = 0.0;   // smoothed, rebased audio minus the video clock at arrival
+			uint64_t frames = 0;
+			uint64_t dropped = 0;  // before the first video frame
+			uint64_t resyncs = 0;
+		};
+
+		explicit AudioClock(Config config);
+
+		// Forgets both clocks; the next video frame starts a new session.
+		void reset();
+		void onVideo(int64_t timestamp, Clock::time_point arrival);
+		// Audio timestamp on the video clock, strictly increasing. False until video has been seen.
+		bool rebase(int64_t timestamp, Clock::time_point arrival, int64_t& rebased);
+
+		Stats getStats() const;
+
+	private:
+		void anchor(int64_t timestamp, int64_t videoNow);
+
+		Config mConfig;
+		mutable std::mutex mMutex;
+		Stats mStats;
+		bool mHaveVideo = false;
+		int64_t mVideoTimestamp = 0;
+		Clock::time_point mVideoArrival;
+		bool mAnchored = false;
+		int64_t mLastAudio = 0;
+		int64_t mLastRebased = 0;
+	};
+}
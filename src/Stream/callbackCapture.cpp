@@ -0,0 +1,129 @@
+#include "callbackCapture.h"
+
+#include <cstring>
+
+using namespace Letico;
+
+namespace
+{
+	constexpr size_t STDIO_BUFFER_BYTES = 4 * 1024 * 1024;
+	// A record larger than this is treated as corruption rather than allocated.
+	constexpr uint32_t MAX_RECORD_BYTES = 256 * 1024 * 1024;
+}
+
+CallbackCaptureWriter::~CallbackCaptureWriter()
+{
+	close();
+}
+
+bool CallbackCaptureWriter::open(const std::string& path)
+{
+	close();
+	mFile = std::fopen(path.c_str(), "wb");
+	if (!mFile)
+		return false;
+	mBuffer.resize(STDIO_BUFFER_BYTES);
+	std::setvbuf(mFile, mBuffer.data(), _IOFBF, mBuffer.size());
+	mRecords = 0;
+	mBytes = 0;
+	mFailed = false;
+
+	CaptureFileHeader header{};
+	std::memcpy(header.magic, CaptureFileHeader::MAGIC, sizeof(header.magic));
+	header.version = CaptureFileHeader::VERSION;
+	header.headerSize = sizeof(header);
+	mFailed = std::fwrite(&header, sizeof(header), 1, mFile) != 1;
+	mBytes = sizeof(header);
+	return !mFailed;
+}
+
+bool CallbackCaptureWriter::close()
+{
+	if (!mFile)
+		return false;
+	const bool ok = std::fclose(mFile) == 0 && !mFailed;
+	mFile = nullptr;
+	return ok;
+}
+
+bool CallbackCaptureWriter::write(
+	CaptureKind kind, int64_t offsetNs, int64_t timestamp, const void* data, size_t size, uint8_t streamType, int streamIndex
+)
+{
+	if (!mFile || mFailed)
+		return false;
+
+	CaptureRecordHeader header{};
+	header.kind = static_cast<uint8_t>(kind);
+	header.streamType = streamType;
+	header.streamIndex = static_cast<int16_t>(streamIndex);
+	header.size = static_cast<uint32_t>(size);
+	header.offsetNs = offsetNs;
+	header.timestamp = timestamp;
+	mFailed = std::fwrite(&header, sizeof(header), 1, mFile) != 1 || (size != 0 && std::fwrite(data, size, 1, mFile) != 1);
+	mRecords++;
+	mBytes += sizeof(header) + size;
+	return !mFailed;
+}
+
+bool CallbackCaptureWriter::writeGyro(int64_t offsetNs, const std::vector<ins_camera::GyroData>& data)
+{
+	const int64_t timestamp = data.empty() ? 0 : data.front().timestamp;
+	return write(CaptureKind::Gyro, offsetNs, timestamp, data.data(), data.size() * sizeof(ins_camera::GyroData));
+}
+
+bool CallbackCaptureWriter::writeExposure(int64_t offsetNs, const ins_camera::ExposureData& data)
+{
+	return write(CaptureKind::Exposure, offsetNs, 0, &data, sizeof(data));
+}
+
+CallbackCaptureReader::~CallbackCaptureReader()
+{
+	if (mFile)
+		std::fclose(mFile);
+}
+
+bool CallbackCaptureReader::open(const std::string& path)
+{
+	if (mFile)
+		std::fclose(mFile);
+	mFile = std::fopen(path.c_str(), "rb");
+	if (!mFile)
+		return false;
+	mBuffer.resize(STDIO_BUFFER_BYTES);
+	std::setvbuf(mFile, mBuffer.data(), _IOFBF, mBuffer.size());
+
+	CaptureFileHeader header{};
+	if (std::fread(&header, sizeof(header), 1, mFile) != 1 ||
+		std::memcmp(header.magic, CaptureFileHeader::MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != CaptureFileHeader::VERSION || header.headerSize < sizeof(header))
+	{
+		std::fclose(mFile);
+		mFile = nullptr;
+		return false;
+	}
+	mFirstRecord = static_cast<long>(header.headerSize);
+	return std::fseek(mFile, mFirstRecord, SEEK_SET) == 0;
+}
+
+bool CallbackCaptureReader::next(CaptureRecord& record)
+{
+	if (!mFile)
+		return false;
+
+	CaptureRecordHeader header{};
+	if (std::fread(&header, sizeof(header), 1, mFile) != 1 || header.size > MAX_RECORD_BYTES)
+		return false;
+	record.kind = static_cast<CaptureKind>(header.kind);
+	record.streamType = header.streamType;
+	record.streamIndex = header.streamIndex;
+	record.offsetNs = header.offsetNs;
+	record.timestamp = header.timestamp;
+	record.payload.resize(header.size);
+	return header.size == 0 || std::fread(record.payload.data(), header.size, 1, mFile) == 1;
+}
+
+bool CallbackCaptureReader::rewind()
+{
+	return mFile && std::fseek(mFile, mFirstRecord, SEEK_SET) == 0;
+}
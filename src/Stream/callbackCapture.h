@@ -0,0 +1,107 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Letico
+{
+	// Binary capture of StreamDelegate callbacks, so the stream pipeline can be replayed and benchmarked without a
+	// camera. A file is a fixed header followed by records, each a 24-byte header and the raw callback payload:
+	// video/audio bytes, an array of GyroData, or one ExposureData. Integers are little-endian (host order on
+	// every platform the service runs on). `offsetNs` is when the callback arrived, relative to the start of the capture.
+	enum class CaptureKind : uint8_t
+	{
+		Video = 1,
+		Audio = 2,
+		Gyro = 3,
+		Exposure = 4
+	};
+
+	struct CaptureFileHeader
+	{
+		static constexpr char MAGIC[8] = {'L', 'T', 'C', 'A', 'P', 'T', 'R', '1'};
+		static constexpr uint32_t VERSION = 1;
+
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;  // bytes from the start of the file to the first record
+	};
+
+	struct CaptureRecordHeader
+	{
+		uint8_t kind;
+		uint8_t streamType;
+		int16_t streamIndex;
+		uint32_t size;	// payload bytes that follow
+		int64_t offsetNs;
+		int64_t timestamp;	// SDK timestamp of video/audio, first sample of gyro, 0 for exposure
+	};
+
+	static_assert(sizeof(CaptureRecordHeader) == 24, "capture record header layout is part of the file format");
+
+	struct CaptureRecord
+	{
+		CaptureKind kind = CaptureKind::Video;
+		uint8_t streamType = 0;
+		int streamIndex = 0;
+		int64_t offsetNs = 0;
+		int64_t timestamp = 0;
+		std::vector<uint8_t> payload;
+	};
+
+	// Appends records through a large stdio buffer. Not thread-safe; CallbackRecorder writes from its capture thread.
+	class CallbackCaptureWriter
+	{
+	public:
+		CallbackCaptureWriter() = default;
+		~CallbackCaptureWriter();
+		CallbackCaptureWriter(const CallbackCaptureWriter&) = delete;
+		CallbackCaptureWriter& operator=(const CallbackCaptureWriter&) = delete;
+
+		bool open(const std::string& path);
+		bool close();
+		bool isOpen() const { return mFile != nullptr; }
+
+		bool write(CaptureKind kind, int64_t offsetNs, int64_t timestamp, const void* data, size_t size, uint8_t streamType = 0, int streamIndex = 0);
+		bool writeGyro(int64_t offsetNs, const std::vector<ins_camera::GyroData>& data);
+		bool writeExposure(int64_t offsetNs, const ins_camera::ExposureData& data);
+
+		uint64_t records() const { return mRecords; }
+		uint64_t bytes() const { return mBytes; }
+
+	private:
+		std::FILE* mFile = nullptr;
+		std::vector<char> mBuffer;
+		uint64_t mRecords = 0;
+		uint64_t mBytes = 0;
+		bool mFailed = false;
+	};
+
+	class CallbackCaptureReader
+	{
+	public:
+		CallbackCaptureReader() = default;
+		~CallbackCaptureReader();
+		CallbackCaptureReader(const CallbackCaptureReader&) = delete;
+		CallbackCaptureReader& operator=(const CallbackCaptureReader&) = delete;
+
+		// Fails on a missing file or a header this build does not understand.
+		bool open(const std::string& path);
+		// Reads the next record into `record`, reusing its payload buffer. Returns false at the end of the file or
+		// on a truncated record (a capture cut short keeps every complete record before the cut).
+		bool next(CaptureRecord& record);
+		// Back to the first record, for looping replays.
+		bool rewind();
+
+	private:
+		std::FILE* mFile = nullptr;
+		std::vector<char> mBuffer;
+		long mFirstRecord = 0;
+	};
+}
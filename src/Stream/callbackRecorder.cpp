@@ -0,0 +1,226 @@
+#include "callbackRecorder.h"
+
+#include <utility>
+
+using namespace Letico;
+
+namespace
+{
+	// A few seconds of a high bitrate stream; the capture thread only has to keep up with the disk on average.
+	constexpr size_t VIDEO_RING_BYTES = 64 * 1024 * 1024;
+	constexpr size_t AUDIO_RING_BYTES = 1024 * 1024;
+	constexpr size_t GYRO_RING_BYTES = 4 * 1024 * 1024;
+	constexpr size_t EXPOSURE_RING_BYTES = 256 * 1024;
+	// Records written per hold of the state mutex, so getStats() never waits behind a long backlog.
+	constexpr int WRITE_BATCH = 256;
+
+	CaptureKind captureKind(FrameRing::RecordKind kind)
+	{
+		switch (kind)
+		{
+		case FrameRing::RecordKind::Audio:
+			return CaptureKind::Audio;
+		case FrameRing::RecordKind::Gyro:
+			return CaptureKind::Gyro;
+		case FrameRing::RecordKind::Exposure:
+			return CaptureKind::Exposure;
+		default:
+			return CaptureKind::Video;
+		}
+	}
+}
+
+CallbackRecorder::CallbackRecorder(std::shared_ptr<ins_camera::StreamDelegate> target): mTarget(std::move(target))
+{
+}
+
+CallbackRecorder::~CallbackRecorder()
+{
+	stop();
+}
+
+bool CallbackRecorder::start(const std::string& path)
+{
+	std::lock_guard<std::mutex> control(mControlMutex);
+	if (mCapturing.load(std::memory_order_acquire))
+		return false;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!mWriter.open(path))
+			return false;
+		if (!mVideoRing)
+		{
+			mVideoRing = std::make_unique<FrameRing>(VIDEO_RING_BYTES);
+			mAudioRing = std::make_unique<FrameRing>(AUDIO_RING_BYTES);
+			mGyroRing = std::make_unique<FrameRing>(GYRO_RING_BYTES);
+			mExposureRing = std::make_unique<FrameRing>(EXPOSURE_RING_BYTES);
+		}
+		mPath = path;
+		mStartedNs = FrameRing::nowNs();
+		mLastOffsetNs = 0;
+		mDroppedAtStart = droppedRecords();
+	}
+	mCapturing.store(true, std::memory_order_seq_cst);
+	mCaptureThread = std::thread([this] { captureLoop(); });
+	return true;
+}
+
+CallbackRecorder::Stats CallbackRecorder::stop()
+{
+	std::lock_guard<std::mutex> control(mControlMutex);
+	if (!mCapturing.exchange(false, std::memory_order_seq_cst))
+		return {};
+	// A callback that saw the capture running may still be copying into a ring; its record belongs to the file.
+	while (mProducers.load(std::memory_order_seq_cst) != 0)
+		std::this_thread::yield();
+	mWakeSequence.fetch_add(1, std::memory_order_release);
+	mWakeSequence.notify_one();
+	if (mCaptureThread.joinable())
+		mCaptureThread.join();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats;
+	fillStatsLocked(stats);
+	stats.capturing = false;
+	mWriter.close();
+	return stats;
+}
+
+CallbackRecorder::Stats CallbackRecorder::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats;
+	fillStatsLocked(stats);
+	return stats;
+}
+
+void CallbackRecorder::fillStatsLocked(Stats& stats) const
+{
+	stats.capturing = mWriter.isOpen();
+	stats.path = mPath;
+	stats.records = mWriter.records();
+	stats.bytes = mWriter.bytes();
+	stats.dropped = droppedRecords() - mDroppedAtStart;
+	stats.seconds = static_cast<double>(mLastOffsetNs) / 1e9;
+}
+
+uint64_t CallbackRecorder::droppedRecords() const
+{
+	if (!mVideoRing)
+		return 0;
+	return mVideoRing->getStats().droppedRecords + mAudioRing->getStats().droppedRecords +
+		   mGyroRing->getStats().droppedRecords + mExposureRing->getStats().droppedRecords;
+}
+
+void CallbackRecorder::capture(
+	const std::unique_ptr<FrameRing>& ring, FrameRing::RecordKind kind, const uint8_t* data, size_t size, int64_t timestamp,
+	int64_t arrivalNs, uint8_t streamType, int streamIndex
+)
+{
+	// Sequentially consistent with start() and stop(): either this callback sees the capture stopped, or stop()
+	// sees it here. The ring is only dereferenced once the capture it was allocated for is seen running.
+	mProducers.fetch_add(1, std::memory_order_seq_cst);
+	if (mCapturing.load(std::memory_order_seq_cst) &&
+		ring->push(kind, data, size, timestamp, arrivalNs, streamType, streamIndex))
+	{
+		mWakeSequence.fetch_add(1, std::memory_order_release);
+		mWakeSequence.notify_one();
+	}
+	mProducers.fetch_sub(1, std::memory_order_release);
+}
+
+// Arrival time is taken before forwarding so replays reproduce the SDK's pacing, not the pipeline's.
+
+void CallbackRecorder::OnAudioData(const uint8_t* data, size_t size, int64_t timestamp)
+{
+	const int64_t now = FrameRing::nowNs();
+	mTarget->OnAudioData(data, size, timestamp);
+	if (!mCapturing.load(std::memory_order_relaxed))
+		return;
+	capture(mAudioRing, FrameRing::RecordKind::Audio, data, size, timestamp, now);
+}
+
+void CallbackRecorder::OnVideoData(const uint8_t* data, size_t size, int64_t timestamp, uint8_t streamType, int stream_index)
+{
+	const int64_t now = FrameRing::nowNs();
+	mTarget->OnVideoData(data, size, timestamp, streamType, stream_index);
+	if (!mCapturing.load(std::memory_order_relaxed))
+		return;
+	capture(mVideoRing, FrameRing::RecordKind::Video, data, size, timestamp, now, streamType, stream_index);
+}
+
+void CallbackRecorder::OnGyroData(const std::vector<ins_camera::GyroData>& data)
+{
+	const int64_t now = FrameRing::nowNs();
+	mTarget->OnGyroData(data);
+	if (!mCapturing.load(std::memory_order_relaxed))
+		return;
+	const int64_t timestamp = data.empty() ? 0 : data.front().timestamp;
+	const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+	capture(mGyroRing, FrameRing::RecordKind::Gyro, bytes, data.size() * sizeof(ins_camera::GyroData), timestamp, now);
+}
+
+void CallbackRecorder::OnExposureData(const ins_camera::ExposureData& data)
+{
+	const int64_t now = FrameRing::nowNs();
+	mTarget->OnExposureData(data);
+	if (!mCapturing.load(std::memory_order_relaxed))
+		return;
+	capture(mExposureRing, FrameRing::RecordKind::Exposure, reinterpret_cast<const uint8_t*>(&data), sizeof(data), 0, now);
+}
+
+void CallbackRecorder::captureLoop()
+{
+	while (true)
+	{
+		const uint32_t sequence = mWakeSequence.load(std::memory_order_acquire);
+		bool busy;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			busy = drainLocked();
+		}
+		if (busy)
+			continue;
+		if (!mCapturing.load(std::memory_order_acquire) && mProducers.load(std::memory_order_acquire) == 0)
+		{
+			// stop() waited for the last producer; whatever it pushed is written before the file closes.
+			std::lock_guard<std::mutex> lock(mMutex);
+			while (drainLocked())
+			{
+			}
+			break;
+		}
+		mWakeSequence.wait(sequence, std::memory_order_acquire);
+	}
+}
+
+bool CallbackRecorder::drainLocked()
+{
+	FrameRing* rings[] = {mVideoRing.get(), mAudioRing.get(), mGyroRing.get(), mExposureRing.get()};
+	int written = 0;
+	while (written < WRITE_BATCH)
+	{
+		// The rings are separate producers; merging by arrival keeps the file in the order the SDK called.
+		FrameRing* oldest = nullptr;
+		const FrameRing::RecordHeader* record = nullptr;
+		for (FrameRing* ring : rings)
+		{
+			const FrameRing::RecordHeader* head = ring->peek();
+			if (head != nullptr && (record == nullptr || head->arrivalNs < record->arrivalNs))
+			{
+				oldest = ring;
+				record = head;
+			}
+		}
+		if (record == nullptr)
+			break;
+		mLastOffsetNs = record->arrivalNs - mStartedNs;
+		mWriter.write(
+			captureKind(record->kind), mLastOffsetNs, record->timestamp, record->payload(), record->size, record->streamType,
+			record->streamIndex
+		);
+		oldest->pop();
+		written++;
+	}
+	return written != 0;
+}
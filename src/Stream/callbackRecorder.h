@@ -0,0 +1,80 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_delegate.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "callbackCapture.h"
+#include "frameRing.h"
+
+namespace Letico
+{
+	// StreamDelegate decorator installed between the SDK and the real delegate. Every callback is forwarded
+	// first; while a capture is running it is then also copied into a ring per callback kind, like the delegate
+	// does, and a capture thread writes the records to a capture file (see callbackCapture.h) in arrival order.
+	// The SDK threads never touch the file. With no capture running the only cost is two atomic operations per
+	// callback.
+	class CallbackRecorder : public ins_camera::StreamDelegate
+	{
+	public:
+		struct Stats
+		{
+			bool capturing = false;
+			std::string path;
+			uint64_t records = 0;
+			uint64_t bytes = 0;
+			uint64_t dropped = 0;  // callbacks lost because the capture thread fell behind
+			double seconds = 0.0;
+		};
+
+		explicit CallbackRecorder(std::shared_ptr<ins_camera::StreamDelegate> target);
+		~CallbackRecorder();
+
+		// Returns false if a capture is already running or the file cannot be created.
+		bool start(const std::string& path);
+		Stats stop();
+		Stats getStats() const;
+
+		void OnAudioData(const uint8_t* data, size_t size, int64_t timestamp) override;
+		void OnVideoData(const uint8_t* data, size_t size, int64_t timestamp, uint8_t streamType, int stream_index = 0) override;
+		void OnGyroData(const std::vector<ins_camera::GyroData>& data) override;
+		void OnExposureData(const ins_camera::ExposureData& data) override;
+
+	private:
+		// Producer side: pushes only while capturing, and lets stop() wait until no producer is inside a push.
+		void capture(
+			const std::unique_ptr<FrameRing>& ring, FrameRing::RecordKind kind, const uint8_t* data, size_t size,
+			int64_t timestamp, int64_t arrivalNs, uint8_t streamType = 0, int streamIndex = 0
+		);
+		void captureLoop();
+		// Writes every queued record, oldest arrival first. False when the rings were empty.
+		bool drainLocked();
+		uint64_t droppedRecords() const;
+		void fillStatsLocked(Stats& stats) const;
+
+		std::shared_ptr<ins_camera::StreamDelegate> mTarget;
+		// Allocated by the first capture and reused by later ones; empty whenever no capture is running.
+		std::unique_ptr<FrameRing> mVideoRing;
+		std::unique_ptr<FrameRing> mAudioRing;
+		std::unique_ptr<FrameRing> mGyroRing;
+		std::unique_ptr<FrameRing> mExposureRing;
+		std::atomic<bool> mCapturing{false};
+		std::atomic<int> mProducers{0};	 // callbacks between their mCapturing check and the end of their push
+		std::atomic<uint32_t> mWakeSequence{0};
+		std::thread mCaptureThread;
+
+		std::mutex mControlMutex;  // start and stop
+		mutable std::mutex mMutex;	// capture thread state below
+		CallbackCaptureWriter mWriter;
+		std::string mPath;
+		int64_t mStartedNs = 0;
+		int64_t mLastOffsetNs = 0;
+		uint64_t mDroppedAtStart = 0;
+	};
+}
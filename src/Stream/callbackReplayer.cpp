@@ -0,0 +1,150 @@
+#include "callbackReplayer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	enum KindSlot
+	{
+		VIDEO_SLOT,
+		AUDIO_SLOT,
+		GYRO_SLOT,
+		EXPOSURE_SLOT,
+		SLOT_COUNT
+	};
+
+	constexpr auto LATE_THRESHOLD = std::chrono::milliseconds(1);
+	// Gap left between the end of one loop and the start of the next, in both clocks.
+	constexpr int64_t LOOP_GAP_MS = 33;
+
+	// Issues one recorded callback with its SDK timestamps moved by `shift` ms. Returns the result slot, or
+	// SLOT_COUNT for record kinds this build does not know.
+	int dispatch(const CaptureRecord& record, int64_t shift, ins_camera::StreamDelegate& delegate, std::vector<ins_camera::GyroData>& gyro)
+	{
+		switch (record.kind)
+		{
+			case CaptureKind::Video:
+				delegate.OnVideoData(record.payload.data(), record.payload.size(), record.timestamp + shift, record.streamType, record.streamIndex);
+				return VIDEO_SLOT;
+			case CaptureKind::Audio:
+				delegate.OnAudioData(record.payload.data(), record.payload.size(), record.timestamp + shift);
+				return AUDIO_SLOT;
+			case CaptureKind::Gyro:
+				gyro.resize(record.payload.size() / sizeof(ins_camera::GyroData));
+				std::memcpy(gyro.data(), record.payload.data(), gyro.size() * sizeof(ins_camera::GyroData));
+				for (auto& sample : gyro)
+				{
+					sample.timestamp += shift;
+				}
+				delegate.OnGyroData(gyro);
+				return GYRO_SLOT;
+			case CaptureKind::Exposure:
+			{
+				// Exposure timestamps are passed through unchanged; they are not on the millisecond stream clock.
+				ins_camera::ExposureData exposure{};
+				std::memcpy(&exposure, record.payload.data(), std::min(record.payload.size(), sizeof(exposure)));
+				delegate.OnExposureData(exposure);
+				return EXPOSURE_SLOT;
+			}
+		}
+		return SLOT_COUNT;
+	}
+
+	double percentile(std::vector<double>& values, double p)
+	{
+		if (values.empty())
+			return 0.0;
+		const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1)));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+
+	void summarize(std::vector<double>& latencies, CallbackReplayer::KindResult& result)
+	{
+		result.p50Us = percentile(latencies, 0.50);
+		result.p99Us = percentile(latencies, 0.99);
+		result.p999Us = percentile(latencies, 0.999);
+		result.maxUs = latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end());
+	}
+}
+
+bool CallbackReplayer::replay(const std::string& path, ins_camera::StreamDelegate& delegate, const Options& options, Result& result)
+{
+	CallbackCaptureReader reader;
+	if (!reader.open(path))
+		return false;
+
+	result = Result();
+	KindResult* kinds[SLOT_COUNT] = {&result.video, &result.audio, &result.gyro, &result.exposure};
+	std::vector<double> latencies[SLOT_COUNT];
+	std::vector<ins_camera::GyroData> gyro;
+	CaptureRecord record;
+
+	const auto started = Clock::now();
+	int64_t loopStartNs = 0;  // schedule position of the current loop's first record
+	int64_t timestampShift = 0;
+	for (int loop = 0; loop < options.loops && (loop == 0 || reader.rewind()); loop++)
+	{
+		bool firstRecord = true;
+		bool firstMedia = true;
+		int64_t firstOffsetNs = 0;
+		int64_t lastOffsetNs = 0;
+		int64_t firstTimestamp = 0;
+		int64_t lastTimestamp = 0;
+		while (reader.next(record))
+		{
+			if (firstRecord)
+			{
+				firstOffsetNs = record.offsetNs;
+				lastOffsetNs = record.offsetNs;
+				firstRecord = false;
+			}
+			lastOffsetNs = std::max(lastOffsetNs, record.offsetNs);
+			if (record.kind == CaptureKind::Video || record.kind == CaptureKind::Audio)
+			{
+				firstTimestamp = firstMedia ? record.timestamp : std::min(firstTimestamp, record.timestamp);
+				lastTimestamp = firstMedia ? record.timestamp : std::max(lastTimestamp, record.timestamp);
+				firstMedia = false;
+			}
+
+			if (options.speed > 0.0)
+			{
+				const double scheduledNs = static_cast<double>(loopStartNs + record.offsetNs - firstOffsetNs) / options.speed;
+				const auto due = started + std::chrono::nanoseconds(static_cast<int64_t>(scheduledNs));
+				const auto now = Clock::now();
+				if (due > now)
+					std::this_thread::sleep_until(due);
+				else if (now - due > LATE_THRESHOLD)
+					result.lateCalls++;
+			}
+
+			const auto callStart = Clock::now();
+			const int slot = dispatch(record, timestampShift, delegate, gyro);
+			if (slot == SLOT_COUNT)
+				continue;
+			latencies[slot].push_back(std::chrono::duration<double, std::micro>(Clock::now() - callStart).count());
+			kinds[slot]->calls++;
+			kinds[slot]->bytes += record.payload.size();
+		}
+
+		const int64_t spanNs = lastOffsetNs - firstOffsetNs;
+		if (loop == 0)
+			result.captureSeconds = static_cast<double>(spanNs) / 1e9;
+		loopStartNs += spanNs + LOOP_GAP_MS * 1000000;
+		timestampShift += lastTimestamp - firstTimestamp + LOOP_GAP_MS;
+	}
+
+	result.wallSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+	for (int slot = 0; slot < SLOT_COUNT; slot++)
+	{
+		summarize(latencies[slot], *kinds[slot]);
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_delegate.h>
+
+#include <cstdint>
+#include <string>
+
+#include "callbackCapture.h"
+
+namespace Letico
+{
+	// Drives any StreamDelegate from a capture file on the calling thread, the way the SDK would, and measures
+	// how long each callback holds that thread.
+	class CallbackReplayer
+	{
+	public:
+		struct Options
+		{
+			double speed = 1.0;	 // 1 = real time, N = N times faster, 0 = as fast as possible
+			int loops = 1;		 // later loops shift SDK timestamps so they keep increasing
+		};
+
+		struct KindResult
+		{
+			uint64_t calls = 0;
+			uint64_t bytes = 0;
+			double p50Us = 0.0;
+			double p99Us = 0.0;
+			double p999Us = 0.0;
+			double maxUs = 0.0;
+		};
+
+		struct Result
+		{
+			KindResult video;
+			KindResult audio;
+			KindResult gyro;
+			KindResult exposure;
+			double captureSeconds = 0.0;  // span of one loop of the capture
+			double wallSeconds = 0.0;
+			uint64_t lateCalls = 0;	 // calls issued more than 1 ms after their scheduled time
+		};
+
+		// Returns false if the capture cannot be opened.
+		static bool replay(const std::string& path, ins_camera::StreamDelegate& delegate, const Options& options, Result& result);
+	};
+}
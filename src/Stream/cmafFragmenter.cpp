@@ -0,0 +1,250 @@
+#include "cmafFragmenter.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace Letico;
+
+namespace
+{
+	// Used for the last sample of a session when no frame interval has been seen yet.
+	constexpr int64_t DEFAULT_FRAME_INTERVAL = TIMESTAMP_HZ / 30;
+}
+
+CmafFragmenter::CmafFragmenter(Config config): mConfig(config)
+{
+}
+
+void CmafFragmenter::setAudio(bool enabled, const AdtsFramer::Config& format)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mActive)
+		return;
+	mAudio = enabled;
+	mAudioFormat = format;
+}
+
+void CmafFragmenter::start(ins_camera::VideoEncodeType codec)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMuxer = Fmp4Muxer(codec);
+	mMuxer.setAudio(mAudio, mAudioFormat);
+	mPendingAudio.clear();
+	mAudioStarted = false;
+	mInit.reset();
+	mParameterSets.clear();
+	mLatestParameterSets.clear();
+	mPending.clear();
+	mFirstTimestamp = 0;
+	mLastInterval = 0;
+	mSequence = 0;
+	mActive = true;
+}
+
+void CmafFragmenter::stop()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		return;
+	if (!mPending.empty())
+	{
+		flushLocked(mPending.back()->timestamp + (mLastInterval > 0 ? mLastInterval : DEFAULT_FRAME_INTERVAL));
+	}
+	mPendingAudio.clear();
+	mActive = false;
+}
+
+void CmafFragmenter::onVideoFrame(const FramePtr& frame)
+{
+	if (frame->streamIndex != mConfig.streamIndex)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		return;
+
+	const FrameContents contents = NalParser::inspect(frame->data(), frame->size(), mMuxer.codec());
+	if (contents.parameterSets)
+	{
+		collectParameterSetsLocked(frame);
+	}
+	// Parameter sets sent on their own only go into the next init segment; as a sample they would be an empty one.
+	if (!contents.slices)
+		return;
+
+	const bool keyframe = contents.keyframe;
+	if (!mPending.empty() && frame->timestamp > mPending.back()->timestamp)
+	{
+		mLastInterval = frame->timestamp - mPending.back()->timestamp;
+	}
+	if (!mPending.empty() && (keyframe || mPending.size() >= mConfig.maxFragmentFrames))
+	{
+		flushLocked(frame->timestamp);
+	}
+
+	if (keyframe)
+	{
+		updateInitLocked();
+	}
+	// Nothing can be muxed before the first init segment, and a fragment has to start decodable.
+	if (!mInit || (mPending.empty() && !keyframe && mSequence == 0))
+		return;
+
+	if (mPending.empty())
+	{
+		if (mSequence == 0)
+		{
+			mFirstTimestamp = frame->timestamp;
+		}
+		mPendingIndependent = keyframe;
+	}
+	mPending.push_back(frame);
+}
+
+void CmafFragmenter::onAudioFrame(const FramePtr& frame)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	// Audio starts with the first fragment; before it there is no timeline (or init segment) to put it on.
+	if (!mActive || !mMuxer.audio() || (mPending.empty() && mSequence == 0) || frame->timestamp < mFirstTimestamp)
+		return;
+
+	AdtsFramer::Config format;
+	size_t headerSize = 0;
+	size_t frameSize = 0;
+	if (!AdtsFramer::parseHeader(frame->data(), frame->size(), format, headerSize, frameSize) ||
+		headerSize != AdtsFramer::HEADER_SIZE)
+		return;
+	if (format != mMuxer.audioFormat())
+	{
+		// The sample entry no longer matches; the next keyframe brings a new init segment.
+		mMuxer.setAudio(true, format);
+		mParameterSets.clear();
+	}
+	// Audio far ahead of the video would wait for a fragment that may never come (a stalled video stream).
+	const int64_t videoTimestamp = mPending.empty() ? mFirstTimestamp : mPending.back()->timestamp;
+	if (frame->timestamp - videoTimestamp > static_cast<int64_t>(mConfig.audioQueueMs))
+		return;
+	mPendingAudio.push_back(frame);
+}
+
+void CmafFragmenter::collectParameterSetsLocked(const FramePtr& frame)
+{
+	mNals.clear();
+	NalParser::split(frame->data(), frame->size(), mMuxer.codec(), mNals);
+	mLatestParameterSets.clear();
+	for (const auto& nal : mNals)
+	{
+		if (NalParser::isParameterSet(mMuxer.codec(), nal.type))
+		{
+			static const uint8_t START_CODE[] = {0x00, 0x00, 0x00, 0x01};
+			mLatestParameterSets.append(reinterpret_cast<const char*>(START_CODE), sizeof(START_CODE));
+			mLatestParameterSets.append(reinterpret_cast<const char*>(nal.data), nal.size);
+		}
+	}
+}
+
+void CmafFragmenter::updateInitLocked()
+{
+	if (mLatestParameterSets.empty() || mLatestParameterSets == mParameterSets)
+		return;
+
+	std::string init;
+	const auto* data = reinterpret_cast<const uint8_t*>(mLatestParameterSets.data());
+	if (!mMuxer.writeInitSegment(init, data, mLatestParameterSets.size()))
+		return;
+	mParameterSets = mLatestParameterSets;
+	mInit = std::make_shared<const std::string>(std::move(init));
+}
+
+void CmafFragmenter::flushLocked(int64_t endTimestamp)
+{
+	mSamples.clear();
+	for (size_t i = 0; i < mPending.size(); i++)
+	{
+		const auto& frame = mPending[i];
+		const int64_t next = i + 1 < mPending.size() ? mPending[i + 1]->timestamp : endTimestamp;
+		const int64_t duration = std::max<int64_t>(next - frame->timestamp, 1);
+		mSamples.push_back(
+			{frame->data(),
+			 frame->size(),
+			 static_cast<uint32_t>(duration * Fmp4Muxer::TIMESCALE / TIMESTAMP_HZ),
+			 i == 0 && mPendingIndependent}
+		);
+	}
+
+	// Audio up to the end of this fragment goes with it.
+	mAudioSamples.clear();
+	uint64_t audioDecodeTime = mAudioDecodeTime;
+	const uint32_t sampleRate = mMuxer.audioFormat().sampleRate;
+	for (const auto& frame : mPendingAudio)
+	{
+		if (frame->timestamp >= endTimestamp)
+			break;
+		const uint64_t expected = static_cast<uint64_t>(frame->timestamp - mFirstTimestamp) * sampleRate / TIMESTAMP_HZ;
+		const uint64_t drift = expected > mAudioDecodeTime ? expected - mAudioDecodeTime : mAudioDecodeTime - expected;
+		if (drift > AdtsFramer::SAMPLES_PER_FRAME || !mAudioStarted)
+		{
+			// A gap inside the fragment cannot be expressed in one run; the frame starts the next fragment's.
+			if (!mAudioSamples.empty())
+				break;
+			audioDecodeTime = expected;
+			mAudioDecodeTime = expected;
+			mAudioStarted = true;
+		}
+		mAudioSamples.push_back({frame->data() + AdtsFramer::HEADER_SIZE, frame->size() - AdtsFramer::HEADER_SIZE});
+		mAudioDecodeTime += AdtsFramer::SAMPLES_PER_FRAME;
+	}
+
+	std::string data;
+	// Fragments of one session are about the same size; avoid regrowing the buffer while muxing.
+	data.reserve(mLastFragmentBytes + mLastFragmentBytes / 4);
+	const int64_t offset = std::max<int64_t>(mPending.front()->timestamp - mFirstTimestamp, 0);
+	const uint64_t decodeTime = static_cast<uint64_t>(offset) * Fmp4Muxer::TIMESCALE / TIMESTAMP_HZ;
+	mMuxer.writeFragment(data, mSamples, decodeTime, mAudioSamples, audioDecodeTime);
+	// The samples pointed into these frames; only now may they go back to the pool.
+	mPendingAudio.erase(mPendingAudio.begin(), mPendingAudio.begin() + static_cast<std::ptrdiff_t>(mAudioSamples.size()));
+	mLastFragmentBytes = data.size();
+
+	CmafFragment fragment;
+	fragment.data = std::make_shared<const std::string>(std::move(data));
+	fragment.init = mInit;
+	fragment.sequence = mSequence++;
+	fragment.timestamp = mPending.front()->timestamp;
+	fragment.duration = endTimestamp - mPending.front()->timestamp;
+	fragment.decodeTime = decodeTime;
+	fragment.frames = static_cast<uint32_t>(mPending.size());
+	fragment.independent = mPendingIndependent;
+	fragment.format = mMuxer.format();
+	if (mMuxer.audio())
+		fragment.audioCodec = AdtsFramer::codecString(mMuxer.audioFormat());
+	mPending.clear();
+
+	for (const auto& sink : mSinks)
+	{
+		sink->onFragment(fragment);
+	}
+}
+
+void CmafFragmenter::subscribe(std::shared_ptr<FragmentSink> sink)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSinks.push_back(std::move(sink));
+}
+
+void CmafFragmenter::unsubscribe(const std::shared_ptr<FragmentSink>& sink)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSinks.erase(std::remove(mSinks.begin(), mSinks.end(), sink), mSinks.end());
+}
+
+SharedBuffer CmafFragmenter::initSegment() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mInit;
+}
+
+VideoFormat CmafFragmenter::format() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMuxer.format();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fmp4Muxer.h"
+#include "hlsSegmentStore.h"
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// One moof + mdat pair. Fragments are immutable and shared by every consumer, like frames are.
+	struct CmafFragment
+	{
+		SharedBuffer data;
+		SharedBuffer init;	// init segment (ftyp + moov) the fragment decodes with
+		uint64_t sequence = 0;
+		int64_t timestamp = 0;	// stream time of the first sample, ms
+		int64_t duration = 0;	// ms
+		uint64_t decodeTime = 0;  // of the first video sample (tfdt), Fmp4Muxer::TIMESCALE units
+		uint32_t frames = 0;
+		bool independent = true;  // starts with a keyframe
+		VideoFormat format;
+		std::string audioCodec;	 // RFC 6381; empty without an audio track
+	};
+
+	class FragmentSink
+	{
+	public:
+		virtual ~FragmentSink() = default;
+
+		virtual void onFragment(const CmafFragment& fragment) = 0;
+	};
+
+	// Muxes one stream of the live feed into fragmented MP4 exactly once and fans the fragments out: the HLS
+	// segmenter serves them as CMAF segments and the host recorder appends them to disk. Frames of the open GOP
+	// are only referenced, never copied, until the next keyframe closes the fragment, so memory is bounded by one
+	// GOP however long the session runs. A new init segment is produced whenever the parameter sets change.
+	//
+	// With audio, the delegate's ADTS frames wait until the video fragment covering their time is flushed and go
+	// into it as a second track; audio more than `audioQueueMs` ahead of the video is dropped rather than queued
+	// for a stalled video stream. Audio decode time advances by whole AAC frames and only snaps back to the frame
+	// timestamps across a gap, so it does not pick up the millisecond rounding of the timestamps.
+	class CmafFragmenter : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			int streamIndex = 0;
+			size_t maxFragmentFrames = 600;	 // a GOP longer than this is split into several fragments
+			double audioQueueMs = 500.0;
+		};
+
+		explicit CmafFragmenter(Config config);
+
+		// Whether the next session has an audio track; `format` until ADTS headers say otherwise. Ignored while a
+		// session runs.
+		void setAudio(bool enabled, const AdtsFramer::Config& format = AdtsFramer::Config());
+
+		void start(ins_camera::VideoEncodeType codec);
+		// Emits the open GOP as a last fragment.
+		void stop();
+
+		void onVideoFrame(const FramePtr& frame) override;
+		void onAudioFrame(const FramePtr& frame) override;
+
+		void subscribe(std::shared_ptr<FragmentSink> sink);
+		void unsubscribe(const std::shared_ptr<FragmentSink>& sink);
+
+		// Null until parameter sets and then a keyframe have been seen.
+		SharedBuffer initSegment() const;
+		VideoFormat format() const;
+
+	private:
+		// Keeps the parameter sets of a frame, whether they came on their own or in front of a keyframe.
+		void collectParameterSetsLocked(const FramePtr& frame);
+		// Called at a keyframe; builds a new init segment if the latest parameter sets differ from the current one's.
+		void updateInitLocked();
+		void flushLocked(int64_t endTimestamp);
+
+		Config mConfig;
+		mutable std::mutex mMutex;
+		bool mActive = false;
+		Fmp4Muxer mMuxer;
+		SharedBuffer mInit;
+		std::string mParameterSets;	 // VPS/SPS/PPS the current init segment was built from
+		std::string mLatestParameterSets;  // newest VPS/SPS/PPS seen, Annex-B
+		std::vector<NalUnit> mNals;
+
+		std::vector<FramePtr> mPending;
+		std::vector<Fmp4Muxer::Sample> mSamples;
+		bool mAudio = false;
+		AdtsFramer::Config mAudioFormat;
+		std::deque<FramePtr> mPendingAudio;
+		std::vector<Fmp4Muxer::AudioSample> mAudioSamples;
+		uint64_t mAudioDecodeTime = 0;	// of the next audio sample, sample rate units
+		bool mAudioStarted = false;
+		bool mPendingIndependent = false;
+		int64_t mFirstTimestamp = 0;
+		int64_t mLastInterval = 0;
+		uint64_t mSequence = 0;
+		size_t mLastFragmentBytes = 0;
+
+		std::vector<std::shared_ptr<FragmentSink>> mSinks;
+	};
+}
@@ -0,0 +1,200 @@
+#include "dashManifest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+#include <utility>
+
+#include "fmp4Muxer.h"
+
+using namespace Letico;
+
+namespace
+{
+	// Players stay this many target durations behind the live edge, like HLS HOLD-BACK.
+	constexpr double PRESENTATION_DELAY_TARGETS = 3.0;
+
+	double seconds(uint64_t mediaTime)
+	{
+		return static_cast<double>(mediaTime) / Fmp4Muxer::TIMESCALE;
+	}
+
+	std::string utcTime(std::chrono::system_clock::time_point time)
+	{
+		const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+		const std::time_t whole = static_cast<std::time_t>(ms / 1000);
+		std::tm utc{};
+		gmtime_r(&whole, &utc);
+		char stamp[32];
+		const size_t length = std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+		std::snprintf(stamp + length, sizeof(stamp) - length, ".%03dZ", static_cast<int>(ms % 1000));
+		return stamp;
+	}
+
+	std::string duration(double value)
+	{
+		std::ostringstream out;
+		out.setf(std::ios::fixed);
+		out.precision(3);
+		out << "PT" << std::max(value, 0.0) << "S";
+		return out.str();
+	}
+}
+
+DashManifest::DashManifest(std::string segmentPrefix): mSegmentPrefix(std::move(segmentPrefix))
+{
+}
+
+void DashManifest::start(double targetDuration)
+{
+	mTargetDuration = targetDuration;
+	mEnded = false;
+	mAnchored = false;
+	mPeriods.clear();
+	mPresentationEnd = 0.0;
+}
+
+void DashManifest::addSegment(const Segment& segment, std::chrono::system_clock::time_point published)
+{
+	const double segmentSeconds = seconds(segment.duration);
+	if (mPeriods.empty() || segment.discontinuity || segment.initName != mPeriods.back().initName)
+	{
+		Period period;
+		period.id = mNextPeriodId++;
+		period.presentationTimeOffset = segment.decodeTime;
+		period.startNumber = segment.number;
+		period.initName = segment.initName;
+		if (!mAnchored)
+		{
+			// The segment is published when it ends, so the presentation began one segment before now.
+			const auto segmentTime = std::chrono::duration<double>(segmentSeconds);
+			mAvailabilityStart = published - std::chrono::duration_cast<std::chrono::system_clock::duration>(segmentTime);
+			mAnchored = true;
+			period.start = 0.0;
+		}
+		else if (segment.discontinuity || mPeriods.empty())
+		{
+			// The stream was down for a while; place the new timeline where the wall clock is, never overlapping.
+			const double elapsed = std::chrono::duration<double>(published - mAvailabilityStart).count() - segmentSeconds;
+			period.start = std::max(elapsed, mPresentationEnd);
+		}
+		else
+		{
+			// Same timeline, new parameter sets: the period continues exactly where the last one ends.
+			const auto& last = mPeriods.back();
+			period.start = last.start + seconds(segment.decodeTime) - seconds(last.presentationTimeOffset);
+		}
+		mPeriods.push_back(std::move(period));
+	}
+
+	auto& period = mPeriods.back();
+	period.format = segment.format;
+	period.audioCodec = segment.audioCodec;
+	if (segment.duration != 0)
+	{
+		period.bandwidth = std::max<uint64_t>(period.bandwidth, static_cast<uint64_t>(segment.bytes * 8 / segmentSeconds));
+	}
+	auto& runs = period.runs;
+	if (!runs.empty() && runs.back().d == segment.duration &&
+		runs.back().t + runs.back().d * runs.back().count == segment.decodeTime)
+	{
+		runs.back().count++;
+	}
+	else
+	{
+		runs.push_back({segment.decodeTime, segment.duration, 1});
+	}
+	mPresentationEnd = period.start + seconds(segment.decodeTime + segment.duration) - seconds(period.presentationTimeOffset);
+}
+
+void DashManifest::removeOldest()
+{
+	if (mPeriods.empty())
+		return;
+	auto& period = mPeriods.front();
+	auto& run = period.runs.front();
+	run.t += run.d;
+	period.startNumber++;
+	if (--run.count == 0)
+		period.runs.pop_front();
+	if (period.runs.empty())
+		mPeriods.pop_front();
+}
+
+void DashManifest::stop()
+{
+	mEnded = true;
+}
+
+std::string DashManifest::document(std::chrono::system_clock::time_point now) const
+{
+	double windowStart = mPresentationEnd;
+	uint64_t maxDuration = 0;
+	if (!mPeriods.empty())
+	{
+		const auto& first = mPeriods.front();
+		windowStart = first.start + seconds(first.runs.front().t) - seconds(first.presentationTimeOffset);
+	}
+	for (const auto& period : mPeriods)
+	{
+		for (const auto& run : period.runs)
+			maxDuration = std::max(maxDuration, run.d);
+	}
+
+	std::ostringstream mpd;
+	mpd << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	mpd << "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" type=\"dynamic\"";
+	mpd << " availabilityStartTime=\"" << utcTime(mAvailabilityStart) << "\" publishTime=\"" << utcTime(now) << "\"";
+	if (mEnded)
+	{
+		mpd << " mediaPresentationDuration=\"" << duration(mPresentationEnd) << "\"";
+	}
+	else
+	{
+		mpd << " minimumUpdatePeriod=\"" << duration(mTargetDuration) << "\"";
+	}
+	mpd << " timeShiftBufferDepth=\"" << duration(mPresentationEnd - windowStart) << "\"";
+	mpd << " suggestedPresentationDelay=\"" << duration(mTargetDuration * PRESENTATION_DELAY_TARGETS) << "\"";
+	mpd << " minBufferTime=\"" << duration(mTargetDuration) << "\"";
+	mpd << " maxSegmentDuration=\"" << duration(seconds(maxDuration)) << "\">\n";
+
+	for (const auto& period : mPeriods)
+	{
+		mpd << "  <Period id=\"" << period.id << "\" start=\"" << duration(period.start) << "\">\n";
+		mpd << "    <AdaptationSet mimeType=\"video/mp4\" segmentAlignment=\"true\" startWithSAP=\"1\">\n";
+		if (!period.audioCodec.empty())
+		{
+			// Audio is muxed into the video segments as a second track.
+			mpd << "      <ContentComponent id=\"1\" contentType=\"video\"/>\n";
+			mpd << "      <ContentComponent id=\"2\" contentType=\"audio\"/>\n";
+		}
+		mpd << "      <Representation id=\"" << mSegmentPrefix << "\" bandwidth=\"" << period.bandwidth << "\"";
+		if (period.format.width != 0)
+		{
+			mpd << " width=\"" << period.format.width << "\" height=\"" << period.format.height << "\" codecs=\""
+				<< period.format.codecString() << (period.audioCodec.empty() ? "" : ",") << period.audioCodec << "\"";
+		}
+		mpd << ">\n";
+		mpd << "        <SegmentTemplate timescale=\"" << Fmp4Muxer::TIMESCALE << "\" presentationTimeOffset=\""
+			<< period.presentationTimeOffset << "\" startNumber=\"" << period.startNumber << "\" initialization=\""
+			<< period.initName << "\" media=\"" << mSegmentPrefix << "$Number$.m4s\">\n";
+		mpd << "          <SegmentTimeline>\n";
+		for (const auto& run : period.runs)
+		{
+			mpd << "            <S t=\"" << run.t << "\" d=\"" << run.d << "\"";
+			if (run.count > 1)
+			{
+				mpd << " r=\"" << run.count - 1 << "\"";
+			}
+			mpd << "/>\n";
+		}
+		mpd << "          </SegmentTimeline>\n";
+		mpd << "        </SegmentTemplate>\n";
+		mpd << "      </Representation>\n";
+		mpd << "    </AdaptationSet>\n";
+		mpd << "  </Period>\n";
+	}
+	mpd << "</MPD>\n";
+	return mpd.str();
+}
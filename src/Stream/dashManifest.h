@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "spsParser.h"
+
+namespace Letico
+{
+	// MPEG-DASH manifest (live profile, SegmentTemplate with SegmentTimeline) over the CMAF segments the HLS
+	// segmenter publishes, so DASH players fetch the same .m4s and init segments from the same store; nothing is
+	// muxed or kept twice. Every init segment change and every discontinuity starts a new Period.
+	//
+	// The manifest is kept as run-length coded timelines that change by one segment at a time: adding a segment
+	// extends the last run, sliding the window shortens the first. The document is serialized from them once per
+	// segment and published like the playlist, never built per request.
+	class DashManifest
+	{
+	public:
+		struct Segment
+		{
+			uint64_t number = 0;
+			uint64_t decodeTime = 0;  // of the first sample, Fmp4Muxer::TIMESCALE units
+			uint64_t duration = 0;	  // Fmp4Muxer::TIMESCALE units
+			size_t bytes = 0;
+			std::string initName;
+			bool discontinuity = false;	 // a new timeline: the camera stream restarted
+			VideoFormat format;
+			std::string audioCodec;	 // muxed audio track, empty without
+		};
+
+		// Media segments are named `segmentPrefix` + number + ".m4s".
+		explicit DashManifest(std::string segmentPrefix);
+
+		// Forgets the previous session; the first segment added anchors the new one to the wall clock.
+		void start(double targetDuration);
+		void addSegment(const Segment& segment, std::chrono::system_clock::time_point published);
+		// The oldest listed segment slid out of the window.
+		void removeOldest();
+		// The presentation ended; players stop reloading the manifest.
+		void stop();
+
+		bool empty() const { return mPeriods.empty(); }
+		std::string document(std::chrono::system_clock::time_point now) const;
+
+	private:
+		// Segments of equal duration back to back: `t`, `t + d`, ... `t + (count - 1) * d`.
+		struct Run
+		{
+			uint64_t t;
+			uint64_t d;
+			uint64_t count;
+		};
+
+		struct Period
+		{
+			uint64_t id = 0;
+			double start = 0.0;	 // seconds after availabilityStartTime
+			uint64_t presentationTimeOffset = 0;
+			uint64_t startNumber = 0;
+			std::string initName;
+			VideoFormat format;
+			std::string audioCodec;
+			uint64_t bandwidth = 0;	 // bits per second of the busiest segment
+			std::deque<Run> runs;
+		};
+
+		std::string mSegmentPrefix;
+		double mTargetDuration = 2.0;
+		bool mEnded = false;
+		bool mAnchored = false;	 // availabilityStartTime is set for the session
+		std::chrono::system_clock::time_point mAvailabilityStart;
+		uint64_t mNextPeriodId = 0;
+		double mPresentationEnd = 0.0;	// seconds after availabilityStartTime
+		std::deque<Period> mPeriods;
+	};
+}
@@ -0,0 +1,121 @@
+#include "exposureStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+using namespace Letico;
+
+namespace
+{
+	int64_t secondOf(int64_t timestamp)
+	{
+		// Floor, so negative timestamps still land in the second they belong to; safe for the int64 limits.
+		return timestamp / TIMESTAMP_HZ - (timestamp % TIMESTAMP_HZ < 0 ? 1 : 0);
+	}
+}
+
+ExposureStore::ExposureStore(Config config): mConfig(config)
+{
+	mSamples.resize(std::max<size_t>(mConfig.capacity, 1));
+	mSlots.resize(std::max<size_t>(mConfig.seconds, 1));
+}
+
+void ExposureStore::onExposureData(const ins_camera::ExposureData& data)
+{
+	const Sample sample{static_cast<int64_t>(std::llround(data.timestamp * mConfig.timestampToMs)), data.exposure_time};
+	const int64_t second = secondOf(sample.timestamp);
+
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	mAccepted++;
+	if (mSize > 0 && sample.timestamp < mSamples[(mHead + mSize - 1) % mSamples.size()].timestamp)
+	{
+		// The camera clock restarted; seconds of the old clock would be mixed into the new one.
+		mDiscontinuities++;
+		clearLocked();
+	}
+
+	mSamples[(mHead + mSize) % mSamples.size()] = sample;
+	if (mSize < mSamples.size())
+		mSize++;
+	else
+		mHead = (mHead + 1) % mSamples.size();
+
+	auto& slot = mSlots[static_cast<size_t>(second) % mSlots.size()];
+	if (slot.count == 0 || slot.second != second)
+	{
+		slot = {second, 0, sample.exposure, 0.0, sample.exposure};
+	}
+	slot.count++;
+	slot.min = std::min(slot.min, sample.exposure);
+	slot.max = std::max(slot.max, sample.exposure);
+	slot.sum += sample.exposure;
+	mNewestSecond = second;
+}
+
+std::vector<ExposureStore::Bucket> ExposureStore::timeline(int64_t from, int64_t to, size_t maxBuckets) const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	std::vector<Bucket> buckets;
+	if (mSize == 0 || maxBuckets == 0 || from > to)
+		return buckets;
+
+	// Only the newest `seconds` seconds can still be in the ring, and only `maxBuckets` of them are wanted.
+	const int64_t oldest = mNewestSecond - static_cast<int64_t>(mSlots.size()) + 1;
+	const int64_t first = std::max(secondOf(from), oldest);
+	const int64_t last = std::min(secondOf(to), mNewestSecond);
+	for (int64_t second = last; second >= first && buckets.size() < maxBuckets; second--)
+	{
+		const auto& slot = mSlots[static_cast<size_t>(second) % mSlots.size()];
+		if (slot.count == 0 || slot.second != second)
+			continue;
+		buckets.push_back({second * TIMESTAMP_HZ, slot.count, slot.min, slot.sum / slot.count, slot.max});
+	}
+	std::reverse(buckets.begin(), buckets.end());
+	return buckets;
+}
+
+std::vector<ExposureStore::Sample> ExposureStore::recent(size_t count) const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	count = std::min(count, mSize);
+	std::vector<Sample> samples;
+	samples.reserve(count);
+	for (size_t i = mSize - count; i < mSize; i++)
+	{
+		samples.push_back(mSamples[(mHead + i) % mSamples.size()]);
+	}
+	return samples;
+}
+
+ExposureStore::Stats ExposureStore::getStats() const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	Stats stats;
+	stats.samples = mAccepted;
+	stats.discontinuities = mDiscontinuities;
+	stats.stored = mSize;
+	stats.capacity = mSamples.size();
+	if (mSize > 0)
+	{
+		stats.oldestTimestamp = mSamples[mHead].timestamp;
+		stats.newestTimestamp = mSamples[(mHead + mSize - 1) % mSamples.size()].timestamp;
+		const int64_t oldest = mNewestSecond - static_cast<int64_t>(mSlots.size()) + 1;
+		for (const auto& slot : mSlots)
+		{
+			if (slot.count != 0 && slot.second >= oldest)
+				stats.buckets++;
+		}
+	}
+	return stats;
+}
+
+void ExposureStore::clearLocked()
+{
+	mHead = 0;
+	mSize = 0;
+	for (auto& slot : mSlots)
+	{
+		slot.count = 0;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Exposure time of the frames of one camera, kept for lighting control. Samples go into a fixed-size ring, and
+	// the per-second min/sum/max bucket of each sample is updated as it arrives, so a timeline query costs one
+	// step per second of range however many frames it covers. Buckets live in a ring of their own indexed by
+	// second, and outlast the samples.
+	class ExposureStore : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			size_t capacity = 16 * 1024;  // samples; about four minutes at 60 fps
+			size_t seconds = 3600;		  // per-second buckets
+			double timestampToMs = 1000.0;	// ExposureData timestamps are in seconds
+		};
+
+		struct Sample
+		{
+			int64_t timestamp;	// ms
+			double exposure;
+		};
+
+		struct Bucket
+		{
+			int64_t timestamp;	// start of the second, ms
+			uint32_t count;
+			double min;
+			double mean;
+			double max;
+		};
+
+		struct Stats
+		{
+			uint64_t samples = 0;  // accepted since construction
+			uint64_t discontinuities = 0;  // samples that went back in time and restarted the store
+			size_t stored = 0;
+			size_t capacity = 0;
+			size_t buckets = 0;	 // seconds with samples
+			int64_t oldestTimestamp = 0;
+			int64_t newestTimestamp = 0;
+		};
+
+		explicit ExposureStore(Config config);
+
+		void onExposureData(const ins_camera::ExposureData& data) override;
+
+		// Buckets of the seconds that overlap from <= timestamp <= to (ms) and have samples, oldest first. With more
+		// than `maxBuckets` the newest are kept.
+		std::vector<Bucket> timeline(int64_t from, int64_t to, size_t maxBuckets = SIZE_MAX) const;
+		// The last `count` samples, oldest first.
+		std::vector<Sample> recent(size_t count) const;
+		Stats getStats() const;
+
+	private:
+		struct Slot
+		{
+			int64_t second = 0;
+			uint32_t count = 0;	 // 0: no sample in this second since the slot was last reused
+			double min = 0.0;
+			double sum = 0.0;
+			double max = 0.0;
+		};
+
+		void clearLocked();
+
+		Config mConfig;
+		std::vector<Sample> mSamples;
+		size_t mHead = 0;  // oldest sample
+		size_t mSize = 0;
+		std::vector<Slot> mSlots;  // slot of a second: second % size
+		int64_t mNewestSecond = 0;
+
+		mutable std::shared_mutex mMutex;
+		uint64_t mAccepted = 0;
+		uint64_t mDiscontinuities = 0;
+	};
+}
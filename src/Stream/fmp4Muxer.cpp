@@ -0,0 +1,508 @@
+#include "fmp4Muxer.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace Letico;
+
+namespace
+{
+	constexpr uint32_t MOVIE_TIMESCALE = 1000;
+	constexpr uint32_t NAL_LENGTH_SIZE = 4;
+
+	// trun sample_flags: sync samples depend on nothing, the rest depend on others and are non-sync.
+	constexpr uint32_t SYNC_SAMPLE_FLAGS = 0x02000000;
+	constexpr uint32_t NON_SYNC_SAMPLE_FLAGS = 0x01010000;
+
+	constexpr uint32_t TFHD_DEFAULT_SAMPLE_DURATION = 0x000008;
+	constexpr uint32_t TFHD_DEFAULT_BASE_IS_MOOF = 0x020000;
+	constexpr uint32_t TRUN_DATA_OFFSET = 0x000001;
+	constexpr uint32_t TRUN_SAMPLE_DURATION = 0x000100;
+	constexpr uint32_t TRUN_SAMPLE_SIZE = 0x000200;
+	constexpr uint32_t TRUN_SAMPLE_FLAGS = 0x000400;
+
+	const uint32_t UNITY_MATRIX[] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+	void put8(std::string& out, uint8_t value)
+	{
+		out.push_back(static_cast<char>(value));
+	}
+
+	void put16(std::string& out, uint16_t value)
+	{
+		put8(out, static_cast<uint8_t>(value >> 8));
+		put8(out, static_cast<uint8_t>(value));
+	}
+
+	void put32(std::string& out, uint32_t value)
+	{
+		put16(out, static_cast<uint16_t>(value >> 16));
+		put16(out, static_cast<uint16_t>(value));
+	}
+
+	void put64(std::string& out, uint64_t value)
+	{
+		put32(out, static_cast<uint32_t>(value >> 32));
+		put32(out, static_cast<uint32_t>(value));
+	}
+
+	void patch32(std::string& out, size_t at, uint32_t value)
+	{
+		out[at] = static_cast<char>(value >> 24);
+		out[at + 1] = static_cast<char>(value >> 16);
+		out[at + 2] = static_cast<char>(value >> 8);
+		out[at + 3] = static_cast<char>(value);
+	}
+
+	// Boxes are written with a placeholder size that endBox() fills in once the contents are known.
+	size_t beginBox(std::string& out, const char* type)
+	{
+		const size_t at = out.size();
+		put32(out, 0);
+		out.append(type, 4);
+		return at;
+	}
+
+	size_t beginFullBox(std::string& out, const char* type, uint8_t version, uint32_t flags)
+	{
+		const size_t at = beginBox(out, type);
+		put32(out, (static_cast<uint32_t>(version) << 24) | flags);
+		return at;
+	}
+
+	void endBox(std::string& out, size_t at)
+	{
+		patch32(out, at, static_cast<uint32_t>(out.size() - at));
+	}
+
+	void putMatrix(std::string& out)
+	{
+		for (uint32_t value : UNITY_MATRIX)
+		{
+			put32(out, value);
+		}
+	}
+
+	void putZeros(std::string& out, size_t count)
+	{
+		out.append(count, '\0');
+	}
+
+	void putDataInformation(std::string& out)
+	{
+		size_t dinf = beginBox(out, "dinf");
+		size_t dref = beginFullBox(out, "dref", 0, 0);
+		put32(out, 1);
+		endBox(out, beginFullBox(out, "url ", 0, 1));  // media is in this file
+		endBox(out, dref);
+		endBox(out, dinf);
+	}
+
+	// Empty sample tables after stsd: every sample lives in a fragment.
+	void putEmptySampleTables(std::string& out)
+	{
+		for (const char* table : {"stts", "stsc", "stco"})
+		{
+			size_t box = beginFullBox(out, table, 0, 0);
+			put32(out, 0);
+			endBox(out, box);
+		}
+		size_t stsz = beginFullBox(out, "stsz", 0, 0);
+		put32(out, 0);
+		put32(out, 0);
+		endBox(out, stsz);
+	}
+
+	void putTrackExtends(std::string& out, uint32_t trackId)
+	{
+		size_t trex = beginFullBox(out, "trex", 0, 0);
+		put32(out, trackId);
+		put32(out, 1);	// default_sample_description_index
+		put32(out, 0);
+		put32(out, 0);
+		put32(out, 0);
+		endBox(out, trex);
+	}
+}
+
+Fmp4Muxer::Fmp4Muxer(ins_camera::VideoEncodeType codec): mCodec(codec)
+{
+}
+
+bool Fmp4Muxer::writeInitSegment(std::string& out, const uint8_t* data, size_t size)
+{
+	const bool hevc = mCodec == ins_camera::VideoEncodeType::H265;
+	mNals.clear();
+	NalParser::split(data, size, mCodec, mNals);
+	mVps.clear();
+	mSps.clear();
+	mPps.clear();
+	for (const auto& nal : mNals)
+	{
+		std::string unit(reinterpret_cast<const char*>(nal.data), nal.size);
+		if (hevc && nal.type == NalParser::H265_VPS)
+			mVps.push_back(std::move(unit));
+		else if (nal.type == (hevc ? NalParser::H265_SPS : NalParser::H264_SPS))
+			mSps.push_back(std::move(unit));
+		else if (nal.type == (hevc ? NalParser::H265_PPS : NalParser::H264_PPS))
+			mPps.push_back(std::move(unit));
+	}
+	if (mSps.empty() || mPps.empty() || (hevc && mVps.empty()))
+		return false;
+	if (!SpsParser::parse(mCodec, reinterpret_cast<const uint8_t*>(mSps.front().data()), mSps.front().size(), mFormat))
+		return false;
+
+	size_t ftyp = beginBox(out, "ftyp");
+	out.append("iso6", 4);
+	put32(out, 0);
+	out.append("iso6cmfcdashmp41", 16);
+	endBox(out, ftyp);
+
+	size_t moov = beginBox(out, "moov");
+	size_t mvhd = beginFullBox(out, "mvhd", 0, 0);
+	put32(out, 0);	// creation_time
+	put32(out, 0);	// modification_time
+	put32(out, MOVIE_TIMESCALE);
+	put32(out, 0);	// duration: unknown, fragments follow
+	put32(out, 0x00010000);
+	put16(out, 0x0100);
+	putZeros(out, 10);
+	putMatrix(out);
+	putZeros(out, 24);
+	put32(out, (mAudio ? AUDIO_TRACK_ID : TRACK_ID) + 1);
+	endBox(out, mvhd);
+
+	size_t trak = beginBox(out, "trak");
+	size_t tkhd = beginFullBox(out, "tkhd", 0, 0x000003);  // enabled, in movie
+	put32(out, 0);
+	put32(out, 0);
+	put32(out, TRACK_ID);
+	put32(out, 0);
+	put32(out, 0);	// duration
+	putZeros(out, 8);
+	put16(out, 0);	// layer
+	put16(out, 0);	// alternate_group
+	put16(out, 0);	// volume
+	put16(out, 0);
+	putMatrix(out);
+	put32(out, mFormat.width << 16);
+	put32(out, mFormat.height << 16);
+	endBox(out, tkhd);
+
+	size_t mdia = beginBox(out, "mdia");
+	size_t mdhd = beginFullBox(out, "mdhd", 0, 0);
+	put32(out, 0);
+	put32(out, 0);
+	put32(out, TIMESCALE);
+	put32(out, 0);
+	put16(out, 0x55c4);	 // "und"
+	put16(out, 0);
+	endBox(out, mdhd);
+
+	size_t hdlr = beginFullBox(out, "hdlr", 0, 0);
+	put32(out, 0);
+	out.append("vide", 4);
+	putZeros(out, 12);
+	out.append("VideoHandler", 13);	 // including the terminating zero
+	endBox(out, hdlr);
+
+	size_t minf = beginBox(out, "minf");
+	size_t vmhd = beginFullBox(out, "vmhd", 0, 1);
+	putZeros(out, 8);
+	endBox(out, vmhd);
+	putDataInformation(out);
+
+	size_t stbl = beginBox(out, "stbl");
+	size_t stsd = beginFullBox(out, "stsd", 0, 0);
+	put32(out, 1);
+	writeSampleEntry(out);
+	endBox(out, stsd);
+	putEmptySampleTables(out);
+	endBox(out, stbl);
+	endBox(out, minf);
+	endBox(out, mdia);
+	endBox(out, trak);
+	if (mAudio)
+	{
+		writeAudioTrack(out);
+	}
+
+	size_t mvex = beginBox(out, "mvex");
+	putTrackExtends(out, TRACK_ID);
+	if (mAudio)
+	{
+		putTrackExtends(out, AUDIO_TRACK_ID);
+	}
+	endBox(out, mvex);
+	endBox(out, moov);
+	return true;
+}
+
+void Fmp4Muxer::writeSampleEntry(std::string& out)
+{
+	const bool hevc = mCodec == ins_camera::VideoEncodeType::H265;
+	size_t entry = beginBox(out, hevc ? "hvc1" : "avc1");
+	putZeros(out, 6);
+	put16(out, 1);	// data_reference_index
+	putZeros(out, 16);
+	put16(out, static_cast<uint16_t>(mFormat.width));
+	put16(out, static_cast<uint16_t>(mFormat.height));
+	put32(out, 0x00480000);	 // 72 dpi
+	put32(out, 0x00480000);
+	put32(out, 0);
+	put16(out, 1);	// frame_count
+	putZeros(out, 32);	// compressorname
+	put16(out, 0x0018);
+	put16(out, 0xffff);
+
+	if (!hevc)
+	{
+		size_t avcc = beginBox(out, "avcC");
+		put8(out, 1);
+		put8(out, mFormat.profile);
+		put8(out, mFormat.constraints);
+		put8(out, mFormat.level);
+		put8(out, 0xfc | (NAL_LENGTH_SIZE - 1));
+		put8(out, static_cast<uint8_t>(0xe0 | mSps.size()));
+		for (const auto& sps : mSps)
+		{
+			put16(out, static_cast<uint16_t>(sps.size()));
+			out += sps;
+		}
+		put8(out, static_cast<uint8_t>(mPps.size()));
+		for (const auto& pps : mPps)
+		{
+			put16(out, static_cast<uint16_t>(pps.size()));
+			out += pps;
+		}
+		if (mFormat.profile == 100 || mFormat.profile == 110 || mFormat.profile == 122 || mFormat.profile == 144)
+		{
+			put8(out, 0xfc | mFormat.chromaFormat);
+			put8(out, 0xf8 | (mFormat.bitDepthLuma - 8));
+			put8(out, 0xf8 | (mFormat.bitDepthChroma - 8));
+			put8(out, 0);  // no SPS extensions
+		}
+		endBox(out, avcc);
+	}
+	else
+	{
+		size_t hvcc = beginBox(out, "hvcC");
+		put8(out, 1);
+		out.append(reinterpret_cast<const char*>(mFormat.profileTierLevel), sizeof(mFormat.profileTierLevel));
+		put16(out, 0xf000);	 // min_spatial_segmentation_idc
+		put8(out, 0xfc);	 // parallelismType
+		put8(out, 0xfc | mFormat.chromaFormat);
+		put8(out, 0xf8 | (mFormat.bitDepthLuma - 8));
+		put8(out, 0xf8 | (mFormat.bitDepthChroma - 8));
+		put16(out, 0);	// avgFrameRate
+		put8(out, static_cast<uint8_t>((mFormat.maxSubLayers << 3) | (mFormat.temporalIdNested ? 0x04 : 0) | (NAL_LENGTH_SIZE - 1)));
+		put8(out, 3);
+		const std::pair<uint8_t, const std::vector<std::string>*> arrays[] = {
+			{NalParser::H265_VPS, &mVps}, {NalParser::H265_SPS, &mSps}, {NalParser::H265_PPS, &mPps}};
+		for (const auto& array : arrays)
+		{
+			put8(out, 0x80 | array.first);	// array_completeness
+			put16(out, static_cast<uint16_t>(array.second->size()));
+			for (const auto& unit : *array.second)
+			{
+				put16(out, static_cast<uint16_t>(unit.size()));
+				out += unit;
+			}
+		}
+		endBox(out, hvcc);
+	}
+	endBox(out, entry);
+}
+
+void Fmp4Muxer::writeAudioTrack(std::string& out)
+{
+	size_t trak = beginBox(out, "trak");
+	size_t tkhd = beginFullBox(out, "tkhd", 0, 0x000003);
+	put32(out, 0);
+	put32(out, 0);
+	put32(out, AUDIO_TRACK_ID);
+	put32(out, 0);
+	put32(out, 0);	// duration
+	putZeros(out, 8);
+	put16(out, 0);	// layer
+	put16(out, 0);	// alternate_group
+	put16(out, 0x0100);	 // volume 1.0
+	put16(out, 0);
+	putMatrix(out);
+	put32(out, 0);	// width and height
+	put32(out, 0);
+	endBox(out, tkhd);
+
+	size_t mdia = beginBox(out, "mdia");
+	size_t mdhd = beginFullBox(out, "mdhd", 0, 0);
+	put32(out, 0);
+	put32(out, 0);
+	put32(out, mAudioFormat.sampleRate);
+	put32(out, 0);
+	put16(out, 0x55c4);	 // "und"
+	put16(out, 0);
+	endBox(out, mdhd);
+
+	size_t hdlr = beginFullBox(out, "hdlr", 0, 0);
+	put32(out, 0);
+	out.append("soun", 4);
+	putZeros(out, 12);
+	out.append("SoundHandler", 13);
+	endBox(out, hdlr);
+
+	size_t minf = beginBox(out, "minf");
+	size_t smhd = beginFullBox(out, "smhd", 0, 0);
+	put16(out, 0);	// balance
+	put16(out, 0);
+	endBox(out, smhd);
+	putDataInformation(out);
+
+	size_t stbl = beginBox(out, "stbl");
+	size_t stsd = beginFullBox(out, "stsd", 0, 0);
+	put32(out, 1);
+	size_t entry = beginBox(out, "mp4a");
+	putZeros(out, 6);
+	put16(out, 1);	// data_reference_index
+	putZeros(out, 8);
+	put16(out, mAudioFormat.channels);
+	put16(out, 16);	 // samplesize
+	put32(out, 0);
+	put32(out, mAudioFormat.sampleRate << 16);
+
+	// esds: ES_Descriptor > DecoderConfigDescriptor > DecoderSpecificInfo (AudioSpecificConfig), SLConfigDescriptor.
+	const std::vector<uint8_t> specificInfo = AdtsFramer::audioSpecificConfig(mAudioFormat);
+	const uint8_t decoderConfigSize = static_cast<uint8_t>(13 + 2 + specificInfo.size());
+	size_t esds = beginFullBox(out, "esds", 0, 0);
+	put8(out, 0x03);
+	put8(out, static_cast<uint8_t>(3 + 2 + decoderConfigSize + 3));
+	put16(out, 0);	// ES_ID
+	put8(out, 0);	// no dependency, URL or OCR stream
+	put8(out, 0x04);
+	put8(out, decoderConfigSize);
+	put8(out, 0x40);  // objectTypeIndication: MPEG-4 audio
+	put8(out, 0x15);  // streamType audio, upStream 0, reserved 1
+	put8(out, 0);	  // bufferSizeDB
+	put16(out, 0);
+	put32(out, 0);	// maxBitrate: unknown
+	put32(out, 0);	// avgBitrate
+	put8(out, 0x05);
+	put8(out, static_cast<uint8_t>(specificInfo.size()));
+	out.append(reinterpret_cast<const char*>(specificInfo.data()), specificInfo.size());
+	put8(out, 0x06);
+	put8(out, 1);
+	put8(out, 0x02);  // predefined: MP4
+	endBox(out, esds);
+	endBox(out, entry);
+	endBox(out, stsd);
+	putEmptySampleTables(out);
+	endBox(out, stbl);
+	endBox(out, minf);
+	endBox(out, mdia);
+	endBox(out, trak);
+}
+
+void Fmp4Muxer::writeFragment(
+	std::string& out,
+	const std::vector<Sample>& samples,
+	uint64_t decodeTime,
+	const std::vector<AudioSample>& audio,
+	uint64_t audioDecodeTime
+)
+{
+	// Split every sample once; the NAL list is reused for the sizes in trun and for the payload in mdat.
+	mNals.clear();
+	mSampleSizes.clear();
+	size_t mdatBytes = 0;
+	for (const auto& sample : samples)
+	{
+		const size_t first = mNals.size();
+		NalParser::split(sample.data, sample.size, mCodec, mNals);
+		auto kept = std::remove_if(
+			mNals.begin() + first,
+			mNals.end(),
+			[this](const NalUnit& nal)
+			{ return NalParser::isAccessUnitDelimiter(mCodec, nal.type) || NalParser::isParameterSet(mCodec, nal.type); }
+		);
+		mNals.erase(kept, mNals.end());
+		uint32_t sampleBytes = 0;
+		for (size_t i = first; i < mNals.size(); i++)
+		{
+			sampleBytes += static_cast<uint32_t>(NAL_LENGTH_SIZE + mNals[i].size);
+		}
+		mSampleSizes.push_back(sampleBytes);
+		mdatBytes += sampleBytes;
+	}
+
+	const size_t moofStart = out.size();
+	size_t moof = beginBox(out, "moof");
+	size_t mfhd = beginFullBox(out, "mfhd", 0, 0);
+	put32(out, mSequence++);
+	endBox(out, mfhd);
+
+	size_t traf = beginBox(out, "traf");
+	size_t tfhd = beginFullBox(out, "tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+	put32(out, TRACK_ID);
+	endBox(out, tfhd);
+	size_t tfdt = beginFullBox(out, "tfdt", 1, 0);
+	put64(out, decodeTime);
+	endBox(out, tfdt);
+	size_t trun = beginFullBox(out, "trun", 0, TRUN_DATA_OFFSET | TRUN_SAMPLE_DURATION | TRUN_SAMPLE_SIZE | TRUN_SAMPLE_FLAGS);
+	put32(out, static_cast<uint32_t>(samples.size()));
+	const size_t dataOffsetAt = out.size();
+	put32(out, 0);
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		put32(out, samples[i].duration);
+		put32(out, mSampleSizes[i]);
+		put32(out, samples[i].keyframe ? SYNC_SAMPLE_FLAGS : NON_SYNC_SAMPLE_FLAGS);
+	}
+	endBox(out, trun);
+	endBox(out, traf);
+
+	size_t audioBytes = 0;
+	size_t audioDataOffsetAt = 0;
+	if (!audio.empty())
+	{
+		size_t audioTraf = beginBox(out, "traf");
+		size_t audioTfhd = beginFullBox(out, "tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF | TFHD_DEFAULT_SAMPLE_DURATION);
+		put32(out, AUDIO_TRACK_ID);
+		put32(out, AdtsFramer::SAMPLES_PER_FRAME);
+		endBox(out, audioTfhd);
+		size_t audioTfdt = beginFullBox(out, "tfdt", 1, 0);
+		put64(out, audioDecodeTime);
+		endBox(out, audioTfdt);
+		// Sample flags come from trex: zero, every AAC frame is a sync sample.
+		size_t audioTrun = beginFullBox(out, "trun", 0, TRUN_DATA_OFFSET | TRUN_SAMPLE_SIZE);
+		put32(out, static_cast<uint32_t>(audio.size()));
+		audioDataOffsetAt = out.size();
+		put32(out, 0);
+		for (const auto& sample : audio)
+		{
+			put32(out, static_cast<uint32_t>(sample.size));
+			audioBytes += sample.size;
+		}
+		endBox(out, audioTrun);
+		endBox(out, audioTraf);
+	}
+	endBox(out, moof);
+	// Sample data starts right after the mdat header, relative to the start of moof; audio follows the video.
+	const size_t dataOffset = out.size() - moofStart + 8;
+	patch32(out, dataOffsetAt, static_cast<uint32_t>(dataOffset));
+	if (!audio.empty())
+	{
+		patch32(out, audioDataOffsetAt, static_cast<uint32_t>(dataOffset + mdatBytes));
+	}
+
+	out.reserve(out.size() + 8 + mdatBytes + audioBytes);
+	put32(out, static_cast<uint32_t>(8 + mdatBytes + audioBytes));
+	out.append("mdat", 4);
+	for (const auto& nal : mNals)
+	{
+		put32(out, static_cast<uint32_t>(nal.size));
+		out.append(reinterpret_cast<const char*>(nal.data), nal.size);
+	}
+	for (const auto& sample : audio)
+	{
+		out.append(reinterpret_cast<const char*>(sample.data), sample.size);
+	}
+}
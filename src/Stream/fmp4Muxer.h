@@ -0,0 +1,94 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "adtsFramer.h"
+#include "nalParser.h"
+#include "spsParser.h"
+
+namespace Letico
+{
+	// Fragmented MP4 (ISO BMFF / CMAF) writer for a single H.264/H.265 video track. The init segment (ftyp + moov
+	// with an empty sample table and mvex) goes first; each writeFragment() call then produces one self-contained
+	// moof + mdat pair. Nothing has to be patched at the end of a file, so a recording cut short by a crash
+	// still plays up to its last complete fragment, and the same fragments can be served as CMAF chunks.
+	//
+	// Samples are passed as Annex-B access units and rewritten to 4-byte length prefixes; AUDs and in-band
+	// parameter sets are dropped because avc1/hvc1 carry them in the sample entry.
+	//
+	// With audio, the moov gets a second (mp4a) track and each fragment a second traf whose raw AAC samples follow
+	// the video samples in the same mdat, so one fragment stays one self-contained CMAF chunk.
+	class Fmp4Muxer
+	{
+	public:
+		static constexpr uint32_t TIMESCALE = 90000;
+		static constexpr uint32_t TRACK_ID = 1;
+		static constexpr uint32_t AUDIO_TRACK_ID = 2;
+
+		struct Sample
+		{
+			const uint8_t* data;
+			size_t size;
+			uint32_t duration;	// TIMESCALE units
+			bool keyframe;
+		};
+
+		// Raw AAC access unit (no ADTS header) of AdtsFramer::SAMPLES_PER_FRAME samples.
+		struct AudioSample
+		{
+			const uint8_t* data;
+			size_t size;
+		};
+
+		explicit Fmp4Muxer(ins_camera::VideoEncodeType codec = ins_camera::VideoEncodeType::H264);
+
+		void setCodec(ins_camera::VideoEncodeType codec) { mCodec = codec; }
+		ins_camera::VideoEncodeType codec() const { return mCodec; }
+		// Adds an audio track to the next init segment; its timescale is the sample rate.
+		void setAudio(bool enabled, const AdtsFramer::Config& format = AdtsFramer::Config())
+		{
+			mAudio = enabled;
+			mAudioFormat = format;
+		}
+		bool audio() const { return mAudio; }
+		const AdtsFramer::Config& audioFormat() const { return mAudioFormat; }
+
+		// ftyp + moov for the stream described by the parameter sets found in `data` (Annex-B, usually a
+		// keyframe with VPS/SPS/PPS in front). Returns false without writing anything if a set is missing.
+		bool writeInitSegment(std::string& out, const uint8_t* data, size_t size);
+		const VideoFormat& format() const { return mFormat; }
+
+		// moof + mdat for consecutive samples whose first sample decodes at `decodeTime` (TIMESCALE units), and the
+		// audio samples of the same stretch starting at `audioDecodeTime` (sample rate units).
+		void writeFragment(
+			std::string& out,
+			const std::vector<Sample>& samples,
+			uint64_t decodeTime,
+			const std::vector<AudioSample>& audio = {},
+			uint64_t audioDecodeTime = 0
+		);
+		uint32_t nextSequence() const { return mSequence; }
+
+	private:
+		void writeSampleEntry(std::string& out);
+		void writeAudioTrack(std::string& out);
+
+		ins_camera::VideoEncodeType mCodec;
+		VideoFormat mFormat;
+		std::vector<std::string> mVps;
+		std::vector<std::string> mSps;
+		std::vector<std::string> mPps;
+		uint32_t mSequence = 1;
+		bool mAudio = false;
+		AdtsFramer::Config mAudioFormat;
+
+		// Scratch for writeFragment(), kept to avoid reallocating per fragment.
+		std::vector<NalUnit> mNals;
+		std::vector<uint32_t> mSampleSizes;
+	};
+}
@@ -0,0 +1,78 @@
+#include "fragmentQueue.h"
+
+#include <iterator>
+
+using namespace Letico;
+
+FragmentQueue::FragmentQueue(Config config): mConfig(config)
+{
+}
+
+void FragmentQueue::onFragment(const CmafFragment& fragment)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mClosed)
+			return;
+
+		if (mWaitingForIndependent)
+		{
+			if (!fragment.independent)
+			{
+				mStats.droppedFrames++;
+				return;
+			}
+			mWaitingForIndependent = false;
+		}
+
+		if (mFragments.size() + 1 > mConfig.maxFrames || mBytes + fragment.data->size() > mConfig.maxBytes)
+		{
+			mStats.droppedFrames += mFragments.size();
+			mStats.dropEvents++;
+			mFragments.clear();
+			mBytes = 0;
+			if (!fragment.independent)
+			{
+				mWaitingForIndependent = true;
+				mStats.droppedFrames++;
+				return;
+			}
+		}
+
+		mFragments.push_back(fragment);
+		mBytes += fragment.data->size();
+	}
+	mReady.notify_one();
+}
+
+bool FragmentQueue::popAll(std::vector<CmafFragment>& out, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mReady.wait_for(lock, timeout, [this] { return !mFragments.empty() || mClosed; });
+	if (mFragments.empty())
+		return !mClosed;
+
+	mStats.deliveredFrames += mFragments.size();
+	out.insert(out.end(), std::make_move_iterator(mFragments.begin()), std::make_move_iterator(mFragments.end()));
+	mFragments.clear();
+	mBytes = 0;
+	return true;
+}
+
+void FragmentQueue::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mClosed = true;
+	}
+	mReady.notify_all();
+}
+
+FragmentQueue::Stats FragmentQueue::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats = mStats;
+	stats.queuedFrames = mFragments.size();
+	stats.queuedBytes = mBytes;
+	return stats;
+}
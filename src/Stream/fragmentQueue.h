@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "cmafFragmenter.h"
+#include "frameQueue.h"
+
+namespace Letico
+{
+	// Bounded queue of shared CMAF fragments between the fragmenter and a consumer thread (the host recorder).
+	// Same limits and drop policy as FrameQueue, at fragment granularity: on overflow the backlog is dropped and
+	// the consumer resumes at the next independent fragment, so what it writes always decodes.
+	class FragmentQueue : public FragmentSink
+	{
+	public:
+		using Config = FrameQueue::Config;
+		using Stats = FrameQueue::Stats;  // the frame counters count fragments
+
+		explicit FragmentQueue(Config config);
+
+		void onFragment(const CmafFragment& fragment) override;
+
+		// Moves every queued fragment into `out`, waiting up to `timeout` for the first one. Returns false once
+		// the queue is closed and empty.
+		bool popAll(std::vector<CmafFragment>& out, std::chrono::milliseconds timeout);
+		void close();
+
+		Stats getStats() const;
+
+	private:
+		Config mConfig;
+		mutable std::mutex mMutex;
+		std::condition_variable mReady;
+		std::deque<CmafFragment> mFragments;
+		size_t mBytes = 0;
+		bool mWaitingForIndependent = false;
+		bool mClosed = false;
+		Stats mStats;
+	};
+}
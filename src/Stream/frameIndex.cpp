@@ -0,0 +1,239 @@
+#include "frameIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include "nalParser.h"
+
+using namespace Letico;
+
+namespace
+{
+	constexpr size_t STDIO_BUFFER_BYTES = 1024 * 1024;
+	// Gyro and exposure older than this before the oldest pending frame can no longer be needed.
+	constexpr int64_t HISTORY_MS = 1000;
+
+	float lerp(double a, double b, double t)
+	{
+		return static_cast<float>(a + (b - a) * t);
+	}
+}
+
+FrameIndexer::FrameIndexer(Config config): mConfig(config)
+{
+	mConfig.samplesPerFrame = std::max<uint32_t>(mConfig.samplesPerFrame, 1);
+	mRecord.resize(sizeof(FrameIndexRecord) + mConfig.samplesPerFrame * sizeof(FrameIndexGyro));
+}
+
+FrameIndexer::~FrameIndexer()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	closeLocked();
+}
+
+bool FrameIndexer::start(const std::string& path, ins_camera::VideoEncodeType codec)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mFile)
+		return false;
+	mFile = std::fopen(path.c_str(), "wb");
+	if (!mFile)
+		return false;
+	mBuffer.resize(STDIO_BUFFER_BYTES);
+	std::setvbuf(mFile, mBuffer.data(), _IOFBF, mBuffer.size());
+
+	FrameIndexHeader header{};
+	std::memcpy(header.magic, FrameIndexHeader::MAGIC, sizeof(header.magic));
+	header.version = FrameIndexHeader::VERSION;
+	header.headerSize = sizeof(header);
+	header.recordSize = static_cast<uint32_t>(mRecord.size());
+	header.samplesPerFrame = mConfig.samplesPerFrame;
+	header.createdUnixMs =
+		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	std::fwrite(&header, sizeof(header), 1, mFile);
+
+	mCodec = codec;
+	mStats = Stats();
+	mStats.active = true;
+	mStats.path = path;
+	mPending.clear();
+	mGyro.clear();
+	mExposures.clear();
+	return true;
+}
+
+FrameIndexer::Stats FrameIndexer::stop()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mFile)
+		return mStats;
+	flushLocked(true);
+	closeLocked();
+	return mStats;
+}
+
+FrameIndexer::Stats FrameIndexer::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+void FrameIndexer::closeLocked()
+{
+	if (!mFile)
+		return;
+	// Only a cleanly closed index carries its frame count; readers of a cut-short file go by the file size.
+	const uint64_t frameCount = mStats.frames;
+	std::fseek(mFile, offsetof(FrameIndexHeader, frameCount), SEEK_SET);
+	std::fwrite(&frameCount, sizeof(frameCount), 1, mFile);
+	std::fclose(mFile);
+	mFile = nullptr;
+	mStats.active = false;
+}
+
+void FrameIndexer::onVideoFrame(const FramePtr& frame)
+{
+	if (frame->streamIndex != mConfig.streamIndex)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mFile)
+		return;
+	const bool keyframe = NalParser::containsKeyframe(frame->data(), frame->size(), mCodec);
+	mPending.push_back({frame->timestamp, static_cast<uint32_t>(frame->size()), static_cast<uint16_t>(frame->streamIndex), keyframe});
+	flushLocked(false);
+}
+
+void FrameIndexer::onGyroData(const ins_camera::GyroData* samples, size_t count)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mFile || count == 0)
+		return;
+	if (!mGyro.empty() && samples[0].timestamp < mGyro.back().timestamp)
+	{
+		// Clock restart: interpolation needs one increasing run.
+		mGyro.clear();
+	}
+	mGyro.insert(mGyro.end(), samples, samples + count);
+	flushLocked(false);
+}
+
+void FrameIndexer::onExposureData(const ins_camera::ExposureData& data)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mFile)
+		return;
+	mExposures.push_back({data.timestamp * mConfig.exposureTimestampToMs, data.exposure_time});
+	flushLocked(false);
+}
+
+const FrameIndexer::Exposure* FrameIndexer::matchExposureLocked(int64_t timestamp) const
+{
+	const Exposure* best = nullptr;
+	double bestDistance = mConfig.matchToleranceMs;
+	for (const auto& exposure : mExposures)
+	{
+		const double distance = std::abs(exposure.timestamp - static_cast<double>(timestamp));
+		if (distance <= bestDistance)
+		{
+			best = &exposure;
+			bestDistance = distance;
+		}
+	}
+	return best;
+}
+
+void FrameIndexer::flushLocked(bool force)
+{
+	while (!mPending.empty())
+	{
+		const auto& frame = mPending.front();
+		if (!force && mPending.size() <= mConfig.maxPendingFrames)
+		{
+			// Exposures arrive in order, so once one at or past the frame exists the nearest match is final.
+			if (mExposures.empty() || mExposures.back().timestamp < static_cast<double>(frame.timestamp))
+				break;
+			const Exposure* exposure = matchExposureLocked(frame.timestamp);
+			const double halfExposureMs = exposure ? exposure->exposureTime * 500.0 : 0.0;
+			const double windowEnd = static_cast<double>(frame.timestamp) + halfExposureMs + mConfig.gyroMarginMs;
+			if (mGyro.empty() || static_cast<double>(mGyro.back().timestamp) < windowEnd)
+				break;
+		}
+		writeLocked(frame);
+		mPending.pop_front();
+	}
+
+	// Drop what no pending or future frame can reach, keeping one gyro sample before the horizon to interpolate from.
+	if (mGyro.empty())
+		return;
+	const int64_t horizon = (mPending.empty() ? mGyro.back().timestamp : mPending.front().timestamp) - HISTORY_MS;
+	while (mGyro.size() > 1 && mGyro[1].timestamp < horizon)
+		mGyro.pop_front();
+	while (!mExposures.empty() && mExposures.front().timestamp < static_cast<double>(horizon) - mConfig.matchToleranceMs)
+		mExposures.pop_front();
+}
+
+FrameIndexGyro FrameIndexer::interpolateLocked(double time) const
+{
+	FrameIndexGyro out{};
+	if (mGyro.empty())
+		return out;
+	auto after = std::lower_bound(
+		mGyro.begin(),
+		mGyro.end(),
+		time,
+		[](const ins_camera::GyroData& sample, double value) { return static_cast<double>(sample.timestamp) < value; }
+	);
+	const auto& b = after == mGyro.end() ? mGyro.back() : *after;
+	const auto& a = after == mGyro.begin() || after == mGyro.end() ? b : *(after - 1);
+	const double span = static_cast<double>(b.timestamp - a.timestamp);
+	const double t = span > 0.0 ? (time - static_cast<double>(a.timestamp)) / span : 0.0;
+	out.ax = lerp(a.ax, b.ax, t);
+	out.ay = lerp(a.ay, b.ay, t);
+	out.az = lerp(a.az, b.az, t);
+	out.gx = lerp(a.gx, b.gx, t);
+	out.gy = lerp(a.gy, b.gy, t);
+	out.gz = lerp(a.gz, b.gz, t);
+	return out;
+}
+
+void FrameIndexer::writeLocked(const PendingFrame& frame)
+{
+	const Exposure* exposure = matchExposureLocked(frame.timestamp);
+	const double halfExposureMs = exposure ? exposure->exposureTime * 500.0 : 0.0;
+
+	FrameIndexRecord record{};
+	record.timestamp = frame.timestamp;
+	record.windowStart = static_cast<double>(frame.timestamp) - halfExposureMs - mConfig.gyroMarginMs;
+	record.windowEnd = static_cast<double>(frame.timestamp) + halfExposureMs + mConfig.gyroMarginMs;
+	record.frameNumber = static_cast<uint32_t>(mStats.frames);
+	record.frameSize = frame.size;
+	record.exposureTime = exposure ? static_cast<float>(exposure->exposureTime) : 0.0f;
+	record.streamIndex = frame.streamIndex;
+	record.flags = frame.keyframe ? FrameIndexRecord::KEYFRAME : 0;
+	if (exposure)
+	{
+		record.flags |= FrameIndexRecord::EXPOSURE_MATCHED;
+		mStats.exposureMatched++;
+	}
+	if (!mGyro.empty() && static_cast<double>(mGyro.front().timestamp) <= record.windowStart &&
+		static_cast<double>(mGyro.back().timestamp) >= record.windowEnd)
+	{
+		record.flags |= FrameIndexRecord::GYRO_COMPLETE;
+		mStats.gyroComplete++;
+	}
+	std::memcpy(mRecord.data(), &record, sizeof(record));
+
+	auto* gyro = reinterpret_cast<FrameIndexGyro*>(mRecord.data() + sizeof(record));
+	const uint32_t samples = mConfig.samplesPerFrame;
+	for (uint32_t i = 0; i < samples; i++)
+	{
+		const double t = samples > 1 ? static_cast<double>(i) / (samples - 1) : 0.5;
+		gyro[i] = interpolateLocked(record.windowStart + (record.windowEnd - record.windowStart) * t);
+	}
+	std::fwrite(mRecord.data(), mRecord.size(), 1, mFile);
+	mStats.frames++;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Sidecar index of a recording, for stitching and rolling-shutter correction jobs that would otherwise re-parse
+	// the .insv telemetry. Fixed-size little-endian records, so a reader can mmap the file and index frame N
+	// directly: a FrameIndexHeader, then `frameCount` FrameIndexRecords, each followed by `samplesPerFrame`
+	// FrameIndexGyro values interpolated at evenly spaced times from windowStart to windowEnd.
+	struct FrameIndexHeader
+	{
+		static constexpr char MAGIC[8] = {'L', 'T', 'F', 'I', 'D', 'X', '0', '1'};
+		static constexpr uint32_t VERSION = 1;
+
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;	   // bytes before the first record
+		uint32_t recordSize;	   // FrameIndexRecord plus its gyro values
+		uint32_t samplesPerFrame;
+		uint64_t frameCount;	   // written when the index is closed; 0 in a file cut short, use the file size
+		int64_t createdUnixMs;
+		uint8_t reserved[24];
+	};
+
+	struct FrameIndexRecord
+	{
+		static constexpr uint8_t KEYFRAME = 0x01;
+		static constexpr uint8_t EXPOSURE_MATCHED = 0x02;  // exposureTime comes from an ExposureData callback
+		static constexpr uint8_t GYRO_COMPLETE = 0x04;	   // gyro data covered the whole window
+
+		int64_t timestamp;	 // frame timestamp, ms
+		double windowStart;	 // ms, exposure window widened by the configured margin
+		double windowEnd;
+		uint32_t frameNumber;
+		uint32_t frameSize;
+		float exposureTime;	 // seconds, 0 when unknown
+		uint16_t streamIndex;
+		uint8_t flags;
+		uint8_t reserved;
+	};
+
+	struct FrameIndexGyro
+	{
+		float ax, ay, az;
+		float gx, gy, gz;
+	};
+
+	static_assert(sizeof(FrameIndexHeader) == 64, "frame index header layout is part of the file format");
+	static_assert(sizeof(FrameIndexRecord) == 40, "frame index record layout is part of the file format");
+	static_assert(sizeof(FrameIndexGyro) == 24, "frame index gyro layout is part of the file format");
+
+	// Joins video frames with their exposure and gyro as the callbacks arrive. A frame is held until the gyro
+	// stream has passed the end of its exposure window (or `maxPendingFrames` newer frames are waiting, for
+	// cameras that send no gyro or exposure) and then appended; nothing is re-read or re-sorted at the end.
+	class FrameIndexer : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			int streamIndex = 0;  // frames of other streams (LRV, the second lens) are not indexed
+			uint32_t samplesPerFrame = 8;
+			double gyroMarginMs = 5.0;		 // added on both sides of the exposure window (rolling-shutter readout)
+			double matchToleranceMs = 15.0;	 // max distance between a frame and its ExposureData
+			size_t maxPendingFrames = 600;	 // frames held back waiting for late gyro or exposure
+			double exposureTimestampToMs = 1000.0;	// ExposureData timestamps are in seconds
+		};
+
+		struct Stats
+		{
+			bool active = false;
+			std::string path;
+			uint64_t frames = 0;
+			uint64_t exposureMatched = 0;
+			uint64_t gyroComplete = 0;
+		};
+
+		explicit FrameIndexer(Config config);
+		~FrameIndexer();
+		FrameIndexer(const FrameIndexer&) = delete;
+		FrameIndexer& operator=(const FrameIndexer&) = delete;
+
+		// Returns false if an index is already being written or the file cannot be created.
+		bool start(const std::string& path, ins_camera::VideoEncodeType codec);
+		// Writes out every pending frame with whatever data has arrived, and closes the file.
+		Stats stop();
+		Stats getStats() const;
+
+		void onVideoFrame(const FramePtr& frame) override;
+		void onGyroData(const ins_camera::GyroData* samples, size_t count) override;
+		void onExposureData(const ins_camera::ExposureData& data) override;
+
+	private:
+		struct PendingFrame
+		{
+			int64_t timestamp;
+			uint32_t size;
+			uint16_t streamIndex;
+			bool keyframe;
+		};
+
+		struct Exposure
+		{
+			double timestamp;  // ms
+			double exposureTime;
+		};
+
+		void flushLocked(bool force);
+		void writeLocked(const PendingFrame& frame);
+		const Exposure* matchExposureLocked(int64_t timestamp) const;
+		FrameIndexGyro interpolateLocked(double time) const;
+		void closeLocked();
+
+		Config mConfig;
+		mutable std::mutex mMutex;
+		std::FILE* mFile = nullptr;
+		std::vector<char> mBuffer;
+		std::vector<char> mRecord;
+		ins_camera::VideoEncodeType mCodec = ins_camera::VideoEncodeType::H264;
+		Stats mStats;
+
+		std::deque<PendingFrame> mPending;
+		std::deque<ins_camera::GyroData> mGyro;
+		std::deque<Exposure> mExposures;
+	};
+}
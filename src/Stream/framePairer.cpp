@@ -0,0 +1,119 @@
+#include "framePairer.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "nalParser.h"
+
+using namespace Letico;
+
+FramePairer::FramePairer(Config config): mConfig(config)
+{
+	mConfig.maxQueuedFrames = std::max<size_t>(mConfig.maxQueuedFrames, 1);
+}
+
+void FramePairer::start(ins_camera::VideoEncodeType codec)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCodec = codec;
+	for (int lens = 0; lens < 2; lens++)
+	{
+		mQueues[lens].clear();
+		mLastTimestamp[lens] = INT64_MIN;
+	}
+}
+
+void FramePairer::subscribe(std::shared_ptr<FramePairSink> sink)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSinks.push_back(std::move(sink));
+}
+
+void FramePairer::unsubscribe(const std::shared_ptr<FramePairSink>& sink)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSinks.erase(std::remove(mSinks.begin(), mSinks.end(), sink), mSinks.end());
+}
+
+FramePairer::Stats FramePairer::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats = mStats;
+	for (int lens = 0; lens < 2; lens++)
+		stats.queued[lens] = mQueues[lens].size();
+	return stats;
+}
+
+void FramePairer::onVideoFrame(const FramePtr& frame)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (frame->streamIndex != 0 && frame->streamIndex != 1)
+	{
+		mStats.otherStreams++;
+		return;
+	}
+	const int lens = frame->streamIndex;
+	if (frame->timestamp < mLastTimestamp[lens])
+	{
+		// Clock restart: frames before and after it must not be paired with each other.
+		mStats.discontinuities++;
+		mQueues[0].clear();
+		mQueues[1].clear();
+		mLastTimestamp[1 - lens] = INT64_MIN;
+	}
+	mLastTimestamp[lens] = frame->timestamp;
+
+	auto& queue = mQueues[lens];
+	if (queue.size() >= mConfig.maxQueuedFrames)
+	{
+		queue.pop_front();
+		mStats.overflowed[lens]++;
+	}
+	queue.push_back({frame, NalParser::containsKeyframe(frame->data(), frame->size(), mCodec)});
+	matchLocked();
+}
+
+void FramePairer::matchLocked()
+{
+	while (!mQueues[0].empty() && !mQueues[1].empty())
+	{
+		const auto& front = mQueues[0].front();
+		const auto& rear = mQueues[1].front();
+		const int64_t skew = rear.frame->timestamp - front.frame->timestamp;
+		if (std::abs(static_cast<double>(skew)) <= mConfig.toleranceMs)
+		{
+			emitLocked(front, rear);
+			mQueues[0].pop_front();
+			mQueues[1].pop_front();
+		}
+		else
+		{
+			// The older frame is further than the tolerance from every frame the other lens can still deliver.
+			const int older = skew > 0 ? 0 : 1;
+			mQueues[older].pop_front();
+			mStats.unmatched[older]++;
+		}
+	}
+}
+
+void FramePairer::emitLocked(const QueuedFrame& front, const QueuedFrame& rear)
+{
+	FramePair pair;
+	pair.front = front.frame;
+	pair.rear = rear.frame;
+	pair.timestamp = front.frame->timestamp;
+	pair.skewMs = rear.frame->timestamp - front.frame->timestamp;
+	pair.keyframe = front.keyframe && rear.keyframe;
+
+	mStats.pairs++;
+	if (pair.keyframe)
+		mStats.keyframePairs++;
+	const int64_t absoluteSkew = std::abs(pair.skewMs);
+	mStats.lastSkewMs = pair.skewMs;
+	mStats.maxSkewMs = std::max(mStats.maxSkewMs, absoluteSkew);
+	mSkewTotalMs += static_cast<double>(absoluteSkew);
+	mStats.averageSkewMs = mSkewTotalMs / static_cast<double>(mStats.pairs);
+
+	for (const auto& sink : mSinks)
+		sink->onFramePair(pair);
+}
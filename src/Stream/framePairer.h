@@ -0,0 +1,93 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Front and rear access units of one capture instant on a dual-lens camera.
+	struct FramePair
+	{
+		FramePtr front;	 // stream index 0
+		FramePtr rear;	 // stream index 1
+		int64_t timestamp;
+		int64_t skewMs;	  // rear minus front timestamp
+		bool keyframe;	  // both frames are keyframes: a decoding entry point for both lenses
+	};
+
+	// Consumer of paired frames (stitcher, side-by-side muxer). Called on the delegate consumer thread.
+	class FramePairSink
+	{
+	public:
+		virtual ~FramePairSink() = default;
+
+		virtual void onFramePair(const FramePair& pair) = 0;
+	};
+
+	// Joins the two lens streams of a dual-stream camera into frame pairs. Subscribe it to the GopCache so both
+	// streams start on a keyframe. Each stream waits in its own bounded queue. The oldest frames of the two queues
+	// are compared: within `toleranceMs` they are paired, otherwise the older one can no longer match anything
+	// (timestamps only grow) and is dropped as unmatched.
+	class FramePairer : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			double toleranceMs = 15.0;	// half a frame interval at 30 fps
+			size_t maxQueuedFrames = 90;  // per lens; the oldest frame is dropped beyond this
+		};
+
+		struct Stats
+		{
+			uint64_t pairs = 0;
+			uint64_t keyframePairs = 0;
+			uint64_t unmatched[2] = {};	 // per lens: no partner within the tolerance
+			uint64_t overflowed[2] = {};  // per lens: dropped because the other lens fell behind
+			uint64_t discontinuities = 0; // queues flushed because a timestamp went backwards
+			uint64_t otherStreams = 0;	  // frames of stream indexes other than 0 and 1, ignored
+			size_t queued[2] = {};
+			int64_t lastSkewMs = 0;
+			double averageSkewMs = 0.0;	 // of the absolute skew
+			int64_t maxSkewMs = 0;
+		};
+
+		explicit FramePairer(Config config);
+
+		// Drops queued frames from the previous session; frames are parsed as `codec` from now on.
+		void start(ins_camera::VideoEncodeType codec);
+
+		void subscribe(std::shared_ptr<FramePairSink> sink);
+		void unsubscribe(const std::shared_ptr<FramePairSink>& sink);
+
+		void onVideoFrame(const FramePtr& frame) override;
+
+		Stats getStats() const;
+
+	private:
+		struct QueuedFrame
+		{
+			FramePtr frame;
+			bool keyframe;
+		};
+
+		void matchLocked();
+		void emitLocked(const QueuedFrame& front, const QueuedFrame& rear);
+
+		Config mConfig;
+		mutable std::mutex mMutex;
+		ins_camera::VideoEncodeType mCodec = ins_camera::VideoEncodeType::H264;
+		std::deque<QueuedFrame> mQueues[2];
+		int64_t mLastTimestamp[2] = {INT64_MIN, INT64_MIN};
+		std::vector<std::shared_ptr<FramePairSink>> mSinks;
+		Stats mStats;
+		double mSkewTotalMs = 0.0;
+	};
+}
@@ -0,0 +1,106 @@
+#include "framePool.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace Letico;
+
+namespace
+{
+	constexpr size_t SMALLEST_CLASS_BYTES = 2 * 1024;
+	constexpr size_t LARGEST_CLASS_BYTES = 4 * 1024 * 1024;
+
+	std::shared_ptr<EncodedFrame> makeFrame(size_t capacity)
+	{
+		auto frame = std::make_shared<EncodedFrame>();
+		frame->payload.reserve(capacity);
+		return frame;
+	}
+}
+
+std::vector<size_t> FramePool::defaultClasses()
+{
+	std::vector<size_t> classes;
+	for (size_t bytes = SMALLEST_CLASS_BYTES; bytes <= LARGEST_CLASS_BYTES; bytes *= 2)
+		classes.push_back(bytes);
+	return classes;
+}
+
+FramePool::FramePool(Config config): mMaxBytes(config.maxBytes)
+{
+	auto classes = config.classBytes.empty() ? defaultClasses() : config.classBytes;
+	std::sort(classes.begin(), classes.end());
+	classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+	classes.erase(std::remove(classes.begin(), classes.end(), 0), classes.end());
+	mSlabs.resize(classes.size());
+	for (size_t i = 0; i < classes.size(); i++)
+		mSlabs[i].frameBytes = classes[i];
+}
+
+std::shared_ptr<EncodedFrame> FramePool::acquire(size_t size)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& slab : mSlabs)
+	{
+		if (size <= slab.frameBytes)
+			return acquireLocked(slab);
+	}
+	mOversize++;
+	return makeFrame(size);
+}
+
+std::shared_ptr<EncodedFrame> FramePool::acquireLocked(Slab& slab)
+{
+	const size_t count = slab.frames.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		auto& frame = slab.frames[(slab.next + i) % count];
+		// Only this thread hands out references, so a count of one cannot go up behind our back. The fence pairs
+		// with the release decrement of the last consumer: its reads of the frame happen before we overwrite it.
+		if (frame.use_count() != 1)
+			continue;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		slab.next = (slab.next + i + 1) % count;
+		slab.acquired++;
+		frame->payload.clear();
+		return frame;
+	}
+
+	if (mReservedBytes + slab.frameBytes > mMaxBytes)
+	{
+		mExhausted++;
+		return makeFrame(slab.frameBytes);
+	}
+	mReservedBytes += slab.frameBytes;
+	slab.frames.push_back(makeFrame(slab.frameBytes));
+	slab.acquired++;
+	return slab.frames.back();
+}
+
+FramePool::Stats FramePool::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats;
+	stats.reservedBytes = mReservedBytes;
+	stats.maxBytes = mMaxBytes;
+	stats.exhausted = mExhausted;
+	stats.oversize = mOversize;
+	stats.acquired = mExhausted + mOversize;
+	for (const auto& slab : mSlabs)
+	{
+		ClassStats entry;
+		entry.frameBytes = slab.frameBytes;
+		entry.frames = slab.frames.size();
+		entry.acquired = slab.acquired;
+		for (const auto& frame : slab.frames)
+		{
+			if (frame.use_count() != 1)
+				entry.inUse++;
+		}
+		stats.inUse += entry.inUse;
+		stats.inUseBytes += entry.inUse * entry.frameBytes;
+		stats.acquired += entry.acquired;
+		stats.classes.push_back(entry);
+	}
+	return stats;
+}
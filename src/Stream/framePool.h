@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Size-class slab pool of recyclable frames, shared by video and audio. Each class holds frames whose payload
+	// has the class size reserved once; acquire() hands out a free frame of the smallest class the payload fits in,
+	// so sizes from small P-frames to IDRs stop going through malloc/free at frame rate. A class grows on demand and
+	// never shrinks: a frame is only added when every frame of the class is in use, so its frame count is the
+	// high-water mark of frames in flight. Growth stops at `maxBytes` reserved over all classes; past that, and for
+	// payloads larger than the largest class, frames are allocated outside the pool.
+	//
+	// The reference count that recycles a frame is the one every consumer already holds. The pool keeps one
+	// reference to each frame, allocated in one block with it, and a frame only the pool references is free; no
+	// custom deleter and no allocation per frame. acquire() is called from the delegate consumer thread only,
+	// releases may happen on any thread.
+	class FramePool
+	{
+	public:
+		struct Config
+		{
+			std::vector<size_t> classBytes;	 // ascending; defaultClasses() when empty
+			size_t maxBytes = 256 * 1024 * 1024;
+		};
+
+		struct ClassStats
+		{
+			size_t frameBytes = 0;
+			size_t frames = 0;	// allocated so far, the high-water mark of frames in use
+			size_t inUse = 0;
+			uint64_t acquired = 0;
+		};
+
+		struct Stats
+		{
+			std::vector<ClassStats> classes;
+			size_t reservedBytes = 0;
+			size_t maxBytes = 0;
+			size_t inUse = 0;
+			size_t inUseBytes = 0;	// reserved by the frames in use
+			uint64_t acquired = 0;
+			uint64_t exhausted = 0;	 // allocated outside the pool because `maxBytes` was reached
+			uint64_t oversize = 0;	 // larger than the largest class
+		};
+
+		// Powers of two from 2 KB (audio frames) to 4 MB (IDRs at the highest bitrates).
+		static std::vector<size_t> defaultClasses();
+
+		explicit FramePool(Config config);
+
+		// A frame no consumer references, with empty payload and at least `size` bytes of payload capacity.
+		std::shared_ptr<EncodedFrame> acquire(size_t size);
+
+		Stats getStats() const;
+
+	private:
+		struct Slab
+		{
+			size_t frameBytes = 0;
+			std::vector<std::shared_ptr<EncodedFrame>> frames;
+			size_t next = 0;  // where the search for a free frame resumes; frames come back roughly in order
+			uint64_t acquired = 0;
+		};
+
+		std::shared_ptr<EncodedFrame> acquireLocked(Slab& slab);
+
+		mutable std::mutex mMutex;
+		std::vector<Slab> mSlabs;
+		size_t mMaxBytes;
+		size_t mReservedBytes = 0;
+		uint64_t mExhausted = 0;
+		uint64_t mOversize = 0;
+	};
+}
@@ -0,0 +1,99 @@
+#include "frameQueue.h"
+
+#include <utility>
+
+using namespace Letico;
+
+FrameQueue::FrameQueue(Config config, int streamIndex, ins_camera::VideoEncodeType codec):
+	mConfig(config),
+	mStreamIndex(streamIndex),
+	mCodec(codec)
+{
+}
+
+void FrameQueue::onVideoFrame(const FramePtr& frame)
+{
+	if (frame->streamIndex != mStreamIndex)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mClosed)
+			return;
+
+		if (mWaitingForKeyframe)
+		{
+			if (!startsDecoding(frame))
+			{
+				mStats.droppedFrames++;
+				return;
+			}
+			mWaitingForKeyframe = false;
+		}
+
+		if (mFrames.size() + 1 > mConfig.maxFrames || mBytes + frame->size() > mConfig.maxBytes)
+		{
+			// Dropping single frames would leave the decoder with broken references, so drop the backlog and
+			// restart the client at the next keyframe (which may be this one).
+			mStats.droppedFrames += mFrames.size();
+			mStats.dropEvents++;
+			mFrames.clear();
+			mBytes = 0;
+			if (!startsDecoding(frame))
+			{
+				mWaitingForKeyframe = true;
+				mStats.droppedFrames++;
+				return;
+			}
+		}
+
+		mFrames.push_back(frame);
+		mBytes += frame->size();
+	}
+	mReady.notify_one();
+}
+
+bool FrameQueue::popAll(std::vector<FramePtr>& out, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mReady.wait_for(lock, timeout, [this] { return !mFrames.empty() || mClosed; });
+	if (mFrames.empty())
+		return !mClosed;
+
+	mStats.deliveredFrames += mFrames.size();
+	out.insert(out.end(), std::make_move_iterator(mFrames.begin()), std::make_move_iterator(mFrames.end()));
+	mFrames.clear();
+	mBytes = 0;
+	return true;
+}
+
+void FrameQueue::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mClosed = true;
+	}
+	mReady.notify_all();
+}
+
+FrameQueue::Stats FrameQueue::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats = mStats;
+	stats.queuedFrames = mFrames.size();
+	stats.queuedBytes = mBytes;
+	return stats;
+}
+
+bool FrameQueue::startsDecoding(const FramePtr& frame)
+{
+	// Parameter sets sent on their own right before the IDR are kept so the keyframe after them decodes.
+	mNals.clear();
+	NalParser::split(frame->data(), frame->size(), mCodec, mNals);
+	for (const auto& nal : mNals)
+	{
+		if (NalParser::isKeyframe(mCodec, nal.type) || NalParser::isParameterSet(mCodec, nal.type))
+			return true;
+	}
+	return false;
+}
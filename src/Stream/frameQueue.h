@@ -0,0 +1,69 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "nalParser.h"
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Bounded per-client queue of shared video frames for one stream index. The producer side is a StreamSink fed
+	// by the GOP cache; a network thread pops frames and writes them out. Queued entries are references to the
+	// frames every other client also holds, so a queue costs pointers, not payload copies.
+	//
+	// A client that falls behind does not grow memory or slow anyone else down: once the queue is over its limit
+	// everything queued is dropped and the client resumes at the next keyframe.
+	class FrameQueue : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			size_t maxFrames = 120;
+			size_t maxBytes = 16 * 1024 * 1024;
+		};
+
+		struct Stats
+		{
+			uint64_t deliveredFrames = 0;
+			uint64_t droppedFrames = 0;
+			uint64_t dropEvents = 0;  // times the client was resynchronised to a keyframe
+			size_t queuedFrames = 0;
+			size_t queuedBytes = 0;
+		};
+
+		FrameQueue(Config config, int streamIndex, ins_camera::VideoEncodeType codec);
+
+		void onVideoFrame(const FramePtr& frame) override;
+
+		// Moves every queued frame into `out`, waiting up to `timeout` for the first one. Returns false once the
+		// queue is closed and empty.
+		bool popAll(std::vector<FramePtr>& out, std::chrono::milliseconds timeout);
+		void close();
+
+		Stats getStats() const;
+
+	private:
+		bool startsDecoding(const FramePtr& frame);
+
+		Config mConfig;
+		int mStreamIndex;
+		ins_camera::VideoEncodeType mCodec;
+
+		mutable std::mutex mMutex;
+		std::condition_variable mReady;
+		std::deque<FramePtr> mFrames;
+		size_t mBytes = 0;
+		bool mWaitingForKeyframe = false;
+		bool mClosed = false;
+		std::vector<NalUnit> mNals;	 // scratch for keyframe detection while resynchronising
+		Stats mStats;
+	};
+}
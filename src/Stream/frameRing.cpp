@@ -0,0 +1,136 @@
+#include "frameRing.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace Letico;
+
+static_assert(sizeof(FrameRing::RecordHeader) == 32, "record header must stay one alignment unit");
+
+FrameRing::FrameRing(size_t capacityBytes):
+	mCapacity(std::bit_ceil(std::max<size_t>(capacityBytes, 4 * sizeof(RecordHeader)))),
+	mMask(mCapacity - 1),
+	mBuffer(new uint8_t[mCapacity])
+{
+	// Touch every page up front so the first frames do not pay for page faults on the callback thread.
+	std::memset(mBuffer.get(), 0, mCapacity);
+}
+
+bool FrameRing::push(
+	RecordKind kind, const uint8_t* data, size_t size, int64_t timestamp, int64_t arrivalNs, uint8_t streamType, int streamIndex
+)
+{
+	if (size > maxRecordSize())
+	{
+		drop(size, false);
+		return false;
+	}
+
+	const uint64_t head = mHead.load(std::memory_order_relaxed);
+	const size_t recordBytes = alignUp(sizeof(RecordHeader) + size);
+	const size_t untilEnd = mCapacity - (head & mMask);
+	// A record never wraps; if it does not fit before the end of the buffer the remainder becomes padding.
+	const size_t paddingBytes = recordBytes > untilEnd ? untilEnd : 0;
+	const size_t needed = paddingBytes + recordBytes;
+
+	if (head + needed - mCachedTail > mCapacity)
+	{
+		mCachedTail = mTail.load(std::memory_order_acquire);
+		if (head + needed - mCachedTail > mCapacity)
+		{
+			drop(size, true);
+			return false;
+		}
+	}
+
+	uint64_t position = head;
+	if (paddingBytes != 0)
+	{
+		RecordHeader* padding = headerAt(position);
+		padding->size = static_cast<uint32_t>(paddingBytes - sizeof(RecordHeader));
+		padding->kind = RecordKind::Padding;
+		position += paddingBytes;
+	}
+
+	RecordHeader* header = headerAt(position);
+	header->size = static_cast<uint32_t>(size);
+	header->kind = kind;
+	header->streamType = streamType;
+	header->streamIndex = static_cast<int16_t>(streamIndex);
+	header->timestamp = timestamp;
+	header->arrivalNs = arrivalNs;
+	if (size != 0)
+	{
+		std::memcpy(header + 1, data, size);
+	}
+
+	const uint64_t newHead = position + recordBytes;
+	mHead.store(newHead, std::memory_order_release);
+
+	mPushedRecords.store(mPushedRecords.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	mPushedBytes.store(mPushedBytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+	const size_t used = newHead - mTail.load(std::memory_order_relaxed);
+	if (used > mHighWater.load(std::memory_order_relaxed))
+	{
+		mHighWater.store(used, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+const FrameRing::RecordHeader* FrameRing::peek()
+{
+	const uint64_t tail = mTail.load(std::memory_order_relaxed);
+	if (tail == mCachedHead)
+	{
+		mCachedHead = mHead.load(std::memory_order_acquire);
+		if (tail == mCachedHead)
+		{
+			return nullptr;
+		}
+	}
+
+	const RecordHeader* header = headerAt(tail);
+	if (header->kind == RecordKind::Padding)
+	{
+		// Padding is always followed by a real record at the start of the buffer.
+		const uint64_t next = tail + sizeof(RecordHeader) + header->size;
+		mTail.store(next, std::memory_order_release);
+		return headerAt(next);
+	}
+	return header;
+}
+
+void FrameRing::pop()
+{
+	const uint64_t tail = mTail.load(std::memory_order_relaxed);
+	const RecordHeader* header = headerAt(tail);
+	mTail.store(tail + alignUp(sizeof(RecordHeader) + header->size), std::memory_order_release);
+}
+
+bool FrameRing::empty() const
+{
+	return mTail.load(std::memory_order_acquire) == mHead.load(std::memory_order_acquire);
+}
+
+FrameRing::Stats FrameRing::getStats() const
+{
+	return {
+		mPushedRecords.load(std::memory_order_relaxed),
+		mPushedBytes.load(std::memory_order_relaxed),
+		mDroppedRecords.load(std::memory_order_relaxed),
+		mDroppedBytes.load(std::memory_order_relaxed),
+		mOverflows.load(std::memory_order_relaxed),
+		mOversized.load(std::memory_order_relaxed),
+		mHighWater.load(std::memory_order_relaxed),
+		mCapacity};
+}
+
+void FrameRing::drop(size_t size, bool overflow)
+{
+	// Counters have a single writer, so plain load/store keeps the producer free of locked instructions.
+	mDroppedRecords.store(mDroppedRecords.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	mDroppedBytes.store(mDroppedBytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+	auto& counter = overflow ? mOverflows : mOversized;
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
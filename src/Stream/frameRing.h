@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Letico
+{
+	// Lock-free single-producer/single-consumer ring of variable sized records. The producer copies the payload
+	// into preallocated storage and publishes it with one release store, the consumer reads records in place and
+	// releases them in order. Nothing allocates after construction.
+	class FrameRing
+	{
+	public:
+		enum class RecordKind : uint8_t
+		{
+			Padding,
+			Video,
+			Audio,
+			Gyro,
+			Exposure
+		};
+
+		struct RecordHeader
+		{
+			uint32_t size;	// payload bytes following the header
+			RecordKind kind;
+			uint8_t streamType;
+			int16_t streamIndex;
+			int64_t timestamp;
+			int64_t arrivalNs;	// steady clock when the producer was called
+			uint64_t reserved;	// keeps the header one alignment unit
+
+			const uint8_t* payload() const { return reinterpret_cast<const uint8_t*>(this + 1); }
+		};
+
+		struct Stats
+		{
+			uint64_t pushedRecords;
+			uint64_t pushedBytes;
+			uint64_t droppedRecords;
+			uint64_t droppedBytes;
+			uint64_t overflows;	 // push rejected because the ring was full
+			uint64_t oversized;	 // push rejected because the record can never fit
+			size_t highWaterBytes;
+			size_t capacityBytes;
+		};
+
+		// Capacity is rounded up to a power of two.
+		explicit FrameRing(size_t capacityBytes);
+		FrameRing(const FrameRing&) = delete;
+		FrameRing& operator=(const FrameRing&) = delete;
+
+		// Arrival stamp for push(): the steady clock in nanoseconds.
+		static int64_t nowNs()
+		{
+			const auto now = std::chrono::steady_clock::now().time_since_epoch();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+		}
+
+		// Producer side.
+		bool push(
+			RecordKind kind, const uint8_t* data, size_t size, int64_t timestamp, int64_t arrivalNs, uint8_t streamType = 0,
+			int streamIndex = 0
+		);
+
+		// Consumer side: peek() returns the oldest record or nullptr, pop() releases it.
+		const RecordHeader* peek();
+		void pop();
+
+		bool empty() const;
+		size_t capacity() const { return mCapacity; }
+		size_t maxRecordSize() const { return mCapacity / 2 - sizeof(RecordHeader); }
+		Stats getStats() const;
+
+	private:
+		static constexpr size_t CACHE_LINE = 64;
+		// Records are aligned to the header size so the tail of the buffer can always hold a padding header.
+		static constexpr size_t ALIGNMENT = 32;
+
+		static size_t alignUp(size_t value) { return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+		RecordHeader* headerAt(uint64_t position) const
+		{
+			return reinterpret_cast<RecordHeader*>(mBuffer.get() + (position & mMask));
+		}
+		void drop(size_t size, bool overflow);
+
+		size_t mCapacity;
+		size_t mMask;
+		std::unique_ptr<uint8_t[]> mBuffer;
+
+		// Producer owned line.
+		alignas(CACHE_LINE) std::atomic<uint64_t> mHead{0};
+		uint64_t mCachedTail = 0;
+		std::atomic<uint64_t> mPushedRecords{0};
+		std::atomic<uint64_t> mPushedBytes{0};
+		std::atomic<uint64_t> mDroppedRecords{0};
+		std::atomic<uint64_t> mDroppedBytes{0};
+		std::atomic<uint64_t> mOverflows{0};
+		std::atomic<uint64_t> mOversized{0};
+		std::atomic<size_t> mHighWater{0};
+
+		// Consumer owned line.
+		alignas(CACHE_LINE) std::atomic<uint64_t> mTail{0};
+		uint64_t mCachedHead = 0;
+	};
+}
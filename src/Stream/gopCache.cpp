@@ -0,0 +1,232 @@
+#include "gopCache.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace Letico;
+
+namespace
+{
+	const uint8_t START_CODE[] = {0x00, 0x00, 0x00, 0x01};
+
+	double millisecondsSince(std::chrono::steady_clock::time_point since)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+	}
+}
+
+GopCache::GopCache(Config config): mConfig(config)
+{
+}
+
+void GopCache::start(ins_camera::VideoEncodeType codec)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCodec = codec;
+	mStreams.clear();
+	// Subscribers that outlive a session wait for the new session's first keyframe again.
+	for (auto& subscriber : mSubscribers)
+	{
+		subscriber.startedStreams = 0;
+	}
+}
+
+void GopCache::stop()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStreams.clear();
+}
+
+void GopCache::subscribe(std::shared_ptr<StreamSink> sink)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Subscriber subscriber{std::move(sink), std::chrono::steady_clock::now()};
+	mStats.subscriptions++;
+
+	for (const auto& [streamIndex, stream] : mStreams)
+	{
+		if (stream.gop.empty() || stream.overflowed)
+			continue;
+		for (const auto& frame : stream.gop)
+		{
+			subscriber.sink->onVideoFrame(frame);
+		}
+		subscriber.startedStreams |= streamBit(streamIndex);
+	}
+
+	if (subscriber.startedStreams != 0)
+	{
+		mStats.servedFromCache++;
+		recordFirstFrame(subscriber);
+	}
+	else
+	{
+		mStats.waitedForKeyframe++;
+	}
+	mSubscribers.push_back(std::move(subscriber));
+}
+
+void GopCache::unsubscribe(const std::shared_ptr<StreamSink>& sink)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSubscribers.erase(
+		std::remove_if(mSubscribers.begin(), mSubscribers.end(), [&](const Subscriber& s) { return s.sink == sink; }),
+		mSubscribers.end()
+	);
+}
+
+void GopCache::onVideoFrame(const FramePtr& frame)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mNals.clear();
+	NalParser::split(frame->data(), frame->size(), mCodec, mNals);
+	bool keyframe = false;
+	bool hasParameterSets = false;
+	bool hasSlices = false;
+	for (const auto& nal : mNals)
+	{
+		keyframe |= NalParser::isKeyframe(mCodec, nal.type);
+		hasParameterSets |= NalParser::isParameterSet(mCodec, nal.type);
+		hasSlices |= NalParser::isSlice(mCodec, nal.type);
+	}
+
+	CachedStream& stream = mStreams[frame->streamIndex];
+	if (hasParameterSets)
+	{
+		updateParameterSets(stream, frame);
+	}
+	// Parameter sets sent on their own are held for the next keyframe. Passed on alone they would land at the end
+	// of whatever segment or file a subscriber has open, and the next one would start without them.
+	if (!hasSlices)
+		return;
+
+	// Every keyframe carries the parameter sets, so every segment and file cut at one decodes on its own.
+	FramePtr head;
+	if (keyframe)
+	{
+		head = hasParameterSets ? frame : withParameterSets(stream, frame);
+		stream.gop.clear();
+		stream.gop.push_back(head);
+		stream.bytes = head->size();
+		stream.overflowed = false;
+		mStats.gopsCached++;
+	}
+	else if (!stream.gop.empty() && !stream.overflowed)
+	{
+		stream.gop.push_back(frame);
+		stream.bytes += frame->size();
+		if (stream.bytes > mConfig.maxBytes || stream.gop.size() > mConfig.maxFrames)
+		{
+			stream.gop.clear();
+			stream.gop.shrink_to_fit();
+			stream.bytes = 0;
+			stream.overflowed = true;
+			mStats.gopsOverflowed++;
+		}
+	}
+
+	const uint64_t bit = streamBit(frame->streamIndex);
+	for (auto& subscriber : mSubscribers)
+	{
+		if (subscriber.startedStreams & bit)
+		{
+			subscriber.sink->onVideoFrame(keyframe ? head : frame);
+		}
+		else if (keyframe)
+		{
+			subscriber.startedStreams |= bit;
+			subscriber.sink->onVideoFrame(head);
+			recordFirstFrame(subscriber);
+		}
+	}
+}
+
+void GopCache::onAudioFrame(const FramePtr& frame)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (const auto& subscriber : mSubscribers)
+	{
+		subscriber.sink->onAudioFrame(frame);
+	}
+}
+
+GopCache::Stats GopCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats = mStats;
+	stats.subscribers = mSubscribers.size();
+	for (const auto& [streamIndex, stream] : mStreams)
+	{
+		stats.cachedFrames += stream.gop.size();
+		stats.cachedBytes += stream.bytes;
+	}
+	return stats;
+}
+
+ins_camera::VideoEncodeType GopCache::codec() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCodec;
+}
+
+FramePtr GopCache::parameterSets(int streamIndex) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto it = mStreams.find(streamIndex);
+	return it == mStreams.end() ? nullptr : it->second.parameterSets;
+}
+
+void GopCache::updateParameterSets(CachedStream& stream, const FramePtr& frame)
+{
+	std::vector<uint8_t> payload;
+	for (const auto& nal : mNals)
+	{
+		if (!NalParser::isParameterSet(mCodec, nal.type))
+			continue;
+		payload.insert(payload.end(), std::begin(START_CODE), std::end(START_CODE));
+		payload.insert(payload.end(), nal.data, nal.data + nal.size);
+	}
+	if (stream.parameterSets && stream.parameterSets->payload == payload)
+		return;
+
+	auto parameterSets = std::make_shared<EncodedFrame>();
+	parameterSets->kind = FrameKind::Video;
+	parameterSets->timestamp = frame->timestamp;
+	parameterSets->streamType = frame->streamType;
+	parameterSets->streamIndex = frame->streamIndex;
+	parameterSets->payload = std::move(payload);
+	stream.parameterSets = std::move(parameterSets);
+}
+
+FramePtr GopCache::withParameterSets(const CachedStream& stream, const FramePtr& keyframe) const
+{
+	if (!stream.parameterSets)
+		return keyframe;
+
+	// One copy per GOP, and only for encoders that do not repeat the parameter sets in front of every IDR.
+	auto combined = std::make_shared<EncodedFrame>(*keyframe);
+	const auto& prefix = stream.parameterSets->payload;
+	combined->payload.insert(combined->payload.begin(), prefix.begin(), prefix.end());
+	return combined;
+}
+
+void GopCache::recordFirstFrame(Subscriber& subscriber)
+{
+	if (subscriber.firstFrameSeen)
+		return;
+	subscriber.firstFrameSeen = true;
+
+	const double ttff = millisecondsSince(subscriber.subscribed);
+	mTtffTotalMs += ttff;
+	mTtffCount++;
+	mStats.lastTtffMs = ttff;
+	mStats.averageTtffMs = mTtffTotalMs / mTtffCount;
+	mStats.maxTtffMs = std::max(mStats.maxTtffMs, ttff);
+}
+
+uint64_t GopCache::streamBit(int streamIndex)
+{
+	// Cameras have at most a couple of streams; anything out of range shares the top bit.
+	return uint64_t(1) << std::clamp(streamIndex, 0, 63);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "nalParser.h"
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Keeps the most recent GOP of every stream index as a chain of shared frames, so a consumer that subscribes
+	// mid-stream starts decoding at once instead of waiting for the next IDR. Installed as a delegate sink; the
+	// consumers (HLS segmenter, raw and RTSP clients) subscribe here instead of on the delegate.
+	//
+	// A subscriber first receives the cached GOP of each stream, then live frames. Until a stream has produced a
+	// keyframe the subscriber gets nothing from it, so every subscriber's first video frame is decodable. Every
+	// keyframe goes out with the stream's latest parameter sets in front; frames that carry nothing but parameter
+	// sets are never passed on by themselves.
+	class GopCache : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			// Per stream index; a GOP that grows past either limit is dropped and not served until the next keyframe.
+			size_t maxBytes = 64 * 1024 * 1024;
+			size_t maxFrames = 600;
+		};
+
+		struct Stats
+		{
+			uint64_t subscriptions = 0;
+			uint64_t servedFromCache = 0;	// subscribers that got a cached keyframe immediately
+			uint64_t waitedForKeyframe = 0; // subscribers that had to wait for a live keyframe
+			uint64_t gopsCached = 0;
+			uint64_t gopsOverflowed = 0;
+			size_t subscribers = 0;
+			size_t cachedFrames = 0;
+			size_t cachedBytes = 0;
+			// Time to first frame: from subscribe() to the first keyframe handed to the subscriber.
+			double lastTtffMs = 0.0;
+			double averageTtffMs = 0.0;
+			double maxTtffMs = 0.0;
+		};
+
+		explicit GopCache(Config config);
+
+		// Drops whatever is cached from the previous session; frames are parsed as `codec` from now on.
+		void start(ins_camera::VideoEncodeType codec);
+		void stop();
+
+		// Replays the cached GOPs on the calling thread, under the cache lock, before returning; live frames then
+		// follow on the delegate consumer thread, so the subscriber sees one gap-free, ordered sequence.
+		void subscribe(std::shared_ptr<StreamSink> sink);
+		void unsubscribe(const std::shared_ptr<StreamSink>& sink);
+
+		void onVideoFrame(const FramePtr& frame) override;
+		void onAudioFrame(const FramePtr& frame) override;
+
+		Stats getStats() const;
+		ins_camera::VideoEncodeType codec() const;
+		// Latest VPS/SPS/PPS seen on `streamIndex` as an Annex-B frame, or null before the first one.
+		FramePtr parameterSets(int streamIndex) const;
+
+	private:
+		struct CachedStream
+		{
+			std::vector<FramePtr> gop;	// gop[0] is the keyframe, with parameter sets in front
+			size_t bytes = 0;
+			bool overflowed = false;
+			FramePtr parameterSets;	 // latest VPS/SPS/PPS, Annex-B
+		};
+
+		struct Subscriber
+		{
+			std::shared_ptr<StreamSink> sink;
+			std::chrono::steady_clock::time_point subscribed;
+			uint64_t startedStreams = 0;  // bit per stream index that has delivered its keyframe
+			bool firstFrameSeen = false;
+		};
+
+		void updateParameterSets(CachedStream& stream, const FramePtr& frame);
+		FramePtr withParameterSets(const CachedStream& stream, const FramePtr& keyframe) const;
+		void recordFirstFrame(Subscriber& subscriber);
+		static uint64_t streamBit(int streamIndex);
+
+		Config mConfig;
+		mutable std::mutex mMutex;
+		ins_camera::VideoEncodeType mCodec = ins_camera::VideoEncodeType::H264;
+		std::map<int, CachedStream> mStreams;
+		std::vector<Subscriber> mSubscribers;
+		std::vector<NalUnit> mNals;	 // scratch, reused for every frame
+		Stats mStats;
+		double mTtffTotalMs = 0.0;
+		uint64_t mTtffCount = 0;
+	};
+}
@@ -0,0 +1,319 @@
+#include "gyroArchive.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+#include "../utils.hpp"
+#include "tsMuxer.h"
+
+using namespace Letico;
+
+namespace
+{
+	constexpr size_t MAX_VARINT_BYTES = 10;
+	// 7 values per sample, each at most a 10-byte varint.
+	constexpr size_t MAX_SAMPLE_BYTES = 7 * MAX_VARINT_BYTES;
+	constexpr uint32_t MAX_CHUNK_BYTES = 64 * 1024 * 1024;
+
+	void putVarint(std::vector<uint8_t>& out, int64_t value)
+	{
+		uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+		while (zigzag >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(zigzag | 0x80));
+			zigzag >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(zigzag));
+	}
+
+	// Returns false on a varint running past `end` or longer than 10 bytes.
+	bool getVarint(const uint8_t*& in, const uint8_t* end, int64_t& value)
+	{
+		uint64_t zigzag = 0;
+		for (int shift = 0; shift < 70 && in < end; shift += 7)
+		{
+			const uint8_t byte = *in++;
+			zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+			{
+				value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int32_t quantize(double value, double step)
+	{
+		const double q = std::nearbyint(value / step);
+		constexpr double LOW = std::numeric_limits<int32_t>::min();
+		constexpr double HIGH = std::numeric_limits<int32_t>::max();
+		return static_cast<int32_t>(std::clamp(q, LOW, HIGH));
+	}
+}
+
+GyroArchiveWriter::GyroArchiveWriter(Config config): mConfig(config)
+{
+	mConfig.chunkSamples = std::max<uint32_t>(mConfig.chunkSamples, 1);
+	mPayload.reserve(static_cast<size_t>(mConfig.chunkSamples) * MAX_SAMPLE_BYTES);
+}
+
+GyroArchiveWriter::~GyroArchiveWriter()
+{
+	stop();
+}
+
+void GyroArchiveWriter::start()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mActive)
+		return;
+	mActive = true;
+	mFiles.clear();
+	mStats = Stats();
+	mStats.active = true;
+}
+
+std::vector<std::string> GyroArchiveWriter::stop()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		return {};
+	closeFileLocked();
+	mActive = false;
+	mStats.active = false;
+	return mFiles;
+}
+
+GyroArchiveWriter::Stats GyroArchiveWriter::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+bool GyroArchiveWriter::openFileLocked(int64_t timestamp)
+{
+	const std::string stamp = Utils::fileTimestamp();
+	const std::string name = mConfig.filePrefix + "_" + stamp + "_" + std::to_string(mFiles.size()) + ".lgyr";
+	const std::string path = (std::filesystem::path(mConfig.directory) / name).string();
+	mFile = std::fopen(path.c_str(), "wb");
+	if (!mFile)
+	{
+		mStats.writeErrors++;
+		return false;
+	}
+
+	GyroArchiveHeader header{};
+	std::memcpy(header.magic, GyroArchiveHeader::MAGIC, sizeof(header.magic));
+	header.version = GyroArchiveHeader::VERSION;
+	header.headerSize = sizeof(header);
+	header.accelStep = mConfig.accelStep;
+	header.gyroStep = mConfig.gyroStep;
+	if (std::fwrite(&header, sizeof(header), 1, mFile) != 1)
+		mStats.writeErrors++;
+	mStats.bytes += sizeof(header);
+	mStats.files++;
+	mFiles.push_back(path);
+	mFileStart = timestamp;
+	return true;
+}
+
+void GyroArchiveWriter::closeFileLocked()
+{
+	flushChunkLocked();
+	if (mFile)
+	{
+		std::fclose(mFile);
+		mFile = nullptr;
+	}
+}
+
+void GyroArchiveWriter::onGyroData(const ins_camera::GyroData* samples, size_t count)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		return;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const auto& sample = samples[i];
+		// A clock restart starts a new file, so chunks stay in time order for the reader's binary search.
+		const bool restarted = mFile && sample.timestamp < mLastTimestamp;
+		const bool roll = mFile && sample.timestamp - mFileStart >= static_cast<int64_t>(mConfig.rollSeconds * TIMESTAMP_HZ);
+		if (restarted || roll || mChunk.sampleCount >= mConfig.chunkSamples)
+			flushChunkLocked();
+		if (restarted || roll)
+			closeFileLocked();
+		if (!mFile && !openFileLocked(sample.timestamp))
+			return;
+
+		const int32_t values[6] = {
+			quantize(sample.ax, mConfig.accelStep),
+			quantize(sample.ay, mConfig.accelStep),
+			quantize(sample.az, mConfig.accelStep),
+			quantize(sample.gx, mConfig.gyroStep),
+			quantize(sample.gy, mConfig.gyroStep),
+			quantize(sample.gz, mConfig.gyroStep)};
+		if (mChunk.sampleCount == 0)
+		{
+			mChunk.firstTimestamp = sample.timestamp;
+			mPreviousTimestamp = 0;
+			mPreviousDelta = 0;
+			std::fill(std::begin(mPrevious), std::end(mPrevious), 0);
+			std::copy(std::begin(values), std::end(values), mChunk.min);
+			std::copy(std::begin(values), std::end(values), mChunk.max);
+		}
+
+		const int64_t delta = sample.timestamp - mPreviousTimestamp;
+		putVarint(mPayload, delta - mPreviousDelta);
+		mPreviousDelta = delta;
+		mPreviousTimestamp = sample.timestamp;
+		for (int axis = 0; axis < 6; axis++)
+		{
+			putVarint(mPayload, static_cast<int64_t>(values[axis]) - mPrevious[axis]);
+			mPrevious[axis] = values[axis];
+			mChunk.min[axis] = std::min(mChunk.min[axis], values[axis]);
+			mChunk.max[axis] = std::max(mChunk.max[axis], values[axis]);
+		}
+		mChunk.lastTimestamp = sample.timestamp;
+		mChunk.sampleCount++;
+		mLastTimestamp = sample.timestamp;
+		mStats.samples++;
+	}
+}
+
+void GyroArchiveWriter::flushChunkLocked()
+{
+	if (mChunk.sampleCount == 0)
+		return;
+	if (mFile)
+	{
+		mChunk.magic = GyroChunkHeader::MAGIC;
+		mChunk.payloadBytes = static_cast<uint32_t>(mPayload.size());
+		mChunk.crc = TsMuxer::crc32(mPayload.data(), mPayload.size());
+		const bool ok = std::fwrite(&mChunk, sizeof(mChunk), 1, mFile) == 1 &&
+						std::fwrite(mPayload.data(), mPayload.size(), 1, mFile) == 1 && std::fflush(mFile) == 0;
+		if (!ok)
+			mStats.writeErrors++;
+		mStats.bytes += sizeof(mChunk) + mPayload.size();
+		mStats.chunks++;
+	}
+	mPayload.clear();
+	mChunk = GyroChunkHeader{};
+}
+
+GyroArchiveReader::~GyroArchiveReader()
+{
+	if (mFile)
+		std::fclose(mFile);
+}
+
+bool GyroArchiveReader::open(const std::string& path)
+{
+	if (mFile)
+		std::fclose(mFile);
+	mChunks.clear();
+	mFile = std::fopen(path.c_str(), "rb");
+	if (!mFile)
+		return false;
+	if (std::fread(&mHeader, sizeof(mHeader), 1, mFile) != 1 ||
+		std::memcmp(mHeader.magic, GyroArchiveHeader::MAGIC, sizeof(mHeader.magic)) != 0 ||
+		mHeader.version != GyroArchiveHeader::VERSION || mHeader.headerSize < sizeof(mHeader))
+	{
+		std::fclose(mFile);
+		mFile = nullptr;
+		return false;
+	}
+
+	std::fseek(mFile, 0, SEEK_END);
+	const long fileSize = std::ftell(mFile);
+	long offset = mHeader.headerSize;
+	Chunk chunk{};
+	while (std::fseek(mFile, offset, SEEK_SET) == 0 && std::fread(&chunk.header, sizeof(chunk.header), 1, mFile) == 1)
+	{
+		chunk.offset = offset + static_cast<long>(sizeof(chunk.header));
+		if (chunk.header.magic != GyroChunkHeader::MAGIC || chunk.header.payloadBytes > MAX_CHUNK_BYTES ||
+			chunk.offset + static_cast<long>(chunk.header.payloadBytes) > fileSize)
+			break;
+		mChunks.push_back(chunk);
+		offset = chunk.offset + chunk.header.payloadBytes;
+	}
+	return true;
+}
+
+bool GyroArchiveReader::decodeChunk(const Chunk& chunk, std::vector<ins_camera::GyroData>& out)
+{
+	mPayload.resize(chunk.header.payloadBytes);
+	if (std::fseek(mFile, chunk.offset, SEEK_SET) != 0 ||
+		(chunk.header.payloadBytes > 0 && std::fread(mPayload.data(), mPayload.size(), 1, mFile) != 1) ||
+		TsMuxer::crc32(mPayload.data(), mPayload.size()) != chunk.header.crc)
+		return false;
+
+	const size_t start = out.size();
+	out.resize(start + chunk.header.sampleCount);
+	const uint8_t* in = mPayload.data();
+	const uint8_t* end = in + mPayload.size();
+	const double steps[6] = {
+		mHeader.accelStep, mHeader.accelStep, mHeader.accelStep, mHeader.gyroStep, mHeader.gyroStep, mHeader.gyroStep};
+	int64_t timestamp = 0;
+	int64_t delta = 0;
+	int64_t values[6] = {};
+	for (uint32_t i = 0; i < chunk.header.sampleCount; i++)
+	{
+		int64_t value;
+		if (!getVarint(in, end, value))
+		{
+			out.resize(start);
+			return false;
+		}
+		delta += value;
+		timestamp += delta;
+		auto& sample = out[start + i];
+		sample.timestamp = timestamp;
+		double* fields[6] = {&sample.ax, &sample.ay, &sample.az, &sample.gx, &sample.gy, &sample.gz};
+		for (int axis = 0; axis < 6; axis++)
+		{
+			if (!getVarint(in, end, value))
+			{
+				out.resize(start);
+				return false;
+			}
+			values[axis] += value;
+			*fields[axis] = static_cast<double>(values[axis]) * steps[axis];
+		}
+	}
+	return true;
+}
+
+bool GyroArchiveReader::read(int64_t from, int64_t to, std::vector<ins_camera::GyroData>& out)
+{
+	if (!mFile)
+		return false;
+	// Chunks are in time order within a file; find the first one that can overlap.
+	auto chunk = std::lower_bound(
+		mChunks.begin(), mChunks.end(), from, [](const Chunk& c, int64_t value) { return c.header.lastTimestamp < value; }
+	);
+	bool ok = true;
+	for (; chunk != mChunks.end() && chunk->header.firstTimestamp <= to; ++chunk)
+	{
+		const size_t start = out.size();
+		if (!decodeChunk(*chunk, out))
+		{
+			ok = false;
+			continue;
+		}
+		// Trim the edges of the first and last chunk to the range.
+		auto first = std::lower_bound(
+			out.begin() + start, out.end(), from, [](const ins_camera::GyroData& s, int64_t value) { return s.timestamp < value; }
+		);
+		out.erase(out.begin() + start, first);
+		auto last = std::upper_bound(
+			out.begin() + start, out.end(), to, [](int64_t value, const ins_camera::GyroData& s) { return value < s.timestamp; }
+		);
+		out.erase(last, out.end());
+	}
+	return ok;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Compact long-term gyro storage. A file is a GyroArchiveHeader followed by self-contained chunks, each a
+	// GyroChunkHeader and a varint payload. Values are quantized to the header's steps; per sample the payload
+	// holds the zigzag varint of the timestamp's delta-of-delta, then of each axis' delta from the previous
+	// sample (ax, ay, az, gx, gy, gz). Every chunk restarts from zero, so chunks decode independently, and the
+	// header's CRC (CRC-32/MPEG-2 over the payload) and per-axis min/max let a reader skip or verify it without
+	// decoding. A regular 1 kHz stream costs 1 byte per timestamp and typically 1-2 bytes per axis.
+	struct GyroArchiveHeader
+	{
+		static constexpr char MAGIC[8] = {'L', 'T', 'G', 'Y', 'R', 'A', '0', '1'};
+		static constexpr uint32_t VERSION = 1;
+
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		double accelStep;  // value of one quantization step, in GyroData units
+		double gyroStep;
+	};
+
+	struct GyroChunkHeader
+	{
+		static constexpr uint32_t MAGIC = 0x4b435947;  // "GYCK"
+
+		uint32_t magic;
+		uint32_t payloadBytes;
+		uint32_t sampleCount;
+		uint32_t crc;
+		int64_t firstTimestamp;
+		int64_t lastTimestamp;
+		int32_t min[6];	 // quantized, ax..gz
+		int32_t max[6];
+	};
+
+	static_assert(sizeof(GyroArchiveHeader) == 32, "gyro archive header layout is part of the file format");
+	static_assert(sizeof(GyroChunkHeader) == 80, "gyro chunk header layout is part of the file format");
+
+	// Streaming writer, installed as a delegate sink. Samples are encoded as they arrive and a chunk is written
+	// (and flushed, so a crash loses at most one chunk) every `chunkSamples`. Files roll after `rollSeconds` of
+	// gyro time.
+	class GyroArchiveWriter : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			std::string directory;
+			std::string filePrefix = "gyro";
+			uint32_t chunkSamples = 1000;
+			double rollSeconds = 3600.0;
+			double accelStep = 1e-4;
+			double gyroStep = 1e-5;
+		};
+
+		struct Stats
+		{
+			bool active = false;
+			uint64_t samples = 0;
+			uint64_t chunks = 0;
+			uint64_t bytes = 0;	 // written, headers included
+			uint64_t writeErrors = 0;
+			uint64_t files = 0;
+		};
+
+		explicit GyroArchiveWriter(Config config);
+		~GyroArchiveWriter();
+		GyroArchiveWriter(const GyroArchiveWriter&) = delete;
+		GyroArchiveWriter& operator=(const GyroArchiveWriter&) = delete;
+
+		// Samples are ignored until start(); the first file is opened by the first sample.
+		void start();
+		// Writes the open chunk and closes the file; returns every file written since start().
+		std::vector<std::string> stop();
+		Stats getStats() const;
+
+		void onGyroData(const ins_camera::GyroData* samples, size_t count) override;
+
+	private:
+		bool openFileLocked(int64_t timestamp);
+		void flushChunkLocked();
+		void closeFileLocked();
+
+		Config mConfig;
+		mutable std::mutex mMutex;
+		bool mActive = false;
+		std::FILE* mFile = nullptr;
+		int64_t mFileStart = 0;
+		int64_t mLastTimestamp = 0;
+		std::vector<std::string> mFiles;
+		Stats mStats;
+
+		// Open chunk.
+		std::vector<uint8_t> mPayload;
+		GyroChunkHeader mChunk{};
+		int64_t mPreviousTimestamp = 0;
+		int64_t mPreviousDelta = 0;
+		int32_t mPrevious[6] = {};
+	};
+
+	// Random-access reader. open() reads only the chunk headers; read() decodes just the chunks overlapping the
+	// requested range and verifies their CRC.
+	class GyroArchiveReader
+	{
+	public:
+		struct Chunk
+		{
+			GyroChunkHeader header;
+			long offset;  // of the payload
+		};
+
+		GyroArchiveReader() = default;
+		~GyroArchiveReader();
+		GyroArchiveReader(const GyroArchiveReader&) = delete;
+		GyroArchiveReader& operator=(const GyroArchiveReader&) = delete;
+
+		// Fails on a missing file or an unknown header. A truncated last chunk is left out of the index.
+		bool open(const std::string& path);
+		const std::vector<Chunk>& chunks() const { return mChunks; }
+		const GyroArchiveHeader& header() const { return mHeader; }
+
+		// Appends the samples with from <= timestamp <= to to `out`. Returns false if a chunk in the range fails its
+		// CRC or does not decode; its samples are skipped and the rest are still returned.
+		bool read(int64_t from, int64_t to, std::vector<ins_camera::GyroData>& out);
+		// Decodes one chunk, appending to `out`.
+		bool decodeChunk(const Chunk& chunk, std::vector<ins_camera::GyroData>& out);
+
+	private:
+		std::FILE* mFile = nullptr;
+		GyroArchiveHeader mHeader{};
+		std::vector<Chunk> mChunks;
+		std::vector<uint8_t> mPayload;
+	};
+}
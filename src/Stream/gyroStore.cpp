@@ -0,0 +1,189 @@
+#include "gyroStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+
+using namespace Letico;
+
+namespace
+{
+	constexpr double ins_camera::GyroData::*VALUE_FIELDS[] = {
+		&ins_camera::GyroData::ax,
+		&ins_camera::GyroData::ay,
+		&ins_camera::GyroData::az,
+		&ins_camera::GyroData::gx,
+		&ins_camera::GyroData::gy,
+		&ins_camera::GyroData::gz};
+
+	size_t roundUpToPowerOfTwo(size_t value)
+	{
+		size_t result = 1;
+		while (result < value)
+			result <<= 1;
+		return result;
+	}
+}
+
+GyroStore::GyroStore(Config config)
+{
+	const size_t capacity = roundUpToPowerOfTwo(std::max<size_t>(config.capacity, 2));
+	mMask = capacity - 1;
+	mTimestamps.resize(capacity);
+	for (auto& column : mColumns)
+	{
+		column.resize(capacity);
+	}
+}
+
+void GyroStore::onGyroData(const ins_camera::GyroData* samples, size_t count)
+{
+	if (count == 0)
+		return;
+
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	mBatches++;
+	mSamples += count;
+	if (mSize > 0 && samples[0].timestamp < mTimestamps[physical(mSize - 1)])
+	{
+		// The camera clock restarted; binary search needs one increasing run.
+		mDiscontinuities++;
+		mHead = 0;
+		mSize = 0;
+	}
+
+	const size_t capacity = mMask + 1;
+	if (count > capacity)
+	{
+		samples += count - capacity;
+		count = capacity;
+	}
+
+	// Transpose in contiguous runs, at most two when the batch wraps the end of the ring.
+	size_t tail = physical(mSize);
+	size_t done = 0;
+	while (done < count)
+	{
+		const size_t run = std::min(count - done, capacity - tail);
+		const ins_camera::GyroData* source = samples + done;
+		int64_t* timestamps = mTimestamps.data() + tail;
+		for (size_t i = 0; i < run; i++)
+		{
+			timestamps[i] = source[i].timestamp;
+		}
+		for (int c = 0; c < COLUMNS; c++)
+		{
+			double* column = mColumns[c].data() + tail;
+			const auto field = VALUE_FIELDS[c];
+			for (size_t i = 0; i < run; i++)
+			{
+				column[i] = source[i].*field;
+			}
+		}
+		done += run;
+		tail = (tail + run) & mMask;
+	}
+
+	mSize += count;
+	if (mSize > capacity)
+	{
+		mHead = (mHead + mSize - capacity) & mMask;
+		mSize = capacity;
+	}
+}
+
+size_t GyroStore::lowerBound(int64_t timestamp) const
+{
+	size_t low = 0;
+	size_t high = mSize;
+	while (low < high)
+	{
+		const size_t middle = low + (high - low) / 2;
+		if (mTimestamps[physical(middle)] < timestamp)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+template <typename T>
+void GyroStore::copyColumn(const std::vector<double>& column, size_t first, size_t count, char* out) const
+{
+	size_t done = 0;
+	while (done < count)
+	{
+		const size_t start = physical(first + done);
+		const size_t run = std::min(count - done, mMask + 1 - start);
+		if constexpr (std::is_same_v<T, double>)
+		{
+			std::memcpy(out + done * sizeof(T), column.data() + start, run * sizeof(T));
+		}
+		else
+		{
+			T* values = reinterpret_cast<T*>(out) + done;
+			for (size_t i = 0; i < run; i++)
+			{
+				values[i] = static_cast<T>(column[start + i]);
+			}
+		}
+		done += run;
+	}
+}
+
+std::string GyroStore::packRange(int64_t from, int64_t to, ValueType type, size_t maxSamples) const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	const size_t first = lowerBound(from);
+	const size_t last = to == std::numeric_limits<int64_t>::max() ? mSize : lowerBound(to + 1);
+	const size_t count = std::min(last > first ? last - first : 0, maxSamples);
+	const size_t valueBytes = static_cast<size_t>(type);
+
+	std::string body(sizeof(PackedHeader) + count * (sizeof(int64_t) + COLUMNS * valueBytes), '\0');
+	PackedHeader header{};
+	std::memcpy(header.magic, PackedHeader::MAGIC, sizeof(header.magic));
+	header.version = PackedHeader::VERSION;
+	header.valueBytes = static_cast<uint8_t>(valueBytes);
+	header.columns = COLUMNS;
+	header.count = static_cast<uint32_t>(count);
+	std::memcpy(body.data(), &header, sizeof(header));
+
+	char* out = body.data() + sizeof(header);
+	size_t done = 0;
+	while (done < count)
+	{
+		const size_t start = physical(first + done);
+		const size_t run = std::min(count - done, mMask + 1 - start);
+		std::memcpy(out + done * sizeof(int64_t), mTimestamps.data() + start, run * sizeof(int64_t));
+		done += run;
+	}
+	out += count * sizeof(int64_t);
+	for (const auto& column : mColumns)
+	{
+		if (type == ValueType::Float64)
+			copyColumn<double>(column, first, count, out);
+		else
+			copyColumn<float>(column, first, count, out);
+		out += count * valueBytes;
+	}
+	return body;
+}
+
+GyroStore::Stats GyroStore::getStats() const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	Stats stats;
+	stats.samples = mSamples;
+	stats.batches = mBatches;
+	stats.discontinuities = mDiscontinuities;
+	stats.stored = mSize;
+	stats.capacity = mMask + 1;
+	if (mSize > 0)
+	{
+		stats.oldestTimestamp = mTimestamps[physical(0)];
+		stats.newestTimestamp = mTimestamps[physical(mSize - 1)];
+	}
+	return stats;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Most recent gyro samples of one camera, kept column by column (timestamps, ax/ay/az, gx/gy/gz) in a
+	// fixed-size ring. Batches from OnGyroData are transposed in with one pass per column; range queries
+	// binary-search the timestamp column and copy whole column runs out, so pulling a second of kHz IMU data
+	// never walks the samples one struct at a time.
+	class GyroStore : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			size_t capacity = 128 * 1024;  // samples, rounded up to a power of two; about two minutes at 1 kHz
+		};
+
+		struct Stats
+		{
+			uint64_t samples = 0;	   // accepted since construction
+			uint64_t batches = 0;
+			uint64_t discontinuities = 0;  // batches that went back in time and restarted the store
+			size_t stored = 0;
+			size_t capacity = 0;
+			int64_t oldestTimestamp = 0;
+			int64_t newestTimestamp = 0;
+		};
+
+		enum class ValueType : uint8_t
+		{
+			Float32 = 4,
+			Float64 = 8
+		};
+
+		// Body of a packed range: this header, then `count` int64 timestamps, then the six value columns in
+		// ax, ay, az, gx, gy, gz order, each `count` values of `valueBytes`. Little-endian throughout.
+		struct PackedHeader
+		{
+			static constexpr char MAGIC[4] = {'L', 'G', 'Y', 'R'};
+			static constexpr uint8_t VERSION = 1;
+
+			char magic[4];
+			uint8_t version;
+			uint8_t valueBytes;
+			uint16_t columns;  // value columns after the timestamps, always 6
+			uint32_t count;
+			uint32_t reserved;
+		};
+
+		static_assert(sizeof(PackedHeader) == 16, "packed gyro header is part of the wire format");
+
+		explicit GyroStore(Config config);
+
+		void onGyroData(const ins_camera::GyroData* samples, size_t count) override;
+
+		// Samples with from <= timestamp <= to, at most `maxSamples` (the oldest ones are kept), packed as
+		// described by PackedHeader.
+		std::string packRange(int64_t from, int64_t to, ValueType type, size_t maxSamples = SIZE_MAX) const;
+		Stats getStats() const;
+
+	private:
+		static constexpr int COLUMNS = 6;
+
+		// Logical index 0 is the oldest stored sample.
+		size_t physical(size_t logical) const { return (mHead + logical) & mMask; }
+		size_t lowerBound(int64_t timestamp) const;
+		template <typename T>
+		void copyColumn(const std::vector<double>& column, size_t first, size_t count, char* out) const;
+
+		size_t mMask;
+		std::vector<int64_t> mTimestamps;
+		std::vector<double> mColumns[COLUMNS];
+		size_t mHead = 0;  // physical index of the oldest sample
+		size_t mSize = 0;
+
+		mutable std::shared_mutex mMutex;
+		uint64_t mSamples = 0;
+		uint64_t mBatches = 0;
+		uint64_t mDiscontinuities = 0;
+	};
+}
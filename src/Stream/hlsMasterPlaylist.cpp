@@ -0,0 +1,50 @@
+#include "hlsMasterPlaylist.h"
+
+#include <sstream>
+
+#include "nalParser.h"
+#include "spsParser.h"
+
+using namespace Letico;
+
+namespace
+{
+	bool parseFormat(ins_camera::VideoEncodeType codec, const FramePtr& parameterSets, VideoFormat& format)
+	{
+		if (!parameterSets)
+			return false;
+		const uint8_t spsType = codec == ins_camera::VideoEncodeType::H265 ? NalParser::H265_SPS : NalParser::H264_SPS;
+		std::vector<NalUnit> nals;
+		NalParser::split(parameterSets->data(), parameterSets->size(), codec, nals);
+		for (const auto& nal : nals)
+		{
+			if (nal.type == spsType)
+				return SpsParser::parse(codec, nal.data, nal.size, format);
+		}
+		return false;
+	}
+}
+
+std::string HlsMasterPlaylist::build(ins_camera::VideoEncodeType codec, const std::vector<Variant>& variants)
+{
+	std::ostringstream playlist;
+	playlist << "#EXTM3U\n";
+	playlist << "#EXT-X-VERSION:3\n";
+	playlist << "#EXT-X-INDEPENDENT-SEGMENTS\n";
+	for (const auto& variant : variants)
+	{
+		playlist << "#EXT-X-STREAM-INF:BANDWIDTH=" << variant.bandwidth;
+		VideoFormat format;
+		if (parseFormat(codec, variant.parameterSets, format))
+		{
+			playlist << ",RESOLUTION=" << format.width << "x" << format.height << ",CODECS=\"" << format.codecString();
+			if (!variant.audioCodec.empty())
+			{
+				playlist << "," << variant.audioCodec;
+			}
+			playlist << "\"";
+		}
+		playlist << "\n" << variant.uri << "\n";
+	}
+	return playlist.str();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Builds the HLS master playlist that lists the live renditions (main and LRV stream) as variants, so a
+	// player switches between them by bandwidth without any transcoding on the host.
+	class HlsMasterPlaylist
+	{
+	public:
+		struct Variant
+		{
+			std::string uri;  // media playlist, relative to the master
+			uint32_t bandwidth = 0;	 // bits per second
+			// Latest VPS/SPS/PPS of the rendition; adds RESOLUTION and CODECS. May be null before the first keyframe.
+			FramePtr parameterSets;
+			std::string audioCodec;	 // RFC 6381, e.g. "mp4a.40.2"; empty for a rendition without audio
+		};
+
+		// Variants are listed in the given order; players start with the first one.
+		static std::string build(ins_camera::VideoEncodeType codec, const std::vector<Variant>& variants);
+	};
+}
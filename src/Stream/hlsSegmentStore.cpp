@@ -0,0 +1,155 @@
+#include "hlsSegmentStore.h"
+
+#include <mutex>
+#include <utility>
+
+using namespace Letico;
+
+HlsSegmentStore::HlsSegmentStore(Config config): mConfig(config)
+{
+}
+
+void HlsSegmentStore::publishSegment(const std::string& name, std::string data, bool pinned)
+{
+	auto buffer = std::make_shared<const std::string>(std::move(data));
+	const auto now = std::chrono::steady_clock::now();
+
+	{
+		std::unique_lock<std::shared_mutex> lock(mMutex);
+		if (pinned)
+		{
+			mPinned.insert(name);
+		}
+		else if (mSegments.find(name) == mSegments.end())
+		{
+			mOrder.push_back(name);
+		}
+		mSegments[name] = {std::move(buffer), now};
+		evictLocked(now);
+	}
+	mPublished.notify_all();
+}
+
+void HlsSegmentStore::unpinSegment(const std::string& name)
+{
+	const auto now = std::chrono::steady_clock::now();
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	if (mPinned.erase(name) == 0)
+		return;
+	auto it = mSegments.find(name);
+	if (it == mSegments.end())
+		return;
+	// Clients that fetched the last playlist referring to it still get it for maxAge.
+	it->second.published = now;
+	mOrder.push_back(name);
+	evictLocked(now);
+}
+
+void HlsSegmentStore::publishPlaylist(std::string playlist, uint64_t nextSequence, size_t nextPart)
+{
+	auto buffer = std::make_shared<const std::string>(std::move(playlist));
+	{
+		std::unique_lock<std::shared_mutex> lock(mMutex);
+		mPlaylist = std::move(buffer);
+		mNextSequence = nextSequence;
+		mNextPart = nextPart;
+		evictLocked(std::chrono::steady_clock::now());
+	}
+	mPublished.notify_all();
+}
+
+void HlsSegmentStore::publishManifest(std::string manifest)
+{
+	auto buffer = manifest.empty() ? nullptr : std::make_shared<const std::string>(std::move(manifest));
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	mManifest = std::move(buffer);
+}
+
+void HlsSegmentStore::clear()
+{
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	mSegments.clear();
+	mOrder.clear();
+	mPinned.clear();
+	mPlaylist.reset();
+	mManifest.reset();
+	mNextSequence = 0;
+	mNextPart = 0;
+}
+
+SharedBuffer HlsSegmentStore::getSegment(const std::string& name) const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	auto it = mSegments.find(name);
+	return it == mSegments.end() ? nullptr : it->second.data;
+}
+
+SharedBuffer HlsSegmentStore::getPlaylist() const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	return mPlaylist;
+}
+
+SharedBuffer HlsSegmentStore::getManifest() const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	return mManifest;
+}
+
+HlsSegmentStore::BlockResult HlsSegmentStore::waitForPart(uint64_t sequence, int part, std::chrono::milliseconds timeout) const
+{
+	// The spec lets a server refuse requests more than two segments ahead of the live edge.
+	constexpr uint64_t MAX_SEGMENTS_AHEAD = 2;
+
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	if (sequence > mNextSequence + MAX_SEGMENTS_AHEAD)
+		return BlockResult::Unreachable;
+
+	auto available = [&]
+	{
+		if (part < 0)
+			return sequence < mNextSequence;
+		return sequence < mNextSequence || (sequence == mNextSequence && static_cast<size_t>(part) < mNextPart);
+	};
+	return mPublished.wait_for(lock, timeout, available) ? BlockResult::Ready : BlockResult::TimedOut;
+}
+
+SharedBuffer HlsSegmentStore::waitForSegment(const std::string& name, std::chrono::milliseconds timeout) const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	SharedBuffer segment;
+	mPublished.wait_for(
+		lock,
+		timeout,
+		[&]
+		{
+			auto it = mSegments.find(name);
+			if (it != mSegments.end())
+				segment = it->second.data;
+			return segment != nullptr;
+		}
+	);
+	return segment;
+}
+
+size_t HlsSegmentStore::segmentCount() const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	return mSegments.size();
+}
+
+void HlsSegmentStore::evictLocked(std::chrono::steady_clock::time_point now)
+{
+	// Buffers still referenced by in-flight responses stay alive until those responses finish.
+	while (!mOrder.empty())
+	{
+		auto it = mSegments.find(mOrder.front());
+		const bool expired = it == mSegments.end() || now - it->second.published > mConfig.maxAge;
+		if (!expired && mOrder.size() <= mConfig.maxSegments)
+			break;
+		// A name published again as pinned stays; only its old place in the order goes.
+		if (it != mSegments.end() && mPinned.count(it->first) == 0)
+			mSegments.erase(it);
+		mOrder.pop_front();
+	}
+}
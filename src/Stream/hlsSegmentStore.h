@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Letico
+{
+	using SharedBuffer = std::shared_ptr<const std::string>;
+
+	// Immutable, reference-counted HLS objects held in memory. The segmenter publishes each finished segment and
+	// playlist once; HTTP handlers take a reference and stream straight out of it, so serving a request neither
+	// touches the disk nor copies the payload.
+	class HlsSegmentStore
+	{
+	public:
+		struct Config
+		{
+			size_t maxSegments = 10;  // segments and partial segments together
+			std::chrono::seconds maxAge{30};
+		};
+
+		enum class BlockResult
+		{
+			Ready,
+			TimedOut,
+			Unreachable	 // the request is too far ahead of the live edge to ever be satisfied in time
+		};
+
+		explicit HlsSegmentStore(Config config);
+
+		// Pinned objects (fMP4 init segments) are exempt from eviction; every segment that follows refers to them.
+		void publishSegment(const std::string& name, std::string data, bool pinned = false);
+		// A pinned object no segment in the playlist refers to any more; from now on it ages out like a segment.
+		void unpinSegment(const std::string& name);
+		// `nextSequence`/`nextPart` name the first (segment, part) that is not yet available.
+		void publishPlaylist(std::string playlist, uint64_t nextSequence = 0, size_t nextPart = 0);
+		// MPEG-DASH manifest over the same segments; empty withdraws it.
+		void publishManifest(std::string manifest);
+		void clear();
+
+		SharedBuffer getSegment(const std::string& name) const;
+		SharedBuffer getPlaylist() const;
+		// Null until a manifest has been published.
+		SharedBuffer getManifest() const;
+		size_t segmentCount() const;
+
+		// Blocking playlist reload (_HLS_msn/_HLS_part): waits until part `part` of segment `sequence` is
+		// published, or the whole segment when `part` is negative.
+		BlockResult waitForPart(uint64_t sequence, int part, std::chrono::milliseconds timeout) const;
+		// Waits for a segment or part announced by EXT-X-PRELOAD-HINT.
+		SharedBuffer waitForSegment(const std::string& name, std::chrono::milliseconds timeout) const;
+
+	private:
+		struct Entry
+		{
+			SharedBuffer data;
+			std::chrono::steady_clock::time_point published;
+		};
+
+		void evictLocked(std::chrono::steady_clock::time_point now);
+
+		Config mConfig;
+		mutable std::shared_mutex mMutex;
+		mutable std::condition_variable_any mPublished;
+		uint64_t mNextSequence = 0;
+		size_t mNextPart = 0;
+		std::unordered_map<std::string, Entry> mSegments;
+		std::deque<std::string> mOrder;	 // publication order, oldest first
+		std::unordered_set<std::string> mPinned;
+		SharedBuffer mPlaylist;
+		SharedBuffer mManifest;
+	};
+}
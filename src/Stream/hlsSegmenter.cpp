@@ -0,0 +1,433 @@
+#include "hlsSegmenter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+#include "nalParser.h"
+
+using namespace Letico;
+
+namespace
+{
+	// Start presentation time one second in so PCR (which runs ahead of PTS) never goes negative.
+	constexpr int64_t PTS_OFFSET = MPEG_CLOCK_HZ;
+	// Partial segments are listed for roughly this many target durations behind the live edge.
+	constexpr double PART_LISTING_TARGETS = 3.0;
+}
+
+HlsSegmenter::HlsSegmenter(Config config, std::shared_ptr<HlsSegmentStore> store):
+	mConfig(std::move(config)),
+	mStore(std::move(store)),
+	mDash(mConfig.segmentPrefix)
+{
+}
+
+void HlsSegmenter::setTargetDuration(double seconds)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		mConfig.targetDuration = seconds;
+}
+
+void HlsSegmenter::setAudio(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		mAudio = enabled;
+}
+
+void HlsSegmenter::start(ins_camera::VideoEncodeType codec)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMuxer.setCodec(codec);
+	mMuxer.setAudio(mAudio && !mConfig.fragmentedMp4);
+	mAudioQueue.clear();
+	mActive = true;
+	mSegmentOpen = false;
+	mPartOpen = false;
+	mCurrentParts.clear();
+	mCurrentSegment.clear();
+	mFirstTimestamp = 0;
+	mLastTimestamp = 0;
+	mLastFrameInterval = 0;
+	mDiscontinuityPending = false;
+	mSegmentDiscontinuity = false;
+	mDiscontinuitySequence = 0;
+	// The new session publishes its own init segments; the previous ones age out with its segments.
+	for (const auto& segment : mSegments)
+	{
+		if (!segment.initName.empty() && segment.initName != mInitName)
+			mStore->unpinSegment(segment.initName);
+	}
+	if (!mInitName.empty())
+		mStore->unpinSegment(mInitName);
+	mSegments.clear();
+	mInit.reset();
+	mInitName.clear();
+	mDash.start(mConfig.targetDuration);
+	writePlaylist(false);
+}
+
+void HlsSegmenter::stop()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		return;
+	if (mSegmentOpen)
+	{
+		flushAudio(mLastTimestamp + mLastFrameInterval);
+		closeSegment(mLastTimestamp + mLastFrameInterval);
+	}
+	mAudioQueue.clear();
+	mActive = false;
+	mDash.stop();
+	writePlaylist(true);
+}
+
+void HlsSegmenter::markDiscontinuity()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mActive)
+		markDiscontinuityLocked();
+}
+
+void HlsSegmenter::markDiscontinuityLocked()
+{
+	if (mSegmentOpen)
+	{
+		flushAudio(mLastTimestamp + mLastFrameInterval);
+		closeSegment(mLastTimestamp + mLastFrameInterval);
+	}
+	mAudioQueue.clear();
+	// The first segment of a session needs no tag; there is no earlier timeline to break from.
+	mDiscontinuityPending = !mSegments.empty();
+	mLastTimestamp = 0;
+}
+
+void HlsSegmenter::onVideoFrame(const FramePtr& frame)
+{
+	if (frame->streamIndex != mConfig.streamIndex)
+		return;
+
+	// GopCache puts parameter sets sent on their own in front of the next keyframe; written here as a PES of their
+	// own they would end the previous segment and leave the next one starting without them.
+	const FrameContents contents = NalParser::inspect(frame->data(), frame->size(), mMuxer.codec());
+	if (!contents.slices)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		return;
+	if (mSegmentOpen && frame->timestamp < mLastTimestamp)
+	{
+		// The camera clock restarted; PTS would run backwards inside the segment.
+		markDiscontinuityLocked();
+	}
+	// Audio before this frame belongs in front of it, and in the segment (or part) this frame may close.
+	if (mSegmentOpen)
+	{
+		flushAudio(frame->timestamp);
+	}
+
+	const bool keyframe = contents.keyframe;
+	if (!mSegmentOpen)
+	{
+		// Nothing decodes before the first keyframe, so the first segment starts there.
+		if (!keyframe)
+			return;
+		mFirstTimestamp = frame->timestamp;
+		openSegment(frame->timestamp);
+	}
+	else if (keyframe && frame->timestamp - mSegmentStart >= static_cast<int64_t>(mConfig.targetDuration * TIMESTAMP_HZ))
+	{
+		closeSegment(frame->timestamp);
+		openSegment(frame->timestamp);
+	}
+	else if (mConfig.lowLatency &&
+			 frame->timestamp + mLastFrameInterval - mPartStart > static_cast<int64_t>(mConfig.partTarget * TIMESTAMP_HZ))
+	{
+		// Cut before the frame that would push the part past PART-TARGET; the spec forbids longer parts.
+		closePart(frame->timestamp);
+		openPart(frame->timestamp, keyframe);
+	}
+
+	if (frame->timestamp > mLastTimestamp && mLastTimestamp != 0)
+	{
+		mLastFrameInterval = frame->timestamp - mLastTimestamp;
+	}
+	mLastTimestamp = frame->timestamp;
+
+	const int64_t pts = (frame->timestamp - mFirstTimestamp) * MPEG_CLOCK_HZ / TIMESTAMP_HZ + PTS_OFFSET;
+	mMuxer.writeVideo(mCurrentSegment, frame->data(), frame->size(), pts, keyframe);
+}
+
+void HlsSegmenter::onAudioFrame(const FramePtr& frame)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	// Until the first keyframe opens a segment there is no timeline to put audio on.
+	if (!mActive || !mMuxer.audio() || !mSegmentOpen || frame->timestamp < mFirstTimestamp)
+		return;
+	// Audio far ahead of the video would wait for frames that may never come (a stalled video stream).
+	if (frame->timestamp - mLastTimestamp > static_cast<int64_t>(mConfig.audioQueueMs))
+		return;
+	mAudioQueue.push_back(frame);
+}
+
+void HlsSegmenter::flushAudio(int64_t timestamp)
+{
+	while (!mAudioQueue.empty() && mAudioQueue.front()->timestamp < timestamp)
+	{
+		const auto& frame = mAudioQueue.front();
+		if (frame->timestamp >= mFirstTimestamp)
+		{
+			const int64_t pts = (frame->timestamp - mFirstTimestamp) * MPEG_CLOCK_HZ / TIMESTAMP_HZ + PTS_OFFSET;
+			mMuxer.writeAudio(mCurrentSegment, frame->data(), frame->size(), pts);
+		}
+		mAudioQueue.pop_front();
+	}
+}
+
+void HlsSegmenter::onFragment(const CmafFragment& fragment)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive)
+		return;
+	if (mSegmentOpen && fragment.timestamp < mLastTimestamp)
+	{
+		markDiscontinuityLocked();
+	}
+
+	if (!mSegmentOpen)
+	{
+		if (!fragment.independent)
+			return;
+		mFirstTimestamp = fragment.timestamp;
+		openSegment(fragment.timestamp);
+	}
+	else if (fragment.independent &&
+			 (fragment.init != mInit ||
+			  fragment.timestamp - mSegmentStart >= static_cast<int64_t>(mConfig.targetDuration * TIMESTAMP_HZ)))
+	{
+		closeSegment(fragment.timestamp);
+		openSegment(fragment.timestamp);
+	}
+
+	if (fragment.init != mInit)
+	{
+		// Init segments stay pinned in the store while a segment of the window refers to them.
+		mInit = fragment.init;
+		mInitName = mConfig.segmentPrefix + "_init" + std::to_string(mInitCount++) + ".mp4";
+		mStore->publishSegment(mInitName, *mInit, true);
+	}
+	if (mCurrentSegment.empty())
+	{
+		mSegmentDecodeTime = fragment.decodeTime;
+	}
+	mNextDecodeTime = fragment.decodeTime + static_cast<uint64_t>(fragment.duration) * Fmp4Muxer::TIMESCALE / TIMESTAMP_HZ;
+	mSegmentFormat = fragment.format;
+	mSegmentAudioCodec = fragment.audioCodec;
+	mCurrentSegment += *fragment.data;
+	mLastTimestamp = fragment.timestamp + fragment.duration;
+	mLastFrameInterval = 0;
+}
+
+std::string HlsSegmenter::playlist() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPlaylist;
+}
+
+void HlsSegmenter::openSegment(int64_t timestamp)
+{
+	mSegmentOpen = true;
+	mSegmentStart = timestamp;
+	mSegmentDiscontinuity = std::exchange(mDiscontinuityPending, false);
+	mCurrentSegment.clear();
+	// The finished buffer is handed to the store, so size the next one from the last segment up front.
+	mCurrentSegment.reserve(mLastSegmentBytes + mLastSegmentBytes / 4);
+	if (mConfig.fragmentedMp4)
+		return;
+	mMuxer.writeTables(mCurrentSegment);
+	if (mConfig.lowLatency)
+	{
+		openPart(timestamp, true);
+		mPartOffset = 0;  // the first part carries PAT/PMT too
+	}
+}
+
+void HlsSegmenter::closeSegment(int64_t endTimestamp)
+{
+	if (mPartOpen)
+	{
+		closePart(endTimestamp);
+	}
+
+	Segment segment;
+	segment.sequence = mNextSequence++;
+	segment.duration = static_cast<double>(endTimestamp - mSegmentStart) / TIMESTAMP_HZ;
+	segment.name = segmentName(segment.sequence);
+	segment.initName = mInitName;
+	segment.discontinuity = mSegmentDiscontinuity;
+	segment.parts = std::move(mCurrentParts);
+	mCurrentParts.clear();
+	// Segments that fall out of the window stay in the store until it evicts them by age, so clients that
+	// fetched the previous playlist can still download them.
+	mLastSegmentBytes = mCurrentSegment.size();
+	if (mConfig.fragmentedMp4)
+	{
+		DashManifest::Segment entry;
+		entry.number = segment.sequence;
+		entry.decodeTime = mSegmentDecodeTime;
+		entry.duration = mNextDecodeTime - mSegmentDecodeTime;
+		entry.bytes = mCurrentSegment.size();
+		entry.initName = segment.initName;
+		entry.discontinuity = segment.discontinuity;
+		entry.format = mSegmentFormat;
+		entry.audioCodec = mSegmentAudioCodec;
+		mDash.addSegment(entry, std::chrono::system_clock::now());
+	}
+	mStore->publishSegment(segment.name, std::move(mCurrentSegment));
+	mCurrentSegment = std::string();
+	mSegmentOpen = false;
+
+	mSegments.push_back(std::move(segment));
+	while (mSegments.size() > mConfig.windowSize)
+	{
+		if (mSegments.front().discontinuity)
+			mDiscontinuitySequence++;
+		const std::string initName = std::move(mSegments.front().initName);
+		mSegments.pop_front();
+		mDash.removeOldest();
+		// Init segments only change forward, so once the new oldest segment uses another one nothing refers to it.
+		if (!initName.empty() && initName != mInitName && (mSegments.empty() || mSegments.front().initName != initName))
+			mStore->unpinSegment(initName);
+	}
+	writePlaylist(false);
+}
+
+void HlsSegmenter::openPart(int64_t timestamp, bool independent)
+{
+	mPartOpen = true;
+	mPartStart = timestamp;
+	mPartIndependent = independent;
+	mPartOffset = mCurrentSegment.size();
+}
+
+void HlsSegmenter::closePart(int64_t endTimestamp)
+{
+	Part part;
+	part.duration = static_cast<double>(endTimestamp - mPartStart) / TIMESTAMP_HZ;
+	part.independent = mPartIndependent;
+	part.name = partName(mNextSequence, mCurrentParts.size());
+	mStore->publishSegment(part.name, mCurrentSegment.substr(mPartOffset));
+	mCurrentParts.push_back(std::move(part));
+	mPartOpen = false;
+	writePlaylist(false);
+}
+
+bool HlsSegmenter::isUpcoming(const std::string& name) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mActive || !mConfig.lowLatency || !mSegmentOpen)
+		return false;
+	return name == partName(mNextSequence, mCurrentParts.size()) || name == segmentName(mNextSequence);
+}
+
+std::string HlsSegmenter::segmentName(uint64_t sequence) const
+{
+	return mConfig.segmentPrefix + std::to_string(sequence) + (mConfig.fragmentedMp4 ? ".m4s" : ".ts");
+}
+
+std::string HlsSegmenter::partName(uint64_t sequence, size_t index) const
+{
+	return mConfig.segmentPrefix + std::to_string(sequence) + "_part" + std::to_string(index) + ".ts";
+}
+
+void HlsSegmenter::writePlaylist(bool endList)
+{
+	double maxDuration = mConfig.targetDuration;
+	for (const auto& segment : mSegments)
+	{
+		maxDuration = std::max(maxDuration, segment.duration);
+	}
+
+	std::ostringstream playlist;
+	playlist << "#EXTM3U\n";
+	playlist << "#EXT-X-VERSION:" << (mConfig.fragmentedMp4 ? 7 : mConfig.lowLatency ? 6 : 3) << "\n";
+	playlist << "#EXT-X-TARGETDURATION:" << static_cast<int>(std::ceil(maxDuration)) << "\n";
+	playlist.setf(std::ios::fixed);
+	playlist.precision(3);
+	if (mConfig.lowLatency)
+	{
+		playlist << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" << mConfig.partTarget * 3 << "\n";
+		playlist << "#EXT-X-PART-INF:PART-TARGET=" << mConfig.partTarget << "\n";
+	}
+	playlist << "#EXT-X-MEDIA-SEQUENCE:" << (mSegments.empty() ? mNextSequence : mSegments.front().sequence) << "\n";
+	if (mDiscontinuitySequence != 0)
+	{
+		playlist << "#EXT-X-DISCONTINUITY-SEQUENCE:" << mDiscontinuitySequence << "\n";
+	}
+
+	auto writeParts = [&playlist](const std::vector<Part>& parts)
+	{
+		for (const auto& part : parts)
+		{
+			playlist << "#EXT-X-PART:DURATION=" << part.duration << ",URI=\"" << part.name << "\""
+					 << (part.independent ? ",INDEPENDENT=YES" : "") << "\n";
+		}
+	};
+
+	// Only the segments close to the live edge keep their parts listed.
+	double fromEdge = 0.0;
+	size_t firstWithParts = mSegments.size();
+	while (firstWithParts > 0 && fromEdge < PART_LISTING_TARGETS * mConfig.targetDuration)
+	{
+		firstWithParts--;
+		fromEdge += mSegments[firstWithParts].duration;
+	}
+
+	std::string currentInit;
+	for (size_t i = 0; i < mSegments.size(); i++)
+	{
+		const auto& segment = mSegments[i];
+		if (segment.discontinuity)
+		{
+			playlist << "#EXT-X-DISCONTINUITY\n";
+		}
+		if (segment.initName != currentInit)
+		{
+			currentInit = segment.initName;
+			playlist << "#EXT-X-MAP:URI=\"" << currentInit << "\"\n";
+		}
+		if (mConfig.lowLatency && i >= firstWithParts)
+		{
+			writeParts(segment.parts);
+		}
+		playlist << "#EXTINF:" << segment.duration << ",\n" << segment.name << "\n";
+	}
+
+	if (mConfig.lowLatency && mActive && mSegmentOpen)
+	{
+		if (mSegmentDiscontinuity)
+		{
+			playlist << "#EXT-X-DISCONTINUITY\n";
+		}
+		writeParts(mCurrentParts);
+		playlist << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << partName(mNextSequence, mCurrentParts.size()) << "\"\n";
+	}
+	if (endList)
+	{
+		playlist << "#EXT-X-ENDLIST\n";
+	}
+	mPlaylist = playlist.str();
+
+	// Everything before (next sequence, next part) is available once this playlist is visible.
+	mStore->publishPlaylist(mPlaylist, mNextSequence, mSegmentOpen ? mCurrentParts.size() : 0);
+	if (mConfig.fragmentedMp4)
+	{
+		mStore->publishManifest(mDash.empty() ? std::string() : mDash.document(std::chrono::system_clock::now()));
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cmafFragmenter.h"
+#include "dashManifest.h"
+#include "hlsSegmentStore.h"
+#include "streamTypes.h"
+#include "tsMuxer.h"
+
+namespace Letico
+{
+	// Cuts the live Annex-B stream into MPEG-TS segments at keyframe boundaries and maintains a sliding-window
+	// HLS playlist, replacing the external ffmpeg process the /stream.m3u8 endpoint used to depend on. Finished
+	// segments and playlists are published to an HlsSegmentStore that the HTTP server serves from.
+	//
+	// In low-latency mode every segment is additionally published as a run of partial segments (EXT-X-PART)
+	// of roughly `partTarget` seconds, which lets LL-HLS players sit a few parts behind the live edge.
+	//
+	// With `fragmentedMp4` the segmenter is fed CMAF fragments by a CmafFragmenter instead of frames: segments
+	// are runs of whole fragments (.m4s) behind an EXT-X-MAP init segment, muxed once for HLS and recording.
+	// The same segments are listed in an MPEG-DASH manifest, published to the store next to the playlist.
+	//
+	// A break in the stream (the camera stream was restarted, or its timestamps went backwards) ends the open
+	// segment and tags the next one with EXT-X-DISCONTINUITY, so players reset their decoder and timeline.
+	//
+	// With audio, TS segments carry the delegate's ADTS frames on a second PID. Audio waits until video of the same
+	// time has been written, so both streams are interleaved in timestamp order and a segment cut at a keyframe
+	// holds exactly the audio before it; audio more than `audioQueueMs` ahead of the video is dropped rather than
+	// queued for a stalled video stream. In fMP4 mode the audio comes inside the fragments instead.
+	class HlsSegmenter : public StreamSink, public FragmentSink
+	{
+	public:
+		struct Config
+		{
+			double targetDuration = 2.0;  // seconds; segments are cut at the first keyframe past this
+			size_t windowSize = 6;		  // segments listed in the playlist
+			int streamIndex = 0;
+			std::string segmentPrefix = "segment";
+			bool lowLatency = false;
+			double partTarget = 0.2;  // seconds, low-latency mode only
+			bool fragmentedMp4 = false;	 // CMAF segments from onFragment(); not combined with lowLatency
+			double audioQueueMs = 500.0;
+		};
+
+		HlsSegmenter(Config config, std::shared_ptr<HlsSegmentStore> store);
+
+		// Segment length for the next session; ignored while a session runs.
+		void setTargetDuration(double seconds);
+		// Whether the next session carries audio; ignored while a session runs.
+		void setAudio(bool enabled);
+		// Begins a new live session; frames are ignored until start() and after stop().
+		void start(ins_camera::VideoEncodeType codec);
+		// Flushes the open segment and terminates the playlist with EXT-X-ENDLIST.
+		void stop();
+		// Closes the open segment; the next one starts with EXT-X-DISCONTINUITY and a fresh presentation timeline.
+		void markDiscontinuity();
+
+		void onVideoFrame(const FramePtr& frame) override;
+		void onAudioFrame(const FramePtr& frame) override;
+		void onFragment(const CmafFragment& fragment) override;
+
+		std::string playlist() const;
+		// Whether `name` is the part EXT-X-PRELOAD-HINT announces or the open segment it belongs to: the names a
+		// low-latency client may request before they exist. Requests for anything else missing can fail at once.
+		bool isUpcoming(const std::string& name) const;
+		std::shared_ptr<HlsSegmentStore> store() const { return mStore; }
+		const Config& config() const { return mConfig; }
+
+	private:
+		struct Part
+		{
+			double duration;
+			bool independent;
+			std::string name;
+		};
+
+		struct Segment
+		{
+			uint64_t sequence;
+			double duration;
+			std::string name;
+			std::vector<Part> parts;
+			std::string initName;  // fMP4 only
+			bool discontinuity = false;
+		};
+
+		void markDiscontinuityLocked();
+		// Writes queued audio older than `timestamp` into the open segment.
+		void flushAudio(int64_t timestamp);
+		void openSegment(int64_t timestamp);
+		void closeSegment(int64_t endTimestamp);
+		void openPart(int64_t timestamp, bool independent);
+		void closePart(int64_t endTimestamp);
+		void writePlaylist(bool endList);
+		std::string segmentName(uint64_t sequence) const;
+		std::string partName(uint64_t sequence, size_t index) const;
+
+		Config mConfig;
+		std::shared_ptr<HlsSegmentStore> mStore;
+		mutable std::mutex mMutex;
+		bool mActive = false;
+		TsMuxer mMuxer;
+		bool mAudio = false;
+		std::deque<FramePtr> mAudioQueue;
+
+		std::string mCurrentSegment;
+		size_t mLastSegmentBytes = 0;
+		bool mSegmentOpen = false;
+		int64_t mSegmentStart = 0;
+		int64_t mFirstTimestamp = 0;
+		int64_t mLastTimestamp = 0;
+		int64_t mLastFrameInterval = 0;
+		uint64_t mNextSequence = 0;
+		bool mDiscontinuityPending = false;	 // the next segment starts a new timeline
+		bool mSegmentDiscontinuity = false;	 // the open segment does
+		uint64_t mDiscontinuitySequence = 0;  // discontinuities that slid out of the playlist window
+
+		// Parts of the open segment (low-latency mode).
+		std::vector<Part> mCurrentParts;
+		bool mPartOpen = false;
+		bool mPartIndependent = false;
+		int64_t mPartStart = 0;
+		size_t mPartOffset = 0;
+
+		// fMP4: init segment of the open segment and how many have been published.
+		SharedBuffer mInit;
+		std::string mInitName;
+		uint64_t mInitCount = 0;
+		// fMP4: media time of the open segment and its latest fragment, for the DASH timeline.
+		uint64_t mSegmentDecodeTime = 0;
+		uint64_t mNextDecodeTime = 0;
+		VideoFormat mSegmentFormat;
+		std::string mSegmentAudioCodec;
+		DashManifest mDash;
+
+		std::deque<Segment> mSegments;
+		std::string mPlaylist;
+	};
+}
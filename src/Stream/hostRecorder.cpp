@@ -0,0 +1,336 @@
+#include "hostRecorder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#include "../utils.hpp"
+#include "nalParser.h"
+
+using namespace Letico;
+
+namespace
+{
+	constexpr size_t IO_ALIGNMENT = 4096;
+	constexpr int64_t PTS_OFFSET = MPEG_CLOCK_HZ;
+}
+
+HostRecorder::HostRecorder(Config config, std::shared_ptr<GopCache> source, std::shared_ptr<CmafFragmenter> fragmenter):
+	mConfig(std::move(config)),
+	mSource(std::move(source)),
+	mFragmenter(std::move(fragmenter))
+{
+	mConfig.blockBytes = std::max(IO_ALIGNMENT, mConfig.blockBytes / IO_ALIGNMENT * IO_ALIGNMENT);
+}
+
+HostRecorder::~HostRecorder()
+{
+	stop();
+	std::free(mBlock.data);
+}
+
+bool HostRecorder::start(ins_camera::VideoEncodeType codec)
+{
+	std::lock_guard<std::mutex> control(mControlMutex);
+	if (mRunning.load(std::memory_order_acquire))
+		return false;
+	if (mConfig.format == Format::Mp4 && !mFragmenter)
+		return false;
+
+	if (!mBlock.data)
+	{
+		void* block = nullptr;
+		if (posix_memalign(&block, IO_ALIGNMENT, mConfig.blockBytes) != 0)
+			return false;
+		mBlock.data = static_cast<uint8_t*>(block);
+	}
+	mBlock.used = 0;
+	mCodec = codec;
+	mLastTimestamp = 0;
+	{
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mStats = Stats();
+		mStats.recording = true;
+		mFiles.clear();
+		mQueue.reset();
+		mFragmentQueue.reset();
+		if (mConfig.format == Format::Mp4)
+			mFragmentQueue = std::make_shared<FragmentQueue>(mConfig.queue);
+		else
+			mQueue = std::make_shared<FrameQueue>(mConfig.queue, mConfig.streamIndex, codec);
+	}
+
+	mRunning.store(true, std::memory_order_release);
+	mWriterThread = std::thread([this] { writerLoop(); });
+	if (mFragmentQueue)
+		mFragmenter->subscribe(mFragmentQueue);
+	else
+		mSource->subscribe(mQueue);
+	return true;
+}
+
+std::vector<std::string> HostRecorder::stop()
+{
+	std::lock_guard<std::mutex> control(mControlMutex);
+	if (!mRunning.exchange(false, std::memory_order_acq_rel))
+		return {};
+
+	// Closing the queue lets the writer drain what is already queued and finish the file.
+	if (mFragmentQueue)
+	{
+		mFragmenter->unsubscribe(mFragmentQueue);
+		mFragmentQueue->close();
+	}
+	else
+	{
+		mSource->unsubscribe(mQueue);
+		mQueue->close();
+	}
+	if (mWriterThread.joinable())
+		mWriterThread.join();
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mStats.recording = false;
+	mStats.queue = mFragmentQueue ? mFragmentQueue->getStats() : mQueue->getStats();
+	return mFiles;
+}
+
+HostRecorder::Stats HostRecorder::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	Stats stats = mStats;
+	if (mStats.recording)
+		stats.queue = mFragmentQueue ? mFragmentQueue->getStats() : mQueue->getStats();
+	return stats;
+}
+
+void HostRecorder::writerLoop()
+{
+	if (mFragmentQueue)
+	{
+		std::vector<CmafFragment> fragments;
+		while (mFragmentQueue->popAll(fragments, std::chrono::milliseconds(200)))
+		{
+			for (const auto& fragment : fragments)
+			{
+				writeFragment(fragment);
+			}
+			fragments.clear();
+		}
+	}
+	else
+	{
+		std::vector<FramePtr> frames;
+		while (mQueue->popAll(frames, std::chrono::milliseconds(200)))
+		{
+			for (const auto& frame : frames)
+			{
+				writeFrame(frame);
+			}
+			frames.clear();
+		}
+	}
+	closeFile();
+}
+
+void HostRecorder::writeFrame(const FramePtr& frame)
+{
+	// GopCache puts parameter sets sent on their own in front of the next keyframe.
+	const FrameContents contents = NalParser::inspect(frame->data(), frame->size(), mCodec);
+	if (!contents.slices)
+		return;
+	if (mFile >= 0 && frame->timestamp < mLastTimestamp)
+	{
+		// The camera clock restarted; PTS would run backwards in this file, so the next keyframe starts a new one.
+		closeFile();
+	}
+	mLastTimestamp = frame->timestamp;
+
+	const bool keyframe = contents.keyframe;
+	const int64_t roll = static_cast<int64_t>(mConfig.rollSeconds * TIMESTAMP_HZ);
+	FramePtr payload = frame;
+	if (keyframe && (mFile < 0 || frame->timestamp - mFileStart >= roll))
+	{
+		// Every file has to decode on its own, so it only opens on a keyframe with the parameter sets in front.
+		// Until some are known the open file, if any, continues to the next keyframe.
+		FramePtr head = contents.parameterSets ? frame : withParameterSets(frame);
+		if (head)
+		{
+			closeFile();
+			openFile(frame->timestamp);
+			payload = std::move(head);
+		}
+	}
+	if (mFile < 0)
+		return;
+
+	mScratch.clear();
+	if (keyframe)
+	{
+		mMuxer->writeTables(mScratch);
+	}
+	const int64_t pts = (frame->timestamp - mFileStart) * MPEG_CLOCK_HZ / TIMESTAMP_HZ + PTS_OFFSET;
+	mMuxer->writeVideo(mScratch, payload->data(), payload->size(), pts, keyframe);
+	appendToBlock(reinterpret_cast<const uint8_t*>(mScratch.data()), mScratch.size());
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mStats.framesWritten++;
+}
+
+FramePtr HostRecorder::withParameterSets(const FramePtr& keyframe) const
+{
+	const FramePtr parameterSets = mSource->parameterSets(keyframe->streamIndex);
+	if (!parameterSets)
+		return nullptr;
+	auto combined = std::make_shared<EncodedFrame>(*keyframe);
+	combined->payload.insert(combined->payload.begin(), parameterSets->payload.begin(), parameterSets->payload.end());
+	return combined;
+}
+
+void HostRecorder::writeFragment(const CmafFragment& fragment)
+{
+	if (mFile >= 0 && fragment.timestamp < mLastTimestamp)
+	{
+		// The camera clock restarted; decode times would run backwards in this file.
+		closeFile();
+	}
+	mLastTimestamp = fragment.timestamp;
+
+	// A changed init segment (new parameter sets) needs a new file; the moov of the open one no longer applies.
+	const int64_t roll = static_cast<int64_t>(mConfig.rollSeconds * TIMESTAMP_HZ);
+	if (fragment.independent && (mFile < 0 || fragment.timestamp - mFileStart >= roll || fragment.init != mFileInit))
+	{
+		closeFile();
+		if (openFile(fragment.timestamp))
+		{
+			mFileInit = fragment.init;
+			appendToBlock(reinterpret_cast<const uint8_t*>(mFileInit->data()), mFileInit->size());
+		}
+	}
+	if (mFile < 0)
+		return;
+
+	appendToBlock(reinterpret_cast<const uint8_t*>(fragment.data->data()), fragment.data->size());
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mStats.framesWritten += fragment.frames;
+}
+
+bool HostRecorder::openFile(int64_t timestamp)
+{
+	const std::string stamp = Utils::fileTimestamp();
+	const std::string name = mConfig.filePrefix + "_" + stamp + "_" + std::to_string(mFiles.size()) +
+							 (mConfig.format == Format::Mp4 ? ".mp4" : ".ts");
+	const std::string path = (std::filesystem::path(mConfig.directory) / name).string();
+
+	const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+	mDirect = mConfig.directIo;
+	mFile = mDirect ? ::open(path.c_str(), flags | O_DIRECT, 0644) : -1;
+	if (mFile < 0)
+	{
+		mDirect = false;
+		mFile = ::open(path.c_str(), flags, 0644);
+	}
+	if (mFile < 0)
+	{
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mStats.writeErrors++;
+		return false;
+	}
+
+	// Reserve the extents up front so the filesystem does not allocate (and fragment) on every block write.
+	// KEEP_SIZE leaves the visible size alone; closeFile() trims whatever was not used.
+	if (mConfig.preallocateBytes != 0)
+	{
+		::fallocate(mFile, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(mConfig.preallocateBytes));
+	}
+
+	if (mConfig.format == Format::Ts)
+		mMuxer = std::make_unique<TsMuxer>(mCodec);
+	mFileBytes = 0;
+	mFileStart = timestamp;
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mFiles.push_back(path);
+	mStats.files++;
+	return true;
+}
+
+void HostRecorder::closeFile()
+{
+	if (mFile < 0)
+		return;
+	flushBlock();
+	// Releases the preallocated space past the end of the data.
+	::ftruncate(mFile, static_cast<off_t>(mFileBytes));
+	::close(mFile);
+	mFile = -1;
+	mFileInit.reset();
+}
+
+void HostRecorder::appendToBlock(const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		const size_t chunk = std::min(size, mConfig.blockBytes - mBlock.used);
+		std::memcpy(mBlock.data + mBlock.used, data, chunk);
+		mBlock.used += chunk;
+		data += chunk;
+		size -= chunk;
+		if (mBlock.used == mConfig.blockBytes)
+		{
+			flushBlock();
+		}
+	}
+}
+
+void HostRecorder::flushBlock()
+{
+	if (mBlock.used == 0 || mFile < 0)
+		return;
+
+	if (mDirect && mBlock.used % IO_ALIGNMENT != 0)
+	{
+		// Only the last block of a file is partial; O_DIRECT cannot write it, so finish the file buffered.
+		::fcntl(mFile, F_SETFL, ::fcntl(mFile, F_GETFL) & ~O_DIRECT);
+		mDirect = false;
+	}
+
+	const auto started = std::chrono::steady_clock::now();
+	size_t offset = 0;
+	bool failed = false;
+	while (offset < mBlock.used)
+	{
+		const ssize_t written = ::pwrite(mFile, mBlock.data + offset, mBlock.used - offset, static_cast<off_t>(mFileBytes + offset));
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EINVAL && mDirect)
+			{
+				// Some filesystems accept O_DIRECT at open time and refuse it on write.
+				::fcntl(mFile, F_SETFL, ::fcntl(mFile, F_GETFL) & ~O_DIRECT);
+				mDirect = false;
+				continue;
+			}
+			failed = true;
+			break;
+		}
+		offset += written;
+	}
+	const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+	mFileBytes += offset;
+	mBlock.used = 0;
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mStats.bytesWritten += offset;
+	mStats.maxWriteMs = std::max(mStats.maxWriteMs, elapsedMs);
+	if (failed)
+		mStats.writeErrors++;
+}
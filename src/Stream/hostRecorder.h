@@ -0,0 +1,116 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cmafFragmenter.h"
+#include "fragmentQueue.h"
+#include "frameQueue.h"
+#include "gopCache.h"
+#include "tsMuxer.h"
+
+namespace Letico
+{
+	// Records the live stream on the host as rolling MPEG-TS or fragmented MP4 files. The delegate thread only
+	// queues shared pointers (frames, or the fragments CmafFragmenter already muxed for HLS), so a stalled disk
+	// drops to the next keyframe instead of blocking; a writer thread per recorder copies them into large
+	// page-aligned blocks and writes whole blocks, optionally with O_DIRECT, into files preallocated with
+	// fallocate. Files roll at the first keyframe after `rollSeconds` of stream time, and at the first one after the
+	// camera clock restarted.
+	class HostRecorder
+	{
+	public:
+		enum class Format
+		{
+			Ts,
+			Mp4	 // init segment up front, then one moof + mdat per GOP; playable up to the last fragment after a crash
+		};
+
+		struct Config
+		{
+			std::string directory;
+			Format format = Format::Ts;
+			std::string filePrefix = "host";
+			int streamIndex = 0;
+			double rollSeconds = 600.0;
+			size_t blockBytes = 4 * 1024 * 1024;		   // write size, multiple of 4096
+			size_t preallocateBytes = 1024 * 1024 * 1024;  // per file; 0 disables fallocate
+			bool directIo = true;						   // falls back to buffered I/O where O_DIRECT is refused
+			FrameQueue::Config queue{1024, 256 * 1024 * 1024};
+		};
+
+		struct Stats
+		{
+			bool recording = false;
+			uint64_t framesWritten = 0;
+			uint64_t bytesWritten = 0;
+			uint64_t files = 0;
+			uint64_t writeErrors = 0;
+			double maxWriteMs = 0.0;  // slowest single block write
+			FrameQueue::Stats queue;
+		};
+
+		// `fragmenter` is required for Format::Mp4.
+		HostRecorder(Config config, std::shared_ptr<GopCache> source, std::shared_ptr<CmafFragmenter> fragmenter = nullptr);
+		~HostRecorder();
+
+		// Starts recording from the next keyframe (or the cached one). Returns false if already recording or if
+		// MP4 output has no fragmenter to read from.
+		bool start(ins_camera::VideoEncodeType codec);
+		// Flushes and closes the current file; returns every file written since start().
+		std::vector<std::string> stop();
+
+		Stats getStats() const;
+		const Config& config() const { return mConfig; }
+
+	private:
+		struct AlignedBlock
+		{
+			uint8_t* data = nullptr;
+			size_t used = 0;
+		};
+
+		void writerLoop();
+		void writeFrame(const FramePtr& frame);
+		// The keyframe behind the parameter sets GopCache last saw for its stream; null while there are none.
+		FramePtr withParameterSets(const FramePtr& keyframe) const;
+		void writeFragment(const CmafFragment& fragment);
+		bool openFile(int64_t timestamp);
+		void closeFile();
+		void appendToBlock(const uint8_t* data, size_t size);
+		void flushBlock();
+
+		Config mConfig;
+		std::shared_ptr<GopCache> mSource;
+		std::shared_ptr<CmafFragmenter> mFragmenter;
+		std::shared_ptr<FrameQueue> mQueue;
+		std::shared_ptr<FragmentQueue> mFragmentQueue;
+		std::mutex mControlMutex;  // start and stop come from different HTTP worker threads
+		std::thread mWriterThread;
+		std::atomic<bool> mRunning{false};
+		ins_camera::VideoEncodeType mCodec = ins_camera::VideoEncodeType::H264;
+
+		// Writer thread state.
+		std::unique_ptr<TsMuxer> mMuxer;
+		SharedBuffer mFileInit;	 // MP4: init segment at the head of the open file
+		std::string mScratch;  // one muxed frame, copied into the block
+		AlignedBlock mBlock;
+		int mFile = -1;
+		bool mDirect = false;
+		uint64_t mFileBytes = 0;
+		int64_t mFileStart = 0;
+		int64_t mLastTimestamp = 0;	 // of the last frame or fragment; one older than this means the clock restarted
+
+		mutable std::mutex mStatsMutex;
+		Stats mStats;
+		std::vector<std::string> mFiles;
+	};
+}
@@ -0,0 +1,227 @@
+#include "leticoStreamDelegate.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+using namespace Letico;
+
+namespace
+{
+	constexpr size_t AUDIO_RING_BYTES = 1024 * 1024;
+	constexpr size_t GYRO_RING_BYTES = 2 * 1024 * 1024;
+	constexpr size_t EXPOSURE_RING_BYTES = 64 * 1024;
+	// Upper bound of records taken from one ring before the others get a turn.
+	constexpr int DRAIN_BATCH = 64;
+
+	// When the SDK called, not when the consumer got to the record: the queue and slow sinks would skew the clock.
+	AudioClock::Clock::time_point arrivalOf(const FrameRing::RecordHeader& record)
+	{
+		return AudioClock::Clock::time_point(std::chrono::nanoseconds(record.arrivalNs));
+	}
+}
+
+LeticoStreamDelegate::LeticoStreamDelegate(size_t videoRingBytes):
+	LeticoStreamDelegate(videoRingBytes, AudioConfig(), FramePool::Config())
+{
+}
+
+LeticoStreamDelegate::LeticoStreamDelegate(size_t videoRingBytes, AudioConfig audio, FramePool::Config pool):
+	mVideoRing(videoRingBytes),
+	mAudioRing(AUDIO_RING_BYTES),
+	mGyroRing(GYRO_RING_BYTES),
+	mExposureRing(EXPOSURE_RING_BYTES),
+	mAdtsFramer(audio.format),
+	mAudioClock(audio.clock),
+	mFramePool(std::move(pool)),
+	mAudioFormat(audio.format)
+{
+	mConsumerThread = std::thread([this] { consumerLoop(); });
+}
+
+LeticoStreamDelegate::~LeticoStreamDelegate()
+{
+	mRunning.store(false, std::memory_order_release);
+	wakeConsumer();
+	if (mConsumerThread.joinable())
+		mConsumerThread.join();
+}
+
+void LeticoStreamDelegate::OnAudioData(const uint8_t* data, size_t size, int64_t timestamp)
+{
+	if (mAudioRing.push(FrameRing::RecordKind::Audio, data, size, timestamp, FrameRing::nowNs()))
+		wakeConsumer();
+}
+
+void LeticoStreamDelegate::OnVideoData(const uint8_t* data, size_t size, int64_t timestamp, uint8_t streamType, int stream_index)
+{
+	if (mVideoRing.push(FrameRing::RecordKind::Video, data, size, timestamp, FrameRing::nowNs(), streamType, stream_index))
+		wakeConsumer();
+}
+
+void LeticoStreamDelegate::OnGyroData(const std::vector<ins_camera::GyroData>& data)
+{
+	if (data.empty())
+		return;
+	const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+	const size_t size = data.size() * sizeof(ins_camera::GyroData);
+	if (mGyroRing.push(FrameRing::RecordKind::Gyro, bytes, size, data.front().timestamp, FrameRing::nowNs()))
+		wakeConsumer();
+}
+
+void LeticoStreamDelegate::OnExposureData(const ins_camera::ExposureData& data)
+{
+	const auto* bytes = reinterpret_cast<const uint8_t*>(&data);
+	const int64_t timestamp = static_cast<int64_t>(data.timestamp);
+	if (mExposureRing.push(FrameRing::RecordKind::Exposure, bytes, sizeof(data), timestamp, FrameRing::nowNs()))
+		wakeConsumer();
+}
+
+void LeticoStreamDelegate::setLrvStreamType(int streamType)
+{
+	mLrvStreamType.store(streamType, std::memory_order_relaxed);
+}
+
+void LeticoStreamDelegate::resetAudioClock()
+{
+	mAudioClock.reset();
+}
+
+void LeticoStreamDelegate::addSink(std::shared_ptr<StreamSink> sink)
+{
+	std::lock_guard<std::mutex> lock(mSinksMutex);
+	mSinks.push_back(std::move(sink));
+}
+
+void LeticoStreamDelegate::removeSink(const std::shared_ptr<StreamSink>& sink)
+{
+	std::lock_guard<std::mutex> lock(mSinksMutex);
+	mSinks.erase(std::remove(mSinks.begin(), mSinks.end(), sink), mSinks.end());
+}
+
+LeticoStreamDelegate::Stats LeticoStreamDelegate::getStats() const
+{
+	Stats stats{mVideoRing.getStats(), mAudioRing.getStats(), mGyroRing.getStats(), mExposureRing.getStats()};
+	stats.audioClock = mAudioClock.getStats();
+	stats.framePool = mFramePool.getStats();
+	std::lock_guard<std::mutex> lock(mAudioFormatMutex);
+	stats.audioFormat = mAudioFormat;
+	return stats;
+}
+
+void LeticoStreamDelegate::wakeConsumer()
+{
+	mWakeSequence.fetch_add(1, std::memory_order_release);
+	mWakeSequence.notify_one();
+}
+
+void LeticoStreamDelegate::consumerLoop()
+{
+	while (true)
+	{
+		const uint32_t sequence = mWakeSequence.load(std::memory_order_acquire);
+		bool busy = drain(mVideoRing);
+		busy |= drain(mAudioRing);
+		busy |= drain(mGyroRing);
+		busy |= drain(mExposureRing);
+		if (busy)
+			continue;
+		if (!mRunning.load(std::memory_order_acquire))
+			break;
+		mWakeSequence.wait(sequence, std::memory_order_acquire);
+	}
+}
+
+bool LeticoStreamDelegate::drain(FrameRing& ring)
+{
+	int taken = 0;
+	while (taken < DRAIN_BATCH)
+	{
+		const FrameRing::RecordHeader* record = ring.peek();
+		if (record == nullptr)
+			break;
+		dispatch(*record);
+		ring.pop();
+		taken++;
+	}
+	return taken != 0;
+}
+
+void LeticoStreamDelegate::dispatch(const FrameRing::RecordHeader& record)
+{
+	std::lock_guard<std::mutex> lock(mSinksMutex);
+	if (mSinks.empty())
+		return;
+
+	switch (record.kind)
+	{
+	case FrameRing::RecordKind::Video:
+	{
+		mAudioClock.onVideo(record.timestamp, arrivalOf(record));
+		// One copy out of the ring, then the same immutable frame is shared by every sink.
+		auto frame = mFramePool.acquire(record.size);
+		frame->kind = FrameKind::Video;
+		frame->timestamp = record.timestamp;
+		frame->streamType = record.streamType;
+		frame->streamIndex = record.streamIndex;
+		if (record.streamType == mLrvStreamType.load(std::memory_order_relaxed))
+			frame->streamIndex += LRV_STREAM_INDEX;
+		frame->payload.assign(record.payload(), record.payload() + record.size);
+		FramePtr shared = std::move(frame);
+		for (const auto& sink : mSinks)
+			sink->onVideoFrame(shared);
+		break;
+	}
+	case FrameRing::RecordKind::Audio:
+		dispatchAudio(record);
+		break;
+	case FrameRing::RecordKind::Gyro:
+	{
+		const auto* samples = reinterpret_cast<const ins_camera::GyroData*>(record.payload());
+		const size_t count = record.size / sizeof(ins_camera::GyroData);
+		for (const auto& sink : mSinks)
+			sink->onGyroData(samples, count);
+		break;
+	}
+	case FrameRing::RecordKind::Exposure:
+	{
+		const auto* exposure = reinterpret_cast<const ins_camera::ExposureData*>(record.payload());
+		for (const auto& sink : mSinks)
+			sink->onExposureData(*exposure);
+		break;
+	}
+	case FrameRing::RecordKind::Padding:
+		break;
+	}
+}
+
+void LeticoStreamDelegate::dispatchAudio(const FrameRing::RecordHeader& record)
+{
+	mAccessUnits.clear();
+	mAdtsFramer.split(record.payload(), record.size, mAccessUnits);
+	if (mAdtsFramer.config() != mAudioFormat)
+	{
+		std::lock_guard<std::mutex> lock(mAudioFormatMutex);
+		mAudioFormat = mAdtsFramer.config();
+	}
+
+	const auto arrival = arrivalOf(record);
+	for (size_t i = 0; i < mAccessUnits.size(); i++)
+	{
+		const auto& unit = mAccessUnits[i];
+		int64_t timestamp = 0;
+		if (!mAudioClock.rebase(record.timestamp + mAdtsFramer.durationOf(i), arrival, timestamp))
+			continue;
+		auto frame = mFramePool.acquire(AdtsFramer::HEADER_SIZE + unit.size);
+		frame->kind = FrameKind::Audio;
+		frame->timestamp = timestamp;
+		frame->streamType = record.streamType;
+		frame->streamIndex = record.streamIndex;
+		frame->payload.resize(AdtsFramer::HEADER_SIZE + unit.size);
+		mAdtsFramer.writeHeader(frame->payload.data(), unit.size);
+		std::copy(unit.data, unit.data + unit.size, frame->payload.data() + AdtsFramer::HEADER_SIZE);
+		FramePtr shared = std::move(frame);
+		for (const auto& sink : mSinks)
+			sink->onAudioFrame(shared);
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_delegate.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "adtsFramer.h"
+#include "audioClock.h"
+#include "framePool.h"
+#include "frameRing.h"
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Production stream delegate. The SDK callbacks only copy their payload into preallocated lock-free rings and
+	// return; a dedicated consumer thread drains the rings and hands shared frames to the registered sinks.
+	// Every callback kind gets its own ring, so the single-producer contract holds even if the SDK invokes
+	// video, audio and telemetry callbacks from different threads.
+	//
+	// Frames are copied into buffers recycled from a size-class pool, so ingestion does not allocate at frame rate.
+	// Audio leaves the delegate as single ADTS frames (7-byte header, no CRC) stamped on the video clock. Audio that
+	// arrives before the first video frame is dropped.
+	class LeticoStreamDelegate : public ins_camera::StreamDelegate
+	{
+	public:
+		struct AudioConfig
+		{
+			AdtsFramer::Config format;	// until the camera sends ADTS headers of its own
+			AudioClock::Config clock;
+		};
+
+		struct Stats
+		{
+			FrameRing::Stats video;
+			FrameRing::Stats audio;
+			FrameRing::Stats gyro;
+			FrameRing::Stats exposure;
+			AudioClock::Stats audioClock;
+			FramePool::Stats framePool;
+			AdtsFramer::Config audioFormat;
+		};
+
+		static constexpr size_t DEFAULT_VIDEO_RING_BYTES = 32 * 1024 * 1024;
+
+		explicit LeticoStreamDelegate(size_t videoRingBytes = DEFAULT_VIDEO_RING_BYTES);
+		LeticoStreamDelegate(size_t videoRingBytes, AudioConfig audio, FramePool::Config pool);
+		~LeticoStreamDelegate();
+
+		void OnAudioData(const uint8_t* data, size_t size, int64_t timestamp) override;
+		void OnVideoData(const uint8_t* data, size_t size, int64_t timestamp, uint8_t streamType, int stream_index = 0) override;
+		void OnGyroData(const std::vector<ins_camera::GyroData>& data) override;
+		void OnExposureData(const ins_camera::ExposureData& data) override;
+
+		// Video frames the SDK tags with `streamType` are the LRV stream and get LRV_STREAM_INDEX added to their
+		// stream index; -1 (the default) leaves every frame as delivered.
+		void setLrvStreamType(int streamType);
+		// Starts audio rebasing over for a new camera stream session.
+		void resetAudioClock();
+
+		void addSink(std::shared_ptr<StreamSink> sink);
+		void removeSink(const std::shared_ptr<StreamSink>& sink);
+
+		Stats getStats() const;
+
+	private:
+		void consumerLoop();
+		bool drain(FrameRing& ring);
+		void dispatch(const FrameRing::RecordHeader& record);
+		void dispatchAudio(const FrameRing::RecordHeader& record);
+		void wakeConsumer();
+
+		FrameRing mVideoRing;
+		FrameRing mAudioRing;
+		FrameRing mGyroRing;
+		FrameRing mExposureRing;
+
+		std::atomic<uint32_t> mWakeSequence{0};
+		std::atomic<bool> mRunning{true};
+		std::atomic<int> mLrvStreamType{-1};
+		std::thread mConsumerThread;
+
+		std::mutex mSinksMutex;
+		std::vector<std::shared_ptr<StreamSink>> mSinks;
+
+		// Consumer thread only, apart from the stats.
+		AdtsFramer mAdtsFramer;
+		AudioClock mAudioClock;
+		FramePool mFramePool;
+		std::vector<AdtsFramer::AccessUnit> mAccessUnits;
+		mutable std::mutex mAudioFormatMutex;
+		AdtsFramer::Config mAudioFormat;
+	};
+}
@@ -0,0 +1,243 @@
+#include "motionTrigger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+using namespace Letico;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	// Four-lane float vector in the GCC/Clang vector extension: SSE on x86, NEON on ARM, no intrinsics needed.
+	typedef float Float4 __attribute__((vector_size(16)));
+
+	// Sum of x^2 + y^2 + z^2 over three columns. The vector accumulator is what lets the compiler keep four lanes
+	// in flight; a scalar float reduction is never vectorized without -ffast-math.
+	float sumOfSquares(const float* x, const float* y, const float* z, size_t count)
+	{
+		Float4 accumulator = {0.0f, 0.0f, 0.0f, 0.0f};
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			Float4 a, b, c;
+			std::memcpy(&a, x + i, sizeof(a));
+			std::memcpy(&b, y + i, sizeof(b));
+			std::memcpy(&c, z + i, sizeof(c));
+			accumulator += a * a + b * b + c * c;
+		}
+		float sum = accumulator[0] + accumulator[1] + accumulator[2] + accumulator[3];
+		for (; i < count; i++)
+		{
+			sum += x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+		}
+		return sum;
+	}
+
+	double elapsedMs(Clock::time_point from, Clock::time_point to)
+	{
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	}
+}
+
+MotionTrigger::MotionTrigger(Config config, std::function<bool()> start, std::function<void()> stop):
+	mConfig(config),
+	mStart(std::move(start)),
+	mStop(std::move(stop)),
+	mX(WINDOW_CAPACITY),
+	mY(WINDOW_CAPACITY),
+	mZ(WINDOW_CAPACITY),
+	mTimestamps(WINDOW_CAPACITY)
+{
+	mStats.enabled = config.enabled;
+	mActionThread = std::thread(&MotionTrigger::actionLoop, this);
+}
+
+MotionTrigger::~MotionTrigger()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+	}
+	mCommandReady.notify_all();
+	mActionThread.join();
+}
+
+void MotionTrigger::setEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mConfig.enabled = enabled;
+	mStats.enabled = enabled;
+	mAboveSince = -1;
+	mBelowSince = -1;
+	if (!enabled && mRecording)
+	{
+		requestLocked(Command::Stop);
+	}
+}
+
+void MotionTrigger::onExposureData(const ins_camera::ExposureData& data)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.exposure = data.exposure_time;
+	mHaveExposure = true;
+}
+
+void MotionTrigger::onGyroData(const ins_camera::GyroData* samples, size_t count)
+{
+	if (count == 0)
+		return;
+
+	const auto arrival = Clock::now();
+	std::lock_guard<std::mutex> lock(mMutex);
+	const float scale = static_cast<float>(mConfig.gyroScale);
+	for (size_t i = 0; i < count; i++)
+	{
+		const size_t slot = (mHead + mSize) % WINDOW_CAPACITY;
+		mX[slot] = static_cast<float>(samples[i].gx) * scale;
+		mY[slot] = static_cast<float>(samples[i].gy) * scale;
+		mZ[slot] = static_cast<float>(samples[i].gz) * scale;
+		mTimestamps[slot] = samples[i].timestamp;
+		if (mSize < WINDOW_CAPACITY)
+			mSize++;
+		else
+			mHead = (mHead + 1) % WINDOW_CAPACITY;
+	}
+	// Age out everything older than the window (or from before a clock restart).
+	const int64_t now = samples[count - 1].timestamp;
+	const int64_t windowMs = static_cast<int64_t>(mConfig.windowMs);
+	while (mSize > 1 && (now - mTimestamps[mHead] >= windowMs || mTimestamps[mHead] > now))
+	{
+		mHead = (mHead + 1) % WINDOW_CAPACITY;
+		mSize--;
+	}
+
+	const double rms = windowRmsLocked();
+	mStats.motionRms = rms;
+	if (!mConfig.enabled)
+		return;
+
+	if (!mRecording)
+	{
+		if (rms < mConfig.startRms)
+		{
+			mAboveSince = -1;
+			return;
+		}
+		if (mAboveSince < 0)
+		{
+			mAboveSince = now;
+			mOnsetArrival = arrival;
+		}
+		if (now - mAboveSince < static_cast<int64_t>(mConfig.startHoldMs))
+			return;
+		if (mConfig.maxExposure > 0.0 && mHaveExposure && mStats.exposure > mConfig.maxExposure)
+		{
+			mStats.suppressedByExposure++;
+			mAboveSince = -1;
+			return;
+		}
+		mRecording = true;
+		mRecordingSince = now;
+		mBelowSince = -1;
+		requestLocked(Command::Start);
+		return;
+	}
+
+	if (rms >= mConfig.stopRms)
+	{
+		mBelowSince = -1;
+		return;
+	}
+	if (mBelowSince < 0)
+	{
+		mBelowSince = now;
+	}
+	const bool quietLongEnough = now - mBelowSince >= static_cast<int64_t>(mConfig.stopHoldSeconds * TIMESTAMP_HZ);
+	const bool recordedLongEnough = now - mRecordingSince >= static_cast<int64_t>(mConfig.minRecordSeconds * TIMESTAMP_HZ);
+	if (quietLongEnough && recordedLongEnough)
+	{
+		requestLocked(Command::Stop);
+	}
+}
+
+double MotionTrigger::windowRmsLocked() const
+{
+	if (mSize == 0)
+		return 0.0;
+	// At most two contiguous runs when the window wraps the end of the ring.
+	const size_t firstRun = std::min(mSize, WINDOW_CAPACITY - mHead);
+	float sum = sumOfSquares(mX.data() + mHead, mY.data() + mHead, mZ.data() + mHead, firstRun);
+	sum += sumOfSquares(mX.data(), mY.data(), mZ.data(), mSize - firstRun);
+	return std::sqrt(static_cast<double>(sum) / static_cast<double>(mSize));
+}
+
+void MotionTrigger::requestLocked(Command command)
+{
+	if (command == Command::Stop)
+	{
+		mRecording = false;
+		mAboveSince = -1;
+		if (mCommand == Command::Start)
+		{
+			// The start was never issued; there is nothing to stop.
+			mCommand = Command::None;
+			return;
+		}
+	}
+	mCommand = command;
+	mCommandReady.notify_one();
+}
+
+void MotionTrigger::actionLoop()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mCommandReady.wait(lock, [this] { return mCommand != Command::None || !mRunning; });
+		if (!mRunning)
+			break;
+
+		const Command command = std::exchange(mCommand, Command::None);
+		const auto onset = mOnsetArrival;
+		lock.unlock();
+		if (command == Command::Start)
+		{
+			const auto issued = Clock::now();
+			const bool started = mStart();
+			const auto returned = Clock::now();
+			lock.lock();
+			mStats.lastStartCallMs = elapsedMs(issued, returned);
+			if (started)
+			{
+				mStats.starts++;
+				mStats.lastLatencyMs = elapsedMs(onset, issued);
+				mStats.maxLatencyMs = std::max(mStats.maxLatencyMs, mStats.lastLatencyMs);
+				mStats.averageLatencyMs += (mStats.lastLatencyMs - mStats.averageLatencyMs) / static_cast<double>(mStats.starts);
+			}
+			else
+			{
+				mStats.failedStarts++;
+				// Back to idle so the next motion retries; a stop queued meanwhile has nothing to stop.
+				mCommand = Command::None;
+				mRecording = false;
+				mAboveSince = -1;
+			}
+			mStats.recording = mRecording && started;
+		}
+		else
+		{
+			mStop();
+			lock.lock();
+			mStats.stops++;
+			mStats.recording = false;
+		}
+	}
+}
+
+MotionTrigger::Stats MotionTrigger::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Starts and stops camera recording from the live gyro stream. Motion is the RMS angular rate over a sliding
+	// window; recording starts once it has stayed above `startRms` for `startHoldMs` and stops once it has stayed
+	// below `stopRms` for `stopHoldSeconds` (two thresholds, so a steady shake near one level does not toggle).
+	// With `maxExposure` set, starts are also held back while the exposure time says the scene is too dark.
+	//
+	// Decisions are made on the delegate consumer thread; the start/stop actions are SDK calls that can take
+	// seconds, so they run on the trigger's own thread and never stall the stream.
+	class MotionTrigger : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			bool enabled = false;
+			double windowMs = 200.0;
+			double startRms = 0.5;	// rad/s
+			double stopRms = 0.2;	// rad/s
+			double startHoldMs = 100.0;
+			double stopHoldSeconds = 5.0;
+			double minRecordSeconds = 3.0;
+			double maxExposure = 0.0;  // seconds; 0 = ignore exposure
+			double gyroScale = 1.0;	   // gyro units to rad/s
+		};
+
+		struct Stats
+		{
+			bool enabled = false;
+			bool recording = false;	 // a recording started by the trigger is running
+			double motionRms = 0.0;
+			double exposure = 0.0;
+			uint64_t starts = 0;
+			uint64_t stops = 0;
+			uint64_t failedStarts = 0;
+			uint64_t suppressedByExposure = 0;
+			// Reaction latency: from the arrival of the gyro batch that first crossed startRms to the start action
+			// being issued. Includes startHoldMs by design.
+			double lastLatencyMs = 0.0;
+			double averageLatencyMs = 0.0;
+			double maxLatencyMs = 0.0;
+			double lastStartCallMs = 0.0;  // how long the start action itself took
+		};
+
+		// `start` returns false if recording could not be started.
+		MotionTrigger(Config config, std::function<bool()> start, std::function<void()> stop);
+		~MotionTrigger();
+		MotionTrigger(const MotionTrigger&) = delete;
+		MotionTrigger& operator=(const MotionTrigger&) = delete;
+
+		// Disabling while a triggered recording runs stops it.
+		void setEnabled(bool enabled);
+
+		void onGyroData(const ins_camera::GyroData* samples, size_t count) override;
+		void onExposureData(const ins_camera::ExposureData& data) override;
+
+		Stats getStats() const;
+
+	private:
+		enum class Command
+		{
+			None,
+			Start,
+			Stop
+		};
+
+		static constexpr size_t WINDOW_CAPACITY = 4096;	 // samples; windows longer than this are cut
+
+		double windowRmsLocked() const;
+		void requestLocked(Command command);
+		void actionLoop();
+
+		Config mConfig;
+		std::function<bool()> mStart;
+		std::function<void()> mStop;
+
+		mutable std::mutex mMutex;
+		std::condition_variable mCommandReady;
+		Command mCommand = Command::None;
+		bool mRunning = true;
+		std::thread mActionThread;
+
+		// Sliding window, one column per axis so the RMS kernel runs over contiguous floats.
+		std::vector<float> mX;
+		std::vector<float> mY;
+		std::vector<float> mZ;
+		std::vector<int64_t> mTimestamps;
+		size_t mHead = 0;
+		size_t mSize = 0;
+
+		bool mRecording = false;  // desired state; the action thread catches up
+		int64_t mAboveSince = -1;  // gyro timestamp, -1 when below the threshold
+		int64_t mBelowSince = -1;
+		int64_t mRecordingSince = 0;
+		std::chrono::steady_clock::time_point mOnsetArrival;
+		bool mHaveExposure = false;
+		Stats mStats;
+	};
+}
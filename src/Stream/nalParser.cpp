@@ -0,0 +1,367 @@
+#include "nalParser.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LETICO_NAL_X86 1
+#endif
+
+using namespace Letico;
+
+namespace
+{
+	const uint8_t* findScalar(const uint8_t* begin, const uint8_t* end)
+	{
+		const uint8_t* p = begin;
+		while (end - p >= 3)
+		{
+			// A start code can only begin at p, p+1 or p+2 if p[2] is 0, or 1 for one at p itself.
+			if (p[2] == 0)
+			{
+				p++;
+			}
+			else if (p[2] == 1 && p[1] == 0 && p[0] == 0)
+			{
+				return p;
+			}
+			else
+			{
+				p += 3;
+			}
+		}
+		return end;
+	}
+
+#ifdef LETICO_NAL_X86
+	// Both vector kernels compare three overlapping loads (p, p+1, p+2) against 00 00 01, so a start code that
+	// straddles two blocks is still found at its first byte. The tail shorter than a block plus two bytes goes to
+	// the scalar search. Compiled with target attributes: the binary keeps its baseline ISA and dispatches at runtime.
+	__attribute__((target("sse2"))) const uint8_t* findSse2(const uint8_t* begin, const uint8_t* end)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi8(1);
+		const uint8_t* p = begin;
+		while (end - p >= 16 + 2)
+		{
+			const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+			const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+			const __m128i match =
+				_mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)), _mm_cmpeq_epi8(b2, one));
+			const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(match));
+			if (mask != 0)
+				return p + __builtin_ctz(mask);
+			p += 16;
+		}
+		return findScalar(p, end);
+	}
+
+	__attribute__((target("avx2"))) const uint8_t* findAvx2(const uint8_t* begin, const uint8_t* end)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i one = _mm256_set1_epi8(1);
+		const uint8_t* p = begin;
+		while (end - p >= 32 + 2)
+		{
+			const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+			const __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+			const __m256i match = _mm256_and_si256(
+				_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)), _mm256_cmpeq_epi8(b2, one)
+			);
+			const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(match));
+			if (mask != 0)
+				return p + __builtin_ctz(mask);
+			p += 32;
+		}
+		return findSse2(p, end);
+	}
+#endif
+
+	using FindFunction = const uint8_t* (*)(const uint8_t*, const uint8_t*);
+
+	FindFunction kernelFunction(NalParser::ScanKernel kernel)
+	{
+#ifdef LETICO_NAL_X86
+		if (NalParser::isSupported(kernel))
+		{
+			if (kernel == NalParser::ScanKernel::Avx2)
+				return findAvx2;
+			if (kernel == NalParser::ScanKernel::Sse2)
+				return findSse2;
+		}
+#endif
+		return findScalar;
+	}
+
+	// Exp-Golomb reader over a slice header in place: skips emulation prevention bytes as it goes instead of
+	// copying the RBSP out first. Only the first few bytes of a slice are ever read.
+	class HeaderReader
+	{
+	public:
+		HeaderReader(const uint8_t* data, size_t size): mData(data), mSize(size) {}
+
+		uint32_t bit()
+		{
+			if (mBit == 0)
+			{
+				if (!loadByte())
+				{
+					overrun = true;
+					return 0;
+				}
+				mBit = 8;
+			}
+			mBit--;
+			return (mByte >> mBit) & 1;
+		}
+
+		uint32_t ue()
+		{
+			int leadingZeros = 0;
+			while (bit() == 0)
+			{
+				if (overrun || ++leadingZeros > 31)
+				{
+					overrun = true;
+					return 0;
+				}
+			}
+			uint32_t value = 0;
+			for (int i = 0; i < leadingZeros; i++)
+			{
+				value = (value << 1) | bit();
+			}
+			return ((1u << leadingZeros) - 1) + value;
+		}
+
+		bool overrun = false;
+
+	private:
+		bool loadByte()
+		{
+			if (mPosition < mSize && mZeros >= 2 && mData[mPosition] == 0x03)
+			{
+				mPosition++;
+				mZeros = 0;
+			}
+			if (mPosition >= mSize)
+				return false;
+			mByte = mData[mPosition++];
+			mZeros = mByte == 0 ? mZeros + 1 : 0;
+			return true;
+		}
+
+		const uint8_t* mData;
+		size_t mSize;
+		size_t mPosition = 0;
+		int mZeros = 0;
+		uint8_t mByte = 0;
+		int mBit = 0;
+	};
+}
+
+NalScanner::NalScanner(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec):
+	mStart(NalParser::findStartCode(data, data + size)),
+	mEnd(data + size),
+	mCodec(codec)
+{
+}
+
+bool NalScanner::next(NalUnit& nal)
+{
+	while (mStart != mEnd)
+	{
+		const uint8_t* begin = mStart + 3;
+		const uint8_t* next = NalParser::findStartCode(begin, mEnd);
+		const uint8_t* end = next;
+		// Zero bytes in front of the next start code belong to it (4-byte start codes, trailing_zero_8bits).
+		while (end > begin && end[-1] == 0)
+		{
+			end--;
+		}
+		mStart = next;
+		if (end > begin)
+		{
+			nal = {begin, static_cast<size_t>(end - begin), NalParser::nalType(mCodec, begin)};
+			return true;
+		}
+	}
+	return false;
+}
+
+const uint8_t* NalParser::findStartCode(const uint8_t* begin, const uint8_t* end)
+{
+	static const FindFunction find = kernelFunction(bestKernel());
+	return find(begin, end);
+}
+
+const uint8_t* NalParser::findStartCode(const uint8_t* begin, const uint8_t* end, ScanKernel kernel)
+{
+	return kernelFunction(kernel)(begin, end);
+}
+
+bool NalParser::isSupported(ScanKernel kernel)
+{
+	switch (kernel)
+	{
+	case ScanKernel::Scalar:
+		return true;
+#ifdef LETICO_NAL_X86
+	case ScanKernel::Sse2:
+		return __builtin_cpu_supports("sse2");
+	case ScanKernel::Avx2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+NalParser::ScanKernel NalParser::bestKernel()
+{
+	if (isSupported(ScanKernel::Avx2))
+		return ScanKernel::Avx2;
+	if (isSupported(ScanKernel::Sse2))
+		return ScanKernel::Sse2;
+	return ScanKernel::Scalar;
+}
+
+const char* NalParser::kernelName(ScanKernel kernel)
+{
+	switch (kernel)
+	{
+	case ScanKernel::Scalar:
+		return "scalar";
+	case ScanKernel::Sse2:
+		return "sse2";
+	case ScanKernel::Avx2:
+		return "avx2";
+	}
+	return "unknown";
+}
+
+size_t NalParser::split(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec, std::vector<NalUnit>& out)
+{
+	NalScanner scanner(data, size, codec);
+	NalUnit nal;
+	size_t found = 0;
+	while (scanner.next(nal))
+	{
+		out.push_back(nal);
+		found++;
+	}
+	return found;
+}
+
+uint8_t NalParser::nalType(ins_camera::VideoEncodeType codec, const uint8_t* nalHeader)
+{
+	if (codec == ins_camera::VideoEncodeType::H265)
+	{
+		return (nalHeader[0] >> 1) & 0x3f;
+	}
+	return nalHeader[0] & 0x1f;
+}
+
+bool NalParser::isKeyframe(ins_camera::VideoEncodeType codec, uint8_t type)
+{
+	if (codec == ins_camera::VideoEncodeType::H265)
+	{
+		// IRAP pictures: BLA_W_LP .. CRA_NUT (IDR_W_RADL and IDR_N_LP included).
+		return type >= H265_BLA_W_LP && type <= H265_CRA;
+	}
+	return type == H264_IDR;
+}
+
+bool NalParser::isParameterSet(ins_camera::VideoEncodeType codec, uint8_t type)
+{
+	if (codec == ins_camera::VideoEncodeType::H265)
+	{
+		return type == H265_VPS || type == H265_SPS || type == H265_PPS;
+	}
+	return type == H264_SPS || type == H264_PPS;
+}
+
+bool NalParser::isAccessUnitDelimiter(ins_camera::VideoEncodeType codec, uint8_t type)
+{
+	return codec == ins_camera::VideoEncodeType::H265 ? type == H265_AUD : type == H264_AUD;
+}
+
+bool NalParser::isSlice(ins_camera::VideoEncodeType codec, uint8_t type)
+{
+	if (codec == ins_camera::VideoEncodeType::H265)
+	{
+		// TRAIL_N .. RASL_R and the IRAP types; the reserved VCL types in between carry no slices.
+		return type <= 9 || (type >= H265_BLA_W_LP && type <= H265_CRA);
+	}
+	return type >= H264_SLICE && type <= H264_IDR;
+}
+
+bool NalParser::parseSlice(ins_camera::VideoEncodeType codec, const NalUnit& nal, SliceInfo& info)
+{
+	info = SliceInfo();
+	if (!isSlice(codec, nal.type))
+		return false;
+
+	if (codec == ins_camera::VideoEncodeType::H265)
+	{
+		if (nal.size < 3)
+			return false;
+		HeaderReader reader(nal.data + 2, nal.size - 2);
+		info.firstInPicture = reader.bit() != 0;
+		if (nal.type >= H265_BLA_W_LP && nal.type <= H265_RSV_IRAP_23)
+		{
+			reader.bit();  // no_output_of_prior_pics_flag
+		}
+		reader.ue();  // slice_pic_parameter_set_id
+		if (info.firstInPicture)
+		{
+			static const SliceType TYPES[] = {SliceType::B, SliceType::P, SliceType::I};
+			const uint32_t sliceType = reader.ue();
+			if (reader.overrun || sliceType > 2)
+				return false;
+			info.type = TYPES[sliceType];
+		}
+		return !reader.overrun;
+	}
+
+	if (nal.size < 2)
+		return false;
+	HeaderReader reader(nal.data + 1, nal.size - 1);
+	info.firstInPicture = reader.ue() == 0;	 // first_mb_in_slice
+	static const SliceType TYPES[] = {SliceType::P, SliceType::B, SliceType::I, SliceType::P, SliceType::I};
+	const uint32_t sliceType = reader.ue();
+	if (reader.overrun || sliceType > 9)
+		return false;
+	info.type = TYPES[sliceType % 5];
+	return true;
+}
+
+bool NalParser::containsKeyframe(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec)
+{
+	return inspect(data, size, codec).keyframe;
+}
+
+FrameContents NalParser::inspect(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec)
+{
+	// Only NAL headers are needed, so the search resumes right behind each one instead of at the unit's end.
+	FrameContents contents;
+	const uint8_t* end = data + size;
+	const uint8_t* start = findStartCode(data, end);
+	while (start != end)
+	{
+		const uint8_t* nal = start + 3;
+		if (nal < end)
+		{
+			const uint8_t type = nalType(codec, nal);
+			if (isSlice(codec, type))
+			{
+				contents.slices = true;
+				contents.keyframe = isKeyframe(codec, type);
+				break;
+			}
+			contents.parameterSets |= isParameterSet(codec, type);
+		}
+		start = findStartCode(nal, end);
+	}
+	return contents;
+}
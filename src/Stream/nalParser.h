@@ -0,0 +1,115 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Letico
+{
+	// View of one NAL unit inside an Annex-B buffer. `data` points at the NAL header (the start code is not
+	// included) and stays valid only as long as the buffer it was parsed from.
+	struct NalUnit
+	{
+		const uint8_t* data;
+		size_t size;
+		uint8_t type;
+	};
+
+	enum class SliceType : uint8_t
+	{
+		Unknown,
+		P,	// includes H.264 SP
+		B,
+		I	// includes H.264 SI
+	};
+
+	// The start of a slice header, read in place.
+	struct SliceInfo
+	{
+		SliceType type = SliceType::Unknown;
+		bool firstInPicture = false;  // first_mb_in_slice == 0 / first_slice_segment_in_pic_flag
+	};
+
+	// What a frame carries, read from its NAL headers up to the first slice; parameter sets and the other non-VCL
+	// units of an access unit come before its slices.
+	struct FrameContents
+	{
+		bool keyframe = false;
+		bool parameterSets = false;	 // in front of the first slice
+		bool slices = false;  // false: parameter sets or other non-VCL units only
+	};
+
+	// Walks the NAL units of an Annex-B buffer without copying or allocating; the loop behind split().
+	class NalScanner
+	{
+	public:
+		NalScanner(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec);
+
+		// False once the buffer is exhausted.
+		bool next(NalUnit& nal);
+
+	private:
+		const uint8_t* mStart;	// start code of the next unit, or mEnd
+		const uint8_t* mEnd;
+		ins_camera::VideoEncodeType mCodec;
+	};
+
+	class NalParser
+	{
+	public:
+		// Start code search implementations. findStartCode() uses the fastest one the CPU supports.
+		enum class ScanKernel
+		{
+			Scalar,
+			Sse2,
+			Avx2
+		};
+
+		// Returns the first `00 00 01` start code in [begin, end) or `end` if there is none.
+		static const uint8_t* findStartCode(const uint8_t* begin, const uint8_t* end);
+		// Same with a given kernel; one the CPU does not support falls back to the scalar search.
+		static const uint8_t* findStartCode(const uint8_t* begin, const uint8_t* end, ScanKernel kernel);
+		static bool isSupported(ScanKernel kernel);
+		static ScanKernel bestKernel();
+		static const char* kernelName(ScanKernel kernel);
+
+		// Appends every NAL unit of an Annex-B buffer to `out`; returns the number of units found.
+		static size_t split(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec, std::vector<NalUnit>& out);
+
+		static uint8_t nalType(ins_camera::VideoEncodeType codec, const uint8_t* nalHeader);
+		static bool isKeyframe(ins_camera::VideoEncodeType codec, uint8_t type);
+		static bool isParameterSet(ins_camera::VideoEncodeType codec, uint8_t type);
+		static bool isAccessUnitDelimiter(ins_camera::VideoEncodeType codec, uint8_t type);
+		// Coded slice (VCL) NAL unit types.
+		static bool isSlice(ins_camera::VideoEncodeType codec, uint8_t type);
+
+		// Reads slice_type from a slice NAL unit without copying it. False for other NAL units or a truncated
+		// header. H.265 slice_type is only known for the first slice segment of a picture (later ones need the
+		// PPS to parse) and assumes num_extra_slice_header_bits == 0, which is what encoders emit.
+		static bool parseSlice(ins_camera::VideoEncodeType codec, const NalUnit& nal, SliceInfo& info);
+
+		// Convenience check used by consumers that only need to know whether a frame starts a GOP. Stops at the
+		// first slice: every slice of a picture has the same NAL type, so the rest of the frame is not scanned.
+		static bool containsKeyframe(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec);
+		// Same scan, for consumers that also need to tell parameter sets sent on their own from a picture.
+		static FrameContents inspect(const uint8_t* data, size_t size, ins_camera::VideoEncodeType codec);
+
+		// H.264 nal_unit_type values used by the pipeline.
+		static constexpr uint8_t H264_SLICE = 1;
+		static constexpr uint8_t H264_IDR = 5;
+		static constexpr uint8_t H264_SPS = 7;
+		static constexpr uint8_t H264_PPS = 8;
+		static constexpr uint8_t H264_AUD = 9;
+
+		// H.265 nal_unit_type values used by the pipeline.
+		static constexpr uint8_t H265_BLA_W_LP = 16;
+		static constexpr uint8_t H265_CRA = 21;
+		static constexpr uint8_t H265_RSV_IRAP_23 = 23;
+		static constexpr uint8_t H265_VPS = 32;
+		static constexpr uint8_t H265_SPS = 33;
+		static constexpr uint8_t H265_PPS = 34;
+		static constexpr uint8_t H265_AUD = 35;
+	};
+}
@@ -0,0 +1,122 @@
+#include "orientationEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Letico;
+
+namespace
+{
+	// Gaps longer than this (stream restarts, dropped batches) are not integrated across.
+	constexpr double MAX_STEP_SECONDS = 0.1;
+
+	// One Madgwick IMU step (S. Madgwick, "An efficient orientation filter for inertial and inertial/magnetic
+	// sensor arrays", 2010). Branch-free apart from the zero-acceleration guard, no allocation.
+	void madgwickStep(OrientationEstimator::Attitude& q, double gx, double gy, double gz, double ax, double ay, double az, double beta, double dt)
+	{
+		double qDotW = 0.5 * (-q.x * gx - q.y * gy - q.z * gz);
+		double qDotX = 0.5 * (q.w * gx + q.y * gz - q.z * gy);
+		double qDotY = 0.5 * (q.w * gy - q.x * gz + q.z * gx);
+		double qDotZ = 0.5 * (q.w * gz + q.x * gy - q.y * gx);
+
+		const double norm = ax * ax + ay * ay + az * az;
+		if (norm > 0.0)
+		{
+			const double inverse = 1.0 / std::sqrt(norm);
+			ax *= inverse;
+			ay *= inverse;
+			az *= inverse;
+
+			// Gradient of the error between measured and predicted gravity.
+			const double w2 = 2.0 * q.w, x2 = 2.0 * q.x, y2 = 2.0 * q.y, z2 = 2.0 * q.z;
+			const double w4 = 4.0 * q.w, x4 = 4.0 * q.x, y4 = 4.0 * q.y;
+			const double x8 = 8.0 * q.x, y8 = 8.0 * q.y;
+			const double ww = q.w * q.w, xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+			const double sW = w4 * yy + y2 * ax + w4 * xx - x2 * ay;
+			const double sX = x4 * zz - z2 * ax + 4.0 * ww * q.x - w2 * ay - x4 + x8 * xx + x8 * yy + x4 * az;
+			const double sY = 4.0 * ww * q.y + w2 * ax + y4 * zz - z2 * ay - y4 + y8 * xx + y8 * yy + y4 * az;
+			const double sZ = 4.0 * xx * q.z - x2 * ax + 4.0 * yy * q.z - y2 * ay;
+			const double sNorm = sW * sW + sX * sX + sY * sY + sZ * sZ;
+			if (sNorm > 0.0)
+			{
+				const double step = beta / std::sqrt(sNorm);
+				qDotW -= step * sW;
+				qDotX -= step * sX;
+				qDotY -= step * sY;
+				qDotZ -= step * sZ;
+			}
+		}
+
+		q.w += qDotW * dt;
+		q.x += qDotX * dt;
+		q.y += qDotY * dt;
+		q.z += qDotZ * dt;
+		const double inverse = 1.0 / std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+		q.w *= inverse;
+		q.x *= inverse;
+		q.y *= inverse;
+		q.z *= inverse;
+	}
+}
+
+OrientationEstimator::OrientationEstimator(Config config):
+	mConfig(config),
+	mHistoryInterval(std::max<int64_t>(1, static_cast<int64_t>(TIMESTAMP_HZ / std::max(config.historyHz, 1e-3))))
+{
+}
+
+void OrientationEstimator::reset()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mAttitude = Attitude();
+	mHasTimestamp = false;
+	mHistory.clear();
+}
+
+void OrientationEstimator::onGyroData(const ins_camera::GyroData* samples, size_t count)
+{
+	if (count == 0)
+		return;
+
+	const size_t maxHistory = static_cast<size_t>(mConfig.historySeconds * mConfig.historyHz) + 1;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		Attitude attitude = mAttitude;
+		for (size_t i = 0; i < count; i++)
+		{
+			const auto& sample = samples[i];
+			const double dt = mHasTimestamp ? static_cast<double>(sample.timestamp - attitude.timestamp) / TIMESTAMP_HZ : 0.0;
+			if (dt > 0.0 && dt <= MAX_STEP_SECONDS)
+			{
+				const double scale = mConfig.gyroScale;
+				madgwickStep(attitude, sample.gx * scale, sample.gy * scale, sample.gz * scale, sample.ax, sample.ay, sample.az, mConfig.beta, dt);
+			}
+			attitude.timestamp = sample.timestamp;
+			mHasTimestamp = true;
+
+			if (mHistory.empty() || attitude.timestamp - mHistory.back().timestamp >= mHistoryInterval || attitude.timestamp < mHistory.back().timestamp)
+			{
+				mHistory.push_back(attitude);
+				if (mHistory.size() > maxHistory)
+					mHistory.pop_front();
+			}
+		}
+		mAttitude = attitude;
+		mUpdates++;
+	}
+	mUpdated.notify_all();
+}
+
+uint64_t OrientationEstimator::waitForUpdate(uint64_t after, std::chrono::milliseconds timeout, Attitude& attitude) const
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mUpdated.wait_for(lock, timeout, [&] { return mUpdates > after; });
+	attitude = mAttitude;
+	return mUpdates;
+}
+
+std::vector<OrientationEstimator::Attitude> OrientationEstimator::history() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return std::vector<Attitude>(mHistory.begin(), mHistory.end());
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Live attitude of one camera from its own gyro stream: a Madgwick IMU filter (gyro integration corrected
+	// towards the measured gravity vector) stepped once per GyroData sample on the delegate consumer thread.
+	// The quaternion rotates the IMU frame into an earth frame whose z axis is up; with no magnetometer, yaw is
+	// relative to where the stream started and drifts slowly.
+	class OrientationEstimator : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			double beta = 0.05;			 // accelerometer correction gain; 0 = pure gyro integration
+			double gyroScale = 1.0;		 // gyro units to rad/s
+			double historySeconds = 2.0;
+			double historyHz = 100.0;	 // attitudes kept in the history, decimated from the gyro rate
+		};
+
+		struct Attitude
+		{
+			int64_t timestamp = 0;	// gyro clock, milliseconds
+			double w = 1.0;
+			double x = 0.0;
+			double y = 0.0;
+			double z = 0.0;
+		};
+
+		explicit OrientationEstimator(Config config);
+
+		// Restarts from the identity attitude and clears the history.
+		void reset();
+
+		void onGyroData(const ins_camera::GyroData* samples, size_t count) override;
+
+		// Blocks until the attitude is newer than update `after` or the timeout passes; returns the latest update
+		// number and fills `attitude`. Update 0 means no gyro data has arrived yet.
+		uint64_t waitForUpdate(uint64_t after, std::chrono::milliseconds timeout, Attitude& attitude) const;
+		std::vector<Attitude> history() const;
+
+	private:
+		Config mConfig;
+		int64_t mHistoryInterval;  // ms between history entries
+
+		mutable std::mutex mMutex;
+		mutable std::condition_variable mUpdated;
+		Attitude mAttitude;
+		bool mHasTimestamp = false;
+		uint64_t mUpdates = 0;
+		std::deque<Attitude> mHistory;
+	};
+}
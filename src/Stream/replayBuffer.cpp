@@ -0,0 +1,154 @@
+#include "replayBuffer.h"
+
+#include <fstream>
+
+#include "nalParser.h"
+#include "tsMuxer.h"
+
+using namespace Letico;
+
+namespace
+{
+	// The muxed file is flushed to disk in pieces of about this size instead of being built whole in memory.
+	constexpr size_t WRITE_CHUNK_BYTES = 4 * 1024 * 1024;
+	constexpr int64_t PTS_OFFSET = MPEG_CLOCK_HZ;
+}
+
+ReplayBuffer::ReplayBuffer(Config config): mConfig(config)
+{
+}
+
+void ReplayBuffer::start(ins_camera::VideoEncodeType codec)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCodec = codec;
+	clearLocked();
+}
+
+void ReplayBuffer::onVideoFrame(const FramePtr& frame)
+{
+	if (frame->streamIndex != mConfig.streamIndex)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mFrames.empty() && frame->timestamp < mFrames.back().frame->timestamp)
+	{
+		// The camera clock restarted; a window spanning both clocks would trim by the wrong age and save PTS that
+		// run backwards.
+		clearLocked();
+	}
+	const bool keyframe = NalParser::containsKeyframe(frame->data(), frame->size(), mCodec);
+	if (mFrames.empty() && !keyframe)
+		return;
+
+	mFrames.push_back({frame, keyframe});
+	mBytes += frame->size();
+	if (keyframe)
+	{
+		mKeyframeTimestamps.push_back(frame->timestamp);
+	}
+	trimLocked();
+}
+
+void ReplayBuffer::trimLocked()
+{
+	const int64_t window = static_cast<int64_t>(mConfig.maxSeconds * TIMESTAMP_HZ);
+	while (!mFrames.empty())
+	{
+		// The oldest GOP goes once the GOPs after it still cover the window, or when memory runs over.
+		const bool overBudget = mBytes > mConfig.maxBytes;
+		const bool coveredWithout = mKeyframeTimestamps.size() >= 2 && mFrames.back().frame->timestamp - mKeyframeTimestamps[1] >= window;
+		if (!overBudget && !coveredWithout)
+			break;
+
+		if (mKeyframeTimestamps.size() < 2)
+		{
+			// A single GOP larger than the cap: none of it is usable without its keyframe, start over.
+			mFrames.clear();
+			mKeyframeTimestamps.clear();
+			mBytes = 0;
+			break;
+		}
+
+		mKeyframeTimestamps.pop_front();
+		do
+		{
+			mBytes -= mFrames.front().frame->size();
+			mFrames.pop_front();
+		} while (!mFrames.empty() && !mFrames.front().keyframe);
+	}
+}
+
+void ReplayBuffer::clearLocked()
+{
+	mFrames.clear();
+	mKeyframeTimestamps.clear();
+	mBytes = 0;
+}
+
+ReplayBuffer::Snapshot ReplayBuffer::snapshot(double seconds) const
+{
+	Snapshot snapshot;
+	std::lock_guard<std::mutex> lock(mMutex);
+	snapshot.codec = mCodec;
+	if (mFrames.empty())
+		return snapshot;
+
+	const int64_t from = mFrames.back().frame->timestamp - static_cast<int64_t>(seconds * TIMESTAMP_HZ);
+	size_t first = 0;
+	for (size_t i = mFrames.size(); i-- > 0;)
+	{
+		if (mFrames[i].keyframe && mFrames[i].frame->timestamp <= from)
+		{
+			first = i;
+			break;
+		}
+	}
+
+	snapshot.frames.assign(mFrames.begin() + first, mFrames.end());
+	for (const auto& entry : snapshot.frames)
+	{
+		snapshot.bytes += entry.frame->size();
+	}
+	snapshot.duration = static_cast<double>(mFrames.back().frame->timestamp - mFrames[first].frame->timestamp) / TIMESTAMP_HZ;
+	return snapshot;
+}
+
+double ReplayBuffer::bufferedSeconds() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mFrames.empty())
+		return 0.0;
+	return static_cast<double>(mFrames.back().frame->timestamp - mFrames.front().frame->timestamp) / TIMESTAMP_HZ;
+}
+
+bool ReplayBuffer::writeTransportStream(const Snapshot& snapshot, const std::string& path)
+{
+	if (snapshot.frames.empty())
+		return false;
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	TsMuxer muxer(snapshot.codec);
+	std::string out;
+	out.reserve(WRITE_CHUNK_BYTES + WRITE_CHUNK_BYTES / 4);
+	const int64_t firstTimestamp = snapshot.frames.front().frame->timestamp;
+	for (const auto& entry : snapshot.frames)
+	{
+		if (entry.keyframe)
+		{
+			// Repeat PAT/PMT at every keyframe so players can seek within the file.
+			muxer.writeTables(out);
+		}
+		const int64_t pts = (entry.frame->timestamp - firstTimestamp) * MPEG_CLOCK_HZ / TIMESTAMP_HZ + PTS_OFFSET;
+		muxer.writeVideo(out, entry.frame->data(), entry.frame->size(), pts, entry.keyframe);
+		if (out.size() >= WRITE_CHUNK_BYTES)
+		{
+			file.write(out.data(), out.size());
+			out.clear();
+		}
+	}
+	file.write(out.data(), out.size());
+	return file.good();
+}
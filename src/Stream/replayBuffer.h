@@ -0,0 +1,71 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Instant replay: a time-bounded window of the live stream kept in memory, so "save what just happened" is a
+	// snapshot instead of a camera-side record/stop/download cycle. The window always starts on a keyframe and is
+	// trimmed a whole GOP at a time, by age and by a memory cap. Fed by GopCache, which puts the parameter sets in
+	// front of every keyframe, so any GOP a snapshot starts on decodes.
+	class ReplayBuffer : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			double maxSeconds = 30.0;
+			size_t maxBytes = 256 * 1024 * 1024;
+			int streamIndex = 0;
+		};
+
+		struct ReplayFrame
+		{
+			FramePtr frame;
+			bool keyframe;
+		};
+
+		struct Snapshot
+		{
+			std::vector<ReplayFrame> frames;  // starts on a keyframe
+			ins_camera::VideoEncodeType codec = ins_camera::VideoEncodeType::H264;
+			double duration = 0.0;	// seconds
+			size_t bytes = 0;
+		};
+
+		explicit ReplayBuffer(Config config);
+
+		// Clears the window for a new live session. The window is kept after the session ends so it can still be
+		// saved. A frame older than the newest one (a camera clock restart) clears it too.
+		void start(ins_camera::VideoEncodeType codec);
+
+		void onVideoFrame(const FramePtr& frame) override;
+
+		// Frames covering at least the last `seconds` (from the keyframe at or before that point), or everything
+		// buffered. Only shared pointers are copied under the lock, so ingestion is never held up by a save.
+		Snapshot snapshot(double seconds) const;
+		double bufferedSeconds() const;
+
+		// Muxes a snapshot into an MPEG-TS file; returns false if the file could not be written.
+		static bool writeTransportStream(const Snapshot& snapshot, const std::string& path);
+
+	private:
+		void trimLocked();
+		void clearLocked();
+
+		Config mConfig;
+		mutable std::mutex mMutex;
+		ins_camera::VideoEncodeType mCodec = ins_camera::VideoEncodeType::H264;
+		std::deque<ReplayFrame> mFrames;
+		std::deque<int64_t> mKeyframeTimestamps;  // one per GOP in the window, oldest first
+		size_t mBytes = 0;
+	};
+}
@@ -0,0 +1,113 @@
+#include "rtpPacketizer.h"
+
+#include <algorithm>
+
+using namespace Letico;
+
+namespace
+{
+	constexpr uint8_t H264_FU_A = 28;
+	constexpr uint8_t H265_FU = 49;
+	constexpr uint8_t FU_START = 0x80;
+	constexpr uint8_t FU_END = 0x40;
+}
+
+RtpPacketizer::RtpPacketizer(ins_camera::VideoEncodeType codec, uint32_t ssrc, uint16_t initialSequence, size_t maxPacketSize):
+	mCodec(codec),
+	mSsrc(ssrc),
+	mSequence(initialSequence),
+	mMaxPayload(maxPacketSize - RTP_HEADER_SIZE)
+{
+}
+
+size_t RtpPacketizer::packetize(const uint8_t* data, size_t size, uint32_t rtpTimestamp, const PacketCallback& emit)
+{
+	mNals.clear();
+	NalParser::split(data, size, mCodec, mNals);
+	mNals.erase(
+		std::remove_if(mNals.begin(), mNals.end(), [this](const NalUnit& nal) { return NalParser::isAccessUnitDelimiter(mCodec, nal.type); }),
+		mNals.end()
+	);
+
+	const bool h265 = mCodec == ins_camera::VideoEncodeType::H265;
+	const size_t nalHeaderSize = h265 ? 2 : 1;
+	uint8_t header[MAX_HEADER_SIZE];
+	size_t packets = 0;
+
+	for (size_t i = 0; i < mNals.size(); i++)
+	{
+		const NalUnit& nal = mNals[i];
+		const bool lastNal = i + 1 == mNals.size();
+		if (nal.size <= nalHeaderSize)
+			continue;
+
+		if (nal.size <= mMaxPayload)
+		{
+			if (!emitPacket(header, 0, nal.data, nal.size, rtpTimestamp, lastNal, emit))
+				return packets;
+			packets++;
+			continue;
+		}
+
+		// Fragmentation unit: the NAL header is replaced by the FU indicator/payload header and the FU header,
+		// which carries the original type and the start/end flags.
+		size_t payloadHeaderSize;
+		uint8_t* fuHeader;
+		if (h265)
+		{
+			header[RTP_HEADER_SIZE] = static_cast<uint8_t>((nal.data[0] & 0x81) | (H265_FU << 1));
+			header[RTP_HEADER_SIZE + 1] = nal.data[1];
+			fuHeader = header + RTP_HEADER_SIZE + 2;
+			*fuHeader = nal.type;
+			payloadHeaderSize = 3;
+		}
+		else
+		{
+			header[RTP_HEADER_SIZE] = static_cast<uint8_t>((nal.data[0] & 0xe0) | H264_FU_A);
+			fuHeader = header + RTP_HEADER_SIZE + 1;
+			*fuHeader = nal.type;
+			payloadHeaderSize = 2;
+		}
+
+		const size_t fragmentSize = mMaxPayload - payloadHeaderSize;
+		const uint8_t* fragment = nal.data + nalHeaderSize;
+		const uint8_t* end = nal.data + nal.size;
+		bool first = true;
+		while (fragment < end)
+		{
+			const size_t length = std::min(fragmentSize, static_cast<size_t>(end - fragment));
+			const bool lastFragment = fragment + length == end;
+			*fuHeader = static_cast<uint8_t>(nal.type | (first ? FU_START : 0) | (lastFragment ? FU_END : 0));
+			if (!emitPacket(header, payloadHeaderSize, fragment, length, rtpTimestamp, lastNal && lastFragment, emit))
+				return packets;
+			packets++;
+			fragment += length;
+			first = false;
+		}
+	}
+	return packets;
+}
+
+bool RtpPacketizer::emitPacket(
+	uint8_t* header, size_t payloadHeaderSize, const uint8_t* payload, size_t payloadSize, uint32_t rtpTimestamp, bool marker,
+	const PacketCallback& emit
+)
+{
+	header[0] = 0x80;  // version 2, no padding, extension or CSRCs
+	header[1] = static_cast<uint8_t>((marker ? 0x80 : 0x00) | PAYLOAD_TYPE);
+	header[2] = static_cast<uint8_t>(mSequence >> 8);
+	header[3] = static_cast<uint8_t>(mSequence);
+	header[4] = static_cast<uint8_t>(rtpTimestamp >> 24);
+	header[5] = static_cast<uint8_t>(rtpTimestamp >> 16);
+	header[6] = static_cast<uint8_t>(rtpTimestamp >> 8);
+	header[7] = static_cast<uint8_t>(rtpTimestamp);
+	header[8] = static_cast<uint8_t>(mSsrc >> 24);
+	header[9] = static_cast<uint8_t>(mSsrc >> 16);
+	header[10] = static_cast<uint8_t>(mSsrc >> 8);
+	header[11] = static_cast<uint8_t>(mSsrc);
+
+	mSequence++;
+	mPacketCount++;
+	mOctetCount += static_cast<uint32_t>(payloadHeaderSize + payloadSize);
+	return emit(header, RTP_HEADER_SIZE + payloadHeaderSize, payload, payloadSize);
+}
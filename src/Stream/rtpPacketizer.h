@@ -0,0 +1,58 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "nalParser.h"
+
+namespace Letico
+{
+	// Turns Annex-B access units into RTP packets: RFC 6184 for H.264 (single NAL unit packets and FU-A) and
+	// RFC 7798 for H.265 (single NAL unit packets and FU). The payload of every packet points into the caller's
+	// buffer; only the RTP header and the one to three fragmentation bytes are produced here, so the transport
+	// can send each packet as a two-part gather write without copying the NAL data.
+	class RtpPacketizer
+	{
+	public:
+		static constexpr uint8_t PAYLOAD_TYPE = 96;
+		static constexpr uint32_t CLOCK_RATE = 90000;
+		// RTP header + payload; leaves room for IP/UDP headers and interleaving inside a 1500 byte MTU.
+		static constexpr size_t DEFAULT_MAX_PACKET_SIZE = 1400;
+		static constexpr size_t RTP_HEADER_SIZE = 12;
+		static constexpr size_t MAX_HEADER_SIZE = RTP_HEADER_SIZE + 3;
+
+		// Receives one packet as `header` (RTP header and payload header) followed by `payload`. Returning false
+		// stops packetizing the current access unit.
+		using PacketCallback = std::function<bool(const uint8_t* header, size_t headerSize, const uint8_t* payload, size_t payloadSize)>;
+
+		RtpPacketizer(ins_camera::VideoEncodeType codec, uint32_t ssrc, uint16_t initialSequence, size_t maxPacketSize = DEFAULT_MAX_PACKET_SIZE);
+
+		// Packetizes one access unit; the marker bit is set on its last packet. Access unit delimiters are not
+		// sent, RTP already delimits access units. Returns the number of packets emitted.
+		size_t packetize(const uint8_t* data, size_t size, uint32_t rtpTimestamp, const PacketCallback& emit);
+
+		uint32_t ssrc() const { return mSsrc; }
+		uint16_t nextSequence() const { return mSequence; }
+		// Totals for RTCP sender reports.
+		uint32_t packetCount() const { return mPacketCount; }
+		uint32_t octetCount() const { return mOctetCount; }
+
+	private:
+		bool emitPacket(
+			uint8_t* header, size_t payloadHeaderSize, const uint8_t* payload, size_t payloadSize, uint32_t rtpTimestamp, bool marker,
+			const PacketCallback& emit
+		);
+
+		ins_camera::VideoEncodeType mCodec;
+		uint32_t mSsrc;
+		uint16_t mSequence;
+		size_t mMaxPayload;
+		uint32_t mPacketCount = 0;
+		uint32_t mOctetCount = 0;
+		std::vector<NalUnit> mNals;
+	};
+}
@@ -0,0 +1,307 @@
+#include "spsParser.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace Letico;
+
+namespace
+{
+	// Reads RBSP bits; reading past the end sets `overrun` and yields zeros instead of failing on every call.
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* nal, size_t size)
+		{
+			// Drop emulation prevention bytes (00 00 03 -> 00 00).
+			mRbsp.reserve(size);
+			int zeros = 0;
+			for (size_t i = 0; i < size; i++)
+			{
+				if (zeros >= 2 && nal[i] == 0x03)
+				{
+					zeros = 0;
+					continue;
+				}
+				zeros = nal[i] == 0 ? zeros + 1 : 0;
+				mRbsp.push_back(nal[i]);
+			}
+		}
+
+		uint32_t bits(int count)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < count; i++)
+			{
+				value = (value << 1) | bit();
+			}
+			return value;
+		}
+
+		uint32_t bit()
+		{
+			if (mPosition >= mRbsp.size() * 8)
+			{
+				overrun = true;
+				return 0;
+			}
+			const uint32_t value = (mRbsp[mPosition / 8] >> (7 - mPosition % 8)) & 1;
+			mPosition++;
+			return value;
+		}
+
+		void skip(size_t count) { mPosition += count; }
+
+		uint32_t ue()
+		{
+			int leadingZeros = 0;
+			while (bit() == 0)
+			{
+				if (overrun || ++leadingZeros > 31)
+				{
+					overrun = true;
+					return 0;
+				}
+			}
+			return ((1u << leadingZeros) - 1) + bits(leadingZeros);
+		}
+
+		int32_t se()
+		{
+			const uint32_t value = ue();
+			return (value & 1) ? static_cast<int32_t>((value + 1) / 2) : -static_cast<int32_t>(value / 2);
+		}
+
+		// Byte-aligned copy of RBSP bytes, used for the fixed-length profile_tier_level header.
+		bool copyBytes(uint8_t* out, size_t count)
+		{
+			if (mPosition % 8 != 0 || mPosition / 8 + count > mRbsp.size())
+				return false;
+			for (size_t i = 0; i < count; i++)
+			{
+				out[i] = mRbsp[mPosition / 8 + i];
+			}
+			mPosition += count * 8;
+			return true;
+		}
+
+		bool overrun = false;
+
+	private:
+		std::vector<uint8_t> mRbsp;
+		size_t mPosition = 0;
+	};
+
+	void skipScalingList(BitReader& reader, int size)
+	{
+		int32_t lastScale = 8;
+		int32_t nextScale = 8;
+		for (int i = 0; i < size && nextScale != 0; i++)
+		{
+			nextScale = (lastScale + reader.se() + 256) % 256;
+			lastScale = nextScale == 0 ? lastScale : nextScale;
+		}
+	}
+
+	// Crop units per chroma_format_idc (SubWidthC, SubHeightC); monochrome crops in luma samples.
+	void chromaSubsampling(uint8_t chromaFormat, uint32_t& subWidth, uint32_t& subHeight)
+	{
+		subWidth = chromaFormat == 1 || chromaFormat == 2 ? 2 : 1;
+		subHeight = chromaFormat == 1 ? 2 : 1;
+	}
+
+	bool parseH264(BitReader& reader, VideoFormat& format)
+	{
+		reader.skip(8);	 // NAL header
+		format.profile = static_cast<uint8_t>(reader.bits(8));
+		format.constraints = static_cast<uint8_t>(reader.bits(8));
+		format.level = static_cast<uint8_t>(reader.bits(8));
+		reader.ue();  // seq_parameter_set_id
+
+		bool separateColourPlanes = false;
+		switch (format.profile)
+		{
+			case 100:
+			case 110:
+			case 122:
+			case 244:
+			case 44:
+			case 83:
+			case 86:
+			case 118:
+			case 128:
+			case 138:
+			case 139:
+			case 134:
+			case 135:
+			{
+				format.chromaFormat = static_cast<uint8_t>(reader.ue());
+				if (format.chromaFormat == 3)
+				{
+					separateColourPlanes = reader.bit() != 0;
+				}
+				format.bitDepthLuma = static_cast<uint8_t>(reader.ue() + 8);
+				format.bitDepthChroma = static_cast<uint8_t>(reader.ue() + 8);
+				reader.bit();  // qpprime_y_zero_transform_bypass_flag
+				if (reader.bit())
+				{
+					const int lists = format.chromaFormat == 3 ? 12 : 8;
+					for (int i = 0; i < lists; i++)
+					{
+						if (reader.bit())
+						{
+							skipScalingList(reader, i < 6 ? 16 : 64);
+						}
+					}
+				}
+				break;
+			}
+			default:
+				break;
+		}
+
+		reader.ue();  // log2_max_frame_num_minus4
+		const uint32_t pocType = reader.ue();
+		if (pocType == 0)
+		{
+			reader.ue();
+		}
+		else if (pocType == 1)
+		{
+			reader.bit();
+			reader.se();
+			reader.se();
+			const uint32_t cycle = reader.ue();
+			for (uint32_t i = 0; i < cycle && !reader.overrun; i++)
+			{
+				reader.se();
+			}
+		}
+		reader.ue();   // max_num_ref_frames
+		reader.bit();  // gaps_in_frame_num_value_allowed_flag
+		const uint32_t widthInMbs = reader.ue() + 1;
+		const uint32_t heightInMapUnits = reader.ue() + 1;
+		const uint32_t frameMbsOnly = reader.bit();
+		if (!frameMbsOnly)
+		{
+			reader.bit();  // mb_adaptive_frame_field_flag
+		}
+		reader.bit();  // direct_8x8_inference_flag
+
+		uint32_t cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+		if (reader.bit())
+		{
+			cropLeft = reader.ue();
+			cropRight = reader.ue();
+			cropTop = reader.ue();
+			cropBottom = reader.ue();
+		}
+
+		uint32_t cropUnitX = 1;
+		uint32_t cropUnitY = 2 - frameMbsOnly;
+		if (format.chromaFormat != 0 && !separateColourPlanes)
+		{
+			uint32_t subWidth, subHeight;
+			chromaSubsampling(format.chromaFormat, subWidth, subHeight);
+			cropUnitX = subWidth;
+			cropUnitY *= subHeight;
+		}
+		format.width = widthInMbs * 16 - cropUnitX * (cropLeft + cropRight);
+		format.height = (2 - frameMbsOnly) * heightInMapUnits * 16 - cropUnitY * (cropTop + cropBottom);
+		return !reader.overrun;
+	}
+
+	bool parseH265(BitReader& reader, VideoFormat& format)
+	{
+		reader.skip(16);  // NAL header
+		reader.bits(4);	  // sps_video_parameter_set_id
+		format.maxSubLayers = static_cast<uint8_t>(reader.bits(3) + 1);
+		format.temporalIdNested = reader.bit() != 0;
+
+		if (!reader.copyBytes(format.profileTierLevel, sizeof(format.profileTierLevel)))
+			return false;
+		std::vector<bool> profilePresent(format.maxSubLayers), levelPresent(format.maxSubLayers);
+		for (int i = 0; i < format.maxSubLayers - 1; i++)
+		{
+			profilePresent[i] = reader.bit() != 0;
+			levelPresent[i] = reader.bit() != 0;
+		}
+		if (format.maxSubLayers > 1)
+		{
+			reader.skip(2 * (9 - format.maxSubLayers));	 // reserved_zero_2bits up to 8 sub-layers
+		}
+		for (int i = 0; i < format.maxSubLayers - 1; i++)
+		{
+			reader.skip((profilePresent[i] ? 88 : 0) + (levelPresent[i] ? 8 : 0));
+		}
+
+		reader.ue();  // sps_seq_parameter_set_id
+		format.chromaFormat = static_cast<uint8_t>(reader.ue());
+		if (format.chromaFormat == 3)
+		{
+			reader.bit();  // separate_colour_plane_flag
+		}
+		format.width = reader.ue();
+		format.height = reader.ue();
+		if (reader.bit())
+		{
+			uint32_t subWidth, subHeight;
+			chromaSubsampling(format.chromaFormat, subWidth, subHeight);
+			const uint32_t left = reader.ue(), right = reader.ue(), top = reader.ue(), bottom = reader.ue();
+			format.width -= subWidth * (left + right);
+			format.height -= subHeight * (top + bottom);
+		}
+		format.bitDepthLuma = static_cast<uint8_t>(reader.ue() + 8);
+		format.bitDepthChroma = static_cast<uint8_t>(reader.ue() + 8);
+		return !reader.overrun;
+	}
+}
+
+bool SpsParser::parse(ins_camera::VideoEncodeType codec, const uint8_t* nal, size_t size, VideoFormat& format)
+{
+	BitReader reader(nal, size);
+	format.codec = codec;
+	return codec == ins_camera::VideoEncodeType::H265 ? parseH265(reader, format) : parseH264(reader, format);
+}
+
+std::string VideoFormat::codecString() const
+{
+	char buffer[64];
+	if (codec != ins_camera::VideoEncodeType::H265)
+	{
+		std::snprintf(buffer, sizeof(buffer), "avc1.%02x%02x%02x", profile, constraints, level);
+		return buffer;
+	}
+
+	// ISO/IEC 14496-15 E.3: profile space letter + profile, bit-reversed compatibility flags, tier + level,
+	// then the constraint bytes without trailing zero bytes.
+	static const char* const SPACES[] = {"", "A", "B", "C"};
+	const uint8_t space = profileTierLevel[0] >> 6;
+	const bool highTier = (profileTierLevel[0] >> 5) & 1;
+	const uint8_t profileIdc = profileTierLevel[0] & 0x1f;
+	uint32_t compatibility = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		compatibility = (compatibility << 8) | profileTierLevel[1 + i];
+	}
+	uint32_t reversed = 0;
+	for (int i = 0; i < 32; i++)
+	{
+		reversed |= ((compatibility >> i) & 1) << (31 - i);
+	}
+	std::string result = "hvc1.";
+	std::snprintf(buffer, sizeof(buffer), "%s%u.%X.%c%u", SPACES[space], profileIdc, reversed, highTier ? 'H' : 'L', profileTierLevel[11]);
+	result += buffer;
+
+	int lastConstraint = 5;
+	while (lastConstraint >= 0 && profileTierLevel[5 + lastConstraint] == 0)
+	{
+		lastConstraint--;
+	}
+	for (int i = 0; i <= lastConstraint; i++)
+	{
+		std::snprintf(buffer, sizeof(buffer), ".%X", profileTierLevel[5 + i]);
+		result += buffer;
+	}
+	return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Letico
+{
+	// The parts of an H.264/H.265 sequence parameter set that containers and manifests need: picture size and
+	// the profile/level fields copied into avcC/hvcC and RFC 6381 codec strings.
+	struct VideoFormat
+	{
+		ins_camera::VideoEncodeType codec = ins_camera::VideoEncodeType::H264;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint8_t chromaFormat = 1;
+		uint8_t bitDepthLuma = 8;
+		uint8_t bitDepthChroma = 8;
+
+		// H.264: profile_idc, constraint_set flags and level_idc.
+		uint8_t profile = 0;
+		uint8_t constraints = 0;
+		uint8_t level = 0;
+
+		// H.265: general_profile_tier_level() as coded (space/tier/profile, 32 compatibility flags, 48 constraint
+		// bits, level_idc) and the temporal layering fields hvcC repeats.
+		uint8_t profileTierLevel[12] = {};
+		uint8_t maxSubLayers = 1;
+		bool temporalIdNested = false;
+
+		// RFC 6381 `codecs` value, e.g. "avc1.64001f" or "hvc1.1.6.L93.B0".
+		std::string codecString() const;
+	};
+
+	class SpsParser
+	{
+	public:
+		// `nal` starts at the NAL header (no start code). Returns false if the SPS is truncated or malformed.
+		static bool parse(ins_camera::VideoEncodeType codec, const uint8_t* nal, size_t size, VideoFormat& format);
+	};
+}
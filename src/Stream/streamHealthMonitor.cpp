@@ -0,0 +1,225 @@
+#include "streamHealthMonitor.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace Letico;
+
+namespace
+{
+	constexpr auto CHECK_INTERVAL = std::chrono::milliseconds(200);
+	constexpr double BITRATE_WINDOW_SECONDS = 1.0;
+
+	template <typename TimePoint>
+	double secondsBetween(TimePoint from, TimePoint to)
+	{
+		return std::chrono::duration<double>(to - from).count();
+	}
+}
+
+StreamHealthMonitor::StreamHealthMonitor(Config config, std::function<bool()> restart):
+	mConfig(config),
+	mRestart(std::move(restart))
+{
+	mWatchThread = std::thread(&StreamHealthMonitor::watchLoop, this);
+}
+
+StreamHealthMonitor::~StreamHealthMonitor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+	}
+	mWake.notify_all();
+	mWatchThread.join();
+}
+
+void StreamHealthMonitor::arm()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mRestartDone.wait(lock, [this] { return mState != State::Restarting; });
+	const auto now = Clock::now();
+	mState = State::Starting;
+	mArmedAt = now;
+	mFrameSinceArm = false;
+	mStalledAt = Clock::time_point();
+	mNextAttempt = now;
+	mBackoffSeconds = mConfig.initialBackoffSeconds;
+	mStreams.clear();
+	mStats.audioFrames = 0;
+}
+
+void StreamHealthMonitor::disarm()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mRestartDone.wait(lock, [this] { return mState != State::Restarting; });
+	mState = State::Idle;
+	mStalledAt = Clock::time_point();
+}
+
+void StreamHealthMonitor::setAutoRestart(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mConfig.autoRestart = enabled;
+}
+
+void StreamHealthMonitor::onVideoFrame(const FramePtr& frame)
+{
+	const auto now = Clock::now();
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto& stream = mStreams[frame->streamIndex];
+	auto& stats = stream.stats;
+	stats.streamIndex = frame->streamIndex;
+	stats.frames++;
+	stats.bytes += frame->size();
+
+	if (stream.windowBytes == 0 && stream.windowStart == Clock::time_point())
+		stream.windowStart = now;
+	stream.windowBytes += frame->size();
+	const double window = secondsBetween(stream.windowStart, now);
+	if (window >= BITRATE_WINDOW_SECONDS)
+	{
+		stats.bitrateKbps = static_cast<double>(stream.windowBytes) * 8.0 / 1000.0 / window;
+		stream.windowStart = now;
+		stream.windowBytes = 0;
+	}
+
+	if (stream.haveTimestamp)
+	{
+		const int64_t step = frame->timestamp - stream.lastTimestamp;
+		if (step < 0 || static_cast<double>(step) * 1000.0 / TIMESTAMP_HZ > mConfig.gapMs)
+		{
+			stats.discontinuities++;
+		}
+		else
+		{
+			stats.lastIntervalMs = static_cast<double>(step) * 1000.0 / TIMESTAMP_HZ;
+			stats.maxIntervalMs = std::max(stats.maxIntervalMs, stats.lastIntervalMs);
+			stream.intervalTotalMs += stats.lastIntervalMs;
+			stream.intervals++;
+			stats.averageIntervalMs = stream.intervalTotalMs / static_cast<double>(stream.intervals);
+		}
+	}
+	stream.lastTimestamp = frame->timestamp;
+	stream.haveTimestamp = true;
+	stream.lastArrival = now;
+	mLastFrame = now;
+
+	if (mState == State::Starting || mState == State::Stalled)
+	{
+		if (mStalledAt != Clock::time_point())
+		{
+			mStats.lastStallSeconds = secondsBetween(mStalledAt, now);
+			mStalledAt = Clock::time_point();
+		}
+		mState = State::Healthy;
+	}
+	mFrameSinceArm = true;
+}
+
+void StreamHealthMonitor::onAudioFrame(const FramePtr&)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.audioFrames++;
+}
+
+StreamHealthMonitor::Stats StreamHealthMonitor::getStats() const
+{
+	const auto now = Clock::now();
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats = mStats;
+	stats.state = mState;
+	stats.autoRestart = mConfig.autoRestart;
+	stats.backoffSeconds = mState == State::Idle ? 0.0 : std::max(secondsBetween(now, mNextAttempt), 0.0);
+	stats.secondsSinceFrame = mLastFrame == Clock::time_point() ? 0.0 : secondsBetween(mLastFrame, now);
+	for (const auto& [streamIndex, stream] : mStreams)
+	{
+		StreamStats streamStats = stream.stats;
+		streamStats.secondsSinceFrame = secondsBetween(stream.lastArrival, now);
+		// The rate of the last window is stale once frames stop arriving.
+		if (streamStats.secondsSinceFrame > 2 * BITRATE_WINDOW_SECONDS)
+			streamStats.bitrateKbps = 0.0;
+		stats.streams.push_back(streamStats);
+	}
+	return stats;
+}
+
+const char* StreamHealthMonitor::stateName(State state)
+{
+	switch (state)
+	{
+	case State::Idle:
+		return "idle";
+	case State::Starting:
+		return "starting";
+	case State::Healthy:
+		return "healthy";
+	case State::Stalled:
+		return "stalled";
+	case State::Restarting:
+		return "restarting";
+	}
+	return "unknown";
+}
+
+void StreamHealthMonitor::watchLoop()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mWake.wait_for(lock, CHECK_INTERVAL, [this] { return !mRunning; });
+		if (!mRunning)
+			break;
+		checkLocked(Clock::now(), lock);
+	}
+}
+
+void StreamHealthMonitor::checkLocked(Clock::time_point now, std::unique_lock<std::mutex>& lock)
+{
+	switch (mState)
+	{
+	case State::Idle:
+	case State::Restarting:
+		return;
+	case State::Starting:
+		if (secondsBetween(mArmedAt, now) < mConfig.startupSeconds)
+			return;
+		break;
+	case State::Healthy:
+		if (secondsBetween(mLastFrame, now) < mConfig.stallSeconds)
+		{
+			if (secondsBetween(mArmedAt, now) >= mConfig.healthySeconds)
+				mBackoffSeconds = mConfig.initialBackoffSeconds;
+			return;
+		}
+		break;
+	case State::Stalled:
+		break;
+	}
+
+	if (mStalledAt == Clock::time_point())
+	{
+		mStats.stalls++;
+		mStalledAt = mFrameSinceArm ? mLastFrame : mArmedAt;
+	}
+	mState = State::Stalled;
+	if (!mConfig.autoRestart || now < mNextAttempt)
+		return;
+
+	mState = State::Restarting;
+	lock.unlock();
+	const bool restarted = mRestart();
+	lock.lock();
+	const auto done = Clock::now();
+	if (restarted)
+		mStats.restarts++;
+	else
+		mStats.failedRestarts++;
+	mNextAttempt = done + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(mBackoffSeconds));
+	mBackoffSeconds = std::min(mBackoffSeconds * 2.0, mConfig.maxBackoffSeconds);
+	// A failed start delivers nothing, so there is no startup grace to wait out before the next attempt.
+	mState = restarted ? State::Starting : State::Stalled;
+	mArmedAt = done;
+	mFrameSinceArm = false;
+	mRestartDone.notify_all();
+}
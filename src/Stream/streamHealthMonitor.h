@@ -0,0 +1,132 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "streamTypes.h"
+
+namespace Letico
+{
+	// Watchdog for the live stream. The SDK sometimes stops delivering frames without reporting an error, so the
+	// monitor tracks frame arrival, timestamp intervals and bitrate per stream index and treats `stallSeconds`
+	// without a video frame as a stall. A stall is answered with the `restart` action (stop + start the camera
+	// stream); failed or unsuccessful restarts are retried with exponential backoff, which resets once frames
+	// have flowed for `healthySeconds`.
+	//
+	// Frames are accounted on the delegate consumer thread; the watchdog and the restart action, which makes SDK
+	// calls that can take seconds, run on the monitor's own thread.
+	class StreamHealthMonitor : public StreamSink
+	{
+	public:
+		struct Config
+		{
+			bool autoRestart = true;  // false: stalls are only counted
+			double stallSeconds = 3.0;
+			double startupSeconds = 10.0;  // grace period for the first frame after a (re)start
+			double gapMs = 500.0;		   // a timestamp step longer than this counts as a discontinuity
+			double initialBackoffSeconds = 2.0;
+			double maxBackoffSeconds = 60.0;
+			double healthySeconds = 30.0;
+		};
+
+		enum class State
+		{
+			Idle,  // not armed: no live stream
+			Starting,
+			Healthy,
+			Stalled,
+			Restarting
+		};
+
+		struct StreamStats
+		{
+			int streamIndex = 0;
+			uint64_t frames = 0;
+			uint64_t bytes = 0;
+			double bitrateKbps = 0.0;  // over the last second of arrivals
+			double lastIntervalMs = 0.0;  // timestamp step between consecutive frames
+			double averageIntervalMs = 0.0;
+			double maxIntervalMs = 0.0;
+			uint64_t discontinuities = 0;  // timestamp went backwards or jumped by more than gapMs
+			double secondsSinceFrame = 0.0;
+		};
+
+		struct Stats
+		{
+			State state = State::Idle;
+			bool autoRestart = false;
+			uint64_t stalls = 0;
+			uint64_t restarts = 0;
+			uint64_t failedRestarts = 0;
+			double backoffSeconds = 0.0;  // wait before the next restart attempt
+			double lastStallSeconds = 0.0;	// how long the last stall lasted until frames came back
+			double secondsSinceFrame = 0.0;
+			uint64_t audioFrames = 0;
+			std::vector<StreamStats> streams;  // video, by stream index
+		};
+
+		// `restart` returns false if the camera stream could not be started again.
+		StreamHealthMonitor(Config config, std::function<bool()> restart);
+		~StreamHealthMonitor();
+		StreamHealthMonitor(const StreamHealthMonitor&) = delete;
+		StreamHealthMonitor& operator=(const StreamHealthMonitor&) = delete;
+
+		// Live stream started: watch it. Resets the counters of the previous session but not stalls/restarts.
+		void arm();
+		// Live stream stopped on purpose. Waits for a restart in progress, so the caller owns the camera after.
+		void disarm();
+		void setAutoRestart(bool enabled);
+
+		void onVideoFrame(const FramePtr& frame) override;
+		void onAudioFrame(const FramePtr& frame) override;
+
+		Stats getStats() const;
+
+		static const char* stateName(State state);
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct StreamState
+		{
+			StreamStats stats;
+			int64_t lastTimestamp = 0;
+			bool haveTimestamp = false;
+			double intervalTotalMs = 0.0;
+			uint64_t intervals = 0;
+			Clock::time_point lastArrival;
+			Clock::time_point windowStart;
+			uint64_t windowBytes = 0;
+		};
+
+		void watchLoop();
+		void checkLocked(Clock::time_point now, std::unique_lock<std::mutex>& lock);
+
+		Config mConfig;
+		std::function<bool()> mRestart;
+
+		mutable std::mutex mMutex;
+		std::condition_variable mWake;
+		std::condition_variable mRestartDone;
+		bool mRunning = true;
+		std::thread mWatchThread;
+
+		State mState = State::Idle;
+		Clock::time_point mArmedAt;		  // of the current (re)start
+		Clock::time_point mLastFrame;	  // any video stream
+		bool mFrameSinceArm = false;
+		Clock::time_point mStalledAt;
+		Clock::time_point mNextAttempt;
+		double mBackoffSeconds = 0.0;
+		std::map<int, StreamState> mStreams;
+		Stats mStats;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <camera/ins_types.h>
+#include <stream/stream_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Letico
+{
+	// SDK stream timestamps are in milliseconds.
+	constexpr int64_t TIMESTAMP_HZ = 1000;
+	constexpr int64_t MPEG_CLOCK_HZ = 90000;
+	// Frames of the camera's low-resolution (LRV) stream are renumbered from this stream index up, so consumers that
+	// select by stream index never mix them with the main stream.
+	constexpr int LRV_STREAM_INDEX = 8;
+
+	enum class FrameKind : uint8_t
+	{
+		Video,
+		Audio
+	};
+
+	// One encoded access unit copied out of the SDK callback. Frames are immutable once published so a single
+	// instance can be shared by every consumer.
+	struct EncodedFrame
+	{
+		FrameKind kind = FrameKind::Video;
+		int64_t timestamp = 0;
+		uint8_t streamType = 0;
+		int streamIndex = 0;
+		std::vector<uint8_t> payload;
+
+		const uint8_t* data() const { return payload.data(); }
+		size_t size() const { return payload.size(); }
+	};
+
+	using FramePtr = std::shared_ptr<const EncodedFrame>;
+
+	// Consumer side of the stream pipeline. All callbacks run on the delegate consumer thread, never on the SDK
+	// callback thread, so implementations may take locks but should not block for long.
+	class StreamSink
+	{
+	public:
+		virtual ~StreamSink() = default;
+
+		virtual void onVideoFrame(const FramePtr&) {}
+		virtual void onAudioFrame(const FramePtr&) {}
+		virtual void onGyroData(const ins_camera::GyroData*, size_t) {}
+		virtual void onExposureData(const ins_camera::ExposureData&) {}
+	};
+}
@@ -0,0 +1,265 @@
+#include "tsMuxer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "nalParser.h"
+
+using namespace Letico;
+
+namespace
+{
+	constexpr uint8_t SYNC_BYTE = 0x47;
+	constexpr uint8_t STREAM_TYPE_H264 = 0x1b;
+	constexpr uint8_t STREAM_TYPE_H265 = 0x24;
+	constexpr uint8_t STREAM_TYPE_AAC_ADTS = 0x0f;
+	constexpr uint8_t STREAM_ID_VIDEO = 0xe0;
+	constexpr uint8_t STREAM_ID_AUDIO = 0xc0;
+	constexpr int64_t PTS_MASK = (int64_t(1) << 33) - 1;
+	// PCR runs slightly ahead of the presentation clock so decoders never see a frame that is already late.
+	constexpr int64_t PCR_DELAY = 9000;
+
+	const uint8_t H264_AUD[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xf0};
+	const uint8_t H265_AUD[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50};
+
+	std::array<uint32_t, 256> makeCrcTable()
+	{
+		std::array<uint32_t, 256> table{};
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t crc = i << 24;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+			}
+			table[i] = crc;
+		}
+		return table;
+	}
+
+	void writeTimestamp(uint8_t* out, uint8_t marker, int64_t ts)
+	{
+		ts &= PTS_MASK;
+		out[0] = static_cast<uint8_t>(marker | ((ts >> 29) & 0x0e) | 0x01);
+		out[1] = static_cast<uint8_t>(ts >> 22);
+		out[2] = static_cast<uint8_t>(((ts >> 14) & 0xfe) | 0x01);
+		out[3] = static_cast<uint8_t>(ts >> 7);
+		out[4] = static_cast<uint8_t>(((ts << 1) & 0xfe) | 0x01);
+	}
+
+	void writePcr(uint8_t* out, int64_t base)
+	{
+		base &= PTS_MASK;
+		out[0] = static_cast<uint8_t>(base >> 25);
+		out[1] = static_cast<uint8_t>(base >> 17);
+		out[2] = static_cast<uint8_t>(base >> 9);
+		out[3] = static_cast<uint8_t>(base >> 1);
+		out[4] = static_cast<uint8_t>(((base & 1) << 7) | 0x7e);
+		out[5] = 0x00;
+	}
+}
+
+TsMuxer::TsMuxer(ins_camera::VideoEncodeType codec): mCodec(codec)
+{
+}
+
+uint32_t TsMuxer::crc32(const uint8_t* data, size_t size)
+{
+	static const std::array<uint32_t, 256> TABLE = makeCrcTable();
+	uint32_t crc = 0xffffffff;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = (crc << 8) ^ TABLE[((crc >> 24) ^ data[i]) & 0xff];
+	}
+	return crc;
+}
+
+void TsMuxer::writeTables(std::string& out)
+{
+	const uint8_t pat[] = {
+		0x00,  // table_id
+		0xb0,
+		13,	 // section_length
+		0x00,
+		0x01,  // transport_stream_id
+		0xc1,  // version 0, current_next_indicator
+		0x00,
+		0x00,
+		0x00,
+		0x01,  // program_number
+		static_cast<uint8_t>(0xe0 | (PMT_PID >> 8)),
+		static_cast<uint8_t>(PMT_PID & 0xff)};
+	writeSection(out, PAT_PID, pat, sizeof(pat));
+
+	const uint8_t streamType = mCodec == ins_camera::VideoEncodeType::H265 ? STREAM_TYPE_H265 : STREAM_TYPE_H264;
+	const uint8_t pmt[] = {
+		0x02,  // table_id
+		0xb0,
+		static_cast<uint8_t>(9 + 5 + (mAudio ? 5 : 0) + 4),	 // section_length
+		0x00,
+		0x01,  // program_number
+		0xc1,
+		0x00,
+		0x00,
+		static_cast<uint8_t>(0xe0 | (VIDEO_PID >> 8)),	// PCR_PID
+		static_cast<uint8_t>(VIDEO_PID & 0xff),
+		0xf0,
+		0x00,  // program_info_length
+		streamType,
+		static_cast<uint8_t>(0xe0 | (VIDEO_PID >> 8)),
+		static_cast<uint8_t>(VIDEO_PID & 0xff),
+		0xf0,
+		0x00,  // ES_info_length
+		STREAM_TYPE_AAC_ADTS,
+		static_cast<uint8_t>(0xe0 | (AUDIO_PID >> 8)),
+		static_cast<uint8_t>(AUDIO_PID & 0xff),
+		0xf0,
+		0x00};
+	// The audio entry is left out of the section (and so of the CRC) when there is no audio.
+	const size_t pmtSize = mAudio ? sizeof(pmt) : sizeof(pmt) - 5;
+	writeSection(out, PMT_PID, pmt, pmtSize);
+}
+
+void TsMuxer::writeVideo(std::string& out, const uint8_t* data, size_t size, int64_t pts, bool keyframe)
+{
+	// HLS players expect every access unit to start with an AUD; the camera does not always send one.
+	const uint8_t* prefix = nullptr;
+	size_t prefixSize = 0;
+	const uint8_t* first = NalParser::findStartCode(data, data + size);
+	const bool hasAud = first + 3 < data + size && NalParser::isAccessUnitDelimiter(mCodec, NalParser::nalType(mCodec, first + 3));
+	if (!hasAud)
+	{
+		prefix = mCodec == ins_camera::VideoEncodeType::H265 ? H265_AUD : H264_AUD;
+		prefixSize = mCodec == ins_camera::VideoEncodeType::H265 ? sizeof(H265_AUD) : sizeof(H264_AUD);
+	}
+	writePes(out, VIDEO_PID, STREAM_ID_VIDEO, prefix, prefixSize, data, size, pts, keyframe, true);
+}
+
+void TsMuxer::writeAudio(std::string& out, const uint8_t* data, size_t size, int64_t pts)
+{
+	// Every ADTS frame decodes on its own; the flag lets players start on any audio packet.
+	writePes(out, AUDIO_PID, STREAM_ID_AUDIO, nullptr, 0, data, size, pts, true, false);
+}
+
+void TsMuxer::writePes(
+	std::string& out,
+	uint16_t pid,
+	uint8_t streamId,
+	const uint8_t* prefix,
+	size_t prefixSize,
+	const uint8_t* body,
+	size_t bodySize,
+	int64_t pts,
+	bool randomAccess,
+	bool withPcr
+)
+{
+	uint8_t pesHeader[14] = {0x00, 0x00, 0x01, streamId, 0x00, 0x00, 0x80, 0x80, 0x05};
+	writeTimestamp(pesHeader + 9, 0x20, pts);
+	const size_t pesPayload = 8 + prefixSize + bodySize;  // everything after PES_packet_length
+	if (streamId != STREAM_ID_VIDEO && pesPayload <= 0xffff)
+	{
+		pesHeader[4] = static_cast<uint8_t>(pesPayload >> 8);
+		pesHeader[5] = static_cast<uint8_t>(pesPayload & 0xff);
+	}
+
+	// The PES is the concatenation of three spans; `take` copies the next n bytes of it.
+	const uint8_t* spans[3] = {pesHeader, prefix, body};
+	size_t sizes[3] = {sizeof(pesHeader), prefixSize, bodySize};
+	int span = 0;
+	size_t spanOffset = 0;
+	auto take = [&](uint8_t* dst, size_t n)
+	{
+		while (n > 0)
+		{
+			const size_t chunk = std::min(n, sizes[span] - spanOffset);
+			if (chunk != 0)
+			{
+				std::memcpy(dst, spans[span] + spanOffset, chunk);
+			}
+			dst += chunk;
+			n -= chunk;
+			spanOffset += chunk;
+			if (spanOffset == sizes[span])
+			{
+				span++;
+				spanOffset = 0;
+			}
+		}
+	};
+
+	size_t remaining = sizeof(pesHeader) + prefixSize + bodySize;
+	bool first = true;
+	out.reserve(out.size() + (remaining / 184 + 1) * PACKET_SIZE);
+	while (remaining > 0)
+	{
+		uint8_t packet[PACKET_SIZE];
+		packet[0] = SYNC_BYTE;
+		packet[1] = static_cast<uint8_t>((first ? 0x40 : 0x00) | (pid >> 8));
+		packet[2] = static_cast<uint8_t>(pid & 0xff);
+
+		const bool pcr = first && withPcr;
+		const bool flags = first && (withPcr || randomAccess);
+		size_t adaptation = flags ? 2 + (pcr ? 6 : 0) : 0;	// including the length byte
+		if (remaining < PACKET_SIZE - 4 - adaptation)
+		{
+			adaptation = PACKET_SIZE - 4 - remaining;  // stuffing
+		}
+
+		packet[3] = static_cast<uint8_t>((adaptation != 0 ? 0x30 : 0x10) | nextContinuity(pid));
+		if (adaptation != 0)
+		{
+			packet[4] = static_cast<uint8_t>(adaptation - 1);
+			if (adaptation > 1)
+			{
+				packet[5] = static_cast<uint8_t>((randomAccess && first ? 0x40 : 0x00) | (pcr ? 0x10 : 0x00));
+				size_t used = 2;
+				if (pcr)
+				{
+					writePcr(packet + 6, std::max<int64_t>(0, pts - PCR_DELAY));
+					used += 6;
+				}
+				std::memset(packet + 4 + used, 0xff, adaptation - used);
+			}
+		}
+
+		const size_t payload = PACKET_SIZE - 4 - adaptation;
+		take(packet + 4 + adaptation, payload);
+		out.append(reinterpret_cast<const char*>(packet), PACKET_SIZE);
+		remaining -= payload;
+		first = false;
+	}
+}
+
+void TsMuxer::writeSection(std::string& out, uint16_t pid, const uint8_t* section, size_t size)
+{
+	uint8_t packet[PACKET_SIZE];
+	std::memset(packet, 0xff, sizeof(packet));
+	packet[0] = SYNC_BYTE;
+	packet[1] = static_cast<uint8_t>(0x40 | (pid >> 8));
+	packet[2] = static_cast<uint8_t>(pid & 0xff);
+	packet[3] = static_cast<uint8_t>(0x10 | nextContinuity(pid));
+	packet[4] = 0x00;  // pointer_field
+	std::memcpy(packet + 5, section, size);
+	const uint32_t crc = crc32(section, size);
+	packet[5 + size] = static_cast<uint8_t>(crc >> 24);
+	packet[6 + size] = static_cast<uint8_t>(crc >> 16);
+	packet[7 + size] = static_cast<uint8_t>(crc >> 8);
+	packet[8 + size] = static_cast<uint8_t>(crc);
+	out.append(reinterpret_cast<const char*>(packet), PACKET_SIZE);
+}
+
+uint8_t TsMuxer::nextContinuity(uint16_t pid)
+{
+	uint8_t* counter = &mVideoContinuity;
+	if (pid == PAT_PID)
+		counter = &mPatContinuity;
+	else if (pid == PMT_PID)
+		counter = &mPmtContinuity;
+	else if (pid == AUDIO_PID)
+		counter = &mAudioContinuity;
+	const uint8_t value = *counter;
+	*counter = (*counter + 1) & 0x0f;
+	return value;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <camera/ins_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Letico
+{
+	// Minimal MPEG-TS packetizer for one program with an H.264/H.265 elementary stream and, optionally, an ADTS AAC
+	// one. Output is appended to a caller owned buffer so segmenters can build whole segments without intermediate
+	// copies.
+	class TsMuxer
+	{
+	public:
+		static constexpr size_t PACKET_SIZE = 188;
+		static constexpr uint16_t PAT_PID = 0x0000;
+		static constexpr uint16_t PMT_PID = 0x1000;
+		static constexpr uint16_t VIDEO_PID = 0x0100;
+		static constexpr uint16_t AUDIO_PID = 0x0101;
+
+		explicit TsMuxer(ins_camera::VideoEncodeType codec = ins_camera::VideoEncodeType::H264);
+
+		void setCodec(ins_camera::VideoEncodeType codec) { mCodec = codec; }
+		ins_camera::VideoEncodeType codec() const { return mCodec; }
+		// Lists the audio stream in the PMT; takes effect with the next writeTables().
+		void setAudio(bool enabled) { mAudio = enabled; }
+		bool audio() const { return mAudio; }
+
+		// PAT + PMT; every segment has to start with them.
+		void writeTables(std::string& out);
+
+		// One access unit as a PES packet. `pts` is in 90 kHz units; keyframes get random_access_indicator set.
+		void writeVideo(std::string& out, const uint8_t* data, size_t size, int64_t pts, bool keyframe);
+		// One or more ADTS frames as a PES packet, `pts` in 90 kHz units.
+		void writeAudio(std::string& out, const uint8_t* data, size_t size, int64_t pts);
+
+		static uint32_t crc32(const uint8_t* data, size_t size);
+
+	private:
+		void writePes(
+			std::string& out,
+			uint16_t pid,
+			uint8_t streamId,
+			const uint8_t* prefix,
+			size_t prefixSize,
+			const uint8_t* body,
+			size_t bodySize,
+			int64_t pts,
+			bool randomAccess,
+			bool withPcr
+		);
+		void writeSection(std::string& out, uint16_t pid, const uint8_t* section, size_t size);
+		uint8_t nextContinuity(uint16_t pid);
+
+		ins_camera::VideoEncodeType mCodec;
+		uint8_t mPatContinuity = 0;
+		uint8_t mPmtContinuity = 0;
+		uint8_t mVideoContinuity = 0;
+		uint8_t mAudioContinuity = 0;
+		bool mAudio = false;
+	};
+}
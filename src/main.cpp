@@ -2,6 +2,7 @@
 #include "HttpServer/httpServer.h"
 #include "LeticoCamera/leticoCamera.h"
 #include "Menu/menu.h"
+#include "RtspServer/rtspServer.h"
 
 
 int main()
@@ -9,6 +10,7 @@ int main()
 	std::shared_ptr<LeticoCamera> camera = std::make_shared<LeticoCamera>();
 
 	Letico::LeticoHttpServer http({camera});
+	Letico::LeticoRtspServer rtsp({camera->getGopCache()});
 
 	Menu menu({camera});
 	menu.showOptions();
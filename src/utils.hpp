@@ -1,7 +1,10 @@
 #pragma once
+#include <chrono>
 #include <cstdlib> 
+#include <ctime>
 #include <filesystem>
 #include <iostream> 
+#include <string>
 
 class Utils
 {
@@ -24,6 +27,18 @@ public:
         std::cout << savePath;
 		return savePath;
 	}
+
+	// Local time as YYYYMMDD_HHMMSS, for file names. localtime_r, since recorders name their files from their own
+	// threads.
+	static std::string fileTimestamp()
+	{
+		const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		std::tm local{};
+		localtime_r(&now, &local);
+		char stamp[32];
+		std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+		return stamp;
+	}
 private:
     inline static const std::string SAVE_DIR = "insta360Downloads/";
 };
\ No newline at end of file
@@ -0,0 +1,619 @@
+// Minimal RTSP/RTP client for exercising LeticoRtspServer.
+//
+//   rtspLoopbackClient [--udp|--tcp] [--seconds N] [--clients N] [--h265] [--out file] [rtsp://host:port/camera0/stream0]
+//
+// With a URL it plays that stream, depacketizes it and reports packet loss, access units and RTCP sender reports;
+// --out writes the received Annex-B stream to a file for inspection with ffplay. Without a URL it runs a self-test:
+// a server on a free loopback port is fed synthetic frames and every client verifies that each access unit it
+// reassembles is byte-identical to one that was sent, in order, starting at a keyframe.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/RtspServer/rtspServer.h"
+
+using namespace Letico;
+
+namespace
+{
+	const uint8_t START_CODE[] = {0x00, 0x00, 0x00, 0x01};
+
+	uint64_t fnv1a(const uint8_t* data, size_t size)
+	{
+		uint64_t hash = 1469598103934665603ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	struct ClientStats
+	{
+		uint64_t packets = 0;
+		uint64_t lost = 0;
+		uint64_t accessUnits = 0;
+		uint64_t bytes = 0;
+		uint64_t senderReports = 0;
+		uint64_t timestampRegressions = 0;
+		// Self-test only.
+		uint64_t unknownUnits = 0;
+		uint64_t outOfOrderUnits = 0;
+		uint64_t skippedUnits = 0;
+		bool startedOnKeyframe = false;
+	};
+
+	// Reassembles access units from RTP payloads (RFC 6184 / RFC 7798: single NAL, aggregation and fragmentation
+	// units). Every NAL unit is written with a four-byte start code.
+	class Depacketizer
+	{
+	public:
+		explicit Depacketizer(bool h265): mH265(h265) {}
+
+		// Returns true when `marker` completed an access unit, which is then available in `unit()`.
+		bool push(const uint8_t* payload, size_t size, bool marker)
+		{
+			const size_t headerSize = mH265 ? 2 : 1;
+			if (size > headerSize)
+			{
+				const uint8_t type = mH265 ? (payload[0] >> 1) & 0x3f : payload[0] & 0x1f;
+				const uint8_t fragmentType = mH265 ? 49 : 28;
+				const uint8_t aggregateType = mH265 ? 48 : 24;
+				if (type == fragmentType && size > headerSize + 1)
+				{
+					const uint8_t fuHeader = payload[headerSize];
+					if (fuHeader & 0x80)
+					{
+						appendStartCode();
+						if (mH265)
+						{
+							mUnit.push_back(static_cast<uint8_t>((payload[0] & 0x81) | ((fuHeader & 0x3f) << 1)));
+							mUnit.push_back(payload[1]);
+						}
+						else
+						{
+							mUnit.push_back(static_cast<uint8_t>((payload[0] & 0xe0) | (fuHeader & 0x1f)));
+						}
+					}
+					mUnit.insert(mUnit.end(), payload + headerSize + 1, payload + size);
+				}
+				else if (type == aggregateType)
+				{
+					size_t offset = headerSize;
+					while (offset + 2 <= size)
+					{
+						const size_t length = (payload[offset] << 8) | payload[offset + 1];
+						offset += 2;
+						if (offset + length > size)
+							break;
+						appendStartCode();
+						mUnit.insert(mUnit.end(), payload + offset, payload + offset + length);
+						offset += length;
+					}
+				}
+				else
+				{
+					appendStartCode();
+					mUnit.insert(mUnit.end(), payload, payload + size);
+				}
+			}
+			return marker && !mUnit.empty();
+		}
+
+		const std::vector<uint8_t>& unit() const { return mUnit; }
+		void reset() { mUnit.clear(); }
+
+	private:
+		void appendStartCode() { mUnit.insert(mUnit.end(), std::begin(START_CODE), std::end(START_CODE)); }
+
+		bool mH265;
+		std::vector<uint8_t> mUnit;
+	};
+
+	// Frames sent by the self-test source, by content hash.
+	struct SentFrames
+	{
+		std::mutex mutex;
+		std::unordered_map<uint64_t, std::pair<uint64_t, bool>> index;	// hash -> (frame number, keyframe)
+	};
+
+	class RtspClient
+	{
+	public:
+		RtspClient(std::string url, bool tcp, SentFrames* sent): mUrl(std::move(url)), mTcp(tcp), mSent(sent) {}
+
+		~RtspClient()
+		{
+			if (mSocket >= 0)
+				::close(mSocket);
+			if (mRtpSocket >= 0)
+				::close(mRtpSocket);
+			if (mRtcpSocket >= 0)
+				::close(mRtcpSocket);
+		}
+
+		bool run(std::chrono::seconds duration, const std::string& outPath)
+		{
+			if (!connectControl())
+				return false;
+			if (!request("OPTIONS", mUrl, ""))
+				return false;
+			std::string sdp;
+			if (!request("DESCRIBE", mUrl, "Accept: application/sdp\r\n", &sdp))
+				return false;
+			mH265 = sdp.find("H265/90000") != std::string::npos;
+
+			std::string transport;
+			if (mTcp)
+			{
+				transport = "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n";
+			}
+			else
+			{
+				if (!openUdp())
+					return false;
+				transport = "Transport: RTP/AVP;unicast;client_port=" + std::to_string(mRtpPort) + "-" + std::to_string(mRtpPort + 1) + "\r\n";
+			}
+			std::map<std::string, std::string> headers;
+			if (!request("SETUP", mUrl + "/trackID=0", transport, nullptr, &headers))
+				return false;
+			mSession = headers["session"].substr(0, headers["session"].find(';'));
+			if (!request("PLAY", mUrl, "Session: " + mSession + "\r\nRange: npt=0.000-\r\n"))
+				return false;
+
+			if (!outPath.empty())
+				mOut.open(outPath, std::ios::binary);
+			Depacketizer depacketizer(mH265);
+			const auto end = std::chrono::steady_clock::now() + duration;
+			while (std::chrono::steady_clock::now() < end)
+			{
+				if (!receive(depacketizer))
+					break;
+			}
+			sendRequest("TEARDOWN", mUrl, "Session: " + mSession + "\r\n");
+			return true;
+		}
+
+		const ClientStats& stats() const { return mStats; }
+		const std::string& error() const { return mError; }
+
+	private:
+		bool connectControl()
+		{
+			char host[256] = {};
+			int port = 554;
+			if (std::sscanf(mUrl.c_str(), "rtsp://%255[^:/]:%d", host, &port) < 1)
+				return fail("bad url " + mUrl);
+			mSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(static_cast<uint16_t>(port));
+			if (std::strcmp(host, "localhost") == 0)
+				std::strcpy(host, "127.0.0.1");
+			if (::inet_pton(AF_INET, host, &address.sin_addr) != 1 ||
+				::connect(mSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+				return fail("unable to connect to " + mUrl);
+			mServer = address;
+			return true;
+		}
+
+		bool openUdp()
+		{
+			for (int attempt = 0; attempt < 16; attempt++)
+			{
+				mRtpSocket = ::socket(AF_INET, SOCK_DGRAM, 0);
+				sockaddr_in address{};
+				address.sin_family = AF_INET;
+				socklen_t length = sizeof(address);
+				::bind(mRtpSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+				::getsockname(mRtpSocket, reinterpret_cast<sockaddr*>(&address), &length);
+				mRtpPort = ntohs(address.sin_port);
+				mRtcpSocket = ::socket(AF_INET, SOCK_DGRAM, 0);
+				address.sin_port = htons(static_cast<uint16_t>(mRtpPort + 1));
+				if (::bind(mRtcpSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+				{
+					const int buffer = 4 * 1024 * 1024;
+					::setsockopt(mRtpSocket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+					return true;
+				}
+				::close(mRtpSocket);
+				::close(mRtcpSocket);
+				mRtpSocket = mRtcpSocket = -1;
+			}
+			return fail("unable to bind UDP ports");
+		}
+
+		bool sendRequest(const std::string& method, const std::string& url, const std::string& headers)
+		{
+			const std::string text = method + " " + url + " RTSP/1.0\r\nCSeq: " + std::to_string(++mCseq) +
+									 "\r\nUser-Agent: rtspLoopbackClient\r\n" + headers + "\r\n";
+			return ::send(mSocket, text.data(), text.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+		}
+
+		bool request(
+			const std::string& method, const std::string& url, const std::string& headers, std::string* body = nullptr,
+			std::map<std::string, std::string>* responseHeaders = nullptr
+		)
+		{
+			if (!sendRequest(method, url, headers))
+				return fail(method + ": send failed");
+			while (true)
+			{
+				const size_t headerEnd = mBuffer.find("\r\n\r\n");
+				if (!mBuffer.empty() && mBuffer[0] != '$' && headerEnd != std::string::npos)
+				{
+					std::map<std::string, std::string> parsed;
+					size_t lineStart = mBuffer.find("\r\n") + 2;
+					while (lineStart < headerEnd)
+					{
+						const size_t lineEnd = mBuffer.find("\r\n", lineStart);
+						const std::string line = mBuffer.substr(lineStart, lineEnd - lineStart);
+						const size_t colon = line.find(':');
+						if (colon != std::string::npos)
+						{
+							std::string name = line.substr(0, colon);
+							for (auto& c : name)
+								c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+							parsed[name] = line.substr(line.find_first_not_of(' ', colon + 1));
+						}
+						lineStart = lineEnd + 2;
+					}
+					const size_t contentLength = parsed.count("content-length") ? std::stoul(parsed["content-length"]) : 0;
+					if (mBuffer.size() >= headerEnd + 4 + contentLength)
+					{
+						const bool ok = mBuffer.compare(0, 12, "RTSP/1.0 200") == 0;
+						const std::string status = mBuffer.substr(0, mBuffer.find("\r\n"));
+						if (body)
+							*body = mBuffer.substr(headerEnd + 4, contentLength);
+						if (responseHeaders)
+							*responseHeaders = parsed;
+						mBuffer.erase(0, headerEnd + 4 + contentLength);
+						return ok || fail(method + ": " + status);
+					}
+				}
+				char chunk[4096];
+				const ssize_t received = ::recv(mSocket, chunk, sizeof(chunk), 0);
+				if (received <= 0)
+					return fail(method + ": connection closed");
+				mBuffer.append(chunk, received);
+			}
+		}
+
+		bool receive(Depacketizer& depacketizer)
+		{
+			if (mTcp)
+			{
+				while (mBuffer.size() >= 4 && mBuffer[0] == '$')
+				{
+					const size_t length = (static_cast<uint8_t>(mBuffer[2]) << 8) | static_cast<uint8_t>(mBuffer[3]);
+					if (mBuffer.size() < 4 + length)
+						break;
+					const auto* packet = reinterpret_cast<const uint8_t*>(mBuffer.data() + 4);
+					if (mBuffer[1] == 0)
+						onRtp(packet, length, depacketizer);
+					else
+						onRtcp(packet, length);
+					mBuffer.erase(0, 4 + length);
+				}
+				if (!mBuffer.empty() && mBuffer[0] != '$')
+				{
+					// A stray RTSP response (e.g. to a keep-alive); drop it.
+					const size_t end = mBuffer.find("\r\n\r\n");
+					if (end != std::string::npos)
+						mBuffer.erase(0, end + 4);
+				}
+				pollfd descriptor{mSocket, POLLIN, 0};
+				if (::poll(&descriptor, 1, 200) <= 0)
+					return true;
+				char chunk[65536];
+				const ssize_t received = ::recv(mSocket, chunk, sizeof(chunk), 0);
+				if (received <= 0)
+					return fail("connection closed while playing");
+				mBuffer.append(chunk, received);
+				return true;
+			}
+
+			pollfd descriptors[2] = {{mRtpSocket, POLLIN, 0}, {mRtcpSocket, POLLIN, 0}};
+			if (::poll(descriptors, 2, 200) <= 0)
+				return true;
+			uint8_t packet[65536];
+			if (descriptors[0].revents & POLLIN)
+			{
+				const ssize_t received = ::recv(mRtpSocket, packet, sizeof(packet), 0);
+				if (received > 0)
+					onRtp(packet, received, depacketizer);
+			}
+			if (descriptors[1].revents & POLLIN)
+			{
+				const ssize_t received = ::recv(mRtcpSocket, packet, sizeof(packet), 0);
+				if (received > 0)
+					onRtcp(packet, received);
+			}
+			return true;
+		}
+
+		void onRtp(const uint8_t* packet, size_t size, Depacketizer& depacketizer)
+		{
+			if (size < 12 || (packet[0] >> 6) != 2)
+				return;
+			const size_t headerSize = 12 + (packet[0] & 0x0f) * 4;
+			if (size < headerSize)
+				return;
+			const bool marker = packet[1] & 0x80;
+			const uint16_t sequence = static_cast<uint16_t>((packet[2] << 8) | packet[3]);
+			const uint32_t timestamp = (packet[4] << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+
+			if (mStats.packets != 0 && sequence != static_cast<uint16_t>(mLastSequence + 1))
+			{
+				mStats.lost += static_cast<uint16_t>(sequence - mLastSequence - 1);
+				depacketizer.reset();  // the unit in progress is incomplete
+			}
+			if (mStats.packets != 0 && static_cast<int32_t>(timestamp - mLastTimestamp) < 0)
+				mStats.timestampRegressions++;
+			mLastSequence = sequence;
+			mLastTimestamp = timestamp;
+			mStats.packets++;
+
+			if (depacketizer.push(packet + headerSize, size - headerSize, marker))
+			{
+				onAccessUnit(depacketizer.unit());
+				depacketizer.reset();
+			}
+		}
+
+		void onRtcp(const uint8_t* packet, size_t size)
+		{
+			if (size >= 28 && packet[1] == 200)
+				mStats.senderReports++;
+		}
+
+		void onAccessUnit(const std::vector<uint8_t>& unit)
+		{
+			mStats.accessUnits++;
+			mStats.bytes += unit.size();
+			if (mOut.is_open())
+				mOut.write(reinterpret_cast<const char*>(unit.data()), unit.size());
+			if (!mSent)
+				return;
+
+			const uint64_t hash = fnv1a(unit.data(), unit.size());
+			std::lock_guard<std::mutex> lock(mSent->mutex);
+			auto it = mSent->index.find(hash);
+			if (it == mSent->index.end())
+			{
+				mStats.unknownUnits++;
+				return;
+			}
+			const auto [number, keyframe] = it->second;
+			if (mStats.accessUnits == 1)
+				mStats.startedOnKeyframe = keyframe;
+			else if (number <= mLastFrameNumber)
+				mStats.outOfOrderUnits++;
+			else
+				mStats.skippedUnits += number - mLastFrameNumber - 1;
+			mLastFrameNumber = number;
+		}
+
+		bool fail(const std::string& message)
+		{
+			mError = message;
+			return false;
+		}
+
+		std::string mUrl;
+		bool mTcp;
+		SentFrames* mSent;
+		bool mH265 = false;
+		int mSocket = -1;
+		int mRtpSocket = -1;
+		int mRtcpSocket = -1;
+		int mRtpPort = 0;
+		sockaddr_in mServer{};
+		int mCseq = 0;
+		std::string mSession;
+		std::string mBuffer;
+		std::ofstream mOut;
+		std::string mError;
+		uint16_t mLastSequence = 0;
+		uint32_t mLastTimestamp = 0;
+		uint64_t mLastFrameNumber = 0;
+		ClientStats mStats;
+	};
+
+	// Synthetic 30 fps stream: parameter sets + IDR every 30 frames, P frames in between. Payload bytes are
+	// non-zero so no accidental start codes appear.
+	void generateFrames(GopCache& cache, SentFrames& sent, bool h265, std::atomic<bool>& running)
+	{
+		std::mt19937 random(7);
+		std::uniform_int_distribution<int> byte(1, 255);
+		auto appendNal = [&](std::vector<uint8_t>& out, uint8_t type, size_t size)
+		{
+			out.insert(out.end(), std::begin(START_CODE), std::end(START_CODE));
+			if (h265)
+			{
+				out.push_back(static_cast<uint8_t>(type << 1));
+				out.push_back(1);
+			}
+			else
+			{
+				out.push_back(static_cast<uint8_t>(0x60 | type));
+			}
+			for (size_t i = 0; i < size; i++)
+				out.push_back(static_cast<uint8_t>(byte(random)));
+		};
+
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t number = 0; running.load(); number++)
+		{
+			const bool keyframe = number % 30 == 0;
+			auto frame = std::make_shared<EncodedFrame>();
+			frame->timestamp = 1000 + static_cast<int64_t>(number * 1000 / 30);
+			if (keyframe)
+			{
+				if (h265)
+					appendNal(frame->payload, NalParser::H265_VPS, 20);
+				appendNal(frame->payload, h265 ? NalParser::H265_SPS : NalParser::H264_SPS, 24);
+				appendNal(frame->payload, h265 ? NalParser::H265_PPS : NalParser::H264_PPS, 4);
+				appendNal(frame->payload, h265 ? 19 : NalParser::H264_IDR, 60000 + random() % 20000);
+			}
+			else
+			{
+				appendNal(frame->payload, 1, 2000 + random() % 10000);
+			}
+			{
+				std::lock_guard<std::mutex> lock(sent.mutex);
+				sent.index[fnv1a(frame->data(), frame->size())] = {number, keyframe};
+			}
+			cache.onVideoFrame(frame);
+			std::this_thread::sleep_until(start + std::chrono::microseconds((number + 1) * 1000000 / 30));
+		}
+	}
+
+	bool printStats(const std::string& name, const RtspClient& client, bool selfTest)
+	{
+		const ClientStats& stats = client.stats();
+		std::printf(
+			"%-8s packets %8lu lost %5lu units %6lu bytes %10lu SR %3lu ts-regressions %lu",
+			name.c_str(),
+			stats.packets,
+			stats.lost,
+			stats.accessUnits,
+			stats.bytes,
+			stats.senderReports,
+			stats.timestampRegressions
+		);
+		if (!client.error().empty())
+			std::printf(" error: %s", client.error().c_str());
+		bool ok = client.error().empty() && stats.accessUnits != 0;
+		if (selfTest)
+		{
+			std::printf(
+				" | keyframe-start %s unknown %lu out-of-order %lu skipped %lu",
+				stats.startedOnKeyframe ? "yes" : "no",
+				stats.unknownUnits,
+				stats.outOfOrderUnits,
+				stats.skippedUnits
+			);
+			ok = ok && stats.startedOnKeyframe && stats.unknownUnits == 0 && stats.outOfOrderUnits == 0 && stats.senderReports != 0;
+		}
+		std::printf(" %s\n", ok ? "OK" : "FAIL");
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string url;
+	std::string outPath;
+	int seconds = 5;
+	int clients = 0;
+	enum class Mode
+	{
+		Mixed,	// self-test default: alternate TCP and UDP clients
+		Tcp,
+		Udp
+	} mode = Mode::Mixed;
+	bool h265 = false;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--udp")
+			mode = Mode::Udp;
+		else if (arg == "--tcp")
+			mode = Mode::Tcp;
+		else if (arg == "--h265")
+			h265 = true;
+		else if (arg == "--seconds" && i + 1 < argc)
+			seconds = std::atoi(argv[++i]);
+		else if (arg == "--clients" && i + 1 < argc)
+			clients = std::atoi(argv[++i]);
+		else if (arg == "--out" && i + 1 < argc)
+			outPath = argv[++i];
+		else if (arg.rfind("rtsp://", 0) == 0)
+			url = arg;
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--udp|--tcp] [--seconds N] [--clients N] [--h265] [--out file] [rtsp://url]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (!url.empty())
+	{
+		const bool tcp = mode != Mode::Udp;
+		RtspClient client(url, tcp, nullptr);
+		client.run(std::chrono::seconds(seconds), outPath);
+		return printStats(tcp ? "tcp" : "udp", client, false) ? 0 : 1;
+	}
+
+	// Self-test: synthetic source, server on a free loopback port, clients on both transports unless one was
+	// forced. Clients join at staggered times so most of them start from the GOP cache.
+	auto cache = std::make_shared<GopCache>(GopCache::Config{});
+	cache->start(h265 ? ins_camera::VideoEncodeType::H265 : ins_camera::VideoEncodeType::H264);
+	SentFrames sent;
+	std::atomic<bool> running{true};
+	std::thread generator([&] { generateFrames(*cache, sent, h265, running); });
+
+	LeticoRtspServer::Config config;
+	config.address = "127.0.0.1";
+	config.port = 0;
+	LeticoRtspServer server({cache}, config);
+	if (!server.isRunning())
+	{
+		running = false;
+		generator.join();
+		return 1;
+	}
+	const std::string serverUrl = "rtsp://127.0.0.1:" + std::to_string(server.port()) + "/camera0/stream0";
+
+	if (clients <= 0)
+		clients = 4;
+	std::vector<std::unique_ptr<RtspClient>> sessions;
+	std::vector<std::string> names;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < clients; i++)
+	{
+		const bool tcp = mode == Mode::Tcp || (mode == Mode::Mixed && i % 2 == 0);
+		sessions.push_back(std::make_unique<RtspClient>(serverUrl, tcp, &sent));
+		names.push_back((tcp ? "tcp" : "udp") + std::to_string(i));
+	}
+	for (int i = 0; i < clients; i++)
+	{
+		threads.emplace_back(
+			[&, i]
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(250 * i));
+				sessions[i]->run(std::chrono::seconds(seconds), "");
+			}
+		);
+	}
+	for (auto& thread : threads)
+		thread.join();
+	running = false;
+	generator.join();
+
+	bool ok = true;
+	for (int i = 0; i < clients; i++)
+	{
+		ok &= printStats(names[i], *sessions[i], true);
+	}
+	std::printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}